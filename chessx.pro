@@ -22,6 +22,8 @@ greaterThan(QT_MAJOR_VERSION, 4) {
   CONFIG += c++17
   # Add lc0 to package
   # CONFIG += lc0
+  # Uncomment to use BMI2 instructions for sliding piece attacks (Intel Haswell, AMD Zen 3 or newer)
+  # CONFIG += bmi2
   DEFINES += USE_C11
   CONFIG += scid
 }
@@ -41,6 +43,10 @@ sound {
   QT += multimedia
 }
 
+bmi2:!win32-msvc* {
+  QMAKE_CXXFLAGS += -mbmi2
+}
+
 DEFINES += QUAZIP_STATIC
 DEFINES += QT_NO_CAST_TO_ASCII
 DEFINES *= QT_USE_QSTRINGBUILDER
@@ -191,6 +197,7 @@ HEADERS += src/database/board.h \
   src/database/datesearch.h \
   src/database/downloadmanager.h \
   src/database/duplicatesearch.h \
+  src/database/ecoclassifier.h \
   src/database/ecoinfo.h \
   src/database/ecopositions.h \
   src/database/editaction.h \
@@ -209,6 +216,8 @@ HEADERS += src/database/board.h \
   src/database/filtersearch.h \
   src/database/gamecursor.h \
   src/database/gameid.h \
+  src/database/gamestatistics.h \
+  src/database/gamestore.h \
   src/database/gameundocommand.h \
   src/database/gamex.h \
   src/database/historylist.h \
@@ -217,8 +226,11 @@ HEADERS += src/database/board.h \
   src/database/lichessopening.h \
   src/database/lichessopeningdatabase.h \
   src/database/lichesstransfer.h \
+  src/database/materialindex.h \
+  src/database/materialsearch.h \
   src/database/memorydatabase.h \
   src/database/move.h \
+  src/database/movecache.h \
   src/database/movedata.h \
   src/database/nag.h \
   src/database/networkhelper.h \
@@ -228,14 +240,18 @@ HEADERS += src/database/board.h \
   src/database/output.h \
   src/database/outputoptions.h \
   src/database/partialdate.h \
+  src/database/patternsearch.h \
   src/database/pdbtest.h \
   src/database/pgndatabase.h \
+  src/database/pgnmoveparser.h \
+  src/database/pgnscanner.h \
   src/database/piece.h \
   src/database/playerdata.h \
   src/database/playerdatabase.h \
   src/database/playerinfo.h \
   src/database/polyglotdatabase.h \
   src/database/polyglotwriter.h \
+  src/database/positionindex.h \
   src/database/positionsearch.h \
   src/database/refcount.h \
   src/database/result.h \
@@ -244,7 +260,9 @@ HEADERS += src/database/board.h \
   src/database/spellchecker.h \
   src/database/square.h \
   src/database/streamdatabase.h \
+  src/database/syzygy.h \
   src/database/tablebase.h \
+  src/database/tagcolumns.h \
   src/database/tags.h \
   src/database/tagsearch.h \
   src/database/telnetclient.h \
@@ -377,6 +395,7 @@ SOURCES += \
   src/database/datesearch.cpp \
   src/database/downloadmanager.cpp \
   src/database/duplicatesearch.cpp \
+  src/database/ecoclassifier.cpp \
   src/database/ecoinfo.cpp \
   src/database/ecopositions.cpp \
   src/database/editaction.cpp \
@@ -392,6 +411,8 @@ SOURCES += \
   src/database/filtermodel.cpp \
   src/database/filtersearch.cpp \
   src/database/gamecursor.cpp \
+  src/database/gamestatistics.cpp \
+  src/database/gamestore.cpp \
   src/database/gamex.cpp \
   src/database/historylist.cpp \
   src/database/index.cpp \
@@ -399,7 +420,10 @@ SOURCES += \
   src/database/lichessopening.cpp \
   src/database/lichessopeningdatabase.cpp \
   src/database/lichesstransfer.cpp \
+  src/database/materialindex.cpp \
+  src/database/materialsearch.cpp \
   src/database/memorydatabase.cpp \
+  src/database/movecache.cpp \
   src/database/movedata.cpp \
   src/database/nag.cpp \
   src/database/networkhelper.cpp \
@@ -409,14 +433,18 @@ SOURCES += \
   src/database/output.cpp \
   src/database/outputoptions.cpp \
   src/database/partialdate.cpp \
+  src/database/patternsearch.cpp \
   src/database/pdbtest.cpp \
   src/database/pgndatabase.cpp \
+  src/database/pgnmoveparser.cpp \
+  src/database/pgnscanner.cpp \
   src/database/piece.cpp \
   src/database/playerdata.cpp \
   src/database/playerdatabase.cpp \
   src/database/playerinfo.cpp \
   src/database/polyglotdatabase.cpp \
   src/database/polyglotwriter.cpp \
+  src/database/positionindex.cpp \
   src/database/positionsearch.cpp \
   src/database/refcount.cpp \
   src/database/result.cpp \
@@ -424,7 +452,9 @@ SOURCES += \
   src/database/settings.cpp \
   src/database/spellchecker.cpp \
   src/database/streamdatabase.cpp \
+  src/database/syzygy.cpp \
   src/database/tablebase.cpp \
+  src/database/tagcolumns.cpp \
   src/database/tags.cpp \
   src/database/tagsearch.cpp \
   src/database/telnetclient.cpp \
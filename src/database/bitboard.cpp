@@ -33,17 +33,15 @@ quint64 bb_PawnF2[2][64];
 quint64 bb_PawnALL[2][64];
 quint64 bb_PromotionRank[2];
 quint64 bb_KnightAttacks[64];
-quint64 bb_R45Attacks[64][64];
-quint64 bb_L45Attacks[64][64];
 quint64 bb_KingAttacks[64];
-quint64 bb_RankAttacks[64][64];
-quint64 bb_FileAttacks[64][64];
+SliderAttacks bb_RookAttacks[64];
+SliderAttacks bb_BishopAttacks[64];
 quint64 bb_fileMask[8];
 quint64 bb_rankMask[8];
 quint64 bb_Mask[64];
-quint64 bb_MaskL90[64];
-quint64 bb_MaskL45[64];
-quint64 bb_MaskR45[64];
+
+// Attack sets of all squares and relevant occupancies, 4096 at most per rook square and 512 per bishop square
+quint64 bb_SliderTable[102400 + 5248];
 
 using namespace chessx;
 
@@ -68,40 +66,46 @@ const quint64 A6 = H5 << 1, B6 = A6 << 1, C6 = B6 << 1, D6 = C6 << 1, E6 = D6 <<
 const quint64 A7 = H6 << 1, B7 = A7 << 1, C7 = B7 << 1, D7 = C7 << 1, E7 = D7 << 1, F7 = E7 << 1, G7 = F7 << 1, H7 = G7 << 1;
 const quint64 A8 = H7 << 1, B8 = A8 << 1, C8 = B8 << 1, D8 = C8 << 1, E8 = D8 << 1, F8 = E8 << 1, G8 = F8 << 1, H8 = G8 << 1;
 
-const unsigned int RotateL90[64] =
-{
-    h1, h2, h3, h4, h5, h6, h7, h8,
-    g1, g2, g3, g4, g5, g6, g7, g8,
-    f1, f2, f3, f4, f5, f6, f7, f8,
-    e1, e2, e3, e4, e5, e6, e7, e8,
-    d1, d2, d3, d4, d5, d6, d7, d8,
-    c1, c2, c3, c4, c5, c6, c7, c8,
-    b1, b2, b3, b4, b5, b6, b7, b8,
-    a1, a2, a3, a4, a5, a6, a7, a8,
+// Magic factors mapping the relevant occupancy of a square to an index of its attack sets,
+// found by trial so that occupancies with different attacks never share an index
+const quint64 RookMagic[64] =
+{
+    Q_UINT64_C(0x1080004008801020), Q_UINT64_C(0x0840092002c03000), Q_UINT64_C(0x1900200010400900), Q_UINT64_C(0x0880100008000480),
+    Q_UINT64_C(0x4200100420080200), Q_UINT64_C(0x8100020100080400), Q_UINT64_C(0x0200040110886200), Q_UINT64_C(0x0200008040220411),
+    Q_UINT64_C(0x0404800084400220), Q_UINT64_C(0x0000401000402000), Q_UINT64_C(0x0086001081220440), Q_UINT64_C(0x0408800800100280),
+    Q_UINT64_C(0x000a001201040820), Q_UINT64_C(0x8848800200840080), Q_UINT64_C(0x4001000100040200), Q_UINT64_C(0x0442000102105084),
+    Q_UINT64_C(0x9080010020804100), Q_UINT64_C(0x0040404000201009), Q_UINT64_C(0x0000808010002009), Q_UINT64_C(0x2200090021d00100),
+    Q_UINT64_C(0x0008008008040080), Q_UINT64_C(0x0004004002010040), Q_UINT64_C(0x0011040008015042), Q_UINT64_C(0x00000a0001768104),
+    Q_UINT64_C(0x0000800080204009), Q_UINT64_C(0x2010004140002001), Q_UINT64_C(0x9800200280100080), Q_UINT64_C(0x1000100080080080),
+    Q_UINT64_C(0x0442000a00049020), Q_UINT64_C(0x2100040080020080), Q_UINT64_C(0x0800120400900148), Q_UINT64_C(0x0010040a00128541),
+    Q_UINT64_C(0x2800804000800030), Q_UINT64_C(0x1010002000400041), Q_UINT64_C(0x4000200011004100), Q_UINT64_C(0x0610008410800800),
+    Q_UINT64_C(0x0400802402800800), Q_UINT64_C(0xc100020080800400), Q_UINT64_C(0x0002000802000401), Q_UINT64_C(0x0182085882000401),
+    Q_UINT64_C(0x0220204000808000), Q_UINT64_C(0x2860100040024022), Q_UINT64_C(0x0001002004110040), Q_UINT64_C(0x99101042000a0020),
+    Q_UINT64_C(0x0004080004008080), Q_UINT64_C(0x0010040002008080), Q_UINT64_C(0x2012004881020004), Q_UINT64_C(0x8300842444820011),
+    Q_UINT64_C(0x0088403882010200), Q_UINT64_C(0x0820400080210100), Q_UINT64_C(0x0110910040a00300), Q_UINT64_C(0x0801100280080480),
+    Q_UINT64_C(0x0242009008200600), Q_UINT64_C(0x1002000489500200), Q_UINT64_C(0x0040800200010080), Q_UINT64_C(0x0091800041000080),
+    Q_UINT64_C(0x0000209300488001), Q_UINT64_C(0x04c1002414824001), Q_UINT64_C(0x020020000b001041), Q_UINT64_C(0x7000100004200901),
+    Q_UINT64_C(0x8002002004100802), Q_UINT64_C(0x30010002084c0007), Q_UINT64_C(0x0888221800813004), Q_UINT64_C(0x4000002840840112)
 };
 
-const unsigned int RotateR45[64] =
-{
-    a1, b8, c7, d6, e5, f4, g3, h2,
-    a2, b1, c8, d7, e6, f5, g4, h3,
-    a3, b2, c1, d8, e7, f6, g5, h4,
-    a4, b3, c2, d1, e8, f7, g6, h5,
-    a5, b4, c3, d2, e1, f8, g7, h6,
-    a6, b5, c4, d3, e2, f1, g8, h7,
-    a7, b6, c5, d4, e3, f2, g1, h8,
-    a8, b7, c6, d5, e4, f3, g2, h1
-};
-
-const unsigned int RotateL45[64] =
-{
-    a2, b3, c4, d5, e6, f7, g8, h1,
-    a3, b4, c5, d6, e7, f8, g1, h2,
-    a4, b5, c6, d7, e8, f1, g2, h3,
-    a5, b6, c7, d8, e1, f2, g3, h4,
-    a6, b7, c8, d1, e2, f3, g4, h5,
-    a7, b8, c1, d2, e3, f4, g5, h6,
-    a8, b1, c2, d3, e4, f5, g6, h7,
-    a1, b2, c3, d4, e5, f6, g7, h8
+const quint64 BishopMagic[64] =
+{
+    Q_UINT64_C(0xa010041108003100), Q_UINT64_C(0x006082020a002900), Q_UINT64_C(0x6810010619200000), Q_UINT64_C(0x08281a0520000408),
+    Q_UINT64_C(0x0001104001000400), Q_UINT64_C(0x0018901008048400), Q_UINT64_C(0x00040a0210245280), Q_UINT64_C(0x000200210808a402),
+    Q_UINT64_C(0x9140048410821200), Q_UINT64_C(0x0800091010820041), Q_UINT64_C(0x20504804832202c0), Q_UINT64_C(0x0100091401081000),
+    Q_UINT64_C(0x8021011140000012), Q_UINT64_C(0x0810020804450400), Q_UINT64_C(0x208b0542109008a2), Q_UINT64_C(0x0080084a08040204),
+    Q_UINT64_C(0x0040e2a80811244c), Q_UINT64_C(0x2505022008008108), Q_UINT64_C(0x0430220100420040), Q_UINT64_C(0x010a040420220040),
+    Q_UINT64_C(0x1105000290400000), Q_UINT64_C(0x0093001200822120), Q_UINT64_C(0x4000a62048043004), Q_UINT64_C(0x280120048a015004),
+    Q_UINT64_C(0x006090002a020814), Q_UINT64_C(0x44042000240800d0), Q_UINT64_C(0x01102800040a4400), Q_UINT64_C(0x1004080080220040),
+    Q_UINT64_C(0x0001001011004024), Q_UINT64_C(0x0010044000805040), Q_UINT64_C(0x0914041200820100), Q_UINT64_C(0x0004821012821480),
+    Q_UINT64_C(0x0024040500c05021), Q_UINT64_C(0x0088611002080200), Q_UINT64_C(0x0116080a00040020), Q_UINT64_C(0x4000020080080080),
+    Q_UINT64_C(0x2450450140840040), Q_UINT64_C(0x0000880201484100), Q_UINT64_C(0x0222020404020092), Q_UINT64_C(0x8081110600002e00),
+    Q_UINT64_C(0x2842101105000801), Q_UINT64_C(0x1100809008001025), Q_UINT64_C(0x00020202221c0400), Q_UINT64_C(0x0422014022009020),
+    Q_UINT64_C(0x0210046102100c00), Q_UINT64_C(0xc004008082029102), Q_UINT64_C(0x00aa461801101200), Q_UINT64_C(0x0404080080201108),
+    Q_UINT64_C(0x020542108c205002), Q_UINT64_C(0x0410544804100100), Q_UINT64_C(0x0040910841100000), Q_UINT64_C(0x0400200042021100),
+    Q_UINT64_C(0x00004204850400c0), Q_UINT64_C(0x0200100410a42102), Q_UINT64_C(0x1040020801210102), Q_UINT64_C(0x0805040410420000),
+    Q_UINT64_C(0x2884804130100200), Q_UINT64_C(0x800c262201242000), Q_UINT64_C(0x1058000194108800), Q_UINT64_C(0x0014221054420204),
+    Q_UINT64_C(0x0104000012a02200), Q_UINT64_C(0x0200881003300100), Q_UINT64_C(0x0140400202840100), Q_UINT64_C(0x0402020801010201)
 };
 
 const unsigned char Castle[64] =
@@ -127,9 +131,6 @@ const quint64 fileNotH    = ~ fileH;
 const quint64 fileNotAB   = ~(fileA | fileB);
 const quint64 fileNotGH   = ~(fileG | fileH);
 
-#define SetBitL90(s)      (bb_MaskL90[s])
-#define SetBitL45(s)      (bb_MaskL45[s])
-#define SetBitR45(s)      (bb_MaskR45[s])
 #define ShiftDown(b)      ((b)>>8)
 #define Shift2Down(b)     ((b)>>16)
 #define ShiftUp(b)        ((b)<<8)
@@ -524,9 +525,6 @@ void BitBoard::setAt(const Square s, const Piece p)
     m_piece[s] = pt;
     m_occupied ^= bit;
     m_occupied_co[_color] ^= bit;
-    m_occupied_l90 ^= SetBitL90(s);
-    m_occupied_l45 ^= SetBitL45(s);
-    m_occupied_r45 ^= SetBitR45(s);
 }
 
 void BitBoard::removeAt(const Square s)
@@ -581,9 +579,6 @@ void BitBoard::removeAt(const Square s)
     m_piece[s] = Empty;
     m_occupied ^= bit;
     m_occupied_co[_color] ^= bit;
-    m_occupied_l90 ^= SetBitL90(s);
-    m_occupied_l45 ^= SetBitL45(s);
-    m_occupied_r45 ^= SetBitR45(s);
 }
 
 bool BitBoard::isValidFen(const QString& fen) const
@@ -989,15 +984,6 @@ bool BitBoard::fromGoodFen(const QString& qfen, bool chess960)
 
     // Set remainder of bitboard data appropriately
     m_occupied = m_occupied_co[White] + m_occupied_co[Black];
-    for(int i = 0; i < 64; ++i)
-    {
-        if(SetBit(i)&m_occupied)
-        {
-            m_occupied_l90 |= SetBitL90(i);
-            m_occupied_l45 |= SetBitL45(i);
-            m_occupied_r45 |= SetBitR45(i);
-        }
-    }
 
     // Side to move
     c = fen[++i];
@@ -1775,6 +1761,32 @@ int BitBoard::score() const
     return sum;
 }
 
+int BitBoard::materialShift(Color color, PieceType type)
+{
+    return 4 * (5 * color + (type - Queen));
+}
+
+quint64 BitBoard::materialSignature() const
+{
+    quint64 signature = 0;
+    for (int c = White; c <= Black; ++c)
+    {
+        Color color = Color(c);
+        quint64 mine = m_occupied_co[c];
+        signature |= quint64(countSetBits(m_queens & mine)) << materialShift(color, Queen);
+        signature |= quint64(countSetBits(m_rooks & mine)) << materialShift(color, Rook);
+        signature |= quint64(countSetBits(m_bishops & mine)) << materialShift(color, Bishop);
+        signature |= quint64(countSetBits(m_knights & mine)) << materialShift(color, Knight);
+        signature |= quint64(countSetBits(m_pawns & mine)) << materialShift(color, Pawn);
+    }
+    return signature;
+}
+
+int BitBoard::materialCount(quint64 signature, Color color, PieceType type)
+{
+    return int((signature >> materialShift(color, type)) & 0xF);
+}
+
 bool BitBoard::compare(const BitBoard& b) const
 {
     if (m_castle != b.m_castle) return false;
@@ -2274,9 +2286,6 @@ bool BitBoard::doMove(const Move& m)
             m_piece[rook_to] = Rook;
             m_rooks ^= SetBit(rook_from) ^ SetBit(rook_to);
             m_occupied_co[m_stm] ^= SetBit(rook_from) ^ SetBit(rook_to);
-            m_occupied_l90 ^= SetBitL90(rook_from) ^ SetBitL90(rook_to);
-            m_occupied_l45 ^= SetBitL45(rook_from) ^ SetBitL45(rook_to);
-            m_occupied_r45 ^= SetBitR45(rook_from) ^ SetBitR45(rook_to);
         }
         break;
     case Move::TWOFORWARD:
@@ -2316,12 +2325,6 @@ bool BitBoard::doMove(const Move& m)
     switch(m.removal())
     {
     case Empty:
-        if (to != from)
-        {
-            m_occupied_l90 ^= SetBitL90(to);     // extra cleanup needed for non-captures
-            m_occupied_l45 ^= SetBitL45(to);
-            m_occupied_r45 ^= SetBitR45(to);
-        }
         break;
     case Pawn:
         --m_pieceCount[sntm];
@@ -2364,9 +2367,6 @@ bool BitBoard::doMove(const Move& m)
         m_piece[epsq] = Empty;
         m_pawns ^= SetBit(epsq);
         m_occupied_co[sntm] ^= SetBit(epsq);
-        m_occupied_l90 ^= SetBitL90(to) ^ SetBitL90(epsq);
-        m_occupied_l45 ^= SetBitL45(to) ^ SetBitL45(epsq);
-        m_occupied_r45 ^= SetBitR45(to) ^ SetBitR45(epsq);
         break;
     }  // ...no I did not forget the king :)
 
@@ -2379,9 +2379,6 @@ bool BitBoard::doMove(const Move& m)
         if (bb_from != bb_to)
         {
             m_occupied_co[m_stm] ^= bb_from ^ bb_to;
-            m_occupied_l90 ^= SetBitL90(from);
-            m_occupied_l45 ^= SetBitL45(from);
-            m_occupied_r45 ^= SetBitR45(from);
         }
         m_occupied = m_occupied_co[White] + m_occupied_co[Black];
     }
@@ -2502,9 +2499,6 @@ void BitBoard::undoMove(const Move& m)
             m_piece[rook_from] = Rook;
             m_rooks ^= SetBit(rook_from) ^ SetBit(rook_to);
             m_occupied_co[sntm] ^= SetBit(rook_from) ^ SetBit(rook_to);
-            m_occupied_l90 ^= SetBitL90(rook_from) ^ SetBitL90(rook_to);
-            m_occupied_l45 ^= SetBitL45(rook_from) ^ SetBitL45(rook_to);
-            m_occupied_r45 ^= SetBitR45(rook_from) ^ SetBitR45(rook_to);
         }
         break;
     case Move::PROMOTE:
@@ -2534,12 +2528,6 @@ void BitBoard::undoMove(const Move& m)
     switch(m.removal())     // Reverse captures
     {
     case Empty:
-        if (to != from)
-        {
-            m_occupied_l90 ^= SetBitL90(to);     // extra cleanup needed for non-captures
-            m_occupied_l45 ^= SetBitL45(to);
-            m_occupied_r45 ^= SetBitR45(to);
-        }
         break;
     case Pawn:
         ++m_pieceCount[m_stm];
@@ -2573,9 +2561,6 @@ void BitBoard::undoMove(const Move& m)
         m_piece[epsq] = Pawn;
         m_pawns ^= SetBit(epsq);
         m_occupied_co[m_stm] ^= SetBit(epsq);
-        m_occupied_l90 ^= SetBitL90(to) ^ SetBitL90(epsq);
-        m_occupied_l45 ^= SetBitL45(to) ^ SetBitL45(epsq);
-        m_occupied_r45 ^= SetBitR45(to) ^ SetBitR45(epsq);
         break;
     }  // ...no I did not forget the king :)
 
@@ -2588,9 +2573,6 @@ void BitBoard::undoMove(const Move& m)
         if (bb_from != bb_to)
         {
             m_occupied_co[sntm] ^= bb_from ^ bb_to;
-            m_occupied_l90 ^= SetBitL90(from);
-            m_occupied_l45 ^= SetBitL45(from);
-            m_occupied_r45 ^= SetBitR45(from);
         }
         m_occupied = m_occupied_co[White] + m_occupied_co[Black];
     }
@@ -3259,11 +3241,65 @@ QString BitBoard::toHumanFen() const
     return fen;
 }
 
+/** @return the squares attacked by a rook or bishop on @p s with the pieces in @p occupied.
+    If @p relevant is set, the last square of each ray is left out, as it never blocks. */
+static quint64 sliderAttacks(int s, quint64 occupied, bool bishop, bool relevant)
+{
+    static const int rookSteps[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    static const int bishopSteps[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+    const int (*steps)[2] = bishop ? bishopSteps : rookSteps;
+
+    quint64 attacks = 0;
+    for(int d = 0; d < 4; ++d)
+    {
+        int file = File(s) + steps[d][0];
+        int rank = Rank(s) + steps[d][1];
+        while(file >= 0 && file < 8 && rank >= 0 && rank < 8)
+        {
+            int nextFile = file + steps[d][0];
+            int nextRank = rank + steps[d][1];
+            if(relevant && (nextFile < 0 || nextFile >= 8 || nextRank < 0 || nextRank >= 8))
+            {
+                break;
+            }
+            attacks |= SetBit(rank * 8 + file);
+            if(occupied & SetBit(rank * 8 + file))
+            {
+                break;
+            }
+            file = nextFile;
+            rank = nextRank;
+        }
+    }
+    return attacks;
+}
+
+/** Setup @p slider for a rook or bishop on @p s and store its attack sets at @p table.
+    @return the end of the attack sets */
+static quint64* initSliderAttacks(SliderAttacks& slider, int s, quint64 magic, bool bishop, quint64* table)
+{
+    slider.mask = sliderAttacks(s, 0, bishop, true);
+    slider.magic = magic;
+    slider.shift = 64 - qPopulationCount(slider.mask);
+    slider.attacks = table;
+
+    // Visit all subsets of the mask
+    quint64 occupied = 0;
+    do
+    {
+        table[slider.index(occupied)] = sliderAttacks(s, occupied, bishop, false);
+        occupied = (occupied - slider.mask) & slider.mask;
+    }
+    while(occupied);
+
+    return table + (Q_UINT64_C(1) << (64 - slider.shift));
+}
+
 /** Calculate global bit board values before starting */
 void bitBoardInit()
 {
     bitBoardInitRun = true;
-    int i, q;
+    int i;
     quint64 mask;
 
     // Square masks
@@ -3272,12 +3308,6 @@ void bitBoardInit()
     {
         bb_Mask[i] = mask << i;
     }
-    for(i = 0; i < 64; ++i)
-    {
-        bb_MaskL90[i] = SetBit(RotateL90[i]);
-        bb_MaskL45[i] = SetBit(RotateL45[i]);
-        bb_MaskR45[i] = SetBit(RotateR45[i]);
-    }
 
     // Pawn moves and attacks
     for(i = 0; i < 64; ++i)
@@ -3318,112 +3348,15 @@ void bitBoardInit()
         bb_KnightAttacks[i] |= Shift2Right(ShiftDown(mask));
     }
 
-    // Diagonal attacks
-    for(int s = 0; s < 64; ++s)
+    // Rook and bishop attacks
+    quint64* table = bb_SliderTable;
+    for(i = 0; i < 64; ++i)
     {
-        for(int b = 0; b < 64; ++b)
-        {
-            mask = 0;
-            q = s;
-            while(File(q) > 0 && Rank(q) < 7)
-            {
-                q += 7;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateL45[q]) >> bb_ShiftL45[s]))
-                {
-                    break;
-                }
-            }
-            q = s;
-            while(File(q) < 7 && Rank(q) > 0)
-            {
-                q -= 7;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateL45[q]) >> bb_ShiftL45[s]))
-                {
-                    break;
-                }
-            }
-            bb_L45Attacks[s][b] = mask;
-
-            mask = 0;
-            q = s;
-            while(File(q) < 7 && Rank(q) < 7)
-            {
-                q += 9;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateR45[q]) >> bb_ShiftR45[s]))
-                {
-                    break;
-                }
-            }
-            q = s;
-            while(File(q) > 0 && Rank(q) > 0)
-            {
-                q -= 9;
-                mask |= SetBit(q);
-                if(b & (SetBit(RotateR45[q]) >> bb_ShiftR45[s]))
-                {
-                    break;
-                }
-            }
-            bb_R45Attacks[s][b] = mask;
-        }
+        table = initSliderAttacks(bb_RookAttacks[i], i, RookMagic[i], false, table);
     }
-
-    // Rank and File attacks
-    memset(bb_RankAttacks, 0, sizeof(bb_RankAttacks));
-    memset(bb_FileAttacks, 0, sizeof(bb_FileAttacks));
-    int file, rank;
-    for(int sq = 0; sq < 64; ++sq)
+    for(i = 0; i < 64; ++i)
     {
-        for(int bitrow = 0; bitrow < 64; ++bitrow)
-        {
-            file = File(sq);
-            q = sq + 1;
-            while(++file < 8)
-            {
-                bb_RankAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << file) & (bitrow << 1))
-                {
-                    break;
-                }
-                ++q;
-            }
-            file = File(sq);
-            q = sq - 1;
-            while(--file >= 0)
-            {
-                bb_RankAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << file) & (bitrow << 1))
-                {
-                    break;
-                }
-                --q;
-            }
-            rank = Rank(sq);
-            q = sq + 8;
-            while(++rank < 8)
-            {
-                bb_FileAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << (7 - rank)) & (bitrow << 1))
-                {
-                    break;
-                }
-                q += 8;
-            }
-            rank = Rank(sq);
-            q = sq - 8;
-            while(--rank >= 0)
-            {
-                bb_FileAttacks[sq][bitrow] |= SetBit(q);
-                if((1 << (7 - rank)) & (bitrow << 1))
-                {
-                    break;
-                }
-                q -= 8;
-            }
-        }
+        table = initSliderAttacks(bb_BishopAttacks[i], i, BishopMagic[i], true, table);
     }
 
     // King:
@@ -14,6 +14,10 @@
 #ifndef BITBOARD_H_INCLUDED
 #define BITBOARD_H_INCLUDED
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 namespace chessx {
 
 enum BoardStatus
@@ -120,6 +124,8 @@ public:
     bool insufficientMaterial() const;
     /** @return the square at which the king of @p color is located */
     chessx::Square kingSquare(Color color) const;
+    /** @return the squares occupied by pieces of @p color and @p type, bit n is square n */
+    quint64 pieces(Color color, PieceType type) const;
 
     // Query other formats
     //
@@ -214,6 +220,13 @@ public:
     Move::List generateMoves() const;
     /** Calculate a material evaluation */
     int score() const;
+    /** @return the number of queens, rooks, bishops, knights and pawns of both sides,
+        packed into 4 bits each. It changes exactly when a capture or promotion is played. */
+    quint64 materialSignature() const;
+    /** @return the number of pieces of @p color and @p type in a materialSignature() */
+    static int materialCount(quint64 signature, Color color, PieceType type);
+    /** @return the offset of the 4 bits holding the count of @p color and @p type in a materialSignature() */
+    static int materialShift(Color color, PieceType type);
     bool compare(const BitBoard& b) const; //!< Return true if same pieces and castling rights, false otherwise
 protected:
     unsigned int countSetBits(quint64 n) const;
@@ -277,9 +290,6 @@ private:
     quint64 m_pawns, m_knights, m_bishops, m_rooks, m_castlingRooks, m_queens, m_kings;
     quint64 m_occupied_co[2];     // Square mask of those occupied by each color
     quint64 m_occupied;           // Square is empty or holds a piece
-    quint64 m_occupied_l90;       // rotated counter clockwise 90 deg
-    quint64 m_occupied_l45;       // an odd transformation, to straighten out diagonals
-    quint64 m_occupied_r45;       // the opposite odd transformation, just as messy
 
     // Extra state data
     unsigned char m_piece[64];             // type of piece on this square
@@ -344,37 +354,53 @@ enum Char64Relation
 
 } // namespace chessx
 
+/** Attacks of a rook or bishop on one square, looked up by the occupancy of the
+ * squares it passes on its way to the board edges. The index is computed with the
+ * PEXT instruction if the build targets BMI2, else by a magic multiplication.
+ */
+struct SliderAttacks
+{
+    quint64 mask;        // squares whose occupancy matters
+    quint64 magic;       // factor spreading the occupancies of mask over the index range
+    quint64* attacks;    // attack sets of all occupancies of mask
+    unsigned int shift;  // 64 minus the number of squares in mask
+
+    unsigned int index(quint64 occupied) const
+    {
+#ifdef __BMI2__
+        return unsigned(_pext_u64(occupied, mask));
+#else
+        return unsigned(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
 extern quint64 bb_PawnAttacks[2][64];
 extern quint64 bb_KnightAttacks[64];
-extern quint64 bb_R45Attacks[64][64];
-extern quint64 bb_L45Attacks[64][64];
 extern quint64 bb_KingAttacks[64];
-extern quint64 bb_RankAttacks[64][64];
-extern quint64 bb_FileAttacks[64][64];
-
-const unsigned int bb_ShiftR45[64] =
-{
-    1, 58, 51, 44, 37, 30, 23, 16,
-    9, 1, 58, 51, 44, 37, 30, 23,
-    17, 9, 1, 58, 51, 44, 37, 30,
-    25, 17, 9, 1, 58, 51, 44, 37,
-    33, 25, 17, 9, 1, 58, 51, 44,
-    41, 33, 25, 17, 9, 1, 58, 51,
-    49, 41, 33, 25, 17, 9, 1, 58,
-    57, 49, 41, 33, 25, 17, 9, 1
-};
+extern SliderAttacks bb_RookAttacks[64];
+extern SliderAttacks bb_BishopAttacks[64];
 
-const unsigned int bb_ShiftL45[64] =
+inline quint64 BitBoard::pieces(Color color, PieceType type) const
 {
-    9, 17, 25, 33, 41, 49, 57, 1,
-    17, 25, 33, 41, 49, 57, 1, 10,
-    25, 33, 41, 49, 57, 1, 10, 19,
-    33, 41, 49, 57, 1, 10, 19, 28,
-    41, 49, 57, 1, 10, 19, 28, 37,
-    49, 57, 1, 10, 19, 28, 37, 46,
-    57, 1, 10, 19, 28, 37, 46, 55,
-    1, 10, 19, 28, 37, 46, 55, 64
-};
+    switch(type)
+    {
+    case King:
+        return m_kings & m_occupied_co[color];
+    case Queen:
+        return m_queens & m_occupied_co[color];
+    case Rook:
+        return m_rooks & m_occupied_co[color];
+    case Bishop:
+        return m_bishops & m_occupied_co[color];
+    case Knight:
+        return m_knights & m_occupied_co[color];
+    case Pawn:
+        return m_pawns & m_occupied_co[color];
+    default:
+        return 0;
+    }
+}
 
 inline bool BitBoard::isAttackedBy(const unsigned int color, chessx::Square square) const
 {
@@ -455,14 +481,14 @@ inline quint64 BitBoard::knightAttacksFrom(const chessx::Square s) const
 
 inline quint64 BitBoard::bishopAttacksFrom(const chessx::Square s) const
 {
-    return bb_R45Attacks[s][(m_occupied_r45 >> bb_ShiftR45[s]) & 63] |
-           bb_L45Attacks[s][(m_occupied_l45 >> bb_ShiftL45[s]) & 63];
+    const SliderAttacks& slider = bb_BishopAttacks[s];
+    return slider.attacks[slider.index(m_occupied)];
 }
 
 inline quint64 BitBoard::rookAttacksFrom(const chessx::Square s) const
 {
-    return bb_RankAttacks[s][(m_occupied >> ((s & ~7) + 1)) & 63] |
-           bb_FileAttacks[s][(m_occupied_l90 >> (((s & 7) << 3) + 1)) & 63];
+    const SliderAttacks& slider = bb_RookAttacks[s];
+    return slider.attacks[slider.index(m_occupied)];
 }
 
 inline quint64 BitBoard::queenAttacksFrom(const chessx::Square s) const
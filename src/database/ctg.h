@@ -13,7 +13,7 @@
 #define read_24(buf, pos)   \
     ((buf[pos]<<16) + (buf[(pos)+1]<<8) + (buf[(pos)+2]))
 #define read_32(buf, pos)   \
-    ((buf[pos]<<24) + (buf[pos+1]<<16) + (buf[(pos)+2]<<8) + (buf[(pos+3)+2]))
+    (((uint32_t)buf[pos]<<24) + (buf[(pos)+1]<<16) + (buf[(pos)+2]<<8) + (buf[(pos)+3]))
 
 typedef struct _page_bounds_t {
     int pad;
@@ -43,6 +43,28 @@ typedef struct _ctg_entry_t{
     int comment;
 } ctg_entry_t;
 
+/** Move of a ctg_record_t for positions where the game ended or the book stops */
+#define CTG_NO_MOVE 0x100
+
+/**
+ * A position of a game and the move played from it while building a book,
+ * or the sum of equal ones. Records are sorted by the bit reversed hash of
+ * the signature, so the positions sharing a page of the book are adjacent.
+ */
+typedef struct _ctg_record_t{
+    uint32_t order;
+    unsigned char sig[32];
+    uint16_t move;
+    uint32_t games;
+    /** Results from the view of the side which moved into the position */
+    uint32_t wins;
+    uint32_t losses;
+    uint32_t draws;
+    /** Ratings of that side */
+    uint32_t rating_games;
+    uint64_t rating_sum;
+} ctg_record_t;
+
 typedef struct _ctg_move_t{
     int file_from;
     int file_to;
@@ -7,6 +7,11 @@
 * based on Stephan Vermeire's ctg code for Brutus.
 ****************************************************************************/
 
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <vector>
+
 #include <QtCore>
 #include <QtEndian>
 #include "ctgdatabase.h"
@@ -26,6 +31,18 @@ using namespace chessx;
 
 #define create_square(file,rank)    SquareFromRankAndFile(rank,file)
 
+#define CTG_PAGE_SIZE 4096
+/** Number of records sorted in memory before they are written to a run */
+#define CTG_RUN_RECORDS (1 << 19)
+/** Number of records read at once from a run */
+#define CTG_READ_RECORDS 4096
+/** Maximum number of runs merged at once */
+#define CTG_MERGE_RUNS 64
+/** Maximum level of the page index */
+#define CTG_MAX_LEVEL 30
+/** Maximum number of moves stored for a position */
+#define CTG_MAX_MOVES 49
+
 // ---------------------------------------------------------
 // construction
 // ---------------------------------------------------------
@@ -36,13 +53,19 @@ CtgDatabase::CtgDatabase() :
     cto_file(nullptr),
     ctb_file(nullptr),
     m_count(0),
-    page_bounds{}
+    page_bounds{},
+    m_maxPly(0),
+    m_minGame(0),
+    m_runRecords(CTG_RUN_RECORDS),
+    m_mergeRuns(CTG_MERGE_RUNS),
+    m_baseLevel(0)
 {
 }
 
 CtgDatabase::~CtgDatabase()
 {
     close();
+    qDeleteAll(m_runs);
 }
 
 // ---------------------------------------------------------
@@ -212,9 +235,11 @@ bool CtgDatabase::ctg_get_page_index(int hash, int* page_index) const
         key = (hash & mask) + mask;
         if (key >= (uint32_t)page_bounds.low)
         {
-            cto_file->seek(16 + key*4);
             int n;
-            cto_file->read((char*)&n, 4);
+            if (!cto_file->seek(16 + qint64(key)*4) || cto_file->read((char*)&n, 4) != 4)
+            {
+                return false;
+            }
             *page_index = ntohl((uint32_t)n);
             if (*page_index >= 0)
             {
@@ -326,68 +351,70 @@ Move CtgDatabase::squares_to_move(const BoardX& position, Square from, Square to
 
 // ---------------------------------------------------------
 
+// Tables of the ctg move encoding, indexed by the move byte: the piece type,
+// the index of the piece counting from A1 to H8 by files and the move deltas
+static const char* const piece_code =
+    "PNxQPQPxQBKxPBRNxxBKPBxxPxQBxBxxxRBQPxBPQQNxxPBQNQBxNxNQQQBQBxxx"
+    "xQQxKQxxxxPQNQxxRxRxBPxxxxxxPxxPxQPQxxBKxRBxxxRQxxBxQxxxxBRRPRQR"
+    "QRPxxNRRxxNPKxQQxxQxQxPKRRQPxQxBQxQPxRxxxRxQxRQxQPBxxRxQxBxPQQKx"
+    "xBBBRRQPPQBPBRxPxPNNxxxQRQNPxxPKNRxRxQPQRNxPPQQRQQxNRBxNQQQQxQQx";
+static const int piece_index[256]= {
+    5, 2, 9, 2, 2, 1, 4, 9, 2, 2, 1, 9, 1, 1, 2, 1,
+    9, 9, 1, 1, 8, 1, 9, 9, 7, 9, 2, 1, 9, 2, 9, 9,
+    9, 2, 2, 2, 8, 9, 1, 3, 1, 1, 2, 9, 9, 6, 1, 1,
+    2, 1, 2, 9, 1, 9, 1, 1, 2, 1, 1, 2, 1, 9, 9, 9,
+    9, 2, 1, 9, 1, 1, 9, 9, 9, 9, 8, 1, 2, 2, 9, 9,
+    1, 9, 1, 9, 2, 3, 9, 9, 9, 9, 9, 9, 7, 9, 9, 5,
+    9, 1, 2, 2, 9, 9, 1, 1, 9, 2, 1, 0, 9, 9, 1, 2,
+    9, 9, 2, 9, 1, 9, 9, 9, 9, 2, 1, 2, 3, 2, 1, 1,
+    1, 1, 6, 9, 9, 1, 1, 1, 9, 9, 1, 1, 1, 9, 2, 1,
+    9, 9, 2, 9, 1, 9, 2, 1, 1, 1, 1, 3, 9, 1, 9, 2,
+    2, 9, 1, 8, 9, 2, 9, 9, 9, 2, 9, 2, 9, 2, 2, 9,
+    2, 6, 1, 9, 9, 2, 9, 1, 9, 2, 9, 5, 2, 2, 1, 9,
+    9, 1, 2, 1, 2, 2, 2, 7, 7, 2, 2, 6, 2, 1, 9, 4,
+    9, 2, 2, 2, 9, 9, 9, 1, 2, 1, 1, 1, 9, 9, 5, 1,
+    2, 1, 9, 2, 9, 1, 4, 1, 1, 1, 9, 4, 1, 1, 2, 1,
+    2, 1, 9, 2, 2, 2, 0, 1, 2, 2, 2, 2, 9, 1, 2, 9
+};
+static const int forward[256]= {
+    1,-1, 9, 0, 1, 1, 1, 9, 0, 6,-1, 9, 1, 3, 0,-1,
+    9, 9, 7, 1, 1, 5, 9, 9, 1, 9, 6, 1, 9, 7, 9, 9,
+    9, 0, 2, 6, 1, 9, 7, 1, 5, 0,-2, 9, 9, 1, 1, 0,
+   -2, 0, 5, 9, 2, 9, 1, 4, 4, 0, 6, 5, 5, 9, 9, 9,
+    9, 5, 7, 9,-1, 3, 9, 9, 9, 9, 2, 5, 2, 1, 9, 9,
+    6, 9, 0, 9, 1, 1, 9, 9, 9, 9, 9, 9, 1, 9, 9, 2,
+    9, 6, 2, 7, 9, 9, 3, 1, 9, 7, 4, 0, 9, 9, 0, 7,
+    9, 9, 7, 9, 0, 9, 9, 9, 9, 6, 3, 6, 1, 1, 3, 0,
+    6, 1, 1, 9, 9, 2, 0, 5, 9, 9,-2, 1,-1, 9, 2, 0,
+    9, 9, 1, 9, 3, 9, 1, 0, 0, 4, 6, 2, 9, 2, 9, 4,
+    3, 9, 2, 1, 9, 5, 9, 9, 9, 0, 9, 6, 9, 0, 3, 9,
+    4, 2, 6, 9, 9, 0, 9, 5, 9, 3, 9, 1, 0, 2, 0, 9,
+    9, 2, 2, 2, 0, 4, 5, 1, 2, 7, 3, 1, 5, 0, 9, 1,
+    9, 1, 1, 1, 9, 9, 9, 1, 0, 2,-2, 2, 9, 9, 1, 1,
+   -1, 7, 9, 3, 9, 0, 2, 4, 2,-1, 9, 1, 1, 7, 1, 0,
+    0, 1, 9, 2, 2, 1, 0, 1, 0, 6, 0, 2, 9, 7, 3, 9
+};
+static const int left[256] = {
+   -1, 2, 9,-2, 0, 0, 1, 9,-4,-6, 0, 9, 1,-3,-3, 2,
+    9, 9,-7, 0,-1,-5, 9, 9, 0, 9, 0, 1, 9,-7, 9, 9,
+    9,-7, 2,-6, 1, 9, 7, 1,-5,-6,-1, 9, 9,-1,-1,-1,
+    1,-3,-5, 9,-1, 9,-2, 0, 4,-5,-6, 5, 5, 9, 9, 9,
+    9,-5, 7, 9,-1,-3, 9, 9, 9, 9, 0, 5,-1, 0, 9, 9,
+    0, 9,-6, 9, 1, 0, 9, 9, 9, 9, 9, 9,-1, 9, 9, 0,
+    9,-6, 0, 7, 9, 9, 3,-1, 9, 0,-4, 0, 9, 9,-5,-7,
+    9, 9, 7, 9,-2, 9, 9, 9, 9, 6, 0, 0,-1, 0, 3,-1,
+    6, 0, 1, 9, 9, 1,-7, 0, 9, 9,-1,-1, 1, 9, 2,-7,
+    9, 9,-1, 9, 0, 9,-1, 1,-3, 0, 0, 0, 9, 0, 9, 4,
+    0, 9,-2, 0, 9, 0, 9, 9, 9,-2, 9, 6, 9,-4,-3, 9,
+    0, 0, 6, 9, 9,-5, 9, 0, 9,-3, 9, 0,-5, 0,-1, 9,
+    9,-2,-2, 2,-1, 0, 0, 1, 0, 0, 3, 0, 5,-2, 9, 0,
+    9, 1,-2, 2, 9, 9, 9, 1,-6, 2, 1, 0, 9, 9, 1, 1,
+   -2, 0, 9, 0, 9,-4, 0,-4, 0,-2, 9,-1, 0,-7, 1,-4,
+   -7,-1, 9, 1, 0,-1, 0, 2,-1, 0,-3,-2, 9, 0, 3, 9
+};
+
 Move CtgDatabase::byte_to_move(const BoardX& pos, uint8_t byte) const
 {
-    const char* piece_code =
-        "PNxQPQPxQBKxPBRNxxBKPBxxPxQBxBxxxRBQPxBPQQNxxPBQNQBxNxNQQQBQBxxx"
-        "xQQxKQxxxxPQNQxxRxRxBPxxxxxxPxxPxQPQxxBKxRBxxxRQxxBxQxxxxBRRPRQR"
-        "QRPxxNRRxxNPKxQQxxQxQxPKRRQPxQxBQxQPxRxxxRxQxRQxQPBxxRxQxBxPQQKx"
-        "xBBBRRQPPQBPBRxPxPNNxxxQRQNPxxPKNRxRxQPQRNxPPQQRQQxNRBxNQQQQxQQx";
-    const int piece_index[256]= {
-        5, 2, 9, 2, 2, 1, 4, 9, 2, 2, 1, 9, 1, 1, 2, 1,
-        9, 9, 1, 1, 8, 1, 9, 9, 7, 9, 2, 1, 9, 2, 9, 9,
-        9, 2, 2, 2, 8, 9, 1, 3, 1, 1, 2, 9, 9, 6, 1, 1,
-        2, 1, 2, 9, 1, 9, 1, 1, 2, 1, 1, 2, 1, 9, 9, 9,
-        9, 2, 1, 9, 1, 1, 9, 9, 9, 9, 8, 1, 2, 2, 9, 9,
-        1, 9, 1, 9, 2, 3, 9, 9, 9, 9, 9, 9, 7, 9, 9, 5,
-        9, 1, 2, 2, 9, 9, 1, 1, 9, 2, 1, 0, 9, 9, 1, 2,
-        9, 9, 2, 9, 1, 9, 9, 9, 9, 2, 1, 2, 3, 2, 1, 1,
-        1, 1, 6, 9, 9, 1, 1, 1, 9, 9, 1, 1, 1, 9, 2, 1,
-        9, 9, 2, 9, 1, 9, 2, 1, 1, 1, 1, 3, 9, 1, 9, 2,
-        2, 9, 1, 8, 9, 2, 9, 9, 9, 2, 9, 2, 9, 2, 2, 9,
-        2, 6, 1, 9, 9, 2, 9, 1, 9, 2, 9, 5, 2, 2, 1, 9,
-        9, 1, 2, 1, 2, 2, 2, 7, 7, 2, 2, 6, 2, 1, 9, 4,
-        9, 2, 2, 2, 9, 9, 9, 1, 2, 1, 1, 1, 9, 9, 5, 1,
-        2, 1, 9, 2, 9, 1, 4, 1, 1, 1, 9, 4, 1, 1, 2, 1,
-        2, 1, 9, 2, 2, 2, 0, 1, 2, 2, 2, 2, 9, 1, 2, 9
-    };
-    const int forward[256]= {
-        1,-1, 9, 0, 1, 1, 1, 9, 0, 6,-1, 9, 1, 3, 0,-1,
-        9, 9, 7, 1, 1, 5, 9, 9, 1, 9, 6, 1, 9, 7, 9, 9,
-        9, 0, 2, 6, 1, 9, 7, 1, 5, 0,-2, 9, 9, 1, 1, 0,
-       -2, 0, 5, 9, 2, 9, 1, 4, 4, 0, 6, 5, 5, 9, 9, 9,
-        9, 5, 7, 9,-1, 3, 9, 9, 9, 9, 2, 5, 2, 1, 9, 9,
-        6, 9, 0, 9, 1, 1, 9, 9, 9, 9, 9, 9, 1, 9, 9, 2,
-        9, 6, 2, 7, 9, 9, 3, 1, 9, 7, 4, 0, 9, 9, 0, 7,
-        9, 9, 7, 9, 0, 9, 9, 9, 9, 6, 3, 6, 1, 1, 3, 0,
-        6, 1, 1, 9, 9, 2, 0, 5, 9, 9,-2, 1,-1, 9, 2, 0,
-        9, 9, 1, 9, 3, 9, 1, 0, 0, 4, 6, 2, 9, 2, 9, 4,
-        3, 9, 2, 1, 9, 5, 9, 9, 9, 0, 9, 6, 9, 0, 3, 9,
-        4, 2, 6, 9, 9, 0, 9, 5, 9, 3, 9, 1, 0, 2, 0, 9,
-        9, 2, 2, 2, 0, 4, 5, 1, 2, 7, 3, 1, 5, 0, 9, 1,
-        9, 1, 1, 1, 9, 9, 9, 1, 0, 2,-2, 2, 9, 9, 1, 1,
-       -1, 7, 9, 3, 9, 0, 2, 4, 2,-1, 9, 1, 1, 7, 1, 0,
-        0, 1, 9, 2, 2, 1, 0, 1, 0, 6, 0, 2, 9, 7, 3, 9
-    };
-    const int left[256] = {
-       -1, 2, 9,-2, 0, 0, 1, 9,-4,-6, 0, 9, 1,-3,-3, 2,
-        9, 9,-7, 0,-1,-5, 9, 9, 0, 9, 0, 1, 9,-7, 9, 9,
-        9,-7, 2,-6, 1, 9, 7, 1,-5,-6,-1, 9, 9,-1,-1,-1,
-        1,-3,-5, 9,-1, 9,-2, 0, 4,-5,-6, 5, 5, 9, 9, 9,
-        9,-5, 7, 9,-1,-3, 9, 9, 9, 9, 0, 5,-1, 0, 9, 9,
-        0, 9,-6, 9, 1, 0, 9, 9, 9, 9, 9, 9,-1, 9, 9, 0,
-        9,-6, 0, 7, 9, 9, 3,-1, 9, 0,-4, 0, 9, 9,-5,-7,
-        9, 9, 7, 9,-2, 9, 9, 9, 9, 6, 0, 0,-1, 0, 3,-1,
-        6, 0, 1, 9, 9, 1,-7, 0, 9, 9,-1,-1, 1, 9, 2,-7,
-        9, 9,-1, 9, 0, 9,-1, 1,-3, 0, 0, 0, 9, 0, 9, 4,
-        0, 9,-2, 0, 9, 0, 9, 9, 9,-2, 9, 6, 9,-4,-3, 9,
-        0, 0, 6, 9, 9,-5, 9, 0, 9,-3, 9, 0,-5, 0,-1, 9,
-        9,-2,-2, 2,-1, 0, 0, 1, 0, 0, 3, 0, 5,-2, 9, 0,
-        9, 1,-2, 2, 9, 9, 9, 1,-6, 2, 1, 0, 9, 9, 1, 1,
-       -2, 0, 9, 0, 9,-4, 0,-4, 0,-2, 9,-1, 0,-7, 1,-4,
-       -7,-1, 9, 1, 0,-1, 0, 2,-1, 0,-3,-2, 9, 0, 3, 9
-    };
-
     // Find the piece. Note: the board may be mirrored/flipped.
     bool flip_board = pos.blackToMove();
     Color white = pos.toMove();
@@ -597,7 +624,11 @@ uint64_t CtgDatabase::move_weight(const BoardX& pos,
         md.results.update(Draw, entry.draws);
         md.results.update(BlackWin, entry.losses);
     }
-    md.rating.update(entry.avg_rating_score, entry.avg_rating_games);
+    if (entry.avg_rating_games)
+    {
+        // The score is the sum of the ratings
+        md.rating.update((uint32_t)entry.avg_rating_score / entry.avg_rating_games, entry.avg_rating_games);
+    }
     md.move = move;
     md.san = pos.moveToSan(move);
     md.localsan = pos.moveToSan(move, true);
@@ -636,7 +667,8 @@ unsigned int CtgDatabase::getMoveMapForBoard(const BoardX &pos, QMap<Move, MoveD
     int games = 0;
     for (int i=0; i<entry.num_moves; ++i)
     {
-        uint8_t byte = entry.moves[i];
+        // Each move is followed by its annotation
+        uint8_t byte = entry.moves[2*i];
         Move m = byte_to_move(pos, byte);
         if (m.isLegal())
         {
@@ -657,19 +689,568 @@ unsigned int CtgDatabase::getMoveMapForBoard(const BoardX &pos, QMap<Move, MoveD
 // Book building - public interface
 // ---------------------------------------------------------
 
-bool CtgDatabase::openForWriting(const QString &filename, int /*maxPly*/, int /*minGame*/, bool /*uniform*/)
+bool CtgDatabase::openForWriting(const QString &filename, int maxPly, int minGame, bool /*uniform*/)
 {
     if(ctg_file)
     {
         return false;
     }
 
-    // todo
-
+    // A ctg book weights the moves by the games found, there is nothing to make uniform
+    m_filename = filename;
+    m_maxPly = maxPly;
+    m_minGame = minGame;
     return openFile(filename, false);
 }
 
-void CtgDatabase::book_make(Database& /*db*/, volatile bool& /*breakFlag*/)
+void CtgDatabase::setBuildLimits(int runRecords, int mergeRuns, int baseLevel)
 {
-    // todo
+    m_runRecords = std::max(1, runRecords);
+    m_mergeRuns = std::max(2, mergeRuns);
+    m_baseLevel = std::min(baseLevel, CTG_MAX_LEVEL);
+}
+
+void CtgDatabase::book_make(Database& db, volatile bool& breakFlag)
+{
+    QMutexLocker m(mutex());
+    RefKeeper r(db.refCounter());
+
+    m_count = 0;
+    m_records.clear();
+    m_records.reserve(m_runRecords);
+    quint64 games = 0;
+    bool ok = true;
+    for (GameId i = 0; ok && i < db.count() && !breakFlag; ++i)
+    {
+        GameX game;
+        if (db.loadGame(i, game))
+        {
+            add_game(game);
+            ++games;
+        }
+        if (m_records.count() >= m_runRecords)
+        {
+            ok = flush_run();
+        }
+    }
+    ok = ok && !breakFlag && flush_run();
+    ok = ok && write_book(breakFlag);
+    if (ok && !breakFlag)
+    {
+        // Header page, only the number of games is filled in
+        QByteArray header(CTG_PAGE_SIZE, 0);
+        qToBigEndian<quint32>(quint32(std::min<quint64>(games, 0xFFFFFFFF)), (uchar*)header.data() + 28);
+        ctg_file->seek(0);
+        ctg_file->write(header);
+    }
+    else
+    {
+        qWarning() << "Could not build ctg book" << m_filename;
+    }
+
+    m_records.clear();
+    m_records.squeeze();
+    qDeleteAll(m_runs);
+    m_runs.clear();
+    close();
+}
+
+// ---------------------------------------------------------
+// Book building
+// ---------------------------------------------------------
+
+bool CtgDatabase::move_to_byte(const BoardX& pos, Move move, uint8_t* byte) const
+{
+    if (move.isNullMove() || pos.chess960())
+    {
+        return false;
+    }
+    if (move.isPromotion() && pieceType(move.promotedPiece()) != Queen)
+    {
+        return false;
+    }
+
+    // Same normalization as in position_to_ctg_signature()
+    bool flip_board = pos.blackToMove();
+    Color white = pos.toMove();
+    bool mirror_board = (File(pos.kingSquare(white)) < chessx::FILE_E) &&
+        (pos.castlingRights() == 0);
+
+    int file_from = File(move.from());
+    int rank_from = Rank(move.from());
+    int file_to = File(move.to());
+    int rank_to = Rank(move.to());
+    if (flip_board) {
+        rank_from = 7-rank_from;
+        rank_to = 7-rank_to;
+    }
+    if (mirror_board) {
+        file_from = 7-file_from;
+        file_to = 7-file_to;
+    }
+
+    if (move.isCastling()) {
+        *byte = (file_to > file_from) ? 107 : 246;
+        return true;
+    }
+
+    Piece pc = flip_board ? flipPiece(pos.pieceAt(move.from())) : pos.pieceAt(move.from());
+    char glyph = " KQRBNP"[pieceType(pc)];
+
+    // Count the pieces of the same type up to the moving one
+    int nth_piece = 0;
+    bool found = false;
+    for (unsigned char file=0; file<8 && !found; ++file) {
+        for (int rank=0; rank<8 && !found; ++rank) {
+            Square sq = create_square(file, rank);
+            if (flip_board) sq = SquareMirrorRank(sq);
+            if (mirror_board) sq = SquareMirrorFile(sq);
+            Piece piece = flip_board ? flipPiece(pos.pieceAt(sq)) : pos.pieceAt(sq);
+            if (piece == pc) ++nth_piece;
+            found = (file == file_from && rank == rank_from);
+        }
+    }
+
+    int forward_delta = (rank_to - rank_from + 8) % 8;
+    int left_delta = (file_from - file_to + 8) % 8;
+    for (int i=0; i<256; ++i) {
+        if (i == 107 || i == 246) continue;
+        if (piece_code[i] == glyph && piece_index[i] == nth_piece &&
+                (forward[i] + 8) % 8 == forward_delta && (left[i] + 8) % 8 == left_delta) {
+            *byte = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------
+
+static inline quint32 reverse_bits(quint32 n)
+{
+    quint32 r = 0;
+    for (int i=0; i<32; ++i, n>>=1) r = (r << 1) | (n & 1);
+    return r;
+}
+
+static bool record_less(const ctg_record_t& a, const ctg_record_t& b)
+{
+    if (a.order != b.order) return a.order < b.order;
+    int c = memcmp(a.sig, b.sig, sizeof(a.sig));
+    if (c) return c < 0;
+    return a.move < b.move;
+}
+
+static bool same_position(const ctg_record_t& a, const ctg_record_t& b)
+{
+    return a.order == b.order && !memcmp(a.sig, b.sig, sizeof(a.sig));
+}
+
+static void combine_record(ctg_record_t& a, const ctg_record_t& b)
+{
+    a.games += b.games;
+    a.wins += b.wins;
+    a.losses += b.losses;
+    a.draws += b.draws;
+    a.rating_games += b.rating_games;
+    a.rating_sum += b.rating_sum;
+}
+
+void CtgDatabase::add_record(const BoardX& pos, uint16_t move, int result, int rating)
+{
+    ctg_signature_t sig;
+    position_to_ctg_signature(pos, &sig);
+    if (sig.buf_len > (int)sizeof(ctg_record_t::sig)) return;
+
+    ctg_record_t record = { };
+    record.order = reverse_bits((uint32_t)ctg_signature_to_hash(&sig));
+    memcpy(record.sig, sig.buf, sig.buf_len);
+    record.move = move;
+    record.games = 1;
+    // The side which moved into the position is not to move
+    if (!pos.blackToMove()) result = -result;
+    if (result > 0) record.wins = 1;
+    else if (result < 0) record.losses = 1;
+    else record.draws = 1;
+    if (rating > 0) {
+        record.rating_games = 1;
+        record.rating_sum = rating;
+    }
+    m_records.append(record);
+}
+
+void CtgDatabase::add_game(GameX& game)
+{
+    BoardX board(game.startingBoard());
+    if (board.chess960()) return;
+
+    QString result = game.tag(TagNameResult);
+    int score = (result == "1-0") ? 1 : (result == "0-1") ? -1 : (result == "1/2-1/2") ? 0 : 2;
+    if (score == 2) return; // Unfinished games do not count
+
+    int whiteElo = game.tag(TagNameWhiteElo).toInt();
+    int blackElo = game.tag(TagNameBlackElo).toInt();
+
+    game.moveToStart();
+    for (int ply = 0; ; ++ply)
+    {
+        uint16_t byte = CTG_NO_MOVE;
+        Move move;
+        if (ply < m_maxPly && !game.atLineEnd())
+        {
+            game.forward();
+            move = game.move();
+            uint8_t b;
+            if (move_to_byte(board, move, &b)) byte = b;
+        }
+        add_record(board, byte, score, board.blackToMove() ? whiteElo : blackElo);
+        if (byte == CTG_NO_MOVE) break;
+        board.doMove(move);
+    }
+}
+
+bool CtgDatabase::flush_run()
+{
+    if (m_records.isEmpty()) return true;
+
+    std::sort(m_records.begin(), m_records.end(), record_less);
+    int n = 0;
+    for (int i=1; i<m_records.count(); ++i) {
+        if (same_position(m_records[n], m_records[i]) && m_records[n].move == m_records[i].move) {
+            combine_record(m_records[n], m_records[i]);
+        }
+        else {
+            m_records[++n] = m_records[i];
+        }
+    }
+    m_records.resize(n + 1);
+
+    QTemporaryFile* run = new QTemporaryFile;
+    m_runs.append(run);
+    qint64 size = qint64(sizeof(ctg_record_t)) * m_records.count();
+    bool ok = run->open() && run->write((const char*)m_records.constData(), size) == size && run->flush();
+    m_records.clear();
+    return ok;
+}
+
+namespace {
+
+/** Buffered reading of the records of a run */
+class CtgRunReader
+{
+public:
+    explicit CtgRunReader(QIODevice* device) : m_device(device), m_pos(0)
+    {
+        m_device->seek(0);
+        fill();
+    }
+    bool atEnd() const { return m_pos >= m_records.count(); }
+    const ctg_record_t& current() const { return m_records[m_pos]; }
+    void next()
+    {
+        if (++m_pos >= m_records.count()) fill();
+    }
+
+private:
+    void fill()
+    {
+        m_records.resize(CTG_READ_RECORDS);
+        qint64 n = m_device->read((char*)m_records.data(), qint64(sizeof(ctg_record_t)) * CTG_READ_RECORDS);
+        m_records.resize(n > 0 ? int(n / sizeof(ctg_record_t)) : 0);
+        m_pos = 0;
+    }
+
+    QIODevice* m_device;
+    QVector<ctg_record_t> m_records;
+    int m_pos;
+};
+
+} // namespace
+
+bool CtgDatabase::merge_runs(const QList<QTemporaryFile*>& runs,
+                             const std::function<bool(const ctg_record_t&)>& sink,
+                             volatile bool& breakFlag)
+{
+    std::vector<std::unique_ptr<CtgRunReader>> readers;
+    for (QTemporaryFile* run: runs) readers.emplace_back(new CtgRunReader(run));
+
+    // Min heap of the readers by their current record
+    auto greater = [&readers](int a, int b) {
+        return record_less(readers[b]->current(), readers[a]->current());
+    };
+    std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+    for (int i=0; i<(int)readers.size(); ++i) {
+        if (!readers[i]->atEnd()) heap.push(i);
+    }
+
+    bool pending = false;
+    ctg_record_t record = { };
+    quint64 merged = 0;
+    while (!heap.empty()) {
+        int i = heap.top();
+        heap.pop();
+        const ctg_record_t& next = readers[i]->current();
+        if (pending && same_position(record, next) && record.move == next.move) {
+            combine_record(record, next);
+        }
+        else {
+            if (pending && !sink(record)) return false;
+            record = next;
+            pending = true;
+        }
+        readers[i]->next();
+        if (!readers[i]->atEnd()) heap.push(i);
+        if ((++merged % CTG_RUN_RECORDS) == 0 && breakFlag) return false;
+    }
+    return !pending || sink(record);
+}
+
+namespace {
+
+/** Packs the entries of the book into pages and builds the page index */
+class CtgPageWriter
+{
+public:
+    CtgPageWriter(QIODevice* ctg, int baseLevel) :
+        m_ctg(ctg), m_page(CTG_PAGE_SIZE, 0), m_pageIndex(0), m_positions(0), m_used(4),
+        m_baseLevel(baseLevel), m_high(0)
+    {
+    }
+
+    /** Place the entries of a bucket of level m_baseLevel, which share the lowest bits of their hash */
+    bool addBucket(const QVector<QPair<quint32, QByteArray> >& bucket)
+    {
+        return place(bucket, 0, bucket.count(), m_baseLevel);
+    }
+
+    /** Write the last page and return false if writing failed */
+    bool finish()
+    {
+        return flushPage();
+    }
+
+    quint32 low() const { return (quint32(1) << m_baseLevel) - 1; }
+    quint32 high() const { return m_high; }
+    const QVector<qint32>& pageIndex() const { return m_index; }
+
+private:
+    void setIndex(quint32 key, qint32 page)
+    {
+        if ((quint32)m_index.count() <= key) {
+            int count = m_index.count();
+            m_index.resize(key + 1);
+            std::fill(m_index.begin() + count, m_index.end(), -1);
+        }
+        m_index[key] = page;
+        m_high = std::max(m_high, key);
+    }
+
+    bool place(const QVector<QPair<quint32, QByteArray> >& bucket, int begin, int end, int level)
+    {
+        // A bucket of a level holds the positions whose hashes agree in the lowest level bits,
+        // which are the highest bits of the order
+        quint32 mask = (quint32(1) << level) - 1;
+        quint32 key = (reverse_bits(bucket[begin].first) & mask) + mask;
+        int size = 0;
+        for (int i=begin; i<end; ++i) size += bucket[i].second.size();
+
+        if (size > CTG_PAGE_SIZE - 4 && level < CTG_MAX_LEVEL) {
+            // Too large for a page, so it is split by the next bit
+            setIndex(key, -1);
+            quint32 bit = quint32(1) << (31 - level);
+            int mid = begin;
+            while (mid < end && !(bucket[mid].first & bit)) ++mid;
+            if (mid > begin && !place(bucket, begin, mid, level + 1)) return false;
+            if (mid < end && !place(bucket, mid, end, level + 1)) return false;
+            return true;
+        }
+
+        if (m_used + size > CTG_PAGE_SIZE && !flushPage()) return false;
+        for (int i=begin; i<end; ++i) {
+            const QByteArray& entry = bucket[i].second;
+            if (m_used + entry.size() > CTG_PAGE_SIZE) {
+                qWarning() << "Dropping ctg positions with equal hashes";
+                break;
+            }
+            memcpy(m_page.data() + m_used, entry.constData(), entry.size());
+            m_used += entry.size();
+            ++m_positions;
+        }
+        setIndex(key, m_pageIndex);
+        return true;
+    }
+
+    bool flushPage()
+    {
+        if (!m_positions) return true;
+        qToBigEndian<quint16>(m_positions, (uchar*)m_page.data());
+        qToBigEndian<quint16>(m_used, (uchar*)m_page.data() + 2);
+        if (!m_ctg->seek(qint64(CTG_PAGE_SIZE) * (m_pageIndex + 1)) || m_ctg->write(m_page) != CTG_PAGE_SIZE) {
+            return false;
+        }
+        m_page.fill(0);
+        ++m_pageIndex;
+        m_positions = 0;
+        m_used = 4;
+        return true;
+    }
+
+    QIODevice* m_ctg;
+    QByteArray m_page;
+    qint32 m_pageIndex;
+    quint16 m_positions;
+    int m_used;
+    int m_baseLevel;
+    quint32 m_high;
+    QVector<qint32> m_index;
+};
+
+void append_24(QByteArray& data, quint64 n)
+{
+    n = std::min<quint64>(n, 0xFFFFFF);
+    data.append(char(n >> 16)).append(char(n >> 8)).append(char(n));
+}
+
+void append_32(QByteArray& data, quint64 n)
+{
+    n = std::min<quint64>(n, 0xFFFFFFFF);
+    data.append(char(n >> 24)).append(char(n >> 16)).append(char(n >> 8)).append(char(n));
+}
+
+} // namespace
+
+bool CtgDatabase::write_book(volatile bool& breakFlag)
+{
+    // Reduce the number of runs until they can be merged at once
+    while (m_runs.count() > m_mergeRuns) {
+        QList<QTemporaryFile*> runs = m_runs.mid(0, m_mergeRuns);
+        QTemporaryFile* merged = new QTemporaryFile;
+        if (!merged->open()) {
+            delete merged;
+            return false;
+        }
+        QVector<ctg_record_t> buffer;
+        buffer.reserve(CTG_READ_RECORDS);
+        auto write = [&]() {
+            qint64 size = qint64(sizeof(ctg_record_t)) * buffer.count();
+            bool ok = merged->write((const char*)buffer.constData(), size) == size;
+            buffer.clear();
+            return ok;
+        };
+        bool ok = merge_runs(runs, [&](const ctg_record_t& record) {
+            buffer.append(record);
+            return buffer.count() < CTG_READ_RECORDS || write();
+        }, breakFlag) && write() && merged->flush();
+        qDeleteAll(runs);
+        m_runs = m_runs.mid(m_mergeRuns);
+        m_runs.append(merged);
+        if (!ok) return false;
+    }
+
+    // Collect the entries of all positions, sorted by their order
+    QTemporaryFile entries;
+    if (!entries.open()) return false;
+    QDataStream entryStream(&entries);
+    quint64 positions = 0;
+    quint64 entryBytes = 0;
+
+    ctg_record_t position = { };
+    quint32 moveGames[256];
+    bool pending = false;
+    auto writeEntry = [&]() {
+        if (position.games < m_minGame) return true;
+
+        // The most frequent moves which are played often enough
+        QVector<QPair<quint32, int> > moves;
+        for (int i=0; i<256; ++i) {
+            if (moveGames[i] && moveGames[i] >= m_minGame) moves.append(qMakePair(moveGames[i], i));
+        }
+        std::sort(moves.begin(), moves.end(), [](const QPair<quint32, int>& a, const QPair<quint32, int>& b) {
+            return a.first > b.first;
+        });
+        if (moves.count() > CTG_MAX_MOVES) moves.resize(CTG_MAX_MOVES);
+
+        // Keep the average rating if the sum does not fit into 32 bits
+        quint64 rating_games = position.rating_games;
+        quint64 rating_sum = position.rating_sum;
+        while (rating_sum > 0xFFFFFFFF || rating_games > 0xFFFFFF) {
+            rating_sum /= 2;
+            rating_games /= 2;
+        }
+
+        QByteArray entry;
+        entry.append((const char*)position.sig, position.sig[0] % 32);
+        entry.append(char(1 + 2 * moves.count()));
+        for (const QPair<quint32, int>& move: std::as_const(moves)) {
+            entry.append(char(move.second)).append(char(0));
+        }
+        append_24(entry, position.games);
+        append_24(entry, position.losses);
+        append_24(entry, position.wins);
+        append_24(entry, position.draws);
+        append_32(entry, 0);
+        append_24(entry, rating_games);
+        append_32(entry, rating_sum);
+        append_24(entry, 0);
+        append_32(entry, 0);
+        entry.append(3, char(0));
+
+        entryStream << position.order << entry;
+        ++positions;
+        entryBytes += entry.size();
+        return entryStream.status() == QDataStream::Ok;
+    };
+
+    bool ok = merge_runs(m_runs, [&](const ctg_record_t& record) {
+        if (!pending || !same_position(position, record)) {
+            if (pending && !writeEntry()) return false;
+            position = record;
+            position.games = position.wins = position.losses = position.draws = position.rating_games = 0;
+            position.rating_sum = 0;
+            memset(moveGames, 0, sizeof(moveGames));
+            pending = true;
+        }
+        combine_record(position, record);
+        if (record.move != CTG_NO_MOVE) moveGames[record.move] += record.games;
+        return true;
+    }, breakFlag) && (!pending || writeEntry());
+    qDeleteAll(m_runs);
+    m_runs.clear();
+    if (!ok || breakFlag) return false;
+    m_count = positions;
+
+    // Buckets of the base level fill about half a page on average
+    int baseLevel = std::max(1, m_baseLevel);
+    if (positions && !m_baseLevel) {
+        quint64 perPage = std::max<quint64>(1, (CTG_PAGE_SIZE - 4) * positions / entryBytes);
+        while (baseLevel < CTG_MAX_LEVEL && (quint64(1) << baseLevel) * perPage < 2 * positions) ++baseLevel;
+    }
+
+    CtgPageWriter pages(ctg_file, baseLevel);
+    entries.seek(0);
+    QVector<QPair<quint32, QByteArray> > bucket;
+    quint32 bucketShift = 32 - baseLevel;
+    for (quint64 i=0; i<positions; ++i) {
+        quint32 order;
+        QByteArray entry;
+        entryStream >> order >> entry;
+        if (entryStream.status() != QDataStream::Ok) return false;
+        if (!bucket.isEmpty() && (bucket.first().first >> bucketShift) != (order >> bucketShift)) {
+            if (!pages.addBucket(bucket)) return false;
+            bucket.clear();
+        }
+        bucket.append(qMakePair(order, entry));
+    }
+    if (!bucket.isEmpty() && !pages.addBucket(bucket)) return false;
+    if (!pages.finish()) return false;
+
+    // Index of the pages, -1 for buckets which are empty or split
+    QByteArray index(16, 0);
+    for (qint32 page: pages.pageIndex()) {
+        append_32(index, quint32(page));
+    }
+    QByteArray bounds(4, 0);
+    append_32(bounds, pages.low());
+    append_32(bounds, pages.high());
+    return cto_file->write(index) == index.size() && ctb_file->write(bounds) == bounds.size();
 }
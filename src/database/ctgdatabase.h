@@ -5,6 +5,12 @@
 #ifndef CTGDATABASE_H
 #define CTGDATABASE_H
 
+#include <functional>
+
+#include <QList>
+#include <QTemporaryFile>
+#include <QVector>
+
 #include "database.h"
 #include "movedata.h"
 #include <stdint.h>
@@ -52,8 +58,13 @@ public:
     unsigned int getMoveMapForBoard(const BoardX &board, QMap<Move, MoveData>& moves);
     /** Start a search for a new key */
     void reset();
-    /** Compile a ctg book (to be done) */
+    /** Compile a ctg book from the games of @p db, using temporary files
+        to keep the memory bounded for large databases */
     void book_make(Database& db, volatile bool& breakFlag);
+    /** Override the limits of book_make(): the records sorted in memory per run, the runs
+        merged at once and the level of the page index whose buckets are placed first,
+        0 to choose it by the size of the book. Used by tests on small books. */
+    void setBuildLimits(int runRecords, int mergeRuns, int baseLevel);
 
 signals:
 
@@ -106,6 +117,25 @@ protected: // Methods which interface with ChessX
     /** Get the ctg entry associated with the given position. */
     bool ctg_get_entry(const BoardX& pos, ctg_entry_t* entry) const;
 
+protected: // Book building
+    /** Convert a native move to the ctg-format, the inverse of byte_to_move().
+        Returns false if the move cannot be encoded, e.g. an underpromotion. */
+    bool move_to_byte(const BoardX& pos, Move move, uint8_t* byte) const;
+
+    /** Record the positions of the main line of @p game up to the maximum ply */
+    void add_game(GameX& game);
+    /** Record position @p pos of a game with the given @p result from White's view,
+        where @p move has been played and the side which moved in has @p rating */
+    void add_record(const BoardX& pos, uint16_t move, int result, int rating);
+    /** Sort and combine the records collected so far and write them as a run */
+    bool flush_run();
+    /** Merge the sorted @p runs, passing equal records combined to @p sink */
+    bool merge_runs(const QList<QTemporaryFile*>& runs,
+                    const std::function<bool(const ctg_record_t&)>& sink,
+                    volatile bool& breakFlag);
+    /** Merge all runs into the pages and index of the book */
+    bool write_book(volatile bool& breakFlag);
+
 private:
     QString m_filename;
     QIODevice* ctg_file;
@@ -114,6 +144,15 @@ private:
     quint64 m_count;
 
     page_bounds_t page_bounds;
+
+    int m_maxPly;
+    quint32 m_minGame;
+    /** Records of the current run and the runs written so far while building a book */
+    QVector<ctg_record_t> m_records;
+    QList<QTemporaryFile*> m_runs;
+    int m_runRecords;
+    int m_mergeRuns;
+    int m_baseLevel;
 };
 
 #endif // CTGDATABASE_H
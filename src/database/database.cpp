@@ -108,6 +108,26 @@ QString Database::tagValue(GameId gameId, TagIndex tag) const
 
 void Database::findPosition(const BoardX& position, PositionSearchOptions options, const QList<GameId>& games, QList<MoveId>& output, QMap<Move, MoveData>& stats)
 {
+    const PositionIndex* posIndex = positionIndex();
+    if (posIndex)
+    {
+        // answer from the index, no moves need to be parsed
+        PositionIndex::Range range = posIndex->range(position.getHashValue());
+        for (auto gameId: games)
+        {
+            PositionIndex::Hit hit;
+            if (!posIndex->lookup(range, gameId, hit) ||
+                ((options & PositionSearch_GameEnd) && !hit.atGameEnd()))
+            {
+                output.append(NO_MOVE);
+                continue;
+            }
+            output.append(hit.moveId);
+            updateMoveData(position, hit.move(position), gameId, stats);
+        }
+        return;
+    }
+
     for (auto gameId: games)
     {
         // search for position
@@ -132,47 +152,51 @@ void Database::findPosition(const BoardX& position, PositionSearchOptions option
             {
                 move = cursor.move(cursor.nextMove(moveId));
             }
+            updateMoveData(position, move, gameId, stats);
+        }
+    }
+}
 
-            // update metrics
-            auto& md = stats[move];
-            if (!md.results)
-            {
-                if (move.isLegal())
-                {
-                    md.san = position.moveToSan(move);
-                    md.localsan = position.moveToSan(move, true);
-                }
-                else
-                {
-                    // game is finished
-                    md.localsan = md.san = qApp->translate("MoveData", "[end]");
-                }
-                md.move = move;
-            }
-
-            auto result = m_index.tagValue(TagNameResult, gameId);
-            if(result == "1-0")
-            {
-                md.results.update(WhiteWin);
-            }
-            else if(result == "1/2-1/2")
-            {
-                md.results.update(Draw);
-            }
-            else if(result == "0-1")
-            {
-                md.results.update(BlackWin);
-            }
-            else
-            {
-                md.results.update(ResultUnknown);
-            }
-            auto elo = m_index.tagValue((position.toMove() == White)? TagNameWhiteElo: TagNameBlackElo, gameId);
-            md.rating.update(elo.toInt());
-            auto date = m_index.tagValue(TagNameDate, gameId);
-            md.year.update(date.section(".", 0, 0).toInt());
+void Database::updateMoveData(const BoardX& position, const Move& move, GameId gameId, QMap<Move, MoveData>& stats) const
+{
+    // update metrics
+    auto& md = stats[move];
+    if (!md.results)
+    {
+        if (move.isLegal())
+        {
+            md.san = position.moveToSan(move);
+            md.localsan = position.moveToSan(move, true);
+        }
+        else
+        {
+            // game is finished
+            md.localsan = md.san = qApp->translate("MoveData", "[end]");
         }
+        md.move = move;
+    }
+
+    auto result = m_index.tagValue(TagNameResult, gameId);
+    if(result == "1-0")
+    {
+        md.results.update(WhiteWin);
+    }
+    else if(result == "1/2-1/2")
+    {
+        md.results.update(Draw);
+    }
+    else if(result == "0-1")
+    {
+        md.results.update(BlackWin);
+    }
+    else
+    {
+        md.results.update(ResultUnknown);
     }
+    auto elo = m_index.tagValue((position.toMove() == White)? TagNameWhiteElo: TagNameBlackElo, gameId);
+    md.rating.update(elo.toInt());
+    auto date = m_index.tagValue(TagNameDate, gameId);
+    md.year.update(date.section(".", 0, 0).toInt());
 }
 
 bool Database::replace(GameId, GameX &)
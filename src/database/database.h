@@ -17,6 +17,8 @@
 #include "refcount.h"
 #include "move.h"
 #include "movedata.h"
+#include "positionindex.h"
+#include "materialindex.h"
 
 #include <QMutex>
 #include <QString>
@@ -88,8 +90,14 @@ public:
     virtual void loadGameMoves(GameId index, GameX& game) = 0;
     /** Loads game moves and try to find a position */
     virtual int findPosition(GameId index, const BoardX& position) = 0;
+    /** @return true if loadGameMoves() and findPosition() may be called from several threads at once */
+    virtual bool supportsConcurrentLoads() const { return false; }
     /** Perform batched position search */
     virtual void findPosition(const BoardX& position, PositionSearchOptions options, const QList<GameId>& games, QList<MoveId>& output, QMap<Move, MoveData>& stats);
+    /** @return the position index of the database, nullptr if no index is available */
+    virtual const PositionIndex* positionIndex() const { return nullptr; }
+    /** @return the material index of the database, nullptr if there is none */
+    virtual const MaterialIndex* materialIndex() const { return nullptr; }
     /** Saves a game at the given position, returns true if successful */
     virtual bool replace(GameId, GameX&);
     /** Adds a game to the database */
@@ -112,6 +120,8 @@ public:
     virtual bool isModified() const;
     /** Set / Reset the modification flag. */
     virtual void setModified(bool) { }
+    /** Set the modification flag for tags of @p gameIds changed in the index */
+    virtual void setTagsModified(const QVector<GameId>& gameIds) { if (!gameIds.isEmpty()) setModified(true); }
     virtual void startTransaction(bool) { }
     /** Get the Valid Flag for a given game id from the index */
     virtual bool getValidFlag(GameId gameId) const;
@@ -128,6 +138,8 @@ public:
 protected:
     /** Copies all tags from @p game to the Index */
     void setTagsToIndex(const GameX& game, GameId id);
+    /** Add game @p gameId playing @p move from @p position to the statistics @p stats */
+    void updateMoveData(const BoardX& position, const Move& move, GameId gameId, QMap<Move, MoveData>& stats) const;
 
 signals:
     /** Signal emitted when some progress is done. */
@@ -0,0 +1,122 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <algorithm>
+
+#include <QFuture>
+#include <QHash>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+#include "database.h"
+#include "ecoclassifier.h"
+#include "ecopositions.h"
+#include "filter.h"
+#include "gamex.h"
+#include "index.h"
+#include "refcount.h"
+#include "tags.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+EcoClassifier::EcoClassifier(Database* database) :
+    m_database(database)
+{
+}
+
+int EcoClassifier::classify(const FilterX* filter, bool preserve, volatile bool* breakFlag)
+{
+    if (!EcoPositions::waitForEco())
+    {
+        return 0;
+    }
+
+    RefKeeper keeper(m_database->refCounter());
+    IndexX* index = m_database->index();
+    int n = std::min<int>(int(m_database->count()), index->count());
+
+    QVector<GameId> games;
+    const QVector<ValueIndex> ecoColumn = index->tagColumn(TagNameECO);
+    QHash<ValueIndex, bool> hasEco;
+    for (int i = 0; i < n; ++i)
+    {
+        if ((filter && !filter->contains(i)) || index->deleted(i))
+        {
+            continue;
+        }
+        if (preserve)
+        {
+            ValueIndex valueIndex = ecoColumn[i];
+            auto it = hasEco.constFind(valueIndex);
+            if (it == hasEco.constEnd())
+            {
+                QString eco = index->tagValueFromIndex(valueIndex);
+                it = hasEco.insert(valueIndex, !eco.isEmpty() && eco != "?");
+            }
+            if (it.value())
+            {
+                continue;
+            }
+        }
+        games.append(i);
+    }
+
+    // Each range only writes its own part of the results, the strings are owned by EcoPositions
+    QVector<const QString*> results(games.count(), nullptr);
+    auto classifyRange = [&](int begin, int end)
+    {
+        GameX game;
+        for (int i = begin; i < end; ++i)
+        {
+            if ((i & 0xFF) == 0 && breakFlag && *breakFlag)
+            {
+                return;
+            }
+            m_database->loadGameMoves(games[i], game);
+            results[i] = game.ecoClassification();
+        }
+    };
+
+    int threads = std::max(1, std::min(QThread::idealThreadCount(), int(games.count()) / 256));
+    int chunk = (int(games.count()) + threads - 1) / threads;
+    QVector<QFuture<void> > futures;
+    for (int begin = 0; begin < games.count(); begin += chunk)
+    {
+        int end = std::min(begin + chunk, int(games.count()));
+        futures.append(QtConcurrent::run([&classifyRange, begin, end]() { classifyRange(begin, end); }));
+    }
+    for (QFuture<void>& future: futures)
+    {
+        future.waitForFinished();
+    }
+    if (breakFlag && *breakFlag)
+    {
+        return 0;
+    }
+
+    QVector<GameId> gameIds;
+    QVector<QString> codes;
+    QHash<const QString*, QString> codeOf;
+    for (int i = 0; i < games.count(); ++i)
+    {
+        if (!results[i])
+        {
+            continue;
+        }
+        auto it = codeOf.constFind(results[i]);
+        if (it == codeOf.constEnd())
+        {
+            it = codeOf.insert(results[i], results[i]->left(3));
+        }
+        gameIds.append(games[i]);
+        codes.append(it.value());
+    }
+    index->setTagValues(TagNameECO, gameIds, codes);
+    m_database->setTagsModified(gameIds);
+    return gameIds.count();
+}
@@ -0,0 +1,35 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef ECOCLASSIFIER_H
+#define ECOCLASSIFIER_H
+
+class Database;
+class FilterX;
+
+/** @ingroup Database
+ * The EcoClassifier class classifies the games of a database by their ECO
+ * code in bulk and writes the codes into the ECO tag of the index. The
+ * classified games are marked as modified in the database.
+ *
+ * The main line of each game is replayed once, probing the hash table of
+ * EcoPositions at each ply. The games are split into ranges which are
+ * classified in parallel, the index is updated once all ranges are done.
+ */
+class EcoClassifier
+{
+public:
+    explicit EcoClassifier(Database* database);
+
+    /** Classify the games of @p filter, all games of the database if nullptr.
+        Games with an ECO tag keep it if @p preserve is set, games without
+        a classification keep their tag as well.
+        @return the number of games whose ECO tag was set */
+    int classify(const FilterX* filter, bool preserve, volatile bool* breakFlag = nullptr);
+
+private:
+    Database* m_database;
+};
+
+#endif // ECOCLASSIFIER_H
@@ -16,6 +16,8 @@ using namespace chessx;
 #endif // _MSC_VER
 
 QMap<quint64, QString>* EcoPositions::m_ecoPositions = nullptr;
+QHash<QString, QString>* EcoPositions::m_ecoNames = nullptr;
+QVector<EcoPositions::EcoSlot>* EcoPositions::m_ecoTable = nullptr;
 volatile bool EcoPositions::m_ecoReady = false;
 
 bool EcoPositions::loadEcoFile(const QString& ecoFile)
@@ -31,6 +33,8 @@ bool EcoPositions::loadEcoFile(const QString& ecoFile)
         if(id == COMPILED_ECO_FILE_ID)
         {
             sin >> *m_ecoPositions;
+            buildEcoNames();
+            buildEcoTable();
             return true;
         }
         return false;
@@ -38,52 +42,136 @@ bool EcoPositions::loadEcoFile(const QString& ecoFile)
     return false;
 }
 
-QString EcoPositions::findEcoNameDetailed(QString eco)
+void EcoPositions::buildEcoNames()
 {
+    // The first entry in the order of the positions wins, as with a scan of m_ecoPositions
+    QHash<QString, QString>* names = new QHash<QString, QString>();
     for (const auto& actualEco: std::as_const(*m_ecoPositions))
     {
-        if (actualEco.startsWith(eco))
+        QString code = actualEco.section(" ",0,0);
+        QString opName;
+        for (int n = code.length(); n >= 0; --n)
         {
-            QString opName = actualEco.section(" ",1);
-            return opName;
+            QString prefix = code.left(n);
+            if (names->contains(prefix))
+            {
+                // Shorter prefixes have been inserted along with this one
+                break;
+            }
+            if (opName.isNull())
+            {
+                opName = actualEco.section(" ",1);
+            }
+            names->insert(prefix, opName);
         }
     }
-    return QString();
+    delete m_ecoNames;
+    m_ecoNames = names;
 }
 
-QString EcoPositions::findEcoName(QString eco)
+void EcoPositions::buildEcoTable()
+{
+    // Keep the table at most half full, so that probes stay short
+    int size = 1;
+    while (size < 2 * m_ecoPositions->count())
+    {
+        size <<= 1;
+    }
+    QVector<EcoSlot>* table = new QVector<EcoSlot>(size);
+    for (auto it = m_ecoPositions->cbegin(); it != m_ecoPositions->cend(); ++it)
+    {
+        int i = int(it.key() & (size - 1));
+        while (!(*table)[i].eco.isNull())
+        {
+            i = (i + 1) & (size - 1);
+        }
+        (*table)[i].key = it.key();
+        (*table)[i].eco = it.value();
+    }
+    delete m_ecoTable;
+    m_ecoTable = table;
+}
+
+QString EcoPositions::findEcoNameDetailed(QString eco)
 {
+    if (m_ecoNames)
+    {
+        auto it = m_ecoNames->constFind(eco);
+        if (it != m_ecoNames->constEnd())
+        {
+            return it.value();
+        }
+        if (!eco.contains(' '))
+        {
+            return QString();
+        }
+    }
+
+    // Prefixes reaching into the names are not indexed
     for (const auto& actualEco: std::as_const(*m_ecoPositions))
     {
         if (actualEco.startsWith(eco))
         {
             QString opName = actualEco.section(" ",1);
-            if (opName.contains(':'))
-            {
-                opName = opName.section(":",0,0);
-            }
             return opName;
         }
     }
     return QString();
 }
 
+QString EcoPositions::findEcoName(QString eco)
+{
+    QString opName = findEcoNameDetailed(eco);
+    if (opName.contains(':'))
+    {
+        opName = opName.section(":",0,0);
+    }
+    return opName;
+}
+
 void EcoPositions::terminateEco()
 {
     QMap<quint64, QString>* p = m_ecoPositions;
     m_ecoPositions = nullptr;
     delete p;
+    QHash<QString, QString>* names = m_ecoNames;
+    m_ecoNames = nullptr;
+    delete names;
+    QVector<EcoSlot>* table = m_ecoTable;
+    m_ecoTable = nullptr;
+    delete table;
 }
 
-bool EcoPositions::isEcoPosition(const BoardX& b, QString& eco)
+bool EcoPositions::waitForEco()
 {
     while (!m_ecoReady) QThread::sleep(1);
-    if (!m_ecoPositions) return false;
+    return m_ecoTable != nullptr;
+}
+
+const QString* EcoPositions::findEco(quint64 key)
+{
+    if (!m_ecoTable) return nullptr;
+
+    int mask = m_ecoTable->count() - 1;
+    const EcoSlot* table = m_ecoTable->constData();
+    for (int i = int(key & mask); !table[i].eco.isNull(); i = (i + 1) & mask)
+    {
+        if (table[i].key == key)
+        {
+            return &table[i].eco;
+        }
+    }
+    return nullptr;
+}
+
+bool EcoPositions::isEcoPosition(const BoardX& b, QString& eco)
+{
+    if (!waitForEco()) return false;
 
-    quint64 key = b.getHashValue();
-    if(m_ecoPositions->contains(key))
+    const QString* found = findEco(b.getHashValue());
+    if (found)
     {
-        eco = m_ecoPositions->value(key);
+        eco = *found;
         return true;
     }
     return false;
@@ -5,8 +5,10 @@
 #ifndef ECOPOSITIONS_H
 #define ECOPOSITIONS_H
 
+#include <QHash>
 #include <QMap>
 #include <QString>
+#include <QVector>
 #include "board.h"
 
 #define COMPILED_ECO_FILE_ID ((quint32)0xCD5CBD02U)
@@ -15,6 +17,8 @@ struct EcoPositions
 {
 public:
     static QMap<quint64, QString>* m_ecoPositions;
+    /** Detailed opening names by each prefix of the ECO codes, built by loadEcoFile */
+    static QHash<QString, QString>* m_ecoNames;
     static volatile bool m_ecoReady;
 
     /** Method that loads a file containing ECO classifications for use by the ecoClassify method. Returns true if successful */
@@ -24,6 +28,27 @@ public:
     static void terminateEco();
 
     static bool isEcoPosition(const BoardX &b, QString &eco);
+    /** Wait until the ECO file is loaded.
+        @return true if ECO classifications are available */
+    static bool waitForEco();
+    /** Lookup the position with hash @p key without waiting for the ECO file.
+        The result points into the table and is shared by all threads.
+        @return the ECO classification or nullptr if the position is not known */
+    static const QString* findEco(quint64 key);
+
+private:
+    /** Fill m_ecoNames from m_ecoPositions */
+    static void buildEcoNames();
+    /** Fill m_ecoTable from m_ecoPositions */
+    static void buildEcoTable();
+
+    struct EcoSlot
+    {
+        quint64 key;
+        QString eco;
+    };
+    /** Open addressing hash table of m_ecoPositions, empty slots have a null eco */
+    static QVector<EcoSlot>* m_ecoTable;
 };
 
 #endif // ECOPOSITIONS_H
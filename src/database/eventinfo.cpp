@@ -7,6 +7,7 @@
 
 #include "eventinfo.h"
 #include "database.h"
+#include "gamestatistics.h"
 #include "tags.h"
 
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -57,85 +58,54 @@ void EventInfo::setName(const QString& event)
     update();
 }
 
-float EventInfo::toPoints(const QString& res) const
+void EventInfo::update()
 {
-    if(res.startsWith("1/2"))
-    {
-        return 0.5;
-    }
-    else if(res.startsWith('1'))
-    {
-        return 1.0;
-    }
-    else if(res.startsWith('0'))
-    {
-        return 0.0;
-    }
-    else if(res.startsWith("+-"))
-    {
-        return 1.0;
-    }
-    else if(res.startsWith("-+"))
-    {
-        return 0.0;
-    }
-    else if(res.startsWith("+--"))
-    {
-        return 1.0;
-    }
-    else if(res.startsWith("--+"))
-    {
-        return 0.0;
-    }
-    else
+    // Clean previous statistics
+    reset();
+    if(!m_database)
     {
-        return ResultUnknown;
+        return;
     }
-}
-
-void EventInfo::update()
-{
-    QHash<QString, float> players;
-
     const IndexX* index = m_database->index();
 
-    // Determine matching tag values
-    ValueIndex event = index->getValueIndex(m_name);
+    GameStatistics statistics(m_database);
+    GameStatistics::Query query;
+    query.filterTag = TagNameEvent;
+    query.filterValue = index->getValueIndex(m_name);
 
-    // Clean previous statistics
-    reset();
+    // Every game has one White player, so the groups by White add up to the event
+    query.groupTag = TagNameWhite;
+    const GameStatistics::Groups white = statistics.aggregate(query);
+    query.groupTag = TagNameBlack;
+    const GameStatistics::Groups black = statistics.aggregate(query);
 
-    for(int i = 0; i < (int) m_database->count(); ++i)
+    GameStatistics::Aggregate total;
+    QHash<QString, float> players;
+    for(auto it = white.cbegin(); it != white.cend(); ++it)
     {
-        if(index->valueIndexFromTag(TagNameEvent, i) != event)
-        {
-            continue;
-        }
-        QString result = index->tagValue(TagNameResult, i);
-        int res = ResultFromString(result);
-        QString whitePlayer = index->tagValue(TagNameWhite, i);
-        QString blackPlayer = index->tagValue(TagNameBlack, i);
-        // The following works as QHash initializes a default-constructed value to 0
-        players[whitePlayer] += toPoints(result);
-        players[blackPlayer] += (1.0 - toPoints(result));
-        m_games[whitePlayer]++;
-        m_games[blackPlayer]++;
-        m_result[res]++;
-        m_count++;
-        PartialDate date(index->tagValue(TagNameDate, i));
-        if(date.year() > 1000)
-        {
-            m_date[0] = qMin(date, m_date[0]);
-            m_date[1] = qMax(date, m_date[1]);
-        }
+        total.add(it.value());
+        QString player = index->tagValueFromIndex(it.key());
+        players[player] += it.value().points;
+        m_games[player] += it.value().count;
+    }
+    for(auto it = black.cbegin(); it != black.cend(); ++it)
+    {
+        QString player = index->tagValueFromIndex(it.key());
+        players[player] += it.value().count - it.value().points;
+        m_games[player] += it.value().count;
     }
 
-    QHashIterator<QString,float> kviter(players);
+    for(int r = 0; r < 4; ++r)
+    {
+        m_result[r] = total.result[r];
+    }
+    m_count = total.count;
+    m_date[0] = total.minDate;
+    m_date[1] = total.maxDate;
 
-    while(kviter.hasNext())
+    for(auto it = players.cbegin(); it != players.cend(); ++it)
     {
-        kviter.next();
-        m_players.append(PlayerInfoListItem(kviter.key(), kviter.value()));
+        m_players.append(PlayerInfoListItem(it.key(), it.value()));
     }
     std::sort(m_players.begin(), m_players.end(), sortPlayersLt);
 }
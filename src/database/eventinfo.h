@@ -56,7 +56,6 @@ private:
 
     /** Format score statistics for single color. */
     QString formattedScore(const int results[4], int count) const;
-    float toPoints(const QString& res) const;
 
     int m_result[4];
     int m_count;
@@ -12,7 +12,9 @@
 #include "database.h"
 #include "filter.h"
 #include "filtersearch.h"
+#include <QtConcurrent/QtConcurrent>
 #include <QtDebug>
+#include <atomic>
 
 using namespace chessx;
 
@@ -21,6 +23,9 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
+/** Number of games handed out at once to the threads of a parallel search */
+#define SEARCH_BLOCK_SIZE 1024
+
 FilterX::FilterX(Database* database) : QThread()
 {
     m_database = database;
@@ -161,64 +166,103 @@ void FilterX::invert()
     }
 }
 
-void FilterX::runSingleSearch(Search* s, FilterOperator op)
+bool FilterX::searchValue(Search* s, FilterOperator op, GameId game, value_type& value) const
 {
-    connect(s, SIGNAL(prepareUpdate(int)), this, SIGNAL(searchProgress(int)));
-    s->Prepare(m_break);
     switch (op)
     {
     case FilterOperator::NullOperator:
-        for(int searchIndex = 0, sz = static_cast<int>(size()); searchIndex < sz; ++searchIndex)
-        {
-            if (m_break) break;
-            set(searchIndex, s->matches(searchIndex));
-            if (searchIndex % 1024 == 0) emit searchProgress(searchIndex*100/size());
-        }
-        break;
+        value = s->matches(game);
+        return true;
     case FilterOperator::And:
-        for(int searchIndex = 0, sz = static_cast<int>(size()); searchIndex < sz; ++searchIndex)
+        if (contains(game))
         {
-            if (m_break) break;
-            if (contains(searchIndex))
-            {
-                int n = s->matches(searchIndex);
-                if (n!=1) // Better search result or and does not apply
-                {
-                    set(searchIndex, n);
-                }
-            }
-            if (searchIndex % 1024 == 0) emit searchProgress(searchIndex*100/size());
+            int n = s->matches(game);
+            value = n;
+            return n!=1; // Better search result or and does not apply
         }
-        break;
+        return false;
     case FilterOperator::Or:
-        for(int searchIndex = 0, sz = static_cast<int>(size()); searchIndex < sz; ++searchIndex)
+        if (!contains(game))
         {
-            if (m_break) break;
-            if (!contains(searchIndex))
+            int n = s->matches(game);
+            value = n;
+            return n!=0;
+        }
+        return false;
+    case FilterOperator::Remove:
+        value = 0;
+        return contains(game) && s->matches(game);
+    default:
+        return false;
+    }
+}
+
+void FilterX::runSingleSearch(Search* s, FilterOperator op)
+{
+    connect(s, SIGNAL(prepareUpdate(int)), this, SIGNAL(searchProgress(int)));
+    s->Prepare(m_break);
+    if (s->isThreadSafe() && QThread::idealThreadCount() > 1 && size() > SEARCH_BLOCK_SIZE)
+    {
+        runParallelSearch(s, op);
+        return;
+    }
+    for(int searchIndex = 0, sz = static_cast<int>(size()); searchIndex < sz; ++searchIndex)
+    {
+        if (m_break) break;
+        value_type value;
+        if (searchValue(s, op, searchIndex, value))
+        {
+            set(searchIndex, value);
+        }
+        if (searchIndex % SEARCH_BLOCK_SIZE == 0) emit searchProgress(searchIndex*100/size());
+    }
+}
+
+void FilterX::runParallelSearch(Search* s, FilterOperator op)
+{
+    // Idle threads take the next block of games, so slow games do not stall the others.
+    // Each game is written by one thread only, the count is corrected at the end.
+    const int sz = static_cast<int>(size());
+    value_type* values = m_vector->data();
+    std::atomic<int> nextBlock(0);
+    std::atomic<int> searched(0);
+    std::atomic<int> countDelta(0);
+
+    auto work = [this, s, op, sz, values, &nextBlock, &searched, &countDelta](bool reportProgress)
+    {
+        int delta = 0;
+        for (int begin = nextBlock.fetch_add(SEARCH_BLOCK_SIZE); begin < sz && !m_break; begin = nextBlock.fetch_add(SEARCH_BLOCK_SIZE))
+        {
+            int end = qMin(begin + SEARCH_BLOCK_SIZE, sz);
+            for (int i = begin; i < end && !m_break; ++i)
             {
-                int n = s->matches(searchIndex);
-                if (n)
+                value_type value;
+                if (searchValue(s, op, i, value) && values[i] != value)
                 {
-                    set(searchIndex, n);
+                    delta += (value != 0) - (values[i] != 0);
+                    values[i] = value;
                 }
             }
-            if (searchIndex % 1024 == 0) emit searchProgress(searchIndex*100/size());
-        }
-        break;
-    case FilterOperator::Remove:
-        for(int searchIndex = 0, sz = static_cast<int>(size()); searchIndex < sz; ++searchIndex)
-        {
-            if (m_break) break;
-            if (contains(searchIndex) && s->matches(searchIndex))
+            qint64 done = searched.fetch_add(end - begin) + end - begin;
+            if (reportProgress)
             {
-                set(searchIndex, 0);
+                emit searchProgress(static_cast<int>(done * 100 / sz));
             }
-            if (searchIndex % 1024 == 0) emit searchProgress(searchIndex*100/size());
         }
-        break;
-    default:
-        break;
+        countDelta.fetch_add(delta);
+    };
+
+    QList<QFuture<void>> futures;
+    for (int i = 1; i < QThread::idealThreadCount(); ++i)
+    {
+        futures.append(QtConcurrent::run([&work]() { work(false); }));
+    }
+    work(true);
+    for (QFuture<void>& future: futures)
+    {
+        future.waitForFinished();
     }
+    m_count += countDelta;
 }
 
 void FilterX::run()
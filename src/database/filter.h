@@ -37,6 +37,8 @@ public:
     /** Operator for joining filters */
 
     void runSingleSearch(Search* s, FilterOperator op);
+    /** Run a thread safe search on the thread pool */
+    void runParallelSearch(Search* s, FilterOperator op);
     void run();
     void cancel();
 
@@ -78,6 +80,9 @@ signals:
     void searchFinished();
 
 protected:
+    /** Compute the new value of @p game when joining search @p s with operator @p op.
+        @return false if the value of @p game does not change */
+    bool searchValue(Search* s, FilterOperator op, GameId game, value_type& value) const;
 
     int m_count;
     QVector<value_type>* m_vector;
@@ -10,6 +10,7 @@
 
 #include <QtDebug>
 #include <QFile>
+#include <algorithm>
 #include <utility>
 #include "gamecursor.h"
 
@@ -144,17 +145,46 @@ Move GameCursor::move(MoveId moveId) const
 
 int GameCursor::variationCount(MoveId moveId) const
 {
+    int count = 0;
     MoveId node = makeNodeIndex(moveId);
     if(node != NO_MOVE)
     {
-        return m_nodes[node].variations.size();
+        for (MoveId v = m_nodes[node].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
+        {
+            ++count;
+        }
     }
-    return 0;
+    return count;
+}
+
+QList<MoveId> GameCursor::variations() const
+{
+    return variations(m_currentNode);
 }
 
-const QList<MoveId>& GameCursor::variations() const
+QList<MoveId> GameCursor::variations(MoveId moveId) const
 {
-    return m_nodes[m_currentNode].variations;
+    QList<MoveId> list;
+    for (MoveId v = m_nodes[moveId].firstVariation; v != NO_MOVE; v = m_nodes[v].nextVariation)
+    {
+        list.append(v);
+    }
+    return list;
+}
+
+void GameCursor::setVariations(MoveId moveId, const QList<MoveId>& variations)
+{
+    MoveId* link = &m_nodes[moveId].firstVariation;
+    for (MoveId v: variations)
+    {
+        if (v == NO_MOVE)
+        {
+            continue;
+        }
+        *link = v;
+        link = &m_nodes[v].nextVariation;
+    }
+    *link = NO_MOVE;
 }
 
 bool GameCursor::isMainline(MoveId moveId) const
@@ -346,7 +376,7 @@ MoveId GameCursor::variationBranchPoint(MoveId variation) const
         MoveId prevNode = variation;
         while ((prevNode = m_nodes[prevNode].previousNode) != NO_MOVE)
         {
-            if (m_nodes[prevNode].variations.size())
+            if (m_nodes[prevNode].firstVariation != NO_MOVE)
             {
                 branch = prevNode;
                 break;
@@ -363,6 +393,17 @@ bool GameCursor::variationHasSiblings(MoveId variation) const
     return (variationBranchPoint(variation) != NO_MOVE);
 }
 
+bool GameCursor::linePath(MoveId moveId, Line& line) const
+{
+    MoveId node = moveId;
+    while (node > ROOT_NODE)
+    {
+        line.append(node);
+        node = m_nodes[node].previousNode;
+    }
+    return node == ROOT_NODE;
+}
+
 bool GameCursor::moveToId(MoveId moveId, QString* algebraicMoveList)
 {
     moveId = makeNodeIndex(moveId);
@@ -371,39 +412,62 @@ bool GameCursor::moveToId(MoveId moveId, QString* algebraicMoveList)
         return false;
     }
 
+    Line target;
+    linePath(moveId, target);
+
+    if (algebraicMoveList)
+    {
+        for (int i = target.size() - 1; i >= 0; --i)
+        {
+            const Move& m = m_nodes[target[i]].move;
+            if (m.isNullMove())
+            {
+                // Avoid trouble with a null move - UCI does not specify this and Stockfish makes nonsense
+                algebraicMoveList->clear();
+                break;
+            }
+            algebraicMoveList->push_back(m.toAlgebraic());
+            algebraicMoveList->push_back(" ");
+        }
+    }
+
     if (m_currentNode != moveId)
     {
-        //jump to node, travelling back to start adding the moves to the stack
-        MoveId node = moveId;
-        QStack<Move> moveStack;
-        while(node)
+        // Undo the moves back to the node both lines share, then play the moves of the target line.
+        // Jumps between nearby nodes cost a few moves, far jumps never cost more than a replay from
+        // the start. Jumps from the root always start over from the starting board.
+        Line current;
+        bool currentValid = (makeNodeIndex(m_currentNode) != NO_MOVE) && linePath(m_currentNode, current);
+        int common = 0;
+        if (currentValid)
         {
-            moveStack.push(m_nodes[node].move);
-            node = m_nodes[node].previousNode;
+            int n = std::min(target.size(), current.size());
+            while (common < n && target[target.size() - 1 - common] == current[current.size() - 1 - common])
+            {
+                ++common;
+            }
         }
 
-        //reset the board, then make the moves on the stack to create the correct position
-        m_currentNode = moveId;
-        *m_currentBoard = m_startingBoard;
-        while(!moveStack.isEmpty())
+        int undo = current.size() - common;
+        int redo = target.size() - common;
+        if (!currentValid || undo + redo >= target.size())
+        {
+            *m_currentBoard = m_startingBoard;
+            common = 0;
+        }
+        else
         {
-            Move m = moveStack.pop();
-            m_currentBoard->doMove(m);
-            if (algebraicMoveList)
+            for (int i = 0; i < undo; ++i)
             {
-                if (m.isNullMove())
-                {
-                    // Avoid trouble with a null move - UCI does not specify this and Stockfish makes nonsense
-                    algebraicMoveList->clear();
-                    algebraicMoveList = nullptr;
-                }
-                else
-                {
-                    algebraicMoveList->push_back(m.toAlgebraic());
-                    algebraicMoveList->push_back(" ");
-                }
+                m_currentBoard->undoMove(m_nodes[current[i]].move);
             }
         }
+
+        for (int i = target.size() - 1 - common; i >= 0; --i)
+        {
+            m_currentBoard->doMove(m_nodes[target[i]].move);
+        }
+        m_currentNode = moveId;
     }
 
     return true;
@@ -494,7 +558,9 @@ MoveId GameCursor::addVariation(const Move& move)
     auto saveNextNode = m_nodes[m_currentNode].nextNode;
     auto node = addMove(move);
     m_nodes[m_currentNode].parentNode = previousNode;
-    m_nodes[previousNode].variations.append(node);
+    QList<MoveId> vars = variations(previousNode);
+    vars.append(node);
+    setVariations(previousNode, vars);
     m_nodes[previousNode].nextNode = saveNextNode;
     return node;
 }
@@ -517,7 +583,8 @@ void GameCursor::remove(MoveId moveId, QList<MoveId>* removed)
     {
         removed->append(node);
     }
-    for (auto v: std::as_const(m_nodes[node].variations))
+    const QList<MoveId> vars = variations(node);
+    for (auto v: vars)
     {
         remove(v, removed);
     }
@@ -539,7 +606,8 @@ void GameCursor::truncateFrom(MoveId moveId, QList<MoveId>* removed)
     if (node == NO_MOVE)
         return;
     remove(m_nodes[node].nextNode, removed);
-    for (auto v: std::as_const(m_nodes[node].variations))
+    const QList<MoveId> vars = variations(node);
+    for (auto v: vars)
     {
         remove(v, removed);
     }
@@ -566,8 +634,8 @@ void GameCursor::truncateUpto(MoveId moveId, QList<MoveId>* removed)
     // Keep variation if truncating main line
     if(m_nodes[m_nodes[m_currentNode].previousNode].nextNode == m_currentNode)
     {
-        firstNode.variations = m_nodes[m_nodes[m_currentNode].previousNode].variations;
-        foreach(MoveId var, firstNode.variations)
+        firstNode.firstVariation = m_nodes[m_nodes[m_currentNode].previousNode].firstVariation;
+        for (MoveId var = firstNode.firstVariation; var != NO_MOVE; var = m_nodes[var].nextVariation)
         {
             reparentVariation(var, 0);
             m_nodes[var].previousNode = 0;
@@ -598,8 +666,11 @@ void GameCursor::promoteVariation(MoveId variation)
     reparentVariation(variation, m_nodes[parent].parentNode);
 
     // Swap main line and the variation
-    int index = m_nodes[parent].variations.indexOf(variation);
-    qSwap(m_nodes[parent].nextNode, m_nodes[parent].variations[index]);
+    QList<MoveId> vars = variations(parent);
+    int index = vars.indexOf(variation);
+    qSwap(m_nodes[parent].nextNode, vars[index]);
+    setVariations(parent, vars);
+    m_nodes[variation].nextVariation = NO_MOVE;
     moveToId(save);
 }
 
@@ -611,7 +682,7 @@ bool GameCursor::canMoveVariationUp(MoveId moveId) const
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     return i > 0;
 }
@@ -624,7 +695,7 @@ bool GameCursor::canMoveVariationDown(MoveId moveId) const
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     return 0 <= i && i + 1 < vars.size();
 }
@@ -637,12 +708,13 @@ bool GameCursor::moveVariationUp(MoveId moveId)
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     auto possible = i > 0;
     if (possible)
     {
         vars.swapItemsAt(i, i - 1);
+        setVariations(parentNode, vars);
     }
     return possible;
 }
@@ -655,12 +727,13 @@ bool GameCursor::moveVariationDown(MoveId moveId)
     auto variation = variationNumber(moveId);
     auto parentNode = m_nodes[moveId].parentNode;
 
-    auto& vars = m_nodes[parentNode].variations;
+    auto vars = variations(parentNode);
     int i = vars.indexOf(variation);
     auto possible = 0 <= i && i + 1 < vars.size();
     if (possible)
     {
         vars.swapItemsAt(i, i + 1);
+        setVariations(parentNode, vars);
     }
     return possible;
 }
@@ -676,9 +749,14 @@ bool GameCursor::removeVariation(MoveId variation)
     remove(variation);
     moveToId(parentNode);
 
-    QList<MoveId> &vars = m_nodes[m_currentNode].variations;
+    QList<MoveId> vars = variations(m_currentNode);
     int n = vars.indexOf(variation);
-    if (n>=0) vars.removeAt(n);
+    if (n>=0)
+    {
+        vars.removeAt(n);
+        setVariations(m_currentNode, vars);
+        m_nodes[variation].nextVariation = NO_MOVE;
+    }
     return true;
 }
 
@@ -686,9 +764,9 @@ void GameCursor::removeVariations()
 {
     for(int i = 0; i < m_nodes.size(); ++i)
     {
-        while (!m_nodes[i].variations.empty())
+        while (m_nodes[i].firstVariation != NO_MOVE)
         {
-            removeVariation(m_nodes[i].variations.at(0));
+            removeVariation(m_nodes[i].firstVariation);
         }
     }
 }
@@ -754,12 +832,34 @@ QMap<MoveId, MoveId> GameCursor::compact()
     // map NO_MOVE for simplicity
     renames[NO_MOVE] = NO_MOVE;
 
+    // unlink removed variations, so that the variation links only point to kept nodes
+    QMap<MoveId, QList<MoveId> > keptVariations;
+    for (MoveId i = 0; i < m_nodes.size(); ++i)
+    {
+        if (m_nodes[i].Removed() || m_nodes[i].firstVariation == NO_MOVE)
+            continue;
+        QList<MoveId> vars = variations(i);
+        vars.erase(std::remove_if(vars.begin(), vars.end(), [this](MoveId v)
+        {
+            return v == ROOT_NODE || m_nodes[v].Removed();
+        }), vars.end());
+        keptVariations[i] = vars;
+    }
+    for (auto& node: m_nodes)
+    {
+        node.firstVariation = node.nextVariation = NO_MOVE;
+    }
+    for (auto it = keptVariations.cbegin(); it != keptVariations.cend(); ++it)
+    {
+        setVariations(it.key(), it.value());
+    }
+
+    // write iterator, taken first as it detaches the arena
+    auto iw = m_nodes.begin();
     // arena ends
     auto ib = m_nodes.cbegin(), ie = m_nodes.cend();
     // read iterator
     auto ir = ib;
-    // write iterator
-    auto iw = m_nodes.begin();
     // keep track of indexes corresponding to `ir` and `iw`
     MoveId src = 0, dst = 0;
     for (; ir != ie; ++ir, ++src)
@@ -785,12 +885,8 @@ QMap<MoveId, MoveId> GameCursor::compact()
         node.nextNode = renames[node.nextNode];
         node.previousNode = renames[node.previousNode];
         node.parentNode = renames[node.parentNode];
-        for (auto& v: node.variations)
-        {
-            v = renames[v];
-        }
-        node.variations.removeAll(NO_MOVE);
-        node.variations.removeAll(ROOT_NODE);
+        node.firstVariation = renames[node.firstVariation];
+        node.nextVariation = renames[node.nextVariation];
     }
     m_currentNode = renames[m_currentNode];
     return renames;
@@ -832,8 +928,8 @@ void GameCursor::dumpMoveNode(MoveId moveId) const
         qDebug() << "   Prev node   : " << m_nodes.at(moveId).previousNode;
         qDebug() << "   Parent node : " << m_nodes.at(moveId).parentNode;
         qDebug() << "   Deleted     : " << m_nodes.at(moveId).Removed();
-        qDebug() << "   # Variations: " << m_nodes.at(moveId).variations.size();
-        qDebug() << "   Variations  : " << m_nodes.at(moveId).variations;
+        qDebug() << "   # Variations: " << variationCount(moveId);
+        qDebug() << "   Variations  : " << variations(moveId);
         qDebug() << "   Move        : " << m_nodes.at(moveId).move.toAlgebraic()
                  << " (" << m_nodes.at(moveId).move.rawMove()
                  << ", " << m_nodes.at(moveId).move.rawUndo()
@@ -2,6 +2,8 @@
 #define GAMECURSOR_H
 
 #include <QObject>
+#include <QVarLengthArray>
+#include <QVector>
 #include "board.h"
 #include "move.h"
 
@@ -22,13 +24,14 @@ public:
         MoveId previousNode; /* points to the previous node in a line, in case of a line start, it also points to the parent node */
         MoveId nextNode; /* points to the next node in a line */
         MoveId parentNode; /* points to the parent node when inside a line (all nodes in the line have this!) */
+        MoveId firstVariation; /* points to the first node of the first variation branching off here */
+        MoveId nextVariation; /* at a line start, points to the first node of the next variation of the same parent */
         short m_ply;
         Move move;
-        QList<MoveId> variations;
         void remove()
         {
-            parentNode = previousNode = nextNode = NO_MOVE;
-            variations.clear();
+            // nextVariation is kept, the node stays in the variations of its parent until compact()
+            parentNode = previousNode = nextNode = firstVariation = NO_MOVE;
             setRemoved();
         }
         void setRemoved()
@@ -38,7 +41,7 @@ public:
         Node()
         {
             parentNode = nextNode = previousNode = NO_MOVE;
-            variations.clear();
+            firstVariation = nextVariation = NO_MOVE;
             m_ply = 0;
         }
         void SetPly(short ply) { Q_ASSERT(m_ply<0x7FFF); m_ply = ply; }
@@ -47,7 +50,8 @@ public:
         inline bool operator==(const struct Node& c) const
         {
             return (move == c.move &&
-                    variations == c.variations &&
+                    firstVariation == c.firstVariation &&
+                    nextVariation == c.nextVariation &&
                     m_ply == c.m_ply);
         }
     };
@@ -97,8 +101,8 @@ public:
     /** @return number of variations at the current position */
     int variationCount(MoveId moveId = CURRENT_MOVE) const;
     /** @return list of variation at the current move */
-    const QList<MoveId>& variations() const;
-    const QList<MoveId>& variations(MoveId moveId) const { return m_nodes[moveId].variations; }
+    QList<MoveId> variations() const;
+    QList<MoveId> variations(MoveId moveId) const;
     /** @returns amount of allocated nodes */
     int capacity() const { return m_nodes.size(); }
 
@@ -136,7 +140,9 @@ public:
     /** @return Find the next Node back where the variation branches off  */
     MoveId variationBranchPoint(MoveId variation = CURRENT_MOVE) const;
 
-    /** Moves to the position corresponding to the given move id */
+    /** Moves to the position corresponding to the given move id.
+        The board is updated along the path from the current node, so the cost
+        depends on the distance of the nodes rather than on the length of the game. */
     bool moveToId(MoveId moveId, QString* algebraicMoveList=nullptr);
     /** Move forward the given number of moves, returns actual number of moves made */
     int forward(int count = 1);
@@ -201,10 +207,18 @@ public:
     int isEqual(const GameCursor& rhs) const { return m_nodes == rhs.m_nodes; }
 
 private:
+    /** Nodes of a line, deepest node first */
+    typedef QVarLengthArray<MoveId, 256> Line;
+    /** Collect the nodes from @p moveId back to the root into @p line, the root excluded.
+        @return false if the line does not reach the root */
+    bool linePath(MoveId moveId, Line& line) const;
+    /** Link @p variations as the variations of node @p moveId, in this order. NO_MOVE entries are skipped. */
+    void setVariations(MoveId moveId, const QList<MoveId>& variations);
+
     /** Keeps the current position of the game */
     BoardX* m_currentBoard;
-    /** List of nodes */
-    QList<Node> m_nodes;
+    /** List of nodes, a contiguous block shared by copies of the game until either is changed */
+    QVector<Node> m_nodes;
     /** Keeps the current node in the game */
     MoveId m_currentNode;
     /** Keeps the start position of the game */
@@ -213,4 +227,6 @@ private:
     void initCursor();
 };
 
+Q_DECLARE_TYPEINFO(GameCursor::Node, Q_MOVABLE_TYPE);
+
 #endif // GAMECURSOR_H
@@ -0,0 +1,222 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <algorithm>
+#include <functional>
+
+#include <QFuture>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+#include "database.h"
+#include "gamestatistics.h"
+#include "index.h"
+#include "result.h"
+#include "tags.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+GameStatistics::EcoCount::EcoCount() :
+    count(0),
+    result{}
+{
+}
+
+GameStatistics::Aggregate::Aggregate() :
+    count(0),
+    result{},
+    points(0),
+    minRating(99999),
+    maxRating(0),
+    minDate(PDMaxDate),
+    maxDate(PDMinDate)
+{
+}
+
+void GameStatistics::Aggregate::add(const Aggregate& other)
+{
+    count += other.count;
+    for (int i = 0; i < 4; ++i)
+    {
+        result[i] += other.result[i];
+    }
+    points += other.points;
+    minRating = std::min(minRating, other.minRating);
+    maxRating = std::max(maxRating, other.maxRating);
+    minDate = qMin(minDate, other.minDate);
+    maxDate = qMax(maxDate, other.maxDate);
+    for (auto it = other.eco.cbegin(); it != other.eco.cend(); ++it)
+    {
+        EcoCount& eco = this->eco[it.key()];
+        eco.count += it.value().count;
+        for (int i = 0; i < 4; ++i)
+        {
+            eco.result[i] += it.value().result[i];
+        }
+    }
+}
+
+GameStatistics::Query::Query() :
+    filterValue(ValueNoIndex),
+    eco(false)
+{
+}
+
+GameStatistics::GameStatistics(const Database* database) :
+    m_database(database)
+{
+}
+
+float GameStatistics::points(const QString& result)
+{
+    if(result.startsWith("1/2"))
+    {
+        return 0.5;
+    }
+    else if(result.startsWith('1') || result.startsWith("+-"))
+    {
+        return 1.0;
+    }
+    return 0.0;
+}
+
+namespace {
+
+/** Value of a tag parsed once per value index */
+template <class T>
+class ParsedColumn
+{
+public:
+    template <class Parser>
+    ParsedColumn(const IndexX* index, const QVector<ValueIndex>& column, Parser parser) :
+        m_index(index), m_column(column), m_parser(parser), m_last(ValueNoIndex), m_lastValue()
+    {
+    }
+
+    T operator[](int gameId)
+    {
+        ValueIndex valueIndex = m_column[gameId];
+        if (valueIndex != m_last)
+        {
+            auto it = m_values.constFind(valueIndex);
+            if (it == m_values.constEnd())
+            {
+                it = m_values.insert(valueIndex, m_parser(m_index->tagValueFromIndex(valueIndex)));
+            }
+            m_last = valueIndex;
+            m_lastValue = it.value();
+        }
+        return m_lastValue;
+    }
+
+private:
+    const IndexX* m_index;
+    const QVector<ValueIndex>& m_column;
+    std::function<T(const QString&)> m_parser;
+    QHash<ValueIndex, T> m_values;
+    ValueIndex m_last;
+    T m_lastValue;
+};
+
+struct GameResult
+{
+    int result;
+    float points;
+};
+
+} // namespace
+
+GameStatistics::Groups GameStatistics::aggregate(const Query& query, volatile bool* breakFlag) const
+{
+    const IndexX* index = m_database->index();
+    int n = std::min<int>(int(m_database->count()), index->count());
+
+    // Columns are shared by all threads, only the parsed values are per thread
+    const QVector<ValueIndex> filter = query.filterTag.isEmpty() ? QVector<ValueIndex>() : index->tagColumn(query.filterTag);
+    const QVector<ValueIndex> exclude = query.excludeTag.isEmpty() ? QVector<ValueIndex>() : index->tagColumn(query.excludeTag);
+    const QVector<ValueIndex> group = query.groupTag.isEmpty() ? QVector<ValueIndex>() : index->tagColumn(query.groupTag);
+    const QVector<ValueIndex> rating = query.ratingTag.isEmpty() ? QVector<ValueIndex>() : index->tagColumn(query.ratingTag);
+    const QVector<ValueIndex> eco = query.eco ? index->tagColumn(TagNameECO) : QVector<ValueIndex>();
+    const QVector<ValueIndex> result = index->tagColumn(TagNameResult);
+    const QVector<ValueIndex> date = index->tagColumn(TagNameDate);
+
+    auto aggregateRange = [&](int begin, int end)
+    {
+        Groups groups;
+        ParsedColumn<GameResult> results(index, result, [](const QString& s)
+        {
+            return GameResult{ ResultFromString(s), GameStatistics::points(s) };
+        });
+        ParsedColumn<PartialDate> dates(index, date, [](const QString& s) { return PartialDate(s); });
+        ParsedColumn<int> ratings(index, rating, [](const QString& s) { return s.toInt(); });
+
+        for (int i = begin; i < end; ++i)
+        {
+            if ((i & 0xFFFF) == 0 && breakFlag && *breakFlag)
+            {
+                break;
+            }
+            if (!filter.isEmpty() && filter[i] != query.filterValue)
+            {
+                continue;
+            }
+            if (!exclude.isEmpty() && exclude[i] == query.filterValue)
+            {
+                continue;
+            }
+
+            Aggregate& a = groups[group.isEmpty() ? ValueNoIndex : group[i]];
+            GameResult res = results[i];
+            a.count++;
+            a.result[res.result]++;
+            a.points += res.points;
+            if (!rating.isEmpty())
+            {
+                int elo = ratings[i];
+                if (elo)
+                {
+                    a.minRating = std::min(elo, a.minRating);
+                    a.maxRating = std::max(elo, a.maxRating);
+                }
+            }
+            PartialDate d = dates[i];
+            if (d.year() > 1000)
+            {
+                a.minDate = qMin(d, a.minDate);
+                a.maxDate = qMax(d, a.maxDate);
+            }
+            if (!eco.isEmpty())
+            {
+                EcoCount& e = a.eco[eco[i]];
+                e.count++;
+                e.result[res.result]++;
+            }
+        }
+        return groups;
+    };
+
+    int threads = std::max(1, std::min(QThread::idealThreadCount(), n / 4096));
+    int chunk = (n + threads - 1) / threads;
+    QVector<QFuture<Groups> > futures;
+    for (int begin = 0; begin < n; begin += chunk)
+    {
+        int end = std::min(begin + chunk, n);
+        futures.append(QtConcurrent::run([&aggregateRange, begin, end]() { return aggregateRange(begin, end); }));
+    }
+
+    Groups groups;
+    for (QFuture<Groups>& future: futures)
+    {
+        const Groups part = future.result();
+        for (auto it = part.cbegin(); it != part.cend(); ++it)
+        {
+            groups[it.key()].add(it.value());
+        }
+    }
+    return groups;
+}
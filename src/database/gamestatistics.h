@@ -0,0 +1,90 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef GAMESTATISTICS_H
+#define GAMESTATISTICS_H
+
+#include <QHash>
+#include <QString>
+
+#include "indexitem.h"
+#include "partialdate.h"
+
+class Database;
+
+/** @ingroup Database
+ * The GameStatistics class aggregates results, ratings, dates and ECO codes
+ * over the games of a database, optionally grouped by the value of a tag.
+ *
+ * The tags are read as columns of the index. Tag values are parsed once per
+ * distinct value of the value dictionary, not once per game, and the games
+ * are split into ranges which are aggregated in parallel.
+ */
+class GameStatistics
+{
+public:
+    /** Games and results of an ECO code */
+    struct EcoCount
+    {
+        EcoCount();
+        int count;
+        /** Number of games by Result */
+        int result[4];
+    };
+
+    /** Statistics of a group of games */
+    struct Aggregate
+    {
+        Aggregate();
+        /** Add the statistics of @p other */
+        void add(const Aggregate& other);
+
+        int count;
+        /** Number of games by Result */
+        int result[4];
+        /** Points of White */
+        float points;
+        /** Range of the ratings found, 99999 and 0 if there is none */
+        int minRating;
+        int maxRating;
+        /** Range of the dates found, PDMaxDate and PDMinDate if there is none */
+        PartialDate minDate;
+        PartialDate maxDate;
+        /** Games by ECO tag value, if requested */
+        QHash<ValueIndex, EcoCount> eco;
+    };
+    typedef QHash<ValueIndex, Aggregate> Groups;
+
+    /** Selects and groups the games of aggregate() */
+    struct Query
+    {
+        Query();
+        /** Only games whose @p filterTag is @p filterValue are aggregated, all if empty */
+        QString filterTag;
+        ValueIndex filterValue;
+        /** Games whose @p excludeTag is @p filterValue are skipped, none if empty */
+        QString excludeTag;
+        /** Games are grouped by the value of this tag. All games form
+            the group ValueNoIndex if empty. */
+        QString groupTag;
+        /** Tag whose range of ratings is aggregated, none if empty */
+        QString ratingTag;
+        /** Count the games by ECO */
+        bool eco;
+    };
+
+    explicit GameStatistics(const Database* database);
+
+    /** Aggregate the games selected by @p query.
+        @return the statistics of each group */
+    Groups aggregate(const Query& query, volatile bool* breakFlag = nullptr) const;
+
+    /** @return the points of White for a result tag value, "+-" and the like count as well */
+    static float points(const QString& result);
+
+private:
+    const Database* m_database;
+};
+
+#endif // GAMESTATISTICS_H
@@ -0,0 +1,361 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include "gamestore.h"
+#include "gamex.h"
+#include "movecache.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+/** Games are appended to blocks of about this size */
+#define GAME_STORE_BLOCK_SIZE 0x1000000
+/** Flags of a packed game: the FEN of the start position follows */
+#define GAME_STORE_FEN 1
+/** Flags of a packed game: the game is chess960 */
+#define GAME_STORE_CHESS960 2
+
+static inline void appendNumber(QByteArray& data, quint32 n)
+{
+    while (n >= 0x80)
+    {
+        data.append(char((n & 0x7F) | 0x80));
+        n >>= 7;
+    }
+    data.append(char(n));
+}
+
+static inline bool readNumber(const char*& p, const char* end, quint32& n)
+{
+    n = 0;
+    for (int shift = 0; p < end && shift < 32; shift += 7)
+    {
+        unsigned char c = (unsigned char) *p++;
+        n |= quint32(c & 0x7F) << shift;
+        if (!(c & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline void appendString(QByteArray& data, const QString& s)
+{
+    QByteArray utf8 = s.toUtf8();
+    appendNumber(data, quint32(utf8.size()));
+    data.append(utf8);
+}
+
+static inline bool readString(const char*& p, const char* end, QString& s)
+{
+    quint32 n;
+    if (!readNumber(p, end, n) || n > quint32(end - p))
+    {
+        return false;
+    }
+    s = QString::fromUtf8(p, int(n));
+    p += n;
+    return true;
+}
+
+static void appendAnnotations(QByteArray& data, const QMap<MoveId, QString>& map)
+{
+    appendNumber(data, quint32(map.count()));
+    for (auto it = map.cbegin(); it != map.cend(); ++it)
+    {
+        appendNumber(data, quint32(it.key()));
+        appendString(data, it.value());
+    }
+}
+
+static bool readAnnotations(const char*& p, const char* end, QMap<MoveId, QString>& map)
+{
+    quint32 count;
+    if (!readNumber(p, end, count))
+    {
+        return false;
+    }
+    for (quint32 i = 0; i < count; ++i)
+    {
+        quint32 id;
+        QString s;
+        if (!readNumber(p, end, id) || !readString(p, end, s))
+        {
+            return false;
+        }
+        map.insert(MoveId(id), s);
+    }
+    return true;
+}
+
+GameStore::GameStore() :
+    m_size(0),
+    m_garbage(0)
+{
+}
+
+GameStore::~GameStore()
+{
+    clear();
+}
+
+void GameStore::clear()
+{
+    qDeleteAll(m_unpacked);
+    m_unpacked.clear();
+    m_entries.clear();
+    m_blocks.clear();
+    m_size = 0;
+    m_garbage = 0;
+}
+
+bool GameStore::pack(const GameX& game, QByteArray& data)
+{
+    BoardX start = game.startingBoard();
+    quint8 flags = 0;
+    if (start.chess960())
+    {
+        flags |= GAME_STORE_CHESS960 | GAME_STORE_FEN;
+    }
+    else if (start != BoardX::standardStartBoard)
+    {
+        flags |= GAME_STORE_FEN;
+    }
+    data.append(char(flags));
+    if (flags & GAME_STORE_FEN)
+    {
+        appendString(data, start.toFen());
+    }
+
+    QByteArray moves;
+    if (!MoveCache::encode(game, moves))
+    {
+        return false;
+    }
+    appendNumber(data, quint32(moves.size()));
+    data.append(moves);
+
+    appendAnnotations(data, game.m_annotations);
+    appendAnnotations(data, game.m_variationStartAnnotations);
+    appendNumber(data, quint32(game.m_nags.count()));
+    for (auto it = game.m_nags.cbegin(); it != game.m_nags.cend(); ++it)
+    {
+        appendNumber(data, quint32(it.key()));
+        appendNumber(data, quint32(it.value().count()));
+        for (Nag nag: it.value())
+        {
+            if (nag >= NagCount)
+            {
+                return false;
+            }
+            appendNumber(data, quint32(nag));
+        }
+    }
+    return true;
+}
+
+bool GameStore::unpack(const char* data, int size, GameX& game)
+{
+    const char* p = data;
+    const char* end = data + size;
+    game.clearTags();
+    game.m_annotations.clear();
+    game.m_variationStartAnnotations.clear();
+    game.m_nags.clear();
+    game.m_needsCleanup = false;
+
+    if (p == end)
+    {
+        return false;
+    }
+    quint8 flags = quint8(*p++);
+    if (flags & GAME_STORE_FEN)
+    {
+        QString fen;
+        if (!readString(p, end, fen))
+        {
+            return false;
+        }
+        game.m_moves.clear(fen, flags & GAME_STORE_CHESS960);
+    }
+    else
+    {
+        game.m_moves.clear();
+    }
+
+    quint32 moves;
+    if (!readNumber(p, end, moves) || moves > quint32(end - p) ||
+        !MoveCache::decode(p, int(moves), game))
+    {
+        return false;
+    }
+    p += moves;
+
+    if (!readAnnotations(p, end, game.m_annotations) ||
+        !readAnnotations(p, end, game.m_variationStartAnnotations))
+    {
+        return false;
+    }
+    quint32 count;
+    if (!readNumber(p, end, count))
+    {
+        return false;
+    }
+    for (quint32 i = 0; i < count; ++i)
+    {
+        quint32 id, nags;
+        if (!readNumber(p, end, id) || !readNumber(p, end, nags))
+        {
+            return false;
+        }
+        NagSet& nagSet = game.m_nags[MoveId(id)];
+        for (quint32 j = 0; j < nags; ++j)
+        {
+            quint32 nag;
+            if (!readNumber(p, end, nag) || nag >= NagCount)
+            {
+                return false;
+            }
+            nagSet.append(Nag(nag));
+        }
+    }
+
+    game.moveToStart();
+    return p == end;
+}
+
+GameStore::Entry GameStore::store(GameId gameId, const GameX& game)
+{
+    const GameX* source = &game;
+    GameX compacted;
+    for (MoveId id = 1; id < game.cursor().capacity(); ++id)
+    {
+        if (game.cursor().isRemoved(id))
+        {
+            // Removed nodes cannot be packed, but they are not restored anyway
+            compacted = game;
+            compacted.compact();
+            source = &compacted;
+            break;
+        }
+    }
+
+    // Move ids are packed in order, so reordered variations may come back in another order
+    QByteArray data;
+    GameX check;
+    if (!pack(*source, data) ||
+        !unpack(data.constData(), data.size(), check) ||
+        !check.isEqual(*source) ||
+        check.startingBoard() != source->startingBoard() ||
+        check.startingBoard().chess960() != source->startingBoard().chess960())
+    {
+        GameX* unpacked = new GameX(*source);
+        unpacked->clearTags();
+        unpacked->unmountBoard();
+        m_unpacked.insert(gameId, unpacked);
+        return Entry{ Unpacked, 0, 0 };
+    }
+
+    if (m_blocks.isEmpty() ||
+        (!m_blocks.last().isEmpty() && m_blocks.last().size() + data.size() > GAME_STORE_BLOCK_SIZE))
+    {
+        if (!m_blocks.isEmpty())
+        {
+            m_blocks.last().squeeze();
+        }
+        m_blocks.append(QByteArray());
+    }
+    QByteArray& block = m_blocks.last();
+    Entry entry{ quint32(m_blocks.count() - 1), quint32(block.size()), quint32(data.size()) };
+    block.append(data);
+    m_size += data.size();
+    return entry;
+}
+
+void GameStore::release(GameId gameId, const Entry& entry)
+{
+    if (entry.block == Unpacked)
+    {
+        delete m_unpacked.take(gameId);
+    }
+    else
+    {
+        m_size -= entry.size;
+        m_garbage += entry.size;
+    }
+}
+
+void GameStore::append(const GameX& game)
+{
+    GameId gameId = GameId(m_entries.count());
+    m_entries.append(store(gameId, game));
+}
+
+void GameStore::replace(GameId gameId, const GameX& game)
+{
+    if (gameId >= GameId(m_entries.count()))
+    {
+        return;
+    }
+    release(gameId, m_entries[gameId]);
+    m_entries[gameId] = store(gameId, game);
+    if (m_garbage > GAME_STORE_BLOCK_SIZE && m_garbage > m_size)
+    {
+        compact();
+    }
+}
+
+bool GameStore::load(GameId gameId, GameX& game) const
+{
+    if (gameId >= GameId(m_entries.count()))
+    {
+        return false;
+    }
+    const Entry& entry = m_entries.at(gameId);
+    if (entry.block == Unpacked)
+    {
+        game = *m_unpacked.value(gameId);
+        return true;
+    }
+    return unpack(m_blocks.at(entry.block).constData() + entry.offset, int(entry.size), game);
+}
+
+void GameStore::squeeze()
+{
+    m_entries.squeeze();
+    if (!m_blocks.isEmpty())
+    {
+        m_blocks.last().squeeze();
+    }
+}
+
+void GameStore::compact()
+{
+    QVector<QByteArray> blocks;
+    for (Entry& entry: m_entries)
+    {
+        if (entry.block == Unpacked)
+        {
+            continue;
+        }
+        if (blocks.isEmpty() || blocks.last().size() + int(entry.size) > GAME_STORE_BLOCK_SIZE)
+        {
+            if (!blocks.isEmpty())
+            {
+                blocks.last().squeeze();
+            }
+            blocks.append(QByteArray());
+        }
+        QByteArray& block = blocks.last();
+        quint32 offset = quint32(block.size());
+        block.append(m_blocks.at(entry.block).constData() + entry.offset, int(entry.size));
+        entry.block = quint32(blocks.count() - 1);
+        entry.offset = offset;
+    }
+    m_blocks = blocks;
+    m_garbage = 0;
+}
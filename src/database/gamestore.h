@@ -0,0 +1,83 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef GAMESTORE_H
+#define GAMESTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+
+#include "gameid.h"
+
+class GameX;
+
+/** @ingroup Database
+ * The GameStore class keeps the games of a MemoryDatabase in packed form.
+ *
+ * A game is stored as the move words of MoveCache, followed by its comments
+ * in UTF-8 and its NAGs, each keyed by move id. The packed games are appended
+ * to large blocks, so that a game costs little more than its encoded size.
+ * Tags are not stored, they are kept in the index of the database.
+ *
+ * GameX objects are only created by load(). The few games which cannot be
+ * packed, like games with too many moves or with variations reordered after
+ * they were added, are kept as a GameX instead.
+ */
+class GameStore
+{
+public:
+    GameStore();
+    ~GameStore();
+
+    /** Remove all games */
+    void clear();
+    /** @return number of games */
+    int count() const { return m_entries.count(); }
+    /** Add @p game as the next game */
+    void append(const GameX& game);
+    /** Replace game @p gameId by @p game */
+    void replace(GameId gameId, const GameX& game);
+    /** Restore game @p gameId into @p game, without tags and positioned at the start.
+        @return false if there is no such game */
+    bool load(GameId gameId, GameX& game) const;
+    /** Release the unused memory of the last block */
+    void squeeze();
+    /** @return number of bytes used by the packed games */
+    qint64 size() const { return m_size; }
+
+private:
+    /** Location of a packed game */
+    struct Entry
+    {
+        quint32 block;
+        quint32 offset;
+        quint32 size;
+    };
+    /** Block of the entries of games kept as GameX */
+    static const quint32 Unpacked = 0xFFFFFFFF;
+
+    /** Pack @p game into @p data, returns false if it cannot be packed */
+    static bool pack(const GameX& game, QByteArray& data);
+    /** Restore @p size bytes of @p data into @p game */
+    static bool unpack(const char* data, int size, GameX& game);
+    /** Store @p game as game @p gameId and return its location.
+        Games which do not unpack to the very same game are kept as GameX. */
+    Entry store(GameId gameId, const GameX& game);
+    /** Forget the game at @p entry */
+    void release(GameId gameId, const Entry& entry);
+    /** Copy the packed games into new blocks, dropping replaced games */
+    void compact();
+
+    QVector<Entry> m_entries;
+    QVector<QByteArray> m_blocks;
+    /** Games which cannot be packed */
+    QHash<GameId, GameX*> m_unpacked;
+    /** Number of bytes of live packed games */
+    qint64 m_size;
+    /** Number of bytes of replaced games in the blocks */
+    qint64 m_garbage;
+};
+
+#endif // GAMESTORE_H
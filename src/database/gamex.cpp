@@ -496,7 +496,7 @@ bool GameX::currentNodeHasVariation(Square from, Square to) const
     return false;
 }
 
-const QList<MoveId>& GameX::currentVariations() const
+QList<MoveId> GameX::currentVariations() const
 {
     return m_moves.variations();
 }
@@ -1734,33 +1734,44 @@ void GameX::setNeedsCleanup(bool value)
 
 QString GameX::ecoClassify() const
 {
-    //move to end of main line
-    GameX g = *this;
-    if (g.startingBoard() != BoardX::standardStartBoard)
+    if (!EcoPositions::waitForEco())
+    {
+        return QString();
+    }
+    const QString* eco = ecoClassification();
+    return eco ? *eco : QString();
+}
+
+const QString* GameX::ecoClassification() const
+{
+    if (startingBoard() != BoardX::standardStartBoard)
     {
-        if (g.isChess960())
+        if (isChess960())
         {
-            return QString();
+            return nullptr;
         }
     }
-    g.m_moves.moveToEnd();
 
-    // Because we now only move backward() after the loop, we must ensure there are some moves
-    if (g.m_moves.countMoves() == 0) {
-        return QString();
+    MoveId current = m_moves.nextMove(ROOT_NODE);
+    if (current == NO_MOVE)
+    {
+        return nullptr;
     }
 
-    // Search backwards for the first eco position
-    do
+    // Replay the main line once, the last ECO position reached classifies the game
+    BoardX board(m_moves.initialBoard());
+    const QString* eco = EcoPositions::findEco(board.getHashValue());
+    while (current != NO_MOVE)
     {
-        QString eco;
-        if (EcoPositions::isEcoPosition(g.board(),eco))
+        board.doMove(m_moves.move(current));
+        const QString* found = EcoPositions::findEco(board.getHashValue());
+        if (found)
         {
-            return eco;
+            eco = found;
         }
-    } while(g.m_moves.backward());
-
-    return QString();
+        current = m_moves.nextMove(current);
+    }
+    return eco;
 }
 
 bool GameX::isEcoPosition() const
@@ -191,7 +191,7 @@ public :
     MoveId nextMove() const { return m_moves.nextMove(); }
     MoveId parentMove() const { return m_moves.parentMove(); }
     int variationCount(MoveId moveId = CURRENT_MOVE) const { return m_moves.variationCount(moveId); }
-    const QList<MoveId>& variations() const { return m_moves.variations(); }
+    QList<MoveId> variations() const { return m_moves.variations(); }
 
     bool isMainline(MoveId moveId = CURRENT_MOVE) const { return m_moves.isMainline(moveId); }
     bool atLineStart(MoveId moveId = CURRENT_MOVE) const { return m_moves.atLineStart(moveId); }
@@ -346,7 +346,7 @@ public :
     /** @return true if the move @p from @p to is already in a variation */
     bool currentNodeHasVariation(chessx::Square from, chessx::Square to) const;
     /** Return the list of variations of the current node */
-    const QList<MoveId>& currentVariations() const;
+    QList<MoveId> currentVariations() const;
 
     /** Evaluate a list of scores for the complete game (mainline only) */
     void scoreMaterial(QList<double> &scores) const;
@@ -354,6 +354,9 @@ public :
 
     /** @return ECO code for the game */
     QString ecoClassify() const;
+    /** @return ECO code for the game as found in EcoPositions or nullptr.
+        Does not wait for the ECO file, callers must check EcoPositions::waitForEco() */
+    const QString* ecoClassification() const;
     /** @return true if current pos is in the ECO list */
     bool isEcoPosition() const;
 
@@ -423,6 +426,7 @@ private:
 
     void removeTimeCommentsFromMap(AnnotationMap& map);
 
+    friend class GameStore;
     friend class SaveRestoreMove;
 };
 
@@ -9,6 +9,9 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <algorithm>
+#include <utility>
+
 #include <QtDebug>
 #include <QFile>
 #include <QDataStream>
@@ -29,7 +32,11 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
-IndexX::IndexX() : m_mutex(QReadWriteLock::Recursive)
+IndexX::IndexX() :
+    m_mappedValues(nullptr),
+    m_mappedValueCount(0),
+    m_mappedPool(nullptr),
+    m_mutex(QReadWriteLock::Recursive)
 {
     // Dummy Values in case a index is miscalculated
     init();
@@ -42,8 +49,8 @@ IndexX::~IndexX()
 GameId IndexX::add()
 {
     QWriteLocker m(&m_mutex);
-    GameId gameId = m_indexItems.count();
-    m_indexItems.insert(gameId, IndexItem());
+    GameId gameId = m_columns.count();
+    m_columns.resize(gameId + 1);
     return gameId;
 }
 
@@ -61,6 +68,7 @@ TagIndex IndexX::AddTagName(const QString& name)
 
 ValueIndex IndexX::AddTagValue(QString name)
 {
+    detachTagValues();
     ValueIndex n = qHash(name);
     if (m_tagValues.contains(n))
     {
@@ -99,11 +107,25 @@ void IndexX::setTag_nolock(const QString& tagName, const QString& value, GameId
 	TagIndex tagIndex = AddTagName(tagName);
 	ValueIndex valueIndex = AddTagValue(value);
 
-	if (m_indexItems.count() <= (int)gameId)
-	{
-		(void) add();
-	}
-	m_indexItems[gameId].set(tagIndex, valueIndex);
+	m_columns.set(gameId, tagIndex, valueIndex);
+}
+
+void IndexX::setTagValues(const QString& tagName, const QVector<GameId>& gameIds, const QVector<QString>& values)
+{
+    QWriteLocker m(&m_mutex);
+    TagIndex tagIndex = AddTagName(tagName);
+
+    // Bulk updates repeat few values, each is entered into the dictionary once
+    QHash<QString, ValueIndex> valueIndices;
+    for (int i = 0; i < gameIds.count(); ++i)
+    {
+        auto it = valueIndices.constFind(values[i]);
+        if (it == valueIndices.constEnd())
+        {
+            it = valueIndices.insert(values[i], AddTagValue(values[i]));
+        }
+        m_columns.set(gameIds[i], tagIndex, it.value());
+    }
 }
 
 void IndexX::removeTag(const QString& tagName, GameId gameId)
@@ -112,9 +134,9 @@ void IndexX::removeTag(const QString& tagName, GameId gameId)
     if(m_tagNameIndex.contains(tagName))
     {
         TagIndex tagIndex = m_tagNameIndex.value(tagName);
-        if((int)gameId < m_indexItems.count())
+        if((int)gameId < m_columns.count())
         {
-            m_indexItems[gameId].remove(tagIndex);
+            m_columns.remove(gameId, tagIndex);
         }
     }
 }
@@ -125,9 +147,9 @@ bool IndexX::hasTag(const QString& tagName, GameId gameId) const
     if(m_tagNameIndex.contains(tagName))
     {
         TagIndex tagIndex = m_tagNameIndex.value(tagName);
-        if((int)gameId < m_indexItems.count())
+        if((int)gameId < m_columns.count())
         {
-            return m_indexItems[gameId].hasTagIndex(tagIndex);
+            return m_columns.has(gameId, tagIndex);
         }
     }
     return false;
@@ -145,9 +167,10 @@ void IndexX::setValidFlag(GameId gameId, bool value)
     }
 }
 
-bool IndexX::replaceTagValue(const QStringList& tags, const QString& newValue, const QString& oldValue)
+bool IndexX::replaceTagValue(const QStringList& tags, const QString& newValue, const QString& oldValue, QVector<GameId>* gameIds)
 {
     QWriteLocker m(&m_mutex);
+    detachTagValues();
 
     bool ok = false;
     foreach(QString t, tags)
@@ -176,10 +199,7 @@ bool IndexX::replaceTagValue(const QStringList& tags, const QString& newValue, c
         tl << getTagIndex(t);
     }
 
-     for (auto i = m_indexItems.begin(); i != m_indexItems.end(); ++i)
-    {
-        i->replaceValue(tl, valueIndex, newIndex);
-    }
+    m_columns.replaceValue(tl, valueIndex, newIndex, gameIds);
 
     m_tagValues.remove(valueIndex);
     return true;
@@ -196,8 +216,8 @@ bool IndexX::write(QDataStream &out) const
     QReadLocker m(&m_mutex);
 
     out << m_tagNames;
-    out << m_tagValues;
-	out << m_indexItems;
+    out << tagValueHash();
+    m_columns.write(out);
     out << m_validFlags;
 
     bool extension = false;
@@ -208,23 +228,44 @@ bool IndexX::write(QDataStream &out) const
 
 void IndexX::reserve(quint32 estimation)
 {
-    m_tagValues.reserve(estimation+16);
+    if (!m_mappedValues)
+    {
+        m_tagValues.reserve(estimation+16);
+    }
+    m_columns.reserve(estimation);
 }
 
 void IndexX::squeeze()
 {
     m_tagValues.squeeze();
+    m_columns.squeeze();
 }
 
 bool IndexX::read(QDataStream &in, volatile bool *breakFlag, short version)
 {
-    Q_UNUSED(version);
-
     QWriteLocker m(&m_mutex);
 
+    m_mappedValues = nullptr;
+    m_mappedValueCount = 0;
+    m_mappedPool = nullptr;
     in >> m_tagNames;
     in >> m_tagValues;
-	in >> m_indexItems;
+    if (version < VERSION_INDEX_1_6)
+    {
+        // Legacy format with one tag map per game
+        QVector<IndexItem> indexItems;
+        in >> indexItems;
+        m_columns.clear();
+        for (auto it = indexItems.cbegin(); it != indexItems.cend(); ++it)
+        {
+            m_columns.append(*it);
+        }
+        m_columns.squeeze();
+    }
+    else
+    {
+        m_columns.read(in);
+    }
     in >> m_validFlags;
     
 	bool extension;
@@ -237,6 +278,155 @@ bool IndexX::read(QDataStream &in, volatile bool *breakFlag, short version)
     return !(*breakFlag);
 }
 
+static inline void appendWord(QByteArray& data, quint32 word)
+{
+    data.append(reinterpret_cast<const char*>(&word), sizeof(word));
+}
+
+/** Append @p s padded to a multiple of 4 bytes */
+static void appendString(QByteArray& data, const QString& s)
+{
+    appendWord(data, s.length());
+    data.append(reinterpret_cast<const char*>(s.constData()), s.length() * sizeof(QChar));
+    if (s.length() % 2)
+    {
+        data.append(sizeof(QChar), 0);
+    }
+}
+
+void IndexX::writeMapped(QByteArray& data) const
+{
+    QReadLocker m(&m_mutex);
+
+    // All fields are 32 bit words in host byte order, strings are UTF-16
+    appendWord(data, m_tagNames.count());
+    for (auto it = m_tagNames.cbegin(); it != m_tagNames.cend(); ++it)
+    {
+        appendWord(data, it.key());
+        appendString(data, it.value());
+    }
+
+    QList<GameId> invalid = m_validFlags.values();
+    std::sort(invalid.begin(), invalid.end());
+    appendWord(data, invalid.count());
+    for (GameId gameId: std::as_const(invalid))
+    {
+        appendWord(data, gameId);
+    }
+
+    // The value dictionary is sorted by ValueIndex, so that it can be searched in place
+    const QHash<ValueIndex, QString> values = tagValueHash();
+    QList<ValueIndex> keys = values.keys();
+    std::sort(keys.begin(), keys.end());
+    QString pool;
+    appendWord(data, keys.count());
+    for (ValueIndex valueIndex: std::as_const(keys))
+    {
+        const QString& value = values[valueIndex];
+        appendWord(data, valueIndex);
+        appendWord(data, pool.length());
+        appendWord(data, value.length());
+        pool.append(value);
+    }
+    appendString(data, pool);
+
+    m_columns.writeMapped(data);
+}
+
+bool IndexX::map(const char* data, qint64 size)
+{
+    QWriteLocker m(&m_mutex);
+
+    auto reset = [this]()
+    {
+        m_columns.clear();
+        m_tagNames.clear();
+        m_tagNameIndex.clear();
+        m_tagValues.clear();
+        m_deletedGames.clear();
+        m_validFlags.clear();
+        m_mappedValues = nullptr;
+        m_mappedValueCount = 0;
+        m_mappedPool = nullptr;
+    };
+    reset();
+
+    const quint32* words = reinterpret_cast<const quint32*>(data);
+    const qint64 available = size / 4;
+    qint64 pos = 0;
+    bool ok = true;
+    auto readWord = [&]()
+    {
+        if (pos >= available)
+        {
+            ok = false;
+            return 0u;
+        }
+        return words[pos++];
+    };
+    auto readString = [&]()
+    {
+        quint32 length = readWord();
+        qint64 wordCount = (length + 1) / 2;
+        if (!ok || pos + wordCount > available)
+        {
+            ok = false;
+            return QString();
+        }
+        QString s(reinterpret_cast<const QChar*>(words + pos), length);
+        pos += wordCount;
+        return s;
+    };
+
+    // Both maps of the tag names are restored in one pass
+    quint32 tagCount = readWord();
+    for (quint32 i = 0; ok && i < tagCount; ++i)
+    {
+        TagIndex tagIndex = readWord();
+        QString name = readString();
+        m_tagNames.insert(tagIndex, name);
+        m_tagNameIndex.insert(name, tagIndex);
+    }
+
+    quint32 invalidCount = readWord();
+    for (quint32 i = 0; ok && i < invalidCount; ++i)
+    {
+        m_validFlags.insert(readWord());
+    }
+
+    quint32 valueCount = readWord();
+    if (!ok || pos + 3 * (qint64)valueCount + 1 > available)
+    {
+        reset();
+        init();
+        return false;
+    }
+    const MappedValue* values = reinterpret_cast<const MappedValue*>(words + pos);
+    pos += 3 * (qint64)valueCount;
+    quint32 poolLength = readWord();
+    const QChar* pool = reinterpret_cast<const QChar*>(words + pos);
+    pos += (poolLength + 1) / 2;
+    if (pos > available || (valueCount && values[valueCount - 1].offset + values[valueCount - 1].length > poolLength))
+    {
+        reset();
+        init();
+        return false;
+    }
+
+    qint64 columnSize = m_columns.map(data + 4 * pos, size - 4 * pos);
+    if (!columnSize)
+    {
+        reset();
+        init();
+        return false;
+    }
+
+    m_mappedValues = values;
+    m_mappedValueCount = valueCount;
+    m_mappedPool = pool;
+    return true;
+}
+
 void IndexX::clearCache()
 {
     QWriteLocker m(&m_mutex);
@@ -272,10 +462,13 @@ void IndexX::init()
 void IndexX::clear()
 {
     QWriteLocker m(&m_mutex);
-    m_indexItems.clear();
+    m_columns.clear();
     m_tagNames.clear();
     m_tagNameIndex.clear();
     m_tagValues.clear();
+    m_mappedValues = nullptr;
+    m_mappedValueCount = 0;
+    m_mappedPool = nullptr;
     m_deletedGames.clear();
     m_validFlags.clear();
     init(); // Just to make sure that the index can be used after clearing
@@ -283,7 +476,39 @@ void IndexX::clear()
 
 int IndexX::count() const
 {
-    return m_indexItems.count();
+    return m_columns.count();
+}
+
+template <class Predicate>
+QBitArray IndexX::listMatching(TagIndex tagIndex, Predicate predicate) const
+{
+    const QVector<ValueIndex> column = m_columns.column(tagIndex);
+
+    // The predicate is evaluated on the value dictionary, games only look up the result
+    QHash<ValueIndex, bool> valueMatches;
+    ValueIndex lastValue = ValueNoIndex;
+    bool lastMatch = false;
+
+    QBitArray list(column.count(), false);
+    for(int i = 0; i < column.count(); ++i)
+    {
+        ValueIndex valueIndex = column[i];
+        if (valueIndex != lastValue)
+        {
+            auto it = valueMatches.constFind(valueIndex);
+            if (it == valueMatches.constEnd())
+            {
+                it = valueMatches.insert(valueIndex, predicate(tagValueName(valueIndex)));
+            }
+            lastValue = valueIndex;
+            lastMatch = it.value();
+        }
+        if (lastMatch)
+        {
+            list.setBit(i);
+        }
+    }
+    return list;
 }
 
 QBitArray IndexX::listInSet(const QString& tagName, const QSet<QString>& set) const
@@ -291,23 +516,17 @@ QBitArray IndexX::listInSet(const QString& tagName, const QSet<QString>& set) co
     QReadLocker m(&m_mutex);
 
     TagIndex tagIndex = m_tagNameIndex.value(tagName);
-
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    return listMatching(tagIndex, [&set](const QString& value)
     {
-        QString value = tagValue(tagIndex, i);
-        bool b = false;
         foreach(QString s, set)
         {
             if (value.contains(s, Qt::CaseInsensitive))
             {
-                b = true;
-                break;
+                return true;
             }
         }
-        list.setBit(i, b);
-    }
-    return list;
+        return false;
+    });
 }
 
 QBitArray IndexX::listInRange(const QString& tagName, const QString& minValue, const QString& maxValue) const
@@ -315,14 +534,10 @@ QBitArray IndexX::listInRange(const QString& tagName, const QString& minValue, c
     QReadLocker m(&m_mutex);
 
     TagIndex tagIndex = m_tagNameIndex.value(tagName);
-
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    return listMatching(tagIndex, [&minValue, &maxValue](const QString& value)
     {
-        QString value = tagValue(tagIndex, i);
-        list.setBit(i, (minValue <= value) && (value <= maxValue));
-    }
-    return list;
+        return (minValue <= value) && (value <= maxValue);
+    });
 }
 
 QBitArray IndexX::listInRange(const QString &tagName, int minValue, int maxValue) const
@@ -330,14 +545,11 @@ QBitArray IndexX::listInRange(const QString &tagName, int minValue, int maxValue
     QReadLocker m(&m_mutex);
 
     TagIndex tagIndex = m_tagNameIndex.value(tagName);
-
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    return listMatching(tagIndex, [minValue, maxValue](const QString& s)
     {
-        int value = tagValue(tagIndex, i).toInt();
-        list.setBit(i, (minValue <= value) && (value <= maxValue));
-    }
-    return list;
+        int value = s.toInt();
+        return (minValue <= value) && (value <= maxValue);
+    });
 }
 
 QBitArray IndexX::listPartialValue(const QString& tagName, QString value) const
@@ -349,29 +561,46 @@ QBitArray IndexX::listPartialValue(const QString& tagName, QString value) const
     TagIndex tagIndex = m_tagNameIndex.value(tagName);
     QRegularExpression re(value);
     re.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
-    QBitArray list(count(), false);
-    for(int i = 0; i < count(); ++i)
+    re.optimize();
+    return listMatching(tagIndex, [&re](const QString& gameValue)
     {
-        QString gameValue = tagValue(tagIndex, i);
-        list.setBit(i, gameValue.contains(re));
-    }
-    return list;
+        return gameValue.contains(re);
+    });
 }
 
 QString IndexX::tagValue_byIndex(TagIndex tagIndex, GameId gameId) const
 {
     QReadLocker m(&m_mutex);
 
-    if (m_indexItems.length() <= gameId) return QString();
-    ValueIndex valueIndex = m_indexItems[gameId].valueIndex(tagIndex);
+    if (m_columns.count() <= (int)gameId) return QString();
+    ValueIndex valueIndex = m_columns.value(gameId, tagIndex);
+
+    return tagValueName(valueIndex);
+}
+
+QVector<ValueIndex> IndexX::tagColumn(const QString& tagName) const
+{
+    QReadLocker m(&m_mutex);
+
+    TagIndex tagIndex = getTagIndex(tagName);
+    if (tagIndex == TagNoIndex)
+    {
+        return QVector<ValueIndex>(m_columns.count(), 0);
+    }
+    return m_columns.column(tagIndex);
+}
+
+QString IndexX::tagValueFromIndex(ValueIndex valueIndex) const
+{
+    QReadLocker m(&m_mutex);
 
     return tagValueName(valueIndex);
 }
 
 QString IndexX::tagValue(TagIndex tagIndex, GameId gameId) const
 {
-    if (m_indexItems.length() <= gameId) return QString();
-    ValueIndex valueIndex = m_indexItems[gameId].valueIndex(tagIndex);
+    if (m_columns.count() <= (int)gameId) return QString();
+    ValueIndex valueIndex = m_columns.value(gameId, tagIndex);
 
     return tagValueName(valueIndex);
 }
@@ -383,10 +612,65 @@ QString IndexX::tagName(TagIndex tagIndex) const
 
 QString IndexX::tagValueName(ValueIndex valueIndex) const
 {
-    QString r = m_tagValues.value(valueIndex);
+    QString r = storedTagValue(valueIndex);
     return r.section(QChar(0),0,0);
 }
 
+bool IndexX::hasTagValue(ValueIndex valueIndex) const
+{
+    if (!m_mappedValues)
+    {
+        return m_tagValues.contains(valueIndex);
+    }
+    const MappedValue* end = m_mappedValues + m_mappedValueCount;
+    const MappedValue* it = std::lower_bound(m_mappedValues, end, valueIndex,
+                                             [](const MappedValue& v, ValueIndex n) { return v.valueIndex < n; });
+    return it != end && it->valueIndex == valueIndex;
+}
+
+QString IndexX::storedTagValue(ValueIndex valueIndex) const
+{
+    if (!m_mappedValues)
+    {
+        return m_tagValues.value(valueIndex);
+    }
+    const MappedValue* end = m_mappedValues + m_mappedValueCount;
+    const MappedValue* it = std::lower_bound(m_mappedValues, end, valueIndex,
+                                             [](const MappedValue& v, ValueIndex n) { return v.valueIndex < n; });
+    if (it == end || it->valueIndex != valueIndex)
+    {
+        return QString();
+    }
+    return QString(m_mappedPool + it->offset, it->length);
+}
+
+QHash<ValueIndex, QString> IndexX::tagValueHash() const
+{
+    if (!m_mappedValues)
+    {
+        return m_tagValues;
+    }
+    QHash<ValueIndex, QString> values;
+    values.reserve(m_mappedValueCount);
+    for (int i = 0; i < m_mappedValueCount; ++i)
+    {
+        const MappedValue& v = m_mappedValues[i];
+        values.insert(v.valueIndex, QString(m_mappedPool + v.offset, v.length));
+    }
+    return values;
+}
+
+void IndexX::detachTagValues()
+{
+    if (m_mappedValues)
+    {
+        m_tagValues = tagValueHash();
+        m_mappedValues = nullptr;
+        m_mappedValueCount = 0;
+        m_mappedPool = nullptr;
+    }
+}
+
 QString IndexX::tagValue(const QString& tagName, GameId gameId) const
 {
     QReadLocker m(&m_mutex);
@@ -403,14 +687,14 @@ ValueIndex IndexX::valueIndexFromTag(const QString& tagName, GameId gameId) cons
 
 bool IndexX::indexItemHasTag(TagIndex tagIndex, GameId gameId) const
 {
-    if (m_indexItems.length() <= gameId) return false;
-    return m_indexItems[gameId].hasTagIndex(tagIndex);
+    if (m_columns.count() <= (int)gameId) return false;
+    return m_columns.has(gameId, tagIndex);
 }
 
 inline ValueIndex IndexX::valueIndexFromIndex(TagIndex tagIndex, GameId gameId) const
 {
-    if (m_indexItems.length() <= gameId) return ValueNoIndex;
-    return m_indexItems[gameId].valueIndex(tagIndex);
+    if (m_columns.count() <= (int)gameId) return ValueNoIndex;
+    return m_columns.value(gameId, tagIndex);
 }
 
 TagIndex IndexX::getTagIndex(const QString& value) const
@@ -426,9 +710,9 @@ ValueIndex IndexX::getValueIndex(QString name) const
 {
     ValueIndex n = qHash(name);
 
-    if (m_tagValues.contains(n))
+    if (hasTagValue(n))
     {
-        if (m_tagValues[n] == name)
+        if (storedTagValue(n) == name)
         {
             return n;
         }
@@ -438,14 +722,14 @@ ValueIndex IndexX::getValueIndex(QString name) const
         do {
             prelim = name + QString::number(i++);
             n = qHash(prelim);
-            if (m_tagValues.contains(n))
+            if (hasTagValue(n))
             {
-                if (m_tagValues[n] == prelim)
+                if (storedTagValue(n) == prelim)
                 {
                     return n;
                 }
             }
-        } while(m_tagValues.contains(n));
+        } while(hasTagValue(n));
     }
 
     return n;
@@ -459,9 +743,11 @@ unsigned int IndexX::hashIndexItem(GameId gameId) const
 bool IndexX::isIndexItemEqual(GameId i, GameId j) const
 {
     QReadLocker m(&m_mutex);
-    const IndexItem& iItem = m_indexItems.value(i);
-    const IndexItem& jItem = m_indexItems.value(j);
-    return (iItem.isEqual(jItem));
+    if ((int)i >= m_columns.count() || (int)j >= m_columns.count())
+    {
+        return (int)i >= m_columns.count() && (int)j >= m_columns.count();
+    }
+    return m_columns.isEqual(i, j);
 }
 
 void IndexX::loadGameHeaders(GameId id, GameX& game) const
@@ -469,7 +755,7 @@ void IndexX::loadGameHeaders(GameId id, GameX& game) const
     QReadLocker m(&m_mutex);
 
     game.clearTags();
-    foreach(TagIndex tagIndex, m_indexItems[id].getTagIndices())
+    foreach(TagIndex tagIndex, m_columns.tagIndices(id))
     {
         // qDebug() << "lGH>" << &game << " " << id << " " << tagName(tagIndex) << " " << tagValue(tagIndex, id);
         game.setTag(tagName(tagIndex), tagValue(tagIndex, id));
@@ -494,22 +780,22 @@ QStringList IndexX::playerNames() const
     TagIndex tagIndex = getTagIndex(TagNameWhite);
     if(tagIndex != TagNoIndex)
     {
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            playerNameIndex.insert(i->valueIndex(tagIndex));
-		}
+        const QVector<ValueIndex> column = m_columns.column(tagIndex);
+        for (ValueIndex valueIndex: column)
+        {
+            playerNameIndex.insert(valueIndex);
+        }
     }
 
     tagIndex = getTagIndex(TagNameBlack);
     if(tagIndex != TagNoIndex)
     {
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            playerNameIndex.insert(i->valueIndex(tagIndex));
-		}
-	}
+        const QVector<ValueIndex> column = m_columns.column(tagIndex);
+        for (ValueIndex valueIndex: column)
+        {
+            playerNameIndex.insert(valueIndex);
+        }
+    }
 
     foreach(ValueIndex valueIndex, playerNameIndex)
     {
@@ -528,11 +814,11 @@ QSet<ValueIndex> IndexX::tagValueSet(const QString& tagName) const
 
 	if (tagIndex != TagNoIndex)
 	{
-        QVector<IndexItem>::const_iterator i;
-		for (i = m_indexItems.constBegin(); i != m_indexItems.constEnd(); ++i)
-		{
-            tagNameIndex.insert(i->valueIndex(tagIndex));
-		}
+        const QVector<ValueIndex> column = m_columns.column(tagIndex);
+        for (ValueIndex valueIndex: column)
+        {
+            tagNameIndex.insert(valueIndex);
+        }
 	}
 	return tagNameIndex;
 }
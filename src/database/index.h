@@ -20,6 +20,7 @@
 #include <QVector>
 
 #include "indexitem.h"
+#include "tagcolumns.h"
 #include "gamex.h"
 #include "gameid.h"
 
@@ -27,14 +28,17 @@
 #define VERSION_INDEX_1_3 0x0002
 #define VERSION_INDEX_1_4 0x0101
 #define VERSION_INDEX_1_5 0x0201
-#define VERSION_INDEX_CURRENT VERSION_INDEX_1_5
+#define VERSION_INDEX_1_6 0x0202
+#define VERSION_INDEX_2_0 0x0300
+#define VERSION_INDEX_CURRENT VERSION_INDEX_2_0
 
 #define INDEX_FILE_MAGIC 0xce55
 
 /** @ingroup Database
- * The Index class holds a list of IndexItem instances, typically one
- * for each game in the current database. This enables fast access to
- * game header information.
+ * The Index class holds the header information of all games in the
+ * current database. Tag values are interned into a value dictionary and
+ * stored column by column (see TagColumns). This enables fast access to
+ * game header information and sequential scans over single tags.
  *
  */
 
@@ -61,9 +65,11 @@ public:
     void setTag(const QString& tagName, const QString &value, GameId gameId);
 	/** Store the tag value for the given game, tag is given by name w/o locking*/
 	void setTag_nolock(const QString& tagName, const QString &value, GameId gameId);
+    /** Store the tag value @p values[i] for game @p gameIds[i] under a single lock */
+    void setTagValues(const QString& tagName, const QVector<GameId>& gameIds, const QVector<QString>& values);
 
-    /** Set the valid flag accordingly */
-    bool replaceTagValue(const QStringList &tags, const QString& newValue, const QString& oldValue);
+    /** Replace @p oldValue by @p newValue in @p tags of all games, the changed games are added to @p gameIds */
+    bool replaceTagValue(const QStringList &tags, const QString& newValue, const QString& oldValue, QVector<GameId>* gameIds = nullptr);
 
     // Retrieving tags //
     //
@@ -95,6 +101,11 @@ public:
 
     /** Query the value of a tag given the tags index for a specific game */
     QString tagValue_byIndex(TagIndex tagIndex, GameId gameId) const;
+    /** @return the values of @p tagName for all games, absent values are 0.
+        This is a shallow copy of the column if the tag is frequent. */
+    QVector<ValueIndex> tagColumn(const QString& tagName) const;
+    /** Get the value of a @p valueIndex, as found in a tagColumn() */
+    QString tagValueFromIndex(ValueIndex valueIndex) const;
 
     /** Get the list of players (optimized query, as it reads white and black names w/o duplicates) */
     QStringList playerNames() const;
@@ -130,6 +141,15 @@ public:
     /** Read the index from disk, using m_filename */
     bool read(QDataStream& in, volatile bool *breakFlag, short version);
 
+    /** Append the index in the fixed layout used by map() to @p data */
+    void writeMapped(QByteArray& data) const;
+    /** Use an index written by writeMapped() in place, usually from a memory
+        mapped file. Tag names are read at once, the value dictionary and the
+        tag columns are only looked up when needed. @p data must stay valid
+        until the index is cleared.
+        @return false if @p data is invalid */
+    bool map(const char* data, qint64 size);
+
     /** Clear all cached values */
     void clearCache();
 
@@ -186,12 +206,26 @@ private:
     /** Get the name of a @p valueIndex */
     QString tagValueName(ValueIndex valueIndex) const;
 
+    /** @return true if the value dictionary contains @p valueIndex */
+    bool hasTagValue(ValueIndex valueIndex) const;
+    /** @return the stored string of @p valueIndex, including the suffix of colliding values */
+    QString storedTagValue(ValueIndex valueIndex) const;
+    /** @return the value dictionary, copied from the mapped data if needed */
+    QHash<ValueIndex, QString> tagValueHash() const;
+    /** Copy the mapped value dictionary into memory before changing it */
+    void detachTagValues();
+
     /** @ret the value index number of a tags index @p value for a given game */
     ValueIndex valueIndexFromIndex(TagIndex tagIndex, GameId gameId) const;
 
     /** @ret true if a game @p gameId has a given tag index */
     bool indexItemHasTag(TagIndex tagIndex, GameId gameId) const;
 
+    /** Evaluate @p predicate once per distinct value of the tag @p tagIndex.
+        @ret a bit array of the games whose value satisfies the predicate */
+    template <class Predicate>
+    QBitArray listMatching(TagIndex tagIndex, Predicate predicate) const;
+
 private:
     /** Contains information which games are marked for deletion */
     QSet<GameId> m_deletedGames;
@@ -203,8 +237,20 @@ private:
     QHash<ValueIndex, QString> m_tagValues;
     /** Contains information which games are marked as valid */
     QSet<GameId> m_validFlags;
-    /** Hold the list of index items (=holds all game header information) */
-    QVector<IndexItem> m_indexItems;
+    /** Hold the tag columns (=holds all game header information) */
+    TagColumns m_columns;
+
+    /** Entry of the mapped value dictionary, the string is stored in m_mappedPool */
+    struct MappedValue
+    {
+        ValueIndex valueIndex;
+        quint32 offset;
+        quint32 length;
+    };
+    /** Mapped value dictionary sorted by ValueIndex, used instead of m_tagValues if set */
+    const MappedValue* m_mappedValues;
+    int m_mappedValueCount;
+    const QChar* m_mappedPool;
 
     mutable QReadWriteLock m_mutex;
 };
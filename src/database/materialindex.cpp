@@ -0,0 +1,94 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include "gamex.h"
+#include "materialindex.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+MaterialIndex::MaterialIndex()
+{
+    clear();
+}
+
+void MaterialIndex::clear()
+{
+    m_offsets.clear();
+    m_offsets.append(0);
+    m_signatures.clear();
+    m_moveIds.clear();
+}
+
+void MaterialIndex::collect(const GameX& game, QVector<quint64>& signatures, QVector<MoveId>& moveIds)
+{
+    const GameCursor& cursor = game.cursor();
+    BoardX board(cursor.initialBoard());
+    quint64 last = 0;
+
+    MoveId current = ROOT_NODE;
+    while (current != NO_MOVE)
+    {
+        quint64 signature = board.materialSignature();
+        if (current == ROOT_NODE || signature != last)
+        {
+            signatures.append(signature);
+            moveIds.append(current);
+            last = signature;
+        }
+        MoveId next = cursor.nextMove(current);
+        if (next != NO_MOVE)
+        {
+            board.doMove(cursor.move(next));
+        }
+        current = next;
+    }
+}
+
+void MaterialIndex::addGame(GameId gameId, const GameX& game)
+{
+    while (count() < (int)gameId)
+    {
+        m_offsets.append(m_signatures.count());
+    }
+    collect(game, m_signatures, m_moveIds);
+    m_offsets.append(m_signatures.count());
+}
+
+MaterialIndex::Range MaterialIndex::range(GameId gameId) const
+{
+    if ((int)gameId >= count())
+    {
+        return Range(0, 0);
+    }
+    return Range(m_offsets.at(gameId), m_offsets.at(gameId + 1));
+}
+
+void MaterialIndex::write(QDataStream& out) const
+{
+    out << m_offsets;
+    out << m_signatures;
+    out << m_moveIds;
+}
+
+bool MaterialIndex::read(QDataStream& in, volatile bool* breakFlag)
+{
+    clear();
+    in >> m_offsets;
+    if (breakFlag && *breakFlag) return false;
+    in >> m_signatures;
+    in >> m_moveIds;
+    if ((breakFlag && *breakFlag) ||
+        (in.status() != QDataStream::Ok) ||
+        m_offsets.isEmpty() ||
+        ((int)m_offsets.last() != m_signatures.count()) ||
+        (m_moveIds.count() != m_signatures.count()))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
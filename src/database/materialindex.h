@@ -0,0 +1,64 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef MATERIALINDEX_H
+#define MATERIALINDEX_H
+
+#include <QDataStream>
+#include <QPair>
+#include <QVector>
+
+#include "gamecursor.h"
+#include "gameid.h"
+
+class GameX;
+
+/** @ingroup Database
+ * The MaterialIndex class keeps for every game the material configurations
+ * reached in its main line, as BitBoard::materialSignature(), together with
+ * the move id of the first position having it. Material only changes by
+ * captures and promotions, so a game has a few dozen entries at most and
+ * material searches need not parse any moves.
+ */
+class MaterialIndex
+{
+public:
+    /** A range of entries belonging to one game */
+    typedef QPair<int, int> Range;
+
+    MaterialIndex();
+
+    /** Remove all games */
+    void clear();
+    /** @return true if the index holds no games */
+    bool isEmpty() const { return m_offsets.count() <= 1; }
+    /** @return number of games */
+    int count() const { return m_offsets.count() - 1; }
+
+    /** Add the main line of @p game with id @p gameId, games have to be added in order */
+    void addGame(GameId gameId, const GameX& game);
+
+    /** @return the entries of game @p gameId */
+    Range range(GameId gameId) const;
+    /** @return the material signature of entry @p i */
+    quint64 signatureAt(int i) const { return m_signatures.at(i); }
+    /** @return the move id of the first position of entry @p i */
+    MoveId moveIdAt(int i) const { return m_moveIds.at(i); }
+
+    /** Append the material signatures of the main line of @p game and the move ids reaching them */
+    static void collect(const GameX& game, QVector<quint64>& signatures, QVector<MoveId>& moveIds);
+
+    /** Write the index to a stream */
+    void write(QDataStream& out) const;
+    /** Read the index from a stream, returns false if interrupted by @p breakFlag */
+    bool read(QDataStream& in, volatile bool* breakFlag);
+
+private:
+    /** Start of the entries of each game, plus the end of the last one */
+    QVector<quint32> m_offsets;
+    QVector<quint64> m_signatures;
+    QVector<MoveId> m_moveIds;
+};
+
+#endif // MATERIALINDEX_H
@@ -0,0 +1,150 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include "materialsearch.h"
+
+#include "database.h"
+#include "gamex.h"
+#include "materialindex.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+/** Number of 4 bit fields of a material signature */
+#define MATERIAL_FIELDS 10
+
+/* MaterialSearch Class
+ * ******************************/
+MaterialSearch::MaterialSearch(Database* db) :
+    Search(db),
+    m_min(0),
+    m_max(Q_UINT64_C(0xFFFFFFFFFF)),
+    m_ignoreColors(false),
+    m_materialIndex(nullptr)
+{
+}
+
+void MaterialSearch::setRange(Color color, PieceType type, int min, int max)
+{
+    int shift = BitBoard::materialShift(color, type);
+    quint64 mask = Q_UINT64_C(0xF) << shift;
+    m_min = (m_min & ~mask) | (quint64(qBound(0, min, 15)) << shift);
+    m_max = (m_max & ~mask) | (quint64(qBound(0, max, 15)) << shift);
+}
+
+bool MaterialSearch::setMaterial(Color color, const QString& pieces)
+{
+    int counts[Pawn + 1] = { 0 };
+    for (QChar c: pieces)
+    {
+        switch (c.toUpper().toLatin1())
+        {
+        case 'K': break;
+        case 'Q': ++counts[Queen]; break;
+        case 'R': ++counts[Rook]; break;
+        case 'B': ++counts[Bishop]; break;
+        case 'N': ++counts[Knight]; break;
+        case 'P': ++counts[Pawn]; break;
+        default: return false;
+        }
+    }
+    for (int type = Queen; type <= Pawn; ++type)
+    {
+        setRange(color, PieceType(type), counts[type], counts[type]);
+    }
+    return true;
+}
+
+void MaterialSearch::setMaterial(const BitBoard& board)
+{
+    quint64 signature = board.materialSignature();
+    for (int color = White; color <= Black; ++color)
+    {
+        for (int type = Queen; type <= Pawn; ++type)
+        {
+            int count = BitBoard::materialCount(signature, Color(color), PieceType(type));
+            setRange(Color(color), PieceType(type), count, count);
+        }
+    }
+}
+
+void MaterialSearch::setIgnoreColors(bool ignoreColors)
+{
+    m_ignoreColors = ignoreColors;
+}
+
+inline bool MaterialSearch::inRange(quint64 signature) const
+{
+    for (int shift = 0; shift < 4 * MATERIAL_FIELDS; shift += 4)
+    {
+        quint64 value = (signature >> shift) & 0xF;
+        if (value < ((m_min >> shift) & 0xF) || value > ((m_max >> shift) & 0xF))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MaterialSearch::matchesSignature(quint64 signature) const
+{
+    if (inRange(signature))
+    {
+        return true;
+    }
+    if (m_ignoreColors)
+    {
+        // White fields are the lower half, black fields the upper half
+        const int half = 4 * MATERIAL_FIELDS / 2;
+        quint64 swapped = (signature >> half) | ((signature & ((Q_UINT64_C(1) << half) - 1)) << half);
+        return inRange(swapped);
+    }
+    return false;
+}
+
+void MaterialSearch::Prepare(volatile bool&)
+{
+    m_materialIndex = m_database ? m_database->materialIndex() : nullptr;
+}
+
+bool MaterialSearch::isThreadSafe() const
+{
+    return m_materialIndex || (m_database && m_database->supportsConcurrentLoads());
+}
+
+int MaterialSearch::matches(GameId index) const
+{
+    if (m_materialIndex)
+    {
+        MaterialIndex::Range range = m_materialIndex->range(index);
+        for (int i = range.first; i < range.second; ++i)
+        {
+            if (matchesSignature(m_materialIndex->signatureAt(i)))
+            {
+                return m_materialIndex->moveIdAt(i) + 1;
+            }
+        }
+        return 0;
+    }
+
+    if (!m_database)
+    {
+        return 0;
+    }
+    GameX game;
+    m_database->loadGameMoves(index, game);
+    QVector<quint64> signatures;
+    QVector<MoveId> moveIds;
+    MaterialIndex::collect(game, signatures, moveIds);
+    for (int i = 0; i < signatures.count(); ++i)
+    {
+        if (matchesSignature(signatures[i]))
+        {
+            return moveIds[i] + 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef MATERIALSEARCH_H
+#define MATERIALSEARCH_H
+
+#include "search.h"
+#include "piece.h"
+
+class BitBoard;
+class MaterialIndex;
+
+/** @ingroup Search
+The MaterialSearch class finds games whose main line reaches a given material
+balance, e.g. rook endgames with rook and pawn against rook. Every piece type of
+each side has an allowed range of counts, kings are not counted.
+If the database provides a MaterialIndex, no moves need to be parsed.
+*/
+class MaterialSearch : public Search
+{
+    Q_OBJECT
+
+public:
+    /** Standard constructor, all material matches until restricted */
+    explicit MaterialSearch(Database* db = nullptr);
+
+    /** Require between @p min and @p max pieces of @p type for @p color */
+    void setRange(Color color, PieceType type, int min, int max);
+    /** Require exactly the pieces listed in @p pieces (e.g. "RP") for @p color.
+        @return false if @p pieces contains anything but piece letters */
+    bool setMaterial(Color color, const QString& pieces);
+    /** Require exactly the pieces standing on @p board */
+    void setMaterial(const BitBoard& board);
+    /** Also match positions with the colors exchanged */
+    void setIgnoreColors(bool ignoreColors);
+
+    /** @return true if @p signature as of BitBoard::materialSignature() is sought */
+    bool matchesSignature(quint64 signature) const;
+
+    /** Lookup the material index of the database, if there is one */
+    virtual void Prepare(volatile bool&);
+    /** Return the move id of the first position with the sought material + 1, 0 if none */
+    virtual int matches(GameId index) const;
+    /** The index is read only, without it the database must support concurrent loads */
+    virtual bool isThreadSafe() const;
+
+private:
+    bool inRange(quint64 signature) const;
+
+    /** Allowed counts for each field of the signature, packed like the signature */
+    quint64 m_min;
+    quint64 m_max;
+    bool m_ignoreColors;
+    /** Index used for the current search, nullptr if none */
+    const MaterialIndex* m_materialIndex;
+};
+
+#endif // MATERIALSEARCH_H
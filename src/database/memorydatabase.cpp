@@ -8,10 +8,13 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <algorithm>
+
 #include <QtCore>
 #include <QFileInfo>
 #include <QMutexLocker>
 #include "memorydatabase.h"
+#include "output.h"
 #include "settings.h"
 #include "tags.h"
 
@@ -30,14 +33,16 @@ MemoryDatabase::~MemoryDatabase()
 
 void MemoryDatabase::clear()
 {
-    for(int i = 0; i < m_games.count(); ++i)
-    {
-        delete m_games[i];
-    }
     m_games.clear();
     m_index.clear();
     m_isModified = false;
     m_transaction = false;
+    m_fileRanges.clear();
+    m_unsavedGames.clear();
+    m_untrackedChanges = false;
+    m_blankedBytes = 0;
+    m_fileSize = 0;
+    m_fileModified = QDateTime();
 
     PgnDatabase::clear();
 }
@@ -54,10 +59,33 @@ bool MemoryDatabase::isModified() const
 
 void MemoryDatabase::setModified(bool b)
 {
+    // Changes made through the index directly are not known game by game
+    m_untrackedChanges = m_untrackedChanges || b;
     m_isModified = b;
     if (!m_transaction) emit dirtyChanged(m_isModified);
 }
 
+void MemoryDatabase::setUnsaved(GameId gameId)
+{
+    m_unsavedGames.insert(gameId);
+    m_isModified = true;
+    if (!m_transaction) emit dirtyChanged(m_isModified);
+}
+
+void MemoryDatabase::setTagsModified(const QVector<GameId>& gameIds)
+{
+    if (gameIds.isEmpty())
+    {
+        return;
+    }
+    for (GameId gameId: gameIds)
+    {
+        m_unsavedGames.insert(gameId);
+    }
+    m_isModified = true;
+    if (!m_transaction) emit dirtyChanged(m_isModified);
+}
+
 void MemoryDatabase::startTransaction(bool b)
 {
     m_transaction = b;
@@ -75,27 +103,22 @@ bool MemoryDatabase::appendGame(const GameX& game)
     setTagsToIndex(game, m_count);
 
     // Upate game array
-    GameX* newGame = new GameX;
-    *newGame = game;
-    newGame->clearTags();
-    newGame->unmountBoard();
-    m_games.append(newGame);
-    ++m_count;
-    setModified(true);
+    m_games.append(game);
+    setUnsaved(m_count++);
     return true;
 }
 
 bool MemoryDatabase::remove(GameId gameId)
 {
     m_index.setDeleted(gameId, true);
-    setModified(true);
+    setUnsaved(gameId);
     return true;
 }
 
 bool MemoryDatabase::undelete(GameId gameId)
 {
     m_index.setDeleted(gameId, false);
-    setModified(true);
+    setUnsaved(gameId);
     return true;
 }
 
@@ -110,10 +133,8 @@ bool MemoryDatabase::replace(GameId gameId, GameX& game)
     setTagsToIndex(game, gameId);
 
     // Upate game array
-    *m_games[gameId] = game;
-    m_games[gameId]->clearTags();
-    m_games[gameId]->unmountBoard();
-    setModified(true);
+    m_games.replace(gameId, game);
+    setUnsaved(gameId);
     return true;
 }
 
@@ -124,7 +145,10 @@ void MemoryDatabase::loadGameMoves(GameId gameId, GameX& game)
     {
         return;
     }
-    game = *m_games[gameId];
+    if (!m_games.load(gameId, game))
+    {
+        game.clear();
+    }
 }
 
 int MemoryDatabase::findPosition(GameId index, const BoardX &position)
@@ -143,7 +167,11 @@ bool MemoryDatabase::loadGame(GameId gameId, GameX& game)
         return false;
     }
 
-    game = *m_games[gameId];
+    if (!m_games.load(gameId, game))
+    {
+        game.clear();
+        return false;
+    }
     loadGameHeaders(gameId, game);
 
     return true;
@@ -152,50 +180,397 @@ bool MemoryDatabase::loadGame(GameId gameId, GameX& game)
 void MemoryDatabase::parseGame()
 {
     QWriteLocker m(&m_mutex);
-    GameX* game = new GameX;
+    GameX game;
 
     QString fen = m_index.tagValue(TagNameFEN, m_count - 1);
     QString variant = m_index.tagValue(TagNameVariant, m_count - 1).toLower();
     bool chess960 = (variant.startsWith("fischer", Qt::CaseInsensitive) || variant.endsWith("960"));
     if(fen != "?")
     {
-        game->dbSetStartingBoard(fen, chess960);
+        game.dbSetStartingBoard(fen, chess960);
     }
 
-    bool ok = parseMoves(game);
+    bool ok = parseMoves(&game);
 
     m_index.setValidFlag(m_count - 1, ok);
 
-    QString valLength = QString::number((game->plyCount() + 1) / 2);
-    game->setTag(TagNameLength, valLength);
+    QString valLength = QString::number((game.plyCount() + 1) / 2);
+    game.setTag(TagNameLength, valLength);
 
-    QString eco = game->tag(TagNameECO).left(3);
+    QString eco = game.tag(TagNameECO).left(3);
     if(eco == "?")
     {
         eco.clear();
-        game->setTag(TagNameECO, "");
+        game.setTag(TagNameECO, "");
     }
 
     if(AppSettings->getValue("/General/automaticECO").toBool())
     {
         if(eco.isEmpty() || !AppSettings->getValue("/General/preserveECO").toBool())
         {
-            eco = game->ecoClassify().left(3);
+            eco = game.ecoClassify().left(3);
             if(!eco.isEmpty())
             {
-                game->setTag(TagNameECO, eco);
+                game.setTag(TagNameECO, eco);
             }
         }
     }
 
-    setMissingTagsToIndex(*game, m_count-1);
+    setMissingTagsToIndex(game, m_count-1);
 
-    game->unmountBoard();
     m_games.append(game);
 }
 
 bool MemoryDatabase::parseFile()
 {
     bool ok = parseFileIntern();
+    m_games.squeeze();
+    if (ok && qobject_cast<QFile*>(m_file.data()))
+    {
+        // Each game extends up to the next one
+        updateFileStamp();
+        m_fileRanges.resize(m_count);
+        for (GameId i = 0; i < (GameId)m_count; ++i)
+        {
+            m_fileRanges[i].begin = offset(i);
+            m_fileRanges[i].end = (i + 1 < (GameId)m_count) ? offset(i + 1) : m_fileSize;
+        }
+        if (m_count && hadBOM())
+        {
+            m_fileRanges[0].begin = std::max<qint64>(m_fileRanges[0].begin, 3);
+        }
+        m_blankedBytes = blankedBytes();
+    }
     return ok;
 }
+
+qint64 MemoryDatabase::blankedBytes() const
+{
+    QFile file(filename());
+    qint64 size = file.size();
+    if (!size || !file.open(QIODevice::ReadOnly))
+    {
+        return 0;
+    }
+    const uchar* data = file.map(0, size);
+    if (!data)
+    {
+        return 0;
+    }
+    qint64 blanked = 0;
+    for (const FileRange& range: m_fileRanges)
+    {
+        qint64 end = std::min(range.end, size);
+        qint64 i = end;
+        while (i > range.begin && (data[i - 1] == ' ' || data[i - 1] == '\n' || data[i - 1] == '\r'))
+        {
+            --i;
+        }
+        // Besides the blank line in front of the next game
+        blanked += std::max<qint64>(0, end - i - 4);
+    }
+    file.unmap(const_cast<uchar*>(data));
+    return blanked;
+}
+
+void MemoryDatabase::updateFileStamp()
+{
+    QFileInfo fi(filename());
+    m_fileSize = fi.size();
+    m_fileModified = fi.lastModified();
+}
+
+/** @return @p size bytes of blank lines */
+static QByteArray blankText(qint64 size)
+{
+    QByteArray text(size, ' ');
+    for (qint64 i = size - 1; i >= 0; i -= 80)
+    {
+        text[i] = '\n';
+    }
+    return text;
+}
+
+/** Move @p size bytes of @p file from @p from to @p to, which must not be in front of @p from */
+static bool moveBytes(QFile& file, qint64 from, qint64 to, qint64 size)
+{
+    // Copy from the end, so that no byte is overwritten before it is read
+    const qint64 chunk = 0x100000;
+    while (size > 0)
+    {
+        qint64 n = std::min(chunk, size);
+        size -= n;
+        if (!file.seek(from + size))
+        {
+            return false;
+        }
+        QByteArray data = file.read(n);
+        if (data.size() != n || !file.seek(to + size) || file.write(data) != n)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MemoryDatabase::saveChanges(Output& output)
+{
+    QFileInfo fi(filename());
+    if (m_untrackedChanges || !m_fileModified.isValid() || !fi.exists() ||
+        fi.size() != m_fileSize || fi.lastModified() != m_fileModified)
+    {
+        return false;
+    }
+    if (m_blankedBytes > m_fileSize / 2)
+    {
+        // Compact the file by writing it as a whole
+        return false;
+    }
+
+    QList<GameId> games = m_unsavedGames.values();
+    std::sort(games.begin(), games.end());
+    games.erase(std::lower_bound(games.begin(), games.end(), (GameId)m_count), games.end());
+    QVector<FileRange> ranges = m_fileRanges;
+    while (ranges.count() < (int)m_count)
+    {
+        ranges.append(FileRange{-1, -1});
+    }
+    int lastInFile = ranges.count() - 1;
+    while (lastInFile >= 0 && ranges[lastInFile].begin < 0)
+    {
+        --lastInFile;
+    }
+
+    // Games are only found in the order of the file, so a changed game has to stay
+    // in its place and only games behind all others can be appended
+    QVector<QByteArray> texts;
+    for (GameId gameId: std::as_const(games))
+    {
+        QByteArray text;
+        GameX game;
+        if (loadGame(gameId, game))
+        {
+            QString s = output.outputDatabaseGame(&game);
+            text = isUtf8() ? s.toUtf8() : s.toLatin1();
+            // The next game is only found after a blank line
+            if (!text.endsWith('\n'))
+            {
+                text.append('\n');
+            }
+            if (!text.endsWith("\n\n"))
+            {
+                text.append('\n');
+            }
+
+            if (ranges[gameId].begin < 0 && (int)gameId < lastInFile)
+            {
+                return false;
+            }
+        }
+        texts.append(text);
+    }
+
+    QFile file(filename());
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        return false;
+    }
+
+    qint64 end = m_fileSize;
+    qint64 blanked = m_blankedBytes;
+    bool ok = true;
+
+    // Blank the deleted games first, a game in front of them may grow into their text
+    for (int i = 0; i < games.count(); ++i)
+    {
+        FileRange& range = ranges[games[i]];
+        if (texts[i].isEmpty() && range.begin >= 0)
+        {
+            qint64 size = range.end - range.begin;
+            ok = ok && file.seek(range.begin) && file.write(blankText(size)) == size;
+            blanked += size;
+            range.begin = range.end = -1;
+        }
+    }
+    QMap<qint64, GameId> starts;
+    for (GameId gameId = 0; gameId < (GameId)ranges.count(); ++gameId)
+    {
+        if (ranges[gameId].begin >= 0)
+        {
+            starts.insert(ranges[gameId].begin, gameId);
+        }
+    }
+
+    // A changed game is written over its old text and the blank text behind it.
+    // If it does not fit, the rest of the file is moved behind it.
+    QMap<qint64, int> grown;
+    for (int i = 0; i < games.count(); ++i)
+    {
+        const QByteArray& text = texts[i];
+        FileRange& range = ranges[games[i]];
+        if (text.isEmpty() || range.begin < 0)
+        {
+            continue;
+        }
+        auto next = starts.upperBound(range.begin);
+        if (next != starts.end() && range.begin + text.size() > next.key())
+        {
+            grown.insert(range.begin, i);
+            continue;
+        }
+        qint64 size = range.end - range.begin;
+        if (text.size() <= size)
+        {
+            ok = ok && file.seek(range.begin) && file.write(text + blankText(size - text.size())) == size;
+            blanked += size - text.size();
+            continue;
+        }
+        ok = ok && file.seek(range.begin) && file.write(text) == text.size();
+        blanked -= std::max<qint64>(0, std::min(range.begin + text.size(), end) - range.end);
+        range.end = range.begin + text.size();
+        end = std::max(end, range.end);
+    }
+    if (!grown.isEmpty())
+    {
+        // Each grown game gets some blank text behind it, so that it can grow in place next time
+        const QList<qint64> begins = grown.keys();
+        QVector<qint64> limits;
+        QVector<qint64> spaces;
+        QVector<qint64> shifts;
+        qint64 shift = 0;
+        for (qint64 begin: begins)
+        {
+            int i = grown.value(begin);
+            qint64 limit = starts.upperBound(begin).key();
+            qint64 space = texts[i].size() + texts[i].size() / 4 + 80;
+            blanked -= limit - ranges[games[i]].end;
+            shift += space - (limit - begin);
+            limits.append(limit);
+            spaces.append(space);
+            shifts.append(shift);
+        }
+
+        // Move the text between the grown games, starting with the last part
+        for (int j = begins.count() - 1; ok && j >= 0; --j)
+        {
+            qint64 to = (j + 1 < begins.count()) ? begins[j + 1] : end;
+            ok = moveBytes(file, limits[j], limits[j] + shifts[j], to - limits[j]);
+        }
+        for (auto it = starts.cbegin(); it != starts.cend(); ++it)
+        {
+            FileRange& range = ranges[it.value()];
+            int j = int(std::lower_bound(begins.cbegin(), begins.cend(), range.begin) - begins.cbegin());
+            bool isGrown = (j < begins.count() && begins[j] == range.begin);
+            qint64 offset = j ? shifts[j - 1] : 0;
+            range.begin += offset;
+            if (isGrown)
+            {
+                const QByteArray& text = texts[grown.value(begins[j])];
+                range.end = range.begin + spaces[j];
+                ok = ok && file.seek(range.begin) && file.write(text + blankText(spaces[j] - text.size())) == spaces[j];
+            }
+            else
+            {
+                range.end += offset;
+            }
+        }
+        end += shift;
+    }
+
+    // New games are appended
+    for (int i = 0; i < games.count(); ++i)
+    {
+        const QByteArray& text = texts[i];
+        FileRange& range = ranges[games[i]];
+        if (text.isEmpty() || range.begin >= 0)
+        {
+            continue;
+        }
+        // Separate the game from the end of the file by a blank line
+        QByteArray tail;
+        if (end > 0)
+        {
+            qint64 n = std::min<qint64>(end, 4);
+            ok = ok && file.seek(end - n);
+            tail = file.read(n);
+            tail.replace('\r', QByteArray());
+        }
+        QByteArray separator;
+        if (!tail.isEmpty() && !tail.endsWith("\n\n"))
+        {
+            separator = tail.endsWith('\n') ? "\n" : "\n\n";
+        }
+        ok = ok && file.seek(end) && file.write(separator) == separator.size() && file.write(text) == text.size();
+        range.begin = end + separator.size();
+        end = range.end = range.begin + text.size();
+    }
+    ok = file.flush() && ok;
+    file.close();
+    if (!ok)
+    {
+        return false;
+    }
+
+    m_fileRanges = ranges;
+    m_blankedBytes = std::max<qint64>(0, blanked);
+    m_unsavedGames.clear();
+    updateFileStamp();
+    setModified(false);
+    return true;
+}
+
+void MemoryDatabase::fileWritten()
+{
+    m_unsavedGames.clear();
+    m_untrackedChanges = false;
+    m_fileRanges.clear();
+    m_blankedBytes = 0;
+    m_fileModified = QDateTime();
+
+    QFile file(filename());
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    qint64 size = file.size();
+    const uchar* data = size ? file.map(0, size) : nullptr;
+    if (size && !data)
+    {
+        return;
+    }
+
+    QVector<qint64> begins;
+    PgnScanner scanner(reinterpret_cast<const char*>(data), size, isUtf8());
+    PgnScanner::GameHeader header;
+    qint64 pos = 0;
+    while (scanner.nextGame(pos, size, header))
+    {
+        begins.append(header.offset);
+    }
+
+    // The games were written in order, leaving out the deleted ones
+    QVector<FileRange> ranges((int)m_count, FileRange{-1, -1});
+    int k = 0;
+    for (GameId i = 0; i < (GameId)m_count; ++i)
+    {
+        if (m_index.deleted(i))
+        {
+            continue;
+        }
+        if (k >= begins.count())
+        {
+            return;
+        }
+        ranges[i].begin = begins[k];
+        ranges[i].end = (k + 1 < begins.count()) ? begins[k + 1] : size;
+        ++k;
+    }
+    if (k != begins.count())
+    {
+        return;
+    }
+
+    m_fileRanges = ranges;
+    m_fileSize = size;
+    updateFileStamp();
+}
@@ -11,10 +11,15 @@
 #ifndef MEMORYDATABASE_H__
 #define MEMORYDATABASE_H__
 
+#include <QDateTime>
 #include <QMutex>
+#include <QSet>
 #include <QVector>
+#include "gamestore.h"
 #include "pgndatabase.h"
 
+class Output;
+
 /** @ingroup Database
    The MemoryDatabase class provides database access to PGN files.
    Games are stored in memory, and are editable.
@@ -41,6 +46,8 @@ public:
     virtual bool isModified() const;
     /** Set database dirty flag */
     void setModified(bool b);
+    /** Mark @p gameIds as modified, to be written by the next saveChanges() */
+    virtual void setTagsModified(const QVector<GameId>& gameIds);
     /** Set database dirty flag */
     void startTransaction(bool b);
     /** Adds a game to the database */
@@ -57,16 +64,54 @@ public:
     /** Loads only moves into a game from the given position */
     void loadGameMoves(GameId gameId, GameX& game);
     virtual int findPosition(GameId index, const BoardX& position);
+    /** Games are unpacked from the store under the read lock */
+    virtual bool supportsConcurrentLoads() const { return true; }
+
+    /** Save the changes since the file was read or written in place. Changed
+        games are written over their old text and the blank text behind it, if
+        they do not fit, the rest of the file is moved. New games are appended.
+        The text of deleted games is blanked.
+        @return false if the file has to be written as a whole, because it was
+        changed meanwhile, an undeleted game lost its place or too much of it
+        is blanked */
+    bool saveChanges(Output& output);
+    /** Find the games in the file after it was written as a whole by @p output */
+    void fileWritten();
 
 protected:
     virtual void parseGame();
     virtual bool hasIndexFile() const { return false; }
+    virtual bool indexesHeadersOnly() const { return false; }
 
 private:
     bool parseFile();
+    /** Remember the size and time of the file, to detect changes by others */
+    void updateFileStamp();
+    /** Mark game @p gameId as modified, to be written by the next saveChanges() */
+    void setUnsaved(GameId gameId);
+    /** @return number of bytes blanked by saveChanges(), also in earlier sessions */
+    qint64 blankedBytes() const;
 
 private:
-    QVector <GameX*> m_games;
+    /** Byte range of the text of a game in the file, begin is -1 if it is not stored there */
+    struct FileRange
+    {
+        qint64 begin;
+        qint64 end;
+    };
+
+    /** Moves and annotations of the games, the tags are kept in the index */
+    GameStore m_games;
+    /** Location of the games in the file, empty if it is unknown */
+    QVector<FileRange> m_fileRanges;
+    /** Games which are new, changed, deleted or undeleted since the file was written */
+    QSet<GameId> m_unsavedGames;
+    /** Set if the database was modified in a way that saveChanges() cannot follow */
+    bool m_untrackedChanges {false};
+    /** Number of blanked bytes in the file */
+    qint64 m_blankedBytes {0};
+    qint64 m_fileSize {0};
+    QDateTime m_fileModified;
     bool m_isModified {false};
     bool m_transaction {false};
     mutable QReadWriteLock m_mutex;
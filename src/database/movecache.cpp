@@ -0,0 +1,194 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include "gamex.h"
+#include "movecache.h"
+#include "positionindex.h"
+
+using namespace chessx;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+/** Flag in the move word: a link word follows */
+#define MOVE_CACHE_LINK 0x8000
+/** Flag in the link word: the node starts a variation */
+#define MOVE_CACHE_VARIATION 0x8000
+
+static inline void appendWord(QByteArray& data, quint16 word)
+{
+    data.append(char(word & 0xFF));
+    data.append(char(word >> 8));
+}
+
+static inline quint16 readWord(const char* p)
+{
+    return quint16((unsigned char) p[0] | ((unsigned char) p[1] << 8));
+}
+
+static Move decodeMove(const BoardX& board, quint16 code)
+{
+    Square from = Square(code & 63);
+    Square to = Square((code >> 6) & 63);
+    if (from == to)
+    {
+        return (from == a3) ? board.dummyMove() : board.nullMove();
+    }
+    Move m = board.prepareMove(from, to);
+    PieceType promoted = PieceType((code >> 12) & 7);
+    if (m.isPromotion() && promoted != None)
+    {
+        m.setPromoted(promoted);
+    }
+    return m;
+}
+
+MoveCache::MoveCache()
+{
+    clear();
+}
+
+void MoveCache::clear()
+{
+    m_offsets.clear();
+    m_offsets.append(0);
+    m_data.clear();
+    m_cached.clear();
+}
+
+bool MoveCache::contains(GameId gameId) const
+{
+    return (int)gameId < m_cached.size() && m_cached.testBit(gameId);
+}
+
+bool MoveCache::encode(const GameX& game, QByteArray& data)
+{
+    const GameCursor& cursor = game.cursor();
+    if (cursor.capacity() > MOVE_CACHE_VARIATION)
+    {
+        return false;
+    }
+
+    for (MoveId id = 1; id < cursor.capacity(); ++id)
+    {
+        if (cursor.isRemoved(id))
+        {
+            return false;
+        }
+        MoveId previous = cursor.prevMove(id);
+        bool variation = (cursor.parentMove(id) == previous);
+        bool link = variation || (previous != id - 1);
+        appendWord(data, PositionIndex::encodeMove(cursor.move(id)) | (link ? MOVE_CACHE_LINK : 0));
+        if (link)
+        {
+            appendWord(data, quint16(previous) | (variation ? MOVE_CACHE_VARIATION : 0));
+        }
+    }
+    return true;
+}
+
+bool MoveCache::decode(const char* data, int size, GameX& game)
+{
+    MoveId id = 1;
+    for (const char* p = data, *end = data + size; p + 1 < end; p += 2, ++id)
+    {
+        quint16 code = readWord(p);
+        MoveId previous = id - 1;
+        bool variation = false;
+        if (code & MOVE_CACHE_LINK)
+        {
+            p += 2;
+            if (p + 1 >= end)
+            {
+                return false;
+            }
+            quint16 link = readWord(p);
+            previous = link & ~MOVE_CACHE_VARIATION;
+            variation = link & MOVE_CACHE_VARIATION;
+        }
+        if (previous != game.currentMove() && !game.dbMoveToId(previous))
+        {
+            return false;
+        }
+
+        Move m = decodeMove(game.board(), code & ~MOVE_CACHE_LINK);
+        if (!m.isLegal() && !m.isNullMove() && !m.isDummyMove())
+        {
+            return false;
+        }
+        MoveId node = variation ? game.dbAddVariation(m) : game.dbAddMove(m);
+        if (node != id)
+        {
+            return false;
+        }
+    }
+
+    // Leave the cursor at the end of the main line, as the parser does
+    MoveId last = ROOT_NODE;
+    while (game.cursor().nextMove(last) != NO_MOVE)
+    {
+        last = game.cursor().nextMove(last);
+    }
+    game.dbMoveToId(last);
+    return true;
+}
+
+bool MoveCache::append(const GameX& game)
+{
+    QByteArray data;
+    bool ok = encode(game, data) && (quint64(m_data.size()) + data.size() < 0x7FFFFFFF);
+    if (ok)
+    {
+        // Only keep games which decode to the very same move tree
+        GameX check;
+        check.dbSetStartingBoard(game.startingBoard().toFen(), game.startingBoard().chess960());
+        ok = decode(data.constData(), data.size(), check) && check.cursor().isEqual(game.cursor());
+    }
+    if (ok)
+    {
+        m_data.append(data);
+    }
+    m_offsets.append(m_data.size());
+    m_cached.resize(m_cached.size() + 1);
+    m_cached.setBit(m_cached.size() - 1, ok);
+    return ok;
+}
+
+bool MoveCache::load(GameId gameId, GameX& game) const
+{
+    if (!contains(gameId))
+    {
+        return false;
+    }
+    quint32 begin = m_offsets.at(gameId);
+    quint32 end = m_offsets.at(gameId + 1);
+    return decode(m_data.constData() + begin, int(end - begin), game);
+}
+
+void MoveCache::write(QDataStream& out) const
+{
+    out << m_offsets;
+    out << m_cached;
+    out << m_data;
+}
+
+bool MoveCache::read(QDataStream& in, volatile bool* breakFlag)
+{
+    clear();
+    in >> m_offsets;
+    in >> m_cached;
+    if (breakFlag && *breakFlag) return false;
+    in >> m_data;
+    if ((breakFlag && *breakFlag) ||
+        (in.status() != QDataStream::Ok) ||
+        (m_offsets.count() != m_cached.size() + 1) ||
+        (m_offsets.last() != (quint32)m_data.size()))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef MOVECACHE_H
+#define MOVECACHE_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QDataStream>
+#include <QVector>
+
+#include "gameid.h"
+
+class GameX;
+
+#define VERSION_MOVE_CACHE_1_0 0x0001
+#define VERSION_MOVE_CACHE_CURRENT VERSION_MOVE_CACHE_1_0
+
+#define MOVE_CACHE_FILE_MAGIC 0xce57
+
+/** @ingroup Database
+ * The MoveCache class keeps the move trees of all games of a database in a
+ * compact binary form, so that they can be restored without parsing SAN.
+ *
+ * Each node of a game is stored in the order of its move id as a 16 bit
+ * word holding the from and to squares and the promotion piece. Nodes which
+ * do not simply continue the previous node are followed by a second word
+ * with the id of their predecessor and a flag for the start of a variation.
+ * Annotations are not stored.
+ *
+ * Games which cannot be restored exactly, with the same move ids, are
+ * marked as not cached and have to be parsed.
+ */
+class MoveCache
+{
+public:
+    MoveCache();
+
+    /** Remove all games */
+    void clear();
+    /** @return true if no game is stored */
+    bool isEmpty() const { return m_cached.isEmpty(); }
+    /** @return number of games */
+    int count() const { return m_cached.size(); }
+    /** @return true if game @p gameId can be restored from the cache */
+    bool contains(GameId gameId) const;
+
+    /** Add @p game as the next game, returns false if it cannot be cached */
+    bool append(const GameX& game);
+    /** Restore the moves of game @p gameId into @p game, which already has
+        its starting position set. Returns false if the game is not cached. */
+    bool load(GameId gameId, GameX& game) const;
+
+    /** Write the cache to a stream */
+    void write(QDataStream& out) const;
+    /** Read the cache from a stream, returns false if interrupted by @p breakFlag */
+    bool read(QDataStream& in, volatile bool* breakFlag);
+
+    /** Encode the moves of @p game into @p data, returns false if not possible */
+    static bool encode(const GameX& game, QByteArray& data);
+    /** Decode @p size bytes of @p data into @p game */
+    static bool decode(const char* data, int size, GameX& game);
+
+private:
+    /** Start of each game in m_data, with one extra entry for the end */
+    QVector<quint32> m_offsets;
+    QByteArray m_data;
+    QBitArray m_cached;
+};
+
+#endif // MOVECACHE_H
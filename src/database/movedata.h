@@ -139,6 +139,22 @@ struct MoveData
     YearMetrics year;
     YearMetrics lastYear;
     Move move;
+
+    /** Add the statistics of @p rhs, which were collected for the same move */
+    MoveData& operator+=(const MoveData& rhs)
+    {
+        if (!results)
+        {
+            san = rhs.san;
+            localsan = rhs.localsan;
+            move = rhs.move;
+        }
+        results += rhs.results;
+        rating += rhs.rating;
+        year += rhs.year;
+        lastYear += rhs.lastYear;
+        return *this;
+    }
 };
 
 bool operator<(const MoveData& m1, const MoveData& m2);
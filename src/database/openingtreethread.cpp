@@ -2,8 +2,12 @@
 *   Copyright (C) 2014 by Jens Nissen jens-chessx@gmx.net                   *
 ****************************************************************************/
 
+#include <algorithm>
+
 #include <QMutex>
 #include <QMutexLocker>
+#include <QQueue>
+#include <QtConcurrent/QtConcurrent>
 
 #include "ctgdatabase.h"
 #include "database.h"
@@ -18,6 +22,15 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
+/** Games searched by one task of the thread pool and what was found */
+struct TreeBatch
+{
+    QList<GameId> games;
+    QList<MoveId> moveIds;
+    QMap<Move, MoveData> moves;
+    int processed;
+};
+
 OpeningTreeThread::OpeningTreeThread()
 {
     m_games = nullptr;
@@ -25,6 +38,11 @@ OpeningTreeThread::OpeningTreeThread()
     m_updateFilter = false;
     m_sourceIsDatabase = false;
     m_bEnd = false;
+    m_hitsValid = false;
+    m_hitsSize = 0;
+    m_hitsUpdateFilter = false;
+    m_hitsSourceIsDatabase = false;
+    m_hitsEnd = false;
 }
 
 void OpeningTreeThread::run()
@@ -52,75 +70,132 @@ void OpeningTreeThread::run()
     }
     else if (m_filter)
     {
-        const auto batchSize = 100;
+        Database* database = m_filter->database();
 
-        // setup buffers for batch processing
-        QList<GameId> rqBuffer;
-        QList<MoveId> rsBuffer;
-        rqBuffer.reserve(batchSize);
-        rsBuffer.reserve(batchSize);
+        // batches are searched one after the other if the database can not load games concurrently
+        const auto batchSize = 100;
+        const auto maxPending = database->supportsConcurrentLoads() ? 4 * QThread::idealThreadCount() : 1;
 
         // determine options
         Database::PositionSearchOptions opts = Database::PositionSearch_Default;
         if (m_bEnd)
             opts = Database::PositionSearch_GameEnd;
 
-        // scan games
-        int total = m_filter->size();
+        const BoardX board = m_board;
+
+        // restrict the search to candidates if the last update or a position index allows
+        QList<GameId> candidates;
+        QList<GameId> cleared;
+        bool useCandidates = findCandidates(candidates, cleared);
+        if (m_updateFilter)
+        {
+            for (auto gameId: std::as_const(cleared))
+            {
+                emit requestGameFilterUpdate(gameId, 0);
+            }
+        }
+
+        // scan games, the batches are searched by the thread pool and merged in order
+        QVector<QPair<GameId, MoveId>> hits;
+        QQueue<QFuture<TreeBatch>> pending;
+        int total = useCandidates ? candidates.size() : m_filter->size();
         int processed = 0;
-        while (processed < total)
+        while (processed < total || !pending.isEmpty())
         {
             // prepare requests
-            rqBuffer.clear();
-            rsBuffer.clear();
-            if (m_sourceIsDatabase)
+            while (processed < total && pending.size() < maxPending && !m_break)
             {
-                auto size = std::min(total - processed, batchSize);
-                for (auto i = 0; i < size; ++i)
+                QList<GameId> rqBuffer;
+                rqBuffer.reserve(batchSize);
+                if (useCandidates)
                 {
-                    auto gameId = processed + i;
-                    rqBuffer.append(gameId);
+                    auto size = std::min(total - processed, batchSize);
+                    rqBuffer = candidates.mid(processed, size);
+                    processed += size;
                 }
-                processed += size;
-            }
-            else
-            {
-                for (; processed < total && rqBuffer.size() < batchSize; ++processed)
+                else if (m_sourceIsDatabase)
                 {
-                    auto gameId = processed;
-                    if (m_filter->contains(gameId))
+                    auto size = std::min(total - processed, batchSize);
+                    for (auto i = 0; i < size; ++i)
+                    {
+                        auto gameId = processed + i;
                         rqBuffer.append(gameId);
+                    }
+                    processed += size;
+                }
+                else
+                {
+                    for (; processed < total && rqBuffer.size() < batchSize; ++processed)
+                    {
+                        auto gameId = processed;
+                        if (m_filter->contains(gameId))
+                            rqBuffer.append(gameId);
+                    }
                 }
+
+                // perform search
+                int batchEnd = processed;
+                pending.enqueue(QtConcurrent::run([database, board, opts, rqBuffer, batchEnd]()
+                {
+                    TreeBatch batch;
+                    batch.games = rqBuffer;
+                    batch.moveIds.reserve(rqBuffer.size());
+                    batch.processed = batchEnd;
+                    database->findPosition(board, opts, batch.games, batch.moveIds, batch.moves);
+                    return batch;
+                }));
+            }
+            if (pending.isEmpty())
+            {
+                break;
             }
 
-            // perform search
-            m_filter->database()->findPosition(m_board, opts, rqBuffer, rsBuffer, moves);
+            TreeBatch batch = pending.dequeue().result();
+
+            // interrupt if requested, running batches are awaited but discarded
+            if (m_break)
+            {
+                continue;
+            }
+
+            // merge the statistics of the batch
+            for (auto it = batch.moves.cbegin(); it != batch.moves.cend(); ++it)
+            {
+                moves[it.key()] += it.value();
+            }
 
             // update progress
-            for (auto&& rs: std::as_const(rsBuffer)) // Avoid detaching container
+            for (auto i = 0; i < batch.moveIds.size(); ++i)
             {
+                auto rs = batch.moveIds.at(i);
                 if (rs != NO_MOVE)
+                {
                     games += 1;
+                    hits.append(qMakePair(batch.games.at(i), rs));
+                }
             }
-            ProgressUpdate(moves, games, processed, total);
+            ProgressUpdate(moves, games, batch.processed, total);
 
             // update filter if necessary
             if (m_updateFilter)
             {
-                for (auto i = 0; i < rqBuffer.size(); ++i)
+                for (auto i = 0; i < batch.games.size(); ++i)
                 {
-                    auto rq = rqBuffer.at(i);
-                    auto rs = rsBuffer.at(i);
+                    auto rq = batch.games.at(i);
+                    auto rs = batch.moveIds.at(i);
                     emit requestGameFilterUpdate(rq, rs + 1);
                 }
             }
-
-            // interrupt if requested
-            if (m_break)
-            {
-                break;
-            }
         }
+
+        // remember the games found to start the next update from there
+        m_hitsValid = !m_break;
+        m_hits = hits;
+        m_hitsFilter = m_filter;
+        m_hitsSize = m_filter->size();
+        m_hitsUpdateFilter = m_updateFilter;
+        m_hitsSourceIsDatabase = m_sourceIsDatabase;
+        m_hitsEnd = m_bEnd;
     }
     *m_games = games;
     if(!m_break)
@@ -139,6 +214,58 @@ void OpeningTreeThread::run()
     }
 }
 
+bool OpeningTreeThread::findCandidates(QList<GameId>& candidates, QList<GameId>& cleared) const
+{
+    // With filter updates the filter holds exactly the games found by the last update,
+    // unless it was changed in the meantime
+    bool filterIsHits = m_updateFilter && m_hitsValid && m_hitsUpdateFilter &&
+                        (m_hitsFilter == m_filter) && (m_hitsSize == m_filter->size()) &&
+                        (m_hitsSourceIsDatabase == m_sourceIsDatabase) && (m_hitsEnd == m_bEnd) &&
+                        (m_filter->count() == m_hits.size());
+    for (auto i = 0; filterIsHits && i < m_hits.size(); ++i)
+    {
+        const auto& hit = m_hits.at(i);
+        filterIsHits = (m_filter->gamePosition(hit.first) == FilterX::value_type(hit.second + 1));
+    }
+
+    // A position index lists all games reaching the position, including transpositions
+    const PositionIndex* index = m_filter->database()->positionIndex();
+    if (index && (!m_updateFilter || filterIsHits))
+    {
+        PositionIndex::Range range = index->range(m_board.getHashValue());
+        for (auto i = range.first; i < range.second; ++i)
+        {
+            GameId gameId = index->gameAt(i);
+            if (m_sourceIsDatabase || m_filter->contains(gameId))
+            {
+                candidates.append(gameId);
+            }
+        }
+        if (filterIsHits)
+        {
+            for (const auto& hit: m_hits)
+            {
+                if (!std::binary_search(candidates.cbegin(), candidates.cend(), hit.first))
+                {
+                    cleared.append(hit.first);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Without an index only the games in the filter can match, which are the last hits
+    if (filterIsHits && !m_sourceIsDatabase)
+    {
+        for (const auto& hit: m_hits)
+        {
+            candidates.append(hit.first);
+        }
+        return true;
+    }
+    return false;
+}
+
 void OpeningTreeThread::cancel()
 {
     m_break = true;
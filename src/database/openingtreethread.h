@@ -9,7 +9,9 @@
 #include "gamex.h"
 #include "movedata.h"
 
+#include <QPair>
 #include <QPointer>
+#include <QVector>
 
 class OpeningTreeThread : public QThread
 {
@@ -29,9 +31,22 @@ signals:
 
 protected:
     void ProgressUpdate(QMap<Move, MoveData>& moves, unsigned int games, int i, int n);
+    /** Determine the games to search if not all games of the filter have to be scanned.
+        @p cleared receives games found by the last update which have to be removed from the filter. */
+    bool findCandidates(QList<GameId>& candidates, QList<GameId>& cleared) const;
 private:
     unsigned int* m_games;
 
+    /** Games found by the last completed update with the node of the position */
+    QVector<QPair<GameId, MoveId>> m_hits;
+    /** Settings of the last completed update */
+    bool m_hitsValid;
+    QPointer<FilterX> m_hitsFilter;
+    unsigned int m_hitsSize;
+    bool m_hitsUpdateFilter;
+    bool m_hitsSourceIsDatabase;
+    bool m_hitsEnd;
+
     bool    m_break;
     BoardX   m_board;
     QPointer<FilterX> m_filter;
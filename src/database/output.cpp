@@ -769,6 +769,18 @@ QString Output::output(const GameX* game, bool upToCurrentMove)
     return text;
 }
 
+QString Output::outputDatabaseGame(const GameX* game)
+{
+    QString text = outputTags(game);
+
+    QString gameText = outputGame(game, false);
+    postProcessOutput(gameText);
+    text += gameText;
+    text += "\n\n";
+
+    return text;
+}
+
 QString Output::outputTags(const GameX* game)
 {
     QString text;
@@ -867,13 +879,7 @@ void Output::outputUtf8(QTextStream& out, FilterX& filter)
     {
         if(filter.database()->loadGame(i, game))
         {
-            QString tagText = outputTags(&game);
-            out << tagText;
-
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            out << outText;
-            out << "\n\n";
+            out << outputDatabaseGame(&game);
         }
         int percentDone2 = (i + 1) * 100 / filter.count();
         if(percentDone2 > percentDone)
@@ -900,14 +906,7 @@ void Output::outputLatin1(QDataStream& out, FilterX& filter)
     {
         if(filter.database()->loadGame(i, game))
         {
-            QString tagText = outputTags(&game);
-            b = tagText.toLatin1();
-            out.writeRawData(b, b.length());
-
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            outText.append("\n\n");
-            b = outText.toLatin1();
+            b = outputDatabaseGame(&game).toLatin1();
             out.writeRawData(b, b.length());
         }
         int percentDone2 = (i + 1) * 100 / filter.count();
@@ -937,13 +936,7 @@ void Output::outputUtf8(QTextStream& out, Database& database)
     {
         if(database.loadGame(i, game))
         {
-            QString tagText = outputTags(&game);
-            out << tagText;
-
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            out << outText;
-            out << "\n\n";
+            out << outputDatabaseGame(&game);
         }
         int percentDone2 = (i + 1) * 100 / database.count();
         if(percentDone2 > percentDone)
@@ -972,14 +965,7 @@ void Output::outputLatin1(QDataStream& out, Database& database)
     {
         if(database.loadGame(i, game))
         {
-            QString tagText = outputTags(&game);
-            b = tagText.toLatin1();
-            out.writeRawData(b, b.length());
-
-            QString outText = outputGame(&game, false);
-            postProcessOutput(outText);
-            outText.append("\n\n");
-            b = outText.toLatin1();
+            b = outputDatabaseGame(&game).toLatin1();
             out.writeRawData(b, b.length());
         }
         int percentDone2 = (i + 1) * 100 / database.count();
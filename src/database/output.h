@@ -139,6 +139,9 @@ public:
      * @param database A pointer to a database object. All games in the database will be output, one
      *               after the other, using the output(GameX* game) method */
     QString outputUtf8(Database* database);
+    /** Create the text of a single game as it is written for each game of a database,
+     *  followed by an empty line. The header and footer of the template are left out. */
+    QString outputDatabaseGame(const GameX* game);
 
     /** Append output to a closed file */
     bool append(const QString& filename, GameX& game, bool utf8);
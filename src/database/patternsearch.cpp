@@ -0,0 +1,215 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <QtAlgorithms>
+
+#include "patternsearch.h"
+
+#include "bitboard.h"
+#include "database.h"
+#include "gamex.h"
+#include "materialindex.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+static inline quint64 squareMask(chessx::Square square)
+{
+    return Q_UINT64_C(1) << square;
+}
+
+static inline quint64 fileMask(int file)
+{
+    return Q_UINT64_C(0x0101010101010101) << file;
+}
+
+/* PatternSearch Class
+ * ******************************/
+PatternSearch::PatternSearch(Database* db) :
+    Search(db),
+    m_materialIndex(nullptr)
+{
+}
+
+PatternSearch::Term& PatternSearch::term(Color color, PieceType type)
+{
+    for (Term& t: m_terms)
+    {
+        if (t.color == color && t.type == type)
+        {
+            return t;
+        }
+    }
+    Term t = { color, type, 0, 0 };
+    m_terms.append(t);
+    return m_terms.last();
+}
+
+void PatternSearch::require(Color color, PieceType type, chessx::Square square)
+{
+    requireSquares(color, type, squareMask(square));
+}
+
+void PatternSearch::forbid(Color color, PieceType type, chessx::Square square)
+{
+    forbidSquares(color, type, squareMask(square));
+}
+
+void PatternSearch::requireSquares(Color color, PieceType type, quint64 squares)
+{
+    term(color, type).required |= squares;
+}
+
+void PatternSearch::forbidSquares(Color color, PieceType type, quint64 squares)
+{
+    term(color, type).forbidden |= squares;
+}
+
+void PatternSearch::requirePieces(const BitBoard& board)
+{
+    for (int color = White; color <= Black; ++color)
+    {
+        for (int type = King; type <= Pawn; ++type)
+        {
+            quint64 pieces = board.pieces(Color(color), PieceType(type));
+            if (pieces)
+            {
+                requireSquares(Color(color), PieceType(type), pieces);
+            }
+        }
+    }
+}
+
+void PatternSearch::addPawnStructure(PawnStructure structure)
+{
+    switch (structure)
+    {
+    case IsolatedQueenPawnWhite:
+        require(White, Pawn, chessx::d4);
+        forbidSquares(White, Pawn, fileMask(2) | fileMask(4));
+        break;
+    case IsolatedQueenPawnBlack:
+        require(Black, Pawn, chessx::d5);
+        forbidSquares(Black, Pawn, fileMask(2) | fileMask(4));
+        break;
+    case Carlsbad:
+        require(White, Pawn, chessx::d4);
+        require(White, Pawn, chessx::e3);
+        forbidSquares(White, Pawn, fileMask(2));
+        require(Black, Pawn, chessx::c6);
+        require(Black, Pawn, chessx::d5);
+        forbidSquares(Black, Pawn, fileMask(4));
+        break;
+    case MaroczyBind:
+        require(White, Pawn, chessx::c4);
+        require(White, Pawn, chessx::e4);
+        forbidSquares(White, Pawn, fileMask(3));
+        forbidSquares(Black, Pawn, fileMask(2));
+        break;
+    }
+}
+
+bool PatternSearch::matchesBoard(const BitBoard& board) const
+{
+    for (const Term& t: m_terms)
+    {
+        quint64 pieces = board.pieces(t.color, t.type);
+        if ((pieces & t.required) != t.required || (pieces & t.forbidden))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PatternSearch::matchesMaterial(quint64 signature) const
+{
+    for (const Term& t: m_terms)
+    {
+        if (t.type != King && t.required &&
+                BitBoard::materialCount(signature, t.color, t.type) < int(qPopulationCount(t.required)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PatternSearch::Prepare(volatile bool&)
+{
+    m_materialIndex = m_database ? m_database->materialIndex() : nullptr;
+}
+
+bool PatternSearch::isThreadSafe() const
+{
+    return m_database && m_database->supportsConcurrentLoads();
+}
+
+int PatternSearch::matches(GameId index) const
+{
+    if (!m_database)
+    {
+        return 0;
+    }
+
+    // Entries of the material index which may match, the replay stops after the last one
+    MaterialIndex::Range range(0, 0);
+    int lastEntry = -1;
+    if (m_materialIndex)
+    {
+        range = m_materialIndex->range(index);
+        for (int i = range.second - 1; i >= range.first; --i)
+        {
+            if (matchesMaterial(m_materialIndex->signatureAt(i)))
+            {
+                lastEntry = i;
+                break;
+            }
+        }
+        if (lastEntry < 0)
+        {
+            return 0;
+        }
+    }
+
+    GameX game;
+    m_database->loadGameMoves(index, game);
+    const GameCursor& cursor = game.cursor();
+    BoardX board(cursor.initialBoard());
+    int entry = range.first;
+    bool candidate = true;
+
+    MoveId current = ROOT_NODE;
+    while (current != NO_MOVE)
+    {
+        if (m_materialIndex)
+        {
+            if (entry + 1 < range.second && m_materialIndex->moveIdAt(entry + 1) == current)
+            {
+                ++entry;
+            }
+            if (entry > lastEntry)
+            {
+                break;
+            }
+            if (current == ROOT_NODE || m_materialIndex->moveIdAt(entry) == current)
+            {
+                candidate = matchesMaterial(m_materialIndex->signatureAt(entry));
+            }
+        }
+        if (candidate && matchesBoard(board))
+        {
+            return current + 1;
+        }
+        MoveId next = cursor.nextMove(current);
+        if (next != NO_MOVE)
+        {
+            board.doMove(cursor.move(next));
+        }
+        current = next;
+    }
+    return 0;
+}
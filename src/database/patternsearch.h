@@ -0,0 +1,83 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef PATTERNSEARCH_H
+#define PATTERNSEARCH_H
+
+#include <QVector>
+
+#include "search.h"
+#include "piece.h"
+#include "square.h"
+
+class BitBoard;
+class MaterialIndex;
+
+/** @ingroup Search
+The PatternSearch class finds games whose main line reaches a partial position:
+pieces which have to stand on given squares and pieces which must not stand on
+other squares. Typical pawn structures are predefined. Each position is tested
+by masking the piece bitboards, so the cost is dominated by replaying the moves.
+If the database provides a MaterialIndex, games and parts of games lacking the
+required pieces are skipped.
+*/
+class PatternSearch : public Search
+{
+    Q_OBJECT
+
+public:
+    enum PawnStructure
+    {
+        IsolatedQueenPawnWhite, ///< White pawn on d4 without c- and e-pawns
+        IsolatedQueenPawnBlack, ///< Black pawn on d5 without c- and e-pawns
+        Carlsbad,               ///< White d4 and e3 without c-pawn, Black c6 and d5 without e-pawn
+        MaroczyBind             ///< White c4 and e4 without d-pawn, Black without c-pawn
+    };
+
+    /** Standard constructor, every position matches until restricted */
+    explicit PatternSearch(Database* db = nullptr);
+
+    /** Require a piece of @p color and @p type on @p square */
+    void require(Color color, PieceType type, chessx::Square square);
+    /** Forbid pieces of @p color and @p type on @p square */
+    void forbid(Color color, PieceType type, chessx::Square square);
+    /** Require pieces of @p color and @p type on all squares of @p squares, bit n is square n */
+    void requireSquares(Color color, PieceType type, quint64 squares);
+    /** Forbid pieces of @p color and @p type on all squares of @p squares, bit n is square n */
+    void forbidSquares(Color color, PieceType type, quint64 squares);
+    /** Require all pieces of @p board on their squares, other squares may hold anything */
+    void requirePieces(const BitBoard& board);
+    /** Add the conditions of @p structure */
+    void addPawnStructure(PawnStructure structure);
+
+    /** @return true if @p board fulfills all conditions */
+    bool matchesBoard(const BitBoard& board) const;
+    /** @return true if a position with material @p signature may fulfill all conditions */
+    bool matchesMaterial(quint64 signature) const;
+
+    /** Lookup the material index of the database, if there is one */
+    virtual void Prepare(volatile bool&);
+    /** Return the move id of the first matching position + 1, 0 if none */
+    virtual int matches(GameId index) const;
+    /** Games are loaded by the database, which must support concurrent loads */
+    virtual bool isThreadSafe() const;
+
+private:
+    /** Conditions for the pieces of one color and type */
+    struct Term
+    {
+        Color color;
+        PieceType type;
+        quint64 required;
+        quint64 forbidden;
+    };
+
+    Term& term(Color color, PieceType type);
+
+    QVector<Term> m_terms;
+    /** Index used for the current search, nullptr if none */
+    const MaterialIndex* m_materialIndex;
+};
+
+#endif // PATTERNSEARCH_H
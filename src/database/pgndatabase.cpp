@@ -10,15 +10,19 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include <QBuffer>
 #include <QDir>
 #include <QStringList>
 #include <QtDebug>
 #include <QMutexLocker>
 #include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
 #include "board.h"
 #include "nag.h"
 
 #include "pgndatabase.h"
+#include "pgnmoveparser.h"
 #include "settings.h"
 #include "tags.h"
 
@@ -29,6 +33,11 @@ using namespace chessx;
 #define new DEBUG_NEW
 #endif // _MSC_VER
 
+/** Size of the byte ranges a PGN file is split into for indexing */
+#define SCAN_CHUNK_SIZE (4 * 1024 * 1024)
+/** Marks the fixed layout part of an index file, which is only valid on hosts of the same byte order */
+#define MAPPED_INDEX_BYTE_ORDER 0x01020304
+
 PgnDatabase::PgnDatabase() : Database()
 {
     initialise();
@@ -48,6 +57,7 @@ bool PgnDatabase::open(const QString& filename, bool utf8)
         if(openFile(filename))
         {
             m_utf8 = utf8;
+            m_strictMoveCounter = AppSettings->getValue("/General/strictMoveCounter").toBool();
             return true;
         }
     }
@@ -64,9 +74,9 @@ bool PgnDatabase::readIndexFile(QDataStream &in, volatile bool* breakFlag, short
     return (index()->read(in, breakFlag, version));
 }
 
-bool PgnDatabase::writeIndexFile(QDataStream& out) const
+void PgnDatabase::writeIndexFile(QByteArray& data) const
 {
-    return (index()->write(out));
+    index()->writeMapped(data);
 }
 
 QString PgnDatabase::offsetFilename(const QString& filename) const
@@ -83,6 +93,241 @@ bool PgnDatabase::hasIndexFile() const
     return AppSettings->getValue("/General/useIndexFile").toBool();
 }
 
+bool PgnDatabase::hasPositionIndex() const
+{
+    return hasIndexFile() && AppSettings->getValue("/General/usePositionIndex").toBool();
+}
+
+bool PgnDatabase::hasMoveCache() const
+{
+    return hasIndexFile() && AppSettings->getValue("/General/useMoveCache").toBool();
+}
+
+QString PgnDatabase::sidecarFilename(const QString& filename, const QString& suffix) const
+{
+    QFileInfo fi = QFileInfo(filename);
+    QString basefile = fi.completeBaseName();
+    basefile.append(suffix);
+    QString indexPath = AppSettings->indexPath();
+    return(indexPath + QDir::separator() + basefile);
+}
+
+bool PgnDatabase::readSidecarHeader(QDataStream& in, const QString& filename, unsigned short expectedMagic, short expectedVersion) const
+{
+    short version;
+    unsigned short magic;
+
+    in >> version;
+    in >> magic;
+
+    if (magic != expectedMagic) return false;
+    if (version != expectedVersion) return false;
+
+    int streamVersion;
+    in >> streamVersion;
+    in.setVersion(streamVersion);
+
+    QFileInfo fi = QFileInfo(filename);
+
+    QString basefile;
+    QDateTime lastModified;
+    IndexBaseType count;
+
+    in >> basefile;
+    in >> lastModified;
+    in >> count;
+
+    return (basefile == fi.completeBaseName()) && (lastModified == fi.lastModified()) && (count == m_count);
+}
+
+void PgnDatabase::writeSidecarHeader(QDataStream& out, const QString& filename, unsigned short magic, short version) const
+{
+    int streamVersion = out.version();
+
+    out << version;
+    out << magic;
+    out << streamVersion;
+
+    QFileInfo fi = QFileInfo(filename);
+    out << fi.completeBaseName();
+    out << fi.lastModified().toUTC();
+    out << m_count;
+}
+
+bool PgnDatabase::readPositionIndexFile(const QString& filename, volatile bool *breakFlag)
+{
+    QFile file(sidecarFilename(filename, ".cxp"));
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    if (!readSidecarHeader(in, filename, POSITION_INDEX_FILE_MAGIC, VERSION_POSITION_INDEX_CURRENT))
+    {
+        return false;
+    }
+
+    if (!m_positionIndex.read(in, breakFlag) || !m_materialIndex.read(in, breakFlag))
+    {
+        m_positionIndex.clear();
+        return false;
+    }
+
+    unsigned short finalMagic;
+    in >> finalMagic;
+    if(finalMagic != 0x55ec)
+    {
+        m_positionIndex.clear();
+        m_materialIndex.clear();
+        return false;
+    }
+    return true;
+}
+
+bool PgnDatabase::writePositionIndexFile(const QString& filename) const
+{
+    if(m_positionIndex.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(sidecarFilename(filename, ".cxp"));
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream out(&file);
+    writeSidecarHeader(out, filename, POSITION_INDEX_FILE_MAGIC, VERSION_POSITION_INDEX_CURRENT);
+
+    m_positionIndex.write(out);
+    m_materialIndex.write(out);
+
+    unsigned short finalMagic = 0x55ec;
+    out << finalMagic;
+
+    return true;
+}
+
+bool PgnDatabase::buildPositionIndex()
+{
+    m_positionIndex.clear();
+    m_materialIndex.clear();
+    int percent = 0;
+    for (GameId gameId = 0; gameId < (GameId)m_count; ++gameId)
+    {
+        if (m_break)
+        {
+            m_positionIndex.clear();
+            m_materialIndex.clear();
+            return false;
+        }
+        GameX game;
+        loadGameMoves(gameId, game);
+        m_positionIndex.addGame(gameId, game);
+        m_materialIndex.addGame(gameId, game);
+        int n = (int)(gameId * 100 / m_count);
+        if (n != percent)
+        {
+            percent = n;
+            emit progress(percent);
+        }
+    }
+    m_positionIndex.finalize();
+    emit progress(100);
+    return true;
+}
+
+bool PgnDatabase::readMoveCacheFile(const QString& filename, volatile bool *breakFlag)
+{
+    QFile file(sidecarFilename(filename, ".cxm"));
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QDataStream in(&file);
+    if (!readSidecarHeader(in, filename, MOVE_CACHE_FILE_MAGIC, VERSION_MOVE_CACHE_CURRENT))
+    {
+        return false;
+    }
+
+    if (!m_moveCache.read(in, breakFlag) || (m_moveCache.count() != m_count))
+    {
+        m_moveCache.clear();
+        return false;
+    }
+
+    unsigned short finalMagic;
+    in >> finalMagic;
+    if(finalMagic != 0x55ec)
+    {
+        m_moveCache.clear();
+        return false;
+    }
+    return true;
+}
+
+bool PgnDatabase::writeMoveCacheFile(const QString& filename) const
+{
+    if(m_moveCache.isEmpty())
+    {
+        return false;
+    }
+
+    QFile file(sidecarFilename(filename, ".cxm"));
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QDataStream out(&file);
+    writeSidecarHeader(out, filename, MOVE_CACHE_FILE_MAGIC, VERSION_MOVE_CACHE_CURRENT);
+
+    m_moveCache.write(out);
+
+    unsigned short finalMagic = 0x55ec;
+    out << finalMagic;
+
+    return true;
+}
+
+bool PgnDatabase::buildMoveCache()
+{
+    m_moveCache.clear();
+    int percent = 0;
+    for (GameId gameId = 0; gameId < (GameId)m_count; ++gameId)
+    {
+        if (m_break)
+        {
+            m_moveCache.clear();
+            return false;
+        }
+        GameX game;
+        loadGameMoves(gameId, game);
+        m_moveCache.append(game);
+        int n = (int)(gameId * 100 / m_count);
+        if (n != percent)
+        {
+            percent = n;
+            emit progress(percent);
+        }
+    }
+    emit progress(100);
+    return true;
+}
+
+const PositionIndex* PgnDatabase::positionIndex() const
+{
+    return m_positionIndex.isEmpty() ? nullptr : &m_positionIndex;
+}
+
+const MaterialIndex* PgnDatabase::materialIndex() const
+{
+    return (m_materialIndex.count() == (int)m_count) ? &m_materialIndex : nullptr;
+}
+
 bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFlag, bool& bUpdate)
 {
     if(!hasIndexFile())
@@ -106,7 +351,8 @@ bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFl
 
     if (magic != INDEX_FILE_MAGIC) return false;
     if (version > VERSION_INDEX_CURRENT) return false;
-    if ((version&0xFF00) != (VERSION_INDEX_CURRENT&0xFF00)) return false;
+    bool mapped = (version == VERSION_INDEX_2_0);
+    if (!mapped && (version&0xFF00) != (VERSION_INDEX_1_6&0xFF00)) return false;
 
     int streamVersion;
     in >> streamVersion;
@@ -131,6 +377,14 @@ bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFl
         return false;
     }
 
+    if (mapped)
+    {
+        qint64 start;
+        in >> start;
+        file.close();
+        return mapOffsetFile(filename, start);
+    }
+
     in >> m_allocated;
     in >> bUse64bit;
 
@@ -186,14 +440,58 @@ bool PgnDatabase::readOffsetFile(const QString& filename, volatile bool *breakFl
     return true;
 }
 
-bool PgnDatabase::writeOffsetFile(const QString& filename) const
+bool PgnDatabase::mapOffsetFile(const QString& filename, qint64 start)
+{
+    m_indexFile.setFileName(offsetFilename(filename));
+    if (!m_indexFile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    qint64 size = m_indexFile.size();
+    const char* data = reinterpret_cast<const char*>(m_indexFile.map(0, size));
+    if (!data || start <= 0 || start % 8 || start + 12 > size)
+    {
+        unmapOffsetFile();
+        return false;
+    }
+
+    const quint32* header = reinterpret_cast<const quint32*>(data + start);
+    const quint32 finalMagic = *reinterpret_cast<const quint32*>(data + size - 4);
+    quint32 count = header[1];
+    qint64 indexStart = start + 8 + 8 * (qint64)count;
+    if (header[0] != MAPPED_INDEX_BYTE_ORDER || finalMagic != 0x55ec || indexStart > size - 4 ||
+        !m_index.map(data + indexStart, size - 4 - indexStart) || m_index.count() != (int)count)
+    {
+        unmapOffsetFile();
+        return false;
+    }
+
+    m_mappedOffsets = reinterpret_cast<const quint64*>(data + start + 8);
+    m_mappedStart = start;
+    m_allocated = count;
+    return true;
+}
+
+void PgnDatabase::unmapOffsetFile()
+{
+    if (m_indexFile.isOpen())
+    {
+        // The index may still use the mapped data
+        m_index.clear();
+        m_indexFile.close();
+    }
+    m_mappedOffsets = nullptr;
+}
+
+bool PgnDatabase::writeOffsetFile(const QString& filename)
 {
     if(!hasIndexFile())
     {
         return false;
     }
 
-    QFile file(offsetFilename(filename));
+    // The old file may be mapped, so it is replaced instead of overwritten
+    QSaveFile file(offsetFilename(filename));
     if(!file.open(QIODevice::WriteOnly))
     {
         return false;
@@ -215,27 +513,71 @@ bool PgnDatabase::writeOffsetFile(const QString& filename) const
     out << basefile;
     out << fi.lastModified().toUTC();
 
-    out << m_count;
-    out << bUse64bit;
-    out << m_gameOffsets64;
-    out << m_gameOffsets32;
-    out << magic;
-
-    writeIndexFile(out);
+    // The rest has a fixed layout in host byte order and is used in place by mapOffsetFile()
+    QByteArray data;
+    const quint32 header[2] = { MAPPED_INDEX_BYTE_ORDER, (quint32)m_count };
+    data.append(reinterpret_cast<const char*>(header), sizeof(header));
+    for (GameId gameId = 0; gameId < (GameId)m_count; ++gameId)
+    {
+        quint64 n = offset(gameId);
+        data.append(reinterpret_cast<const char*>(&n), sizeof(n));
+    }
+    writeIndexFile(data);
+    const quint32 finalMagic = 0x55ec;
+    data.append(reinterpret_cast<const char*>(&finalMagic), sizeof(finalMagic));
+
+    qint64 start = (file.pos() + (qint64)sizeof(qint64) + 7) & ~7;
+    out << start;
+    file.write(QByteArray(start - file.pos(), 0));
+    file.write(data);
+
+    // A mapped file can not be replaced on every platform, the new one is mapped instead
+    qint64 mappedStart = m_indexFile.isOpen() ? m_mappedStart : 0;
+    unmapOffsetFile();
+    if (!file.commit())
+    {
+        // A mapped file held the same offsets, so the games keep using it
+        if (!mappedStart || !mapOffsetFile(filename, mappedStart))
+        {
+            QFile::remove(offsetFilename(filename));
+        }
+        return false;
+    }
+    if (mappedStart && !mapOffsetFile(filename, start))
+    {
+        QFile::remove(offsetFilename(filename));
+        return false;
+    }
 
-    unsigned short finalMagic = 0x55ec;
-    out << finalMagic;
+    writeMoveCacheFile(filename);
+    writePositionIndexFile(filename);
 
     return true;
 }
 
 bool PgnDatabase::parseFile()
 {
+    // The mapping is kept until close, games are loaded from it
+    mapFile();
     bool bUpdate = false;
     if(readOffsetFile(m_filename, &m_break, bUpdate))
     {
         m_count = m_allocated;
         emit progress(99);
+        if (hasMoveCache() && !readMoveCacheFile(m_filename, &m_break))
+        {
+            if (buildMoveCache() && !bUpdate)
+            {
+                writeMoveCacheFile(m_filename);
+            }
+        }
+        if (hasPositionIndex() && !readPositionIndexFile(m_filename, &m_break))
+        {
+            if (buildPositionIndex() && !bUpdate)
+            {
+                writePositionIndexFile(m_filename);
+            }
+        }
         if (bUpdate)
         {
             writeOffsetFile(m_filename);
@@ -252,6 +594,14 @@ bool PgnDatabase::parseFile()
     bool ok = parseFileIntern();
     if (ok)
     {
+        if (hasMoveCache())
+        {
+            buildMoveCache();
+        }
+        if (hasPositionIndex())
+        {
+            buildPositionIndex();
+        }
         writeOffsetFile(m_filename);
     }
     return ok;
@@ -259,6 +609,12 @@ bool PgnDatabase::parseFile()
 
 bool PgnDatabase::parseFileIntern()
 {
+    if (m_data && indexesHeadersOnly() && qobject_cast<QFile*>(m_file.data()))
+    {
+        // Scan the mapped file in place instead of reading it line by line
+        return parseFileMapped(m_data, m_dataSize);
+    }
+
     //indexing game positions in the file, game contents are ignored
     qint64 size = m_file->size();
     int oldFp = -3;
@@ -332,46 +688,160 @@ bool PgnDatabase::parseFileIntern()
     return true;
 }
 
-bool PgnDatabase::openFile(const QString& filename)
+bool PgnDatabase::parseFileMapped(const char* data, qint64 size)
 {
-    //open file
-    QFile* file = new QFile(filename);
-    if(!file->exists())
+    // Split the file at game boundaries into ranges scanned by the thread pool
+    PgnScanner scanner(data, size, m_utf8);
+    QVector<qint64> bounds;
+    bounds.append(0);
+    for (qint64 pos = SCAN_CHUNK_SIZE; pos < size; )
     {
-        delete file;
-        return false;
+        qint64 boundary = scanner.resyncPoint(pos);
+        if (boundary >= size)
+        {
+            break;
+        }
+        bounds.append(boundary);
+        pos = boundary + SCAN_CHUNK_SIZE;
     }
-    file->open(QIODevice::ReadOnly);
-    m_file = file;
-    return true;
-}
+    bounds.append(size);
 
-bool PgnDatabase::openString(const QString& content)
-{
-    //open file
-    initialise();
-    m_filename = "Internal.pgn";
-    QByteArray byteArray;
-    byteArray.append(content.toLatin1());
-    QBuffer* buffer = new QBuffer(&byteArray);
-    buffer->open(QIODevice::ReadOnly | QIODevice::Text);
-    m_file = buffer;
-    m_utf8 = false;
-    return parseFile();
-}
+    const bool utf8 = m_utf8;
+    volatile bool* breakFlag = &m_break;
+    int ranges = bounds.count() - 1;
+    int window = 2 * QThread::idealThreadCount();
+    QVector<QFuture<PgnScanner::Chunk>> futures;
+    futures.reserve(ranges);
 
-quint64 PgnDatabase::count() const
-{
-    return m_count;
-}
+    qint64 countDiff = size / 100;
+    qint64 nextDiff = countDiff;
+    percentDone = 0;
+    m_index.reserve(size/1000);
 
-QString PgnDatabase::filename() const
-{
-    return m_filename;
-}
+    // The ranges are merged in file order, so game ids are the same as with a single scan
+    qint64 pos = 0;
+    for (int i = 0; i < ranges && !m_break; ++i)
+    {
+        while (futures.count() < ranges && futures.count() <= i + window)
+        {
+            qint64 begin = bounds[futures.count()];
+            qint64 end = bounds[futures.count() + 1];
+            futures.append(QtConcurrent::run([=]()
+            {
+                PgnScanner rangeScanner(data, size, utf8);
+                PgnScanner::Chunk chunk;
+                rangeScanner.scan(begin, end, chunk, breakFlag);
+                return chunk;
+            }));
+        }
+
+        PgnScanner::Chunk chunk = futures[i].result();
+        if (pos != bounds[i] && !m_break)
+        {
+            // The previous range did not end at the boundary, scan this one again from there
+            chunk = PgnScanner::Chunk();
+            scanner.scan(pos, bounds[i + 1], chunk, &m_break);
+        }
+
+        for (const PgnScanner::GameHeader& header: std::as_const(chunk.games))
+        {
+            if (m_break)
+            {
+                break;
+            }
+            addOffset(header.offset);
+            parseHeaderIntoIndex(header);
+
+            if(header.offset > nextDiff)
+            {
+                nextDiff += countDiff;
+                emit progress(++percentDone);
+            }
+        }
+        pos = chunk.end;
+    }
+
+    // The ranges scan the mapped memory and check m_break, so wait for all of them
+    for (QFuture<PgnScanner::Chunk>& future: futures)
+    {
+        future.waitForFinished();
+    }
+    if (m_break)
+    {
+        return false;
+    }
+    emit progress(100);
+
+    m_gameOffsets32.squeeze();
+    m_gameOffsets64.squeeze();
+    m_index.squeeze();
+    return true;
+}
+
+void PgnDatabase::parseHeaderIntoIndex(const PgnScanner::GameHeader& header)
+{
+    for (const PgnScanner::Tag& tag: header.tags)
+    {
+        parseTagIntoIndex(tag.first, tag.second);
+    }
+
+    QString plyCount = m_index.tagValue(TagNamePlyCount, m_count - 1);
+    if(!plyCount.isEmpty() && plyCount != "?")
+    {
+        m_index.setTag_nolock(TagNameLength, QString::number((plyCount.toInt() + 1) / 2), m_count - 1);
+    }
+    else if (header.lastMoveNumber >= 0)
+    {
+        m_index.setTag_nolock(TagNameLength, QString::number(header.lastMoveNumber), m_count - 1);
+    }
+
+    if (!m_index.hasTag(TagNameLength, m_count - 1)) m_index.setTag_nolock(TagNameLength, "0", m_count - 1);
+    if (!m_index.hasTag(TagNameResult, m_count - 1)) m_index.setTag_nolock(TagNameResult, "*", m_count - 1);
+}
+
+bool PgnDatabase::openFile(const QString& filename)
+{
+    //open file
+    QFile* file = new QFile(filename);
+    if(!file->exists())
+    {
+        delete file;
+        return false;
+    }
+    file->open(QIODevice::ReadOnly);
+    m_file = file;
+    return true;
+}
+
+bool PgnDatabase::openString(const QString& content)
+{
+    //open file
+    initialise();
+    m_filename = "Internal.pgn";
+    QByteArray byteArray;
+    byteArray.append(content.toLatin1());
+    QBuffer* buffer = new QBuffer;
+    buffer->setData(byteArray);
+    buffer->open(QIODevice::ReadOnly | QIODevice::Text);
+    m_file = buffer;
+    m_utf8 = false;
+    m_strictMoveCounter = AppSettings->getValue("/General/strictMoveCounter").toBool();
+    return parseFile();
+}
+
+quint64 PgnDatabase::count() const
+{
+    return m_count;
+}
+
+QString PgnDatabase::filename() const
+{
+    return m_filename;
+}
 
 void PgnDatabase::clear()
 {
+    unmapOffsetFile();
     initialise();
     Database::clear();
 }
@@ -384,6 +854,8 @@ void PgnDatabase::close()
         QCoreApplication::processEvents();
         QThread::sleep(1);
     }
+    unmapFile();
+    unmapOffsetFile();
     if(m_file)
     {
         m_file->close();
@@ -396,15 +868,11 @@ void PgnDatabase::close()
 
 void PgnDatabase::loadGameMoves(GameId gameId, GameX& game)
 {
-    QMutexLocker m(&m_mutex);
     if(!m_file || gameId >= m_count)
     {
         return;
     }
     game.clear();
-    m_variationStack.clear();
-    seekGame(gameId);
-    skipTags();
     QString fen = m_index.tagValue(TagNameFEN, gameId);
     QString variant = m_index.tagValue(TagNameVariant, gameId).toLower();
     bool chess960 = (variant.startsWith("fischer", Qt::CaseInsensitive) || variant.endsWith("960"));
@@ -412,11 +880,30 @@ void PgnDatabase::loadGameMoves(GameId gameId, GameX& game)
     {
         game.dbSetStartingBoard(fen, chess960);
     }
-    parseMoves(&game);
+
+    if (m_moveCache.contains(gameId))
+    {
+        if (m_moveCache.load(gameId, game))
+        {
+            return;
+        }
+        game.clear();
+        if(fen != "?")
+        {
+            game.dbSetStartingBoard(fen, chess960);
+        }
+    }
+
+    parseGameMoves(gameId, &game);
 }
 
 int PgnDatabase::findPosition(GameId index, const BoardX &position)
 {
+    if (!m_positionIndex.isEmpty())
+    {
+        PositionIndex::Hit hit;
+        return m_positionIndex.lookup(position, index, hit) ? hit.moveId : NO_MOVE;
+    }
     GameX g;
     loadGameMoves(index, g);
     return g.cursor().findPosition(position);
@@ -428,13 +915,9 @@ bool PgnDatabase::loadGame(GameId gameId, GameX& game)
     {
         return false;
     }
-    QMutexLocker m(&m_mutex);
     //parse the game
     game.clear();
-    m_variationStack.clear();
     loadGameHeaders(gameId, game);
-    seekGame(gameId);
-    skipTags();
     QString fen = m_index.tagValue(TagNameFEN, gameId);
     QString variant = m_index.tagValue(TagNameVariant, gameId).toLower();
     bool chess960 = (variant.startsWith("fischer", Qt::CaseInsensitive) || variant.endsWith("960"));
@@ -443,20 +926,101 @@ bool PgnDatabase::loadGame(GameId gameId, GameX& game)
         game.dbSetStartingBoard(fen, chess960);
     }
 
-    parseMoves(&game);
+    bool ok = parseGameMoves(gameId, &game);
 
-    return m_variation != -1 || fen != "?";  // Not sure of all of the ramifications of this
+    return ok || fen != "?";  // Not sure of all of the ramifications of this
     // but it seeems to fix the problem with FENs
 }
 
+bool PgnDatabase::parseGameMoves(GameId gameId, GameX* game)
+{
+    if (m_data)
+    {
+        // Each call parses its own copy of the game text, so no lock is needed
+        IndexBaseType begin = offset(gameId);
+        IndexBaseType end = m_dataSize;
+        if (gameId + 1 < (GameId)m_count && offset(gameId + 1) >= begin)
+        {
+            end = offset(gameId + 1);
+        }
+        QByteArray text = QByteArray::fromRawData(m_data + begin, int(end - begin));
+        QBuffer buffer(&text);
+        buffer.open(QIODevice::ReadOnly);
+        PgnMoveParser parser(&buffer, m_utf8, m_strictMoveCounter);
+        parser.readLine();
+        parser.skipTags();
+        return parser.parseMoves(game);
+    }
+
+    QMutexLocker m(&m_mutex);
+    IndexBaseType n = offset(gameId);
+    if(!m_file->seek(n))
+    {
+        qDebug() << "Seeking offset " << QString::number(n) << " failed!";
+    }
+    PgnMoveParser parser(m_file, m_utf8, m_strictMoveCounter);
+    parser.readLine();
+    parser.skipTags();
+    return parser.parseMoves(game);
+}
+
+bool PgnDatabase::parseMoves(GameX* game)
+{
+    PgnMoveParser parser(m_file, m_utf8, m_strictMoveCounter);
+    parser.setLine(m_lineBuffer, m_currentLine);
+    bool ok = parser.parseMoves(game);
+    m_lineBuffer = parser.lineBuffer();
+    m_currentLine = parser.currentLine();
+    return ok;
+}
+
+void PgnDatabase::mapFile()
+{
+    if (m_data)
+    {
+        return;
+    }
+    QFile* file = qobject_cast<QFile*>(m_file.data());
+    if (file)
+    {
+        m_dataSize = file->size();
+        m_data = (m_dataSize > 0) ? reinterpret_cast<const char*>(file->map(0, m_dataSize)) : nullptr;
+        return;
+    }
+    QBuffer* buffer = qobject_cast<QBuffer*>(m_file.data());
+    if (buffer)
+    {
+        m_dataSize = buffer->data().size();
+        m_data = buffer->data().constData();
+    }
+}
+
+void PgnDatabase::unmapFile()
+{
+    QFile* file = qobject_cast<QFile*>(m_file.data());
+    if (file && m_data)
+    {
+        file->unmap(reinterpret_cast<uchar*>(const_cast<char*>(m_data)));
+    }
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_mappedOffsets = nullptr;
+}
+
 void PgnDatabase::initialise()
 {
     m_file = nullptr;
-    m_inComment = false;
-    m_inPreComment = false;
     m_filename = QString();
     m_count = 0;
     m_allocated = 0;
+    m_positionIndex.clear();
+    m_materialIndex.clear();
+    m_moveCache.clear();
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_mappedOffsets = nullptr;
+    m_mappedStart = 0;
+    m_strictMoveCounter = false;
 }
 
 void PgnDatabase::readLine()
@@ -482,16 +1046,6 @@ void PgnDatabase::skipLine()
     m_lineBuffer = m_file->readLine();
 }
 
-void PgnDatabase::seekGame(GameId gameId)
-{
-    IndexBaseType n = offset(gameId);
-    if(!m_file->seek(n))
-    {
-        qDebug() << "Seeking offset " << QString::number(n) << " failed!";
-    }
-    readLine();
-}
-
 void PgnDatabase::parseTagIntoIndex(const QString& tag, QString value)
 {
     if(value.contains("\\\""))
@@ -578,534 +1132,9 @@ void PgnDatabase::parseTagsIntoIndex()
     }
 }
 
-bool PgnDatabase::parseMoves(GameX* game)
-{
-    m_gameOver = false;
-    m_inComment = false;
-    m_inPreComment = false;
-    m_comment.clear();
-    m_precomment.clear();
-    m_newVariation = false;
-    m_variation = 0;
-
-    do
-    {
-        if(m_inComment)
-        {
-            parseComment(game);
-        }
-        else
-        {
-            parseLine(game);
-            if(m_variation == -1)
-            {
-                return false;
-            }
-        }
-    }
-    while(!m_gameOver && (!m_file->atEnd() || m_currentLine != ""));
-
-    if(m_gameOver)
-    {
-        if(game->plyCount() == 0)
-        {
-            if(!m_precomment.isEmpty())
-            {
-                game->dbSetAnnotation(m_precomment);
-                m_precomment.clear();
-                m_inPreComment = false;
-            }
-        }
-        if (game->needsCleanup())
-        {
-            game->clearDummyNodes();
-        }
-    }
-    return true;
-}
-
-char PgnDatabase::peek(QStringRef::const_iterator s)
-{
-    QStringRef::const_iterator n = s+1;
-    if (n != m_currentLine.constEnd())
-    {
-        return (*n).toLatin1();
-    }
-    return 0;
-}
-
-void PgnDatabase::splitTokenList(QVector<QStringRef>& list)
-{
-    auto s = m_currentLine.constBegin();
-    int start = 0;
-    int n = 0;
-    bool inNag = false;
-    int dots = 0;
-    bool breakout = false;
-
-    while (!breakout && (s != m_currentLine.constEnd()))
-    {
-        n++;
-        char c = (*s).toLatin1();
-        switch (c)
-        {
-            case ' ': // WS - Separator of tokens
-            case '\t':
-            if (n>1)
-            {
-                list.push_back(QStringRef(&m_currentLine, start, n-1));
-                start += n;
-                n = 0;
-            }
-            else
-            {
-                start++;
-                n=0;
-            }
-            dots = 0;
-            inNag = false;
-            break;
-
-            case '.': // Count dots to figure out which side is moving.
-            if (!dots)
-            {
-                if (m_currentLine[start].isDigit())
-                {
-                    list.push_back(QStringRef(&m_currentLine, start, n-1)); // Current move counter
-                }
-                start += (n-1);
-                n = 1;
-            }
-            dots++;
-            break;
-
-            case '-': // Can be 0-0, -+, a2-a4 (LAN), 1-0, 0-1, 1/2-1/2, Q-a4,
-            if (!inNag)
-            {
-                if (n>1)
-                {
-                    QStringRef t(&m_currentLine, start, n-1);
-                    QChar c = t.at(0);
-                    if (!c.isLetterOrNumber() && (c!='.'))
-                    {
-                        // It's a token, not part of a move
-                        list.push_back(t);
-                        start += (n-1);
-                        n = 1;
-                        inNag = true;
-                    }
-                }
-                else
-                {
-                   inNag = true;
-                }
-            }
-            break;
-
-            case '=': // Avoid b8=Q to be cut in two token
-            if (!inNag && !isalpha(peek(s)))
-            {
-                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                start += (n-1);
-                n = 1;
-                inNag = true;
-            }
-            break;
-
-            case 0:
-            {
-                Nag nag = NagSet::fromString(*s);
-                if (nag != NullNag)
-                {
-                   if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                   start += n-1;
-                   list.push_back(QStringRef(&m_currentLine, start, 1));
-                   start += 1;
-                   n = 0;
-                }
-                else
-                {
-                    m_variation = -1; // Illegal character -> Skip parsing this game
-                }
-            }
-            break;
-
-            case '!': // Cut a5! / a5 ! into two token, and a5!! is still two tokens
-            case '?':
-            case '+': // Watch out for 0-0+
-            case '$':
-            if (!inNag)
-            {
-                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                start += (n-1);
-                n = 1;
-                inNag = true;
-            }
-            break;
-
-            case '{':
-            {
-                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                list.push_back(QStringRef(&m_currentLine, start+n-1, 1));
-                start += n;
-                n = 0;
-                breakout = true;
-                break; // Let someone else parse the comments
-            }
-
-            case '(': // Actually b8(Q) for b8=Q would be an issue here
-            case ')':
-            case '}':
-            {
-                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                list.push_back(QStringRef(&m_currentLine, start+n-1, 1));
-                start += n;
-                n = 0;
-                dots = 0;
-                inNag = false;
-            }
-            break;
-
-            default:
-            if (c<0)
-            {
-                Nag nag = NagSet::fromString(*s);
-                if (nag != NullNag)
-                {
-                   if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
-                   start += n-1;
-                   list.push_back(QStringRef(&m_currentLine, start, 1));
-                   start += 1;
-                   n = 0;
-                }
-                else
-                {
-                    m_variation = -1; // Illegal character -> Skip parsing this game
-                }
-            }
-            break;
-        }
-        s++;
-    }
-    if (n)
-    {
-        list.push_back(QStringRef(&m_currentLine, start, n));
-    }
-}
-
-void PgnDatabase::parseLine(GameX* game)
-{
-    QVector<QStringRef> list;
-    splitTokenList(list);
-    if(m_variation != -1) for(auto it = list.begin(); it != list.end() && !m_inComment; ++it)
-    {
-        parseToken(game, *it);
-        if(m_variation == -1)
-        {
-            if(!(m_currentLine.startsWith("[")))
-            {
-                skipLine(); // illegal move in the buffer!
-            }
-            return;
-        }
-    }
-
-    if(!m_inComment)
-    {
-        readLine();
-    }
-    else
-    {
-        m_currentLine = m_currentLine.mid(m_currentLine.indexOf("{") + 1); // Implicit assumption that there is no other '{' in the line
-    }
-}
-
-inline void PgnDatabase::parseMoveToken(GameX* game, QString token)
-{
-    QChar c = token.at(0);
-    if (c.isDigit())
-    {
-        moveNumberFound = token.toInt();
-        return;
-    }
-
-    if (token.startsWith("..."))
-    {
-        white = false;
-        dotFound = true;
-        token.remove(0,3);
-    }
-    else if (token.startsWith("."))
-    {
-        white = true;
-        dotFound = true;
-        token.remove(0,1);
-    }
-
-    if (token.isEmpty()) return;
-
-    if(m_newVariation)
-    {
-        bool dummyNeeded = dotFound && (((white && game->board().whiteToMove()) ||
-                                         (!white && game->board().blackToMove())));
-        if (dummyNeeded)
-        {
-            if (!game->move(game->currentMove()).isDummyMove())
-            {
-                game->dbAddMove(game->board().dummyMove());
-                game->forward();
-                game->setNeedsCleanup(true);
-            }
-        }
-        game->backward();
-        m_variation = game->dbAddSanVariation(token, QString());
-        if(!m_precomment.isEmpty())
-        {
-            game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
-            m_precomment.clear();
-            m_inPreComment = false;
-        }
-        m_newVariation = false;
-    }
-    else
-    {
-        m_variation = game->dbAddSanMove(token, QString());
-
-        if(!m_precomment.isEmpty())
-        {
-            game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
-            m_precomment.clear();
-            m_inPreComment = false;
-        }
-    }
-
-    if (dotFound && AppSettings->getValue("/General/strictMoveCounter").toBool() && ( m_variation != NO_MOVE ))
-    {
-        int currentMoveNumber = game->moveNumber();
-        if (currentMoveNumber != moveNumberFound)
-        {
-            game->removeNode();
-            m_variation = NO_MOVE;
-        }
-    }
-
-    dotFound = false;
-}
-
-void PgnDatabase::parseToken(GameX* game, const QStringRef& token)
-{
-    if (token.isEmpty()) return;
-    // qDebug() << "Parsing Token:" << token << ":";
-    char c = token.at(0).toLatin1();
-    switch(c)
-    {
-    case 0:
-        {
-            Nag nag = NagSet::fromString(token.at(0));
-            game->dbAddNag(nag);
-        }
-        break;
-    case '(':
-        {
-            m_newVariation = true;
-            m_variationStack.push(game->currentMove());
-        }
-        break;
-    case ')':
-        MoveId move;
-        if (!m_variationStack.isEmpty())
-        {
-            move = m_variationStack.pop();
-        }
-        else
-        {
-            move = game->parentMove();
-        }
-        game->dbMoveToId(move);
-        game->forward();
-        m_newVariation = false;
-        m_variation = 0;
-        break;
-    case '{':
-        m_comment.clear();
-        m_inComment = true;
-        break;
-    case '$':
-        if (token.length()>1)
-        {
-            game->dbAddNag((Nag)token.mid(1).toInt());
-        }
-        break;
-    case '!':
-        if(token == "!")
-        {
-            game->dbAddNag(GoodMove);
-        }
-        else if(token == "!!")
-        {
-            game->dbAddNag(VeryGoodMove);
-        }
-        else if(token == "!?")
-        {
-            game->dbAddNag(SpeculativeMove);
-        }
-        break;
-    case '?':
-        if(token == "?")
-        {
-            game->dbAddNag(PoorMove);
-        }
-        else if(token == "??")
-        {
-            game->dbAddNag(VeryPoorMove);
-        }
-        else if(token == "?!")
-        {
-            game->dbAddNag(QuestionableMove);
-        }
-        break;
-    case '+':
-        if(token == "+=")
-        {
-            game->dbAddNag(WhiteHasASlightAdvantage);
-        }
-        else if(token == "+/-")
-        {
-            game->dbAddNag(WhiteHasAModerateAdvantage);
-        }
-        break;
-    case '=':
-        if(token == "=")
-        {
-            game->dbAddNag(DrawishPosition);
-        }
-        else if(token == "=+")
-        {
-            game->dbAddNag(BlackHasASlightAdvantage);
-        }
-        break;
-
-    case '*':
-        game->dbSetResult(ResultUnknown);
-        m_gameOver = true;
-        break;
-
-    case '1':
-        if(token == "1-0")
-        {
-            game->dbSetResult(WhiteWin);
-            m_gameOver = true;
-            break;
-        }
-        else if(token == "1/2-1/2" || token == "1/2")
-        {
-            game->dbSetResult(Draw);
-            m_gameOver = true;
-            break;
-        }
-        parseMoveToken(game, token.toString());
-        break;
-
-    case '0':
-        if(token == "0-1")
-        {
-            game->dbSetResult(BlackWin);
-            m_gameOver = true;
-            break;
-        }
-        parseMoveToken(game, token.toString());
-        break;
-
-    case 'Z':
-    case '-':
-        if(token == "-/+")
-        {
-            game->dbAddNag(BlackHasAModerateAdvantage);
-            break;
-        }
-        parseMoveToken(game, token.toString());
-        break;
-
-    default:
-        if (c<0)
-        {
-            Nag nag = NagSet::fromString(token.at(0));
-            game->dbAddNag(nag);
-        }
-        else
-        {
-            parseMoveToken(game, token.toString());
-        }
-        break;
-    }
-}
-
-void PgnDatabase::parseComment(GameX* game)
-{
-    int end = m_currentLine.indexOf('}');
-
-    if(end >= 0)
-    {
-        m_comment.append(m_currentLine.left(end));
-        m_inComment = false;
-        if(m_newVariation || game->plyCount() == 0)
-        {
-            if (game->plyCount()==0 && m_inPreComment)
-            {
-                game->dbSetAnnotation(m_precomment, 0);
-                m_inPreComment = false;
-            }
-            else
-            {
-                m_precomment = m_comment.trimmed();
-                m_inPreComment = true;
-            }
-        }
-        else
-        {
-            QString currentComment = game->annotation();
-            if (!currentComment.isEmpty())
-            {
-                currentComment.append("\n");
-                m_comment.prepend(currentComment);
-            }
-            game->dbSetAnnotation(m_comment.trimmed());
-        }
-        m_currentLine = m_currentLine.right((m_currentLine.length() - end) - 1);
-    }
-    else
-    {
-        m_comment.append(m_currentLine + ' ');
-        readLine();
-    }
-}
-
-inline bool onlyWhitespace(const QByteArray& b)
-{
-    for(int i = 0; i < b.length(); ++i)
-    {
-        if(!isspace(b[i]))
-        {
-            return false;
-        }
-    }
-    return true;
-}
-
 void PgnDatabase::prepareNextLine()
 {
-    if(m_utf8)
-    {
-        QTextStream textStream(m_lineBuffer);
-#if QT_VERSION < 0x060000
-        textStream.setCodec("UTF-8");
-#endif
-        m_currentLine = textStream.readLine().simplified();
-    }
-    else
-    {
-		m_currentLine = QString::fromLatin1(m_lineBuffer).simplified();
-    }
+    m_currentLine = PgnMoveParser::decodeLine(m_lineBuffer, m_utf8);
 }
 
 void PgnDatabase::prepareNextLineForMoveParser()
@@ -1139,22 +1168,6 @@ IndexBaseType PgnDatabase::skipJunk()
     return fp;
 }
 
-void PgnDatabase::skipTags()
-{
-    while(m_lineBuffer.length() && (m_lineBuffer[0] == '[') && !m_file->atEnd())
-    {
-        skipLine();
-    }
-
-    //swallow trailing whitespace
-    while(onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
-    {
-        skipLine();
-    }
-
-    prepareNextLineForMoveParser();
-}
-
 void PgnDatabase::skipMoves()
 {
     QString tag = m_index.tagValue(TagNamePlyCount, m_count - 1);
@@ -1164,7 +1177,7 @@ void PgnDatabase::skipMoves()
     }
     if(!tag.isEmpty())
     {
-        while(!onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
+        while(!PgnMoveParser::onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
         {
             skipLine();
         }
@@ -1179,7 +1192,7 @@ void PgnDatabase::skipMoves()
 
         QString gameText = " ";
 
-        while(!onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
+        while(!PgnMoveParser::onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
         {
             gameText += QString(m_lineBuffer) + " ";
             skipLine();
@@ -1188,14 +1201,14 @@ void PgnDatabase::skipMoves()
         gameText = gameText.remove(QRegularExpression("\\([^\\(\\)]*\\)"));
 
         QRegularExpressionMatch match;
-        if (gameText.lastIndexOf(gameNumber, 0, &match) >= 0)
+        if (gameText.lastIndexOf(gameNumber, -1, &match) >= 0)
         {
             m_index.setTag_nolock(TagNameLength, match.captured(1), m_count - 1);
         }
     }
 
     //swallow trailing whitespace
-    while(onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
+    while(PgnMoveParser::onlyWhitespace(m_lineBuffer) && !m_file->atEnd())
     {
         skipLine();
     }
@@ -1212,6 +1225,10 @@ void PgnDatabase::skipMoves()
 /** Returns the file offset for the given game */
 IndexBaseType PgnDatabase::offset(GameId gameId) const
 {
+    if(m_mappedOffsets)
+    {
+        return m_mappedOffsets[gameId];
+    }
     if(bUse64bit)
     {
         return m_gameOffsets64.at(gameId);
@@ -19,6 +19,8 @@
 #include <QVector>
 
 #include "database.h"
+#include "movecache.h"
+#include "pgnscanner.h"
 
 /** @ingroup Database
    The PgnDatabase class provides database access to PGN files.
@@ -51,6 +53,12 @@ public:
     /** Loads only moves into a game from the given position */
     void loadGameMoves(GameId gameId, GameX& game);
     virtual int findPosition(GameId index, const BoardX& position);
+    /** Games are parsed from the mapped file or read from the device under the database mutex */
+    virtual bool supportsConcurrentLoads() const { return true; }
+    /** @return the position index if one was built or loaded */
+    virtual const PositionIndex* positionIndex() const;
+    /** @return the material index, it is built along with the position index */
+    virtual const MaterialIndex* materialIndex() const;
     /** Open a PGN Data File from a string */
     bool openString(const QString& content);
 
@@ -63,23 +71,13 @@ public:
 
 protected:
     //parsing methods
-    /** Reads moves from the file and adds them to the game. Performs position searches if any are active */
+    /** Reads moves from the file and adds them to the game, continuing with the current line.
+        Used while reading the file sequentially. */
     bool parseMoves(GameX* game);
-    /** Parses a line from the file */
-    void parseLine(GameX* game);
-    /** Split string into list of tokens */
-    char peek(QStringRef::const_iterator s);
-    void splitTokenList(QVector<QStringRef>& list);
-    /** Parses a move token from the file */
-    void parseMoveToken(GameX* game, QString token);
-    /** Parses a token from the file */
-    void parseToken(GameX* game, const QStringRef &token);
-    /** Parses a comment from the file */
-    void parseComment(GameX* game);
+    /** Parses the moves of game @p gameId into @p game. Safe to call from several threads. */
+    bool parseGameMoves(GameId gameId, GameX* game);
     /** Skips past any data which is not valid tag or move data */
     IndexBaseType skipJunk();
-    /** Skips past any tag data */
-    void skipTags();
     /** Skips past any move data */
     void skipMoves();
     /** Parses the tags, and adds the supported types to the index 'm_index' */
@@ -88,18 +86,49 @@ protected:
     void parseTagIntoIndex(const QString &tag, QString value);
 
     bool parseFileIntern();
+    /** Index the games of @p size bytes of PGN at @p data, usually the mapped file.
+        The data is split into ranges which are scanned by the thread pool. */
+    bool parseFileMapped(const char* data, qint64 size);
+    /** Add the tags of a game found by a PgnScanner to the index */
+    void parseHeaderIntoIndex(const PgnScanner::GameHeader& header);
     virtual void parseGame();
+    /** @return true if parseGame() just skips the moves, so that indexing
+        may be done from the game headers alone */
+    virtual bool indexesHeadersOnly() const { return true; }
 
     bool readIndexFile(QDataStream& in, volatile  bool *breakFlag, short version);
-    bool writeIndexFile(QDataStream& out) const;
+    void writeIndexFile(QByteArray& data) const;
     QString offsetFilename(const QString& filename) const;
     bool readOffsetFile(const QString&, volatile bool *breakFlag, bool &bUpdate);
-    bool writeOffsetFile(const QString&) const;
+    /** Write the index file and its sidecar files. An old index file which can not be
+        replaced is removed, unless it is mapped and still describes the database.
+        @return false if the index file could not be written */
+    bool writeOffsetFile(const QString&);
+    /** Use the offsets and the index of an index file in place, starting at byte @p start of the file */
+    bool mapOffsetFile(const QString& filename, qint64 start);
+    void unmapOffsetFile();
+    /** @return the name of a file stored next to the index file of @p filename */
+    QString sidecarFilename(const QString& filename, const QString& suffix) const;
+    /** Read the header of a sidecar file, returns false if it is outdated or invalid */
+    bool readSidecarHeader(QDataStream& in, const QString& filename, unsigned short magic, short version) const;
+    void writeSidecarHeader(QDataStream& out, const QString& filename, unsigned short magic, short version) const;
+    bool readPositionIndexFile(const QString&, volatile bool *breakFlag);
+    bool writePositionIndexFile(const QString&) const;
+    /** Replay the main line of all games into the position and material index */
+    bool buildPositionIndex();
+    bool readMoveCacheFile(const QString&, volatile bool *breakFlag);
+    bool writeMoveCacheFile(const QString&) const;
+    /** Parse all games into the move cache */
+    bool buildMoveCache();
 
     // Open a PGN data File
     bool openFile(const QString& filename);
 
     bool hasIndexFile() const;
+    /** Determine if a position index shall be maintained */
+    bool hasPositionIndex() const;
+    /** Determine if a move cache shall be maintained */
+    bool hasMoveCache() const;
 
     /** Resets/initialises important member variables. Called by constructor and close methods */
     void initialise();
@@ -111,13 +140,17 @@ protected:
     void readTagLine();
     /** Skips the next line of text from the PGN file */
     void skipLine();
-    /** Moves the file position to the start of the given game */
-    void seekGame(GameId gameId);
+    /** Map the file into memory, so that games can be loaded by positional reads */
+    void mapFile();
+    void unmapFile();
 
     void prepareNextLineForMoveParser();
     void prepareNextLine();
 
 protected:
+    /** @return the file position where game @p gameId starts */
+    IndexBaseType offset(GameId gameId) const;
+
 	IndexBaseType m_count; // Should actually be a GameId - but cannot be changed due to serialization issues
 	QPointer<QIODevice> m_file;
 	QString m_currentLine;
@@ -126,32 +159,30 @@ private:
 
     /** Adds the current file position as a new offset */
     bool addOffset(IndexBaseType offset);
-    IndexBaseType offset(GameId gameId) const;
 
     //file variables
     QString m_filename;
     QString m_gameText;
 
-    //parsing variables
-
-    bool m_gameOver;
-    bool m_inComment;
-    bool m_inPreComment;
-    QString m_comment;
-    QString m_precomment;
-    bool m_newVariation;
-    int m_variation;
+    /** The mapped file or the data of a buffer, nullptr if not available */
+    const char* m_data;
+    qint64 m_dataSize;
+    /** Setting read when the database is opened, games are parsed on several threads */
+    bool m_strictMoveCounter;
 
     //game index
     IndexBaseType m_allocated;
     QVector<quint32> m_gameOffsets32;
     QVector<quint64> m_gameOffsets64;
+    /** Index file mapped by mapOffsetFile() and its game offsets */
+    QFile m_indexFile;
+    const quint64* m_mappedOffsets;
+    qint64 m_mappedStart;
+    PositionIndex m_positionIndex;
+    MaterialIndex m_materialIndex;
+    MoveCache m_moveCache;
     QByteArray m_lineBuffer;
-    QStack<MoveId> m_variationStack;
     int percentDone;
-    bool white;
-    bool dotFound;
-    int  moveNumberFound;
     bool bUse64bit {false};
 };
 
@@ -0,0 +1,597 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <cctype>
+
+#include <QTextStream>
+
+#include "gamex.h"
+#include "nag.h"
+#include "pgnmoveparser.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+PgnMoveParser::PgnMoveParser(QIODevice* device, bool utf8, bool strictMoveCounter) :
+    m_device(device),
+    m_utf8(utf8),
+    m_strictMoveCounter(strictMoveCounter),
+    m_gameOver(false),
+    m_inComment(false),
+    m_inPreComment(false),
+    m_newVariation(false),
+    m_variation(0),
+    white(true),
+    dotFound(false),
+    moveNumberFound(0)
+{
+}
+
+void PgnMoveParser::setLine(const QByteArray& lineBuffer, const QString& currentLine)
+{
+    m_lineBuffer = lineBuffer;
+    m_currentLine = currentLine;
+}
+
+bool PgnMoveParser::onlyWhitespace(const QByteArray& b)
+{
+    for(int i = 0; i < b.length(); ++i)
+    {
+        if(!isspace(b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString PgnMoveParser::decodeLine(const QByteArray& line, bool utf8)
+{
+    if(utf8)
+    {
+        QTextStream textStream(line);
+#if QT_VERSION < 0x060000
+        textStream.setCodec("UTF-8");
+#endif
+        return textStream.readLine().simplified();
+    }
+    return QString::fromLatin1(line).simplified();
+}
+
+void PgnMoveParser::readLine()
+{
+    if(m_device->atEnd())
+    {
+        m_lineBuffer.clear();
+        m_currentLine.clear();
+        return;
+    }
+    m_lineBuffer = m_device->readLine();
+    m_currentLine = decodeLine(m_lineBuffer, m_utf8);
+}
+
+void PgnMoveParser::skipLine()
+{
+    m_lineBuffer = m_device->readLine();
+}
+
+void PgnMoveParser::skipTags()
+{
+    while(m_lineBuffer.length() && (m_lineBuffer[0] == '[') && !m_device->atEnd())
+    {
+        skipLine();
+    }
+
+    //swallow trailing whitespace
+    while(onlyWhitespace(m_lineBuffer) && !m_device->atEnd())
+    {
+        skipLine();
+    }
+
+    m_currentLine = decodeLine(m_lineBuffer, m_utf8);
+}
+
+bool PgnMoveParser::parseMoves(GameX* game)
+{
+    m_gameOver = false;
+    m_inComment = false;
+    m_inPreComment = false;
+    m_comment.clear();
+    m_precomment.clear();
+    m_newVariation = false;
+    m_variation = 0;
+
+    do
+    {
+        if(m_inComment)
+        {
+            parseComment(game);
+        }
+        else
+        {
+            parseLine(game);
+            if(m_variation == -1)
+            {
+                return false;
+            }
+        }
+    }
+    while(!m_gameOver && (!m_device->atEnd() || m_currentLine != ""));
+
+    if(m_gameOver)
+    {
+        if(game->plyCount() == 0)
+        {
+            if(!m_precomment.isEmpty())
+            {
+                game->dbSetAnnotation(m_precomment);
+                m_precomment.clear();
+                m_inPreComment = false;
+            }
+        }
+        if (game->needsCleanup())
+        {
+            game->clearDummyNodes();
+        }
+    }
+    return true;
+}
+
+char PgnMoveParser::peek(QStringRef::const_iterator s)
+{
+    QStringRef::const_iterator n = s+1;
+    if (n != m_currentLine.constEnd())
+    {
+        return (*n).toLatin1();
+    }
+    return 0;
+}
+
+void PgnMoveParser::splitTokenList(QVector<QStringRef>& list)
+{
+    auto s = m_currentLine.constBegin();
+    int start = 0;
+    int n = 0;
+    bool inNag = false;
+    int dots = 0;
+    bool breakout = false;
+
+    while (!breakout && (s != m_currentLine.constEnd()))
+    {
+        n++;
+        char c = (*s).toLatin1();
+        switch (c)
+        {
+            case ' ': // WS - Separator of tokens
+            case '\t':
+            if (n>1)
+            {
+                list.push_back(QStringRef(&m_currentLine, start, n-1));
+                start += n;
+                n = 0;
+            }
+            else
+            {
+                start++;
+                n=0;
+            }
+            dots = 0;
+            inNag = false;
+            break;
+
+            case '.': // Count dots to figure out which side is moving.
+            if (!dots)
+            {
+                if (m_currentLine[start].isDigit())
+                {
+                    list.push_back(QStringRef(&m_currentLine, start, n-1)); // Current move counter
+                }
+                start += (n-1);
+                n = 1;
+            }
+            dots++;
+            break;
+
+            case '-': // Can be 0-0, -+, a2-a4 (LAN), 1-0, 0-1, 1/2-1/2, Q-a4,
+            if (!inNag)
+            {
+                if (n>1)
+                {
+                    QStringRef t(&m_currentLine, start, n-1);
+                    QChar c = t.at(0);
+                    if (!c.isLetterOrNumber() && (c!='.'))
+                    {
+                        // It's a token, not part of a move
+                        list.push_back(t);
+                        start += (n-1);
+                        n = 1;
+                        inNag = true;
+                    }
+                }
+                else
+                {
+                   inNag = true;
+                }
+            }
+            break;
+
+            case '=': // Avoid b8=Q to be cut in two token
+            if (!inNag && !isalpha(peek(s)))
+            {
+                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                start += (n-1);
+                n = 1;
+                inNag = true;
+            }
+            break;
+
+            case 0:
+            {
+                Nag nag = NagSet::fromString(*s);
+                if (nag != NullNag)
+                {
+                   if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                   start += n-1;
+                   list.push_back(QStringRef(&m_currentLine, start, 1));
+                   start += 1;
+                   n = 0;
+                }
+                else
+                {
+                    m_variation = -1; // Illegal character -> Skip parsing this game
+                }
+            }
+            break;
+
+            case '!': // Cut a5! / a5 ! into two token, and a5!! is still two tokens
+            case '?':
+            case '+': // Watch out for 0-0+
+            case '$':
+            if (!inNag)
+            {
+                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                start += (n-1);
+                n = 1;
+                inNag = true;
+            }
+            break;
+
+            case '{':
+            {
+                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                list.push_back(QStringRef(&m_currentLine, start+n-1, 1));
+                start += n;
+                n = 0;
+                breakout = true;
+                break; // Let someone else parse the comments
+            }
+
+            case '(': // Actually b8(Q) for b8=Q would be an issue here
+            case ')':
+            case '}':
+            {
+                if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                list.push_back(QStringRef(&m_currentLine, start+n-1, 1));
+                start += n;
+                n = 0;
+                dots = 0;
+                inNag = false;
+            }
+            break;
+
+            default:
+            if (c<0)
+            {
+                Nag nag = NagSet::fromString(*s);
+                if (nag != NullNag)
+                {
+                   if (n>1) list.push_back(QStringRef(&m_currentLine, start, n-1));
+                   start += n-1;
+                   list.push_back(QStringRef(&m_currentLine, start, 1));
+                   start += 1;
+                   n = 0;
+                }
+                else
+                {
+                    m_variation = -1; // Illegal character -> Skip parsing this game
+                }
+            }
+            break;
+        }
+        s++;
+    }
+    if (n)
+    {
+        list.push_back(QStringRef(&m_currentLine, start, n));
+    }
+}
+
+void PgnMoveParser::parseLine(GameX* game)
+{
+    QVector<QStringRef> list;
+    splitTokenList(list);
+    if(m_variation != -1) for(auto it = list.begin(); it != list.end() && !m_inComment; ++it)
+    {
+        parseToken(game, *it);
+        if(m_variation == -1)
+        {
+            if(!(m_currentLine.startsWith("[")))
+            {
+                skipLine(); // illegal move in the buffer!
+            }
+            return;
+        }
+    }
+
+    if(!m_inComment)
+    {
+        readLine();
+    }
+    else
+    {
+        m_currentLine = m_currentLine.mid(m_currentLine.indexOf("{") + 1); // Implicit assumption that there is no other '{' in the line
+    }
+}
+
+inline void PgnMoveParser::parseMoveToken(GameX* game, QString token)
+{
+    QChar c = token.at(0);
+    if (c.isDigit())
+    {
+        moveNumberFound = token.toInt();
+        return;
+    }
+
+    if (token.startsWith("..."))
+    {
+        white = false;
+        dotFound = true;
+        token.remove(0,3);
+    }
+    else if (token.startsWith("."))
+    {
+        white = true;
+        dotFound = true;
+        token.remove(0,1);
+    }
+
+    if (token.isEmpty()) return;
+
+    if(m_newVariation)
+    {
+        bool dummyNeeded = dotFound && (((white && game->board().whiteToMove()) ||
+                                         (!white && game->board().blackToMove())));
+        if (dummyNeeded)
+        {
+            if (!game->move(game->currentMove()).isDummyMove())
+            {
+                game->dbAddMove(game->board().dummyMove());
+                game->forward();
+                game->setNeedsCleanup(true);
+            }
+        }
+        game->backward();
+        m_variation = game->dbAddSanVariation(token, QString());
+        if(!m_precomment.isEmpty())
+        {
+            game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
+            m_precomment.clear();
+            m_inPreComment = false;
+        }
+        m_newVariation = false;
+    }
+    else
+    {
+        m_variation = game->dbAddSanMove(token, QString());
+
+        if(!m_precomment.isEmpty())
+        {
+            game->dbSetAnnotation(m_precomment, m_variation, GameX::BeforeMove);
+            m_precomment.clear();
+            m_inPreComment = false;
+        }
+    }
+
+    if (dotFound && m_strictMoveCounter && ( m_variation != NO_MOVE ))
+    {
+        int currentMoveNumber = game->moveNumber();
+        if (currentMoveNumber != moveNumberFound)
+        {
+            game->removeNode();
+            m_variation = NO_MOVE;
+        }
+    }
+
+    dotFound = false;
+}
+
+void PgnMoveParser::parseToken(GameX* game, const QStringRef& token)
+{
+    if (token.isEmpty()) return;
+    // qDebug() << "Parsing Token:" << token << ":";
+    char c = token.at(0).toLatin1();
+    switch(c)
+    {
+    case 0:
+        {
+            Nag nag = NagSet::fromString(token.at(0));
+            game->dbAddNag(nag);
+        }
+        break;
+    case '(':
+        {
+            m_newVariation = true;
+            m_variationStack.push(game->currentMove());
+        }
+        break;
+    case ')':
+        MoveId move;
+        if (!m_variationStack.isEmpty())
+        {
+            move = m_variationStack.pop();
+        }
+        else
+        {
+            move = game->parentMove();
+        }
+        game->dbMoveToId(move);
+        game->forward();
+        m_newVariation = false;
+        m_variation = 0;
+        break;
+    case '{':
+        m_comment.clear();
+        m_inComment = true;
+        break;
+    case '$':
+        if (token.length()>1)
+        {
+            game->dbAddNag((Nag)token.mid(1).toInt());
+        }
+        break;
+    case '!':
+        if(token == "!")
+        {
+            game->dbAddNag(GoodMove);
+        }
+        else if(token == "!!")
+        {
+            game->dbAddNag(VeryGoodMove);
+        }
+        else if(token == "!?")
+        {
+            game->dbAddNag(SpeculativeMove);
+        }
+        break;
+    case '?':
+        if(token == "?")
+        {
+            game->dbAddNag(PoorMove);
+        }
+        else if(token == "??")
+        {
+            game->dbAddNag(VeryPoorMove);
+        }
+        else if(token == "?!")
+        {
+            game->dbAddNag(QuestionableMove);
+        }
+        break;
+    case '+':
+        if(token == "+=")
+        {
+            game->dbAddNag(WhiteHasASlightAdvantage);
+        }
+        else if(token == "+/-")
+        {
+            game->dbAddNag(WhiteHasAModerateAdvantage);
+        }
+        break;
+    case '=':
+        if(token == "=")
+        {
+            game->dbAddNag(DrawishPosition);
+        }
+        else if(token == "=+")
+        {
+            game->dbAddNag(BlackHasASlightAdvantage);
+        }
+        break;
+
+    case '*':
+        game->dbSetResult(ResultUnknown);
+        m_gameOver = true;
+        break;
+
+    case '1':
+        if(token == "1-0")
+        {
+            game->dbSetResult(WhiteWin);
+            m_gameOver = true;
+            break;
+        }
+        else if(token == "1/2-1/2" || token == "1/2")
+        {
+            game->dbSetResult(Draw);
+            m_gameOver = true;
+            break;
+        }
+        parseMoveToken(game, token.toString());
+        break;
+
+    case '0':
+        if(token == "0-1")
+        {
+            game->dbSetResult(BlackWin);
+            m_gameOver = true;
+            break;
+        }
+        parseMoveToken(game, token.toString());
+        break;
+
+    case 'Z':
+    case '-':
+        if(token == "-/+")
+        {
+            game->dbAddNag(BlackHasAModerateAdvantage);
+            break;
+        }
+        parseMoveToken(game, token.toString());
+        break;
+
+    default:
+        if (c<0)
+        {
+            Nag nag = NagSet::fromString(token.at(0));
+            game->dbAddNag(nag);
+        }
+        else
+        {
+            parseMoveToken(game, token.toString());
+        }
+        break;
+    }
+}
+
+void PgnMoveParser::parseComment(GameX* game)
+{
+    int end = m_currentLine.indexOf('}');
+
+    if(end >= 0)
+    {
+        m_comment.append(m_currentLine.left(end));
+        m_inComment = false;
+        if(m_newVariation || game->plyCount() == 0)
+        {
+            if (game->plyCount()==0 && m_inPreComment)
+            {
+                game->dbSetAnnotation(m_precomment, 0);
+                m_inPreComment = false;
+            }
+            else
+            {
+                m_precomment = m_comment.trimmed();
+                m_inPreComment = true;
+            }
+        }
+        else
+        {
+            QString currentComment = game->annotation();
+            if (!currentComment.isEmpty())
+            {
+                currentComment.append("\n");
+                m_comment.prepend(currentComment);
+            }
+            game->dbSetAnnotation(m_comment.trimmed());
+        }
+        m_currentLine = m_currentLine.right((m_currentLine.length() - end) - 1);
+    }
+    else
+    {
+        m_comment.append(m_currentLine + ' ');
+        readLine();
+    }
+}
@@ -0,0 +1,87 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef PGNMOVEPARSER_H
+#define PGNMOVEPARSER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QStack>
+#include <QString>
+#include <QStringRef>
+#include <QVector>
+
+#include "gamecursor.h"
+
+class GameX;
+
+/** @ingroup Database
+ * The PgnMoveParser class parses the move text of a PGN game line by line
+ * from a device. All parsing state lives in the parser, so several threads
+ * may each parse a game with their own parser, usually reading from a
+ * QBuffer over the bytes of the game in a memory mapped file.
+ */
+class PgnMoveParser
+{
+public:
+    /** Parse from @p device, lines are decoded as UTF-8 if @p utf8 is set, else Latin1.
+        With @p strictMoveCounter moves whose number does not match the game are rejected. */
+    PgnMoveParser(QIODevice* device, bool utf8, bool strictMoveCounter);
+
+    /** Continue with a line already read from the device by someone else */
+    void setLine(const QByteArray& lineBuffer, const QString& currentLine);
+    /** @return the raw line the parser stopped at */
+    const QByteArray& lineBuffer() const { return m_lineBuffer; }
+    /** @return the decoded remainder of the line the parser stopped at */
+    const QString& currentLine() const { return m_currentLine; }
+
+    /** Reads the next line of text from the device */
+    void readLine();
+    /** Skips the next line of text from the device */
+    void skipLine();
+    /** Skips past any tag data */
+    void skipTags();
+    /** Reads moves from the device and adds them to the game.
+        @return false if the game contains an illegal move or character */
+    bool parseMoves(GameX* game);
+
+    /** @return true if @p b contains whitespace only */
+    static bool onlyWhitespace(const QByteArray& b);
+    /** @return the simplified text of @p line */
+    static QString decodeLine(const QByteArray& line, bool utf8);
+
+private:
+    /** Parses a line from the device */
+    void parseLine(GameX* game);
+    char peek(QStringRef::const_iterator s);
+    /** Split the current line into a list of tokens */
+    void splitTokenList(QVector<QStringRef>& list);
+    /** Parses a move token */
+    void parseMoveToken(GameX* game, QString token);
+    /** Parses a token */
+    void parseToken(GameX* game, const QStringRef &token);
+    /** Parses a comment */
+    void parseComment(GameX* game);
+
+    QIODevice* m_device;
+    bool m_utf8;
+    bool m_strictMoveCounter;
+
+    QByteArray m_lineBuffer;
+    QString m_currentLine;
+
+    bool m_gameOver;
+    bool m_inComment;
+    bool m_inPreComment;
+    QString m_comment;
+    QString m_precomment;
+    bool m_newVariation;
+    int m_variation;
+    QStack<MoveId> m_variationStack;
+    bool white;
+    bool dotFound;
+    int  moveNumberFound;
+};
+
+#endif // PGNMOVEPARSER_H
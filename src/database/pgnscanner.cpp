@@ -0,0 +1,319 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+#include "pgnscanner.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+static inline bool isSpace(char c)
+{
+    return isspace((unsigned char) c);
+}
+
+static inline bool isDigit(char c)
+{
+    return isdigit((unsigned char) c);
+}
+
+static inline const char* find(const char* p, const char* end, char c)
+{
+    return (p < end) ? static_cast<const char*>(memchr(p, c, end - p)) : nullptr;
+}
+
+PgnScanner::PgnScanner(const char* data, qint64 size, bool utf8) :
+    m_data(data),
+    m_end(data + size),
+    m_utf8(utf8)
+{
+}
+
+inline const char* PgnScanner::lineEnd(const char* p) const
+{
+    const char* e = find(p, m_end, '\n');
+    return e ? e : m_end;
+}
+
+inline const char* PgnScanner::nextLine(const char* p) const
+{
+    const char* e = lineEnd(p);
+    return (e < m_end) ? e + 1 : m_end;
+}
+
+inline bool PgnScanner::isBlank(const char* p, const char* end) const
+{
+    for (; p < end; ++p)
+    {
+        if (!isSpace(*p))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PgnScanner::nextGame(qint64& pos, qint64 limit, GameHeader& header)
+{
+    const char* p = m_data + pos;
+    if (pos == 0 && m_end - p >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+    {
+        p += 3;
+    }
+
+    // Skip junk up to the first line starting with a tag or a move number
+    while (p < m_end && *p != '[' && !isDigit(*p))
+    {
+        p = nextLine(p);
+    }
+    if (p >= m_end || p - m_data >= limit)
+    {
+        pos = p - m_data;
+        return false;
+    }
+
+    header.offset = p - m_data;
+    header.tags.clear();
+
+    while (p < m_end)
+    {
+        const char* e = lineEnd(p);
+        const char* s = p;
+        while (s < e && isSpace(*s))
+        {
+            ++s;
+        }
+        if (s == e || *s != '[')
+        {
+            break;
+        }
+        parseTagLine(s, e, header);
+        p = (e < m_end) ? e + 1 : m_end;
+    }
+
+    while (p < m_end)
+    {
+        const char* e = lineEnd(p);
+        if (!isBlank(p, e))
+        {
+            break;
+        }
+        p = (e < m_end) ? e + 1 : m_end;
+    }
+
+    header.moveTextBegin = p - m_data;
+    while (p < m_end)
+    {
+        const char* e = lineEnd(p);
+        if (isBlank(p, e))
+        {
+            break;
+        }
+        p = (e < m_end) ? e + 1 : m_end;
+    }
+    header.moveTextEnd = p - m_data;
+
+    while (p < m_end)
+    {
+        const char* e = lineEnd(p);
+        if (!isBlank(p, e))
+        {
+            break;
+        }
+        p = (e < m_end) ? e + 1 : m_end;
+    }
+
+    pos = p - m_data;
+    return true;
+}
+
+void PgnScanner::parseTagLine(const char* p, const char* end, GameHeader& header)
+{
+    while (const char* tagStart = find(p, end, '['))
+    {
+        ++tagStart;
+        const char* tagEnd = tagStart;
+        while (tagEnd < end && !isSpace(*tagEnd))
+        {
+            ++tagEnd;
+        }
+        if (tagEnd == end)
+        {
+            break;
+        }
+        const char* valueStart = find(tagEnd + 1, end, '"');
+        if (!valueStart)
+        {
+            break;
+        }
+        ++valueStart;
+        const char* valueEnd = find(valueStart, end, '"');
+        if (!valueEnd)
+        {
+            break;
+        }
+        const char* tagValueEnd = find(valueEnd + 1, end, ']');
+        if (!tagValueEnd)
+        {
+            break;
+        }
+        header.tags.append(Tag(tagName(tagStart, tagEnd), tagValue(valueStart, valueEnd)));
+        p = tagValueEnd;
+    }
+}
+
+QString PgnScanner::tagName(const char* p, const char* end)
+{
+    const QByteArray key = QByteArray::fromRawData(p, int(end - p));
+    auto it = m_tagNames.constFind(key);
+    if (it != m_tagNames.constEnd())
+    {
+        return it.value();
+    }
+    QString name = QString::fromLatin1(p, int(end - p));
+    m_tagNames.insert(QByteArray(p, int(end - p)), name);
+    return name;
+}
+
+QString PgnScanner::tagValue(const char* p, const char* end) const
+{
+    // Whitespace runs are collapsed like QString::simplified() does on a whole line
+    bool simple = true;
+    for (const char* s = p; s < end; ++s)
+    {
+        if (isSpace(*s) && (*s != ' ' || (s + 1 < end && isSpace(s[1]))))
+        {
+            simple = false;
+            break;
+        }
+    }
+
+    QByteArray collapsed;
+    if (!simple)
+    {
+        collapsed.reserve(int(end - p));
+        for (const char* s = p; s < end; ++s)
+        {
+            if (!isSpace(*s))
+            {
+                collapsed.append(*s);
+            }
+            else if (collapsed.isEmpty() || collapsed.at(collapsed.size() - 1) != ' ' || !isSpace(s[-1]))
+            {
+                collapsed.append(' ');
+            }
+        }
+        p = collapsed.constData();
+        end = p + collapsed.size();
+    }
+
+    return m_utf8 ? QString::fromUtf8(p, int(end - p)) : QString::fromLatin1(p, int(end - p));
+}
+
+int PgnScanner::lastMoveNumber(const GameHeader& header) const
+{
+    const char* p = m_data + header.moveTextBegin;
+    const char* end = m_data + header.moveTextEnd;
+
+    // Drop innermost variations, as the line based parser does
+    QByteArray text;
+    text.reserve(int(end - p) + 1);
+    text.append(' ');
+    int lastOpen = -1;
+    for (; p < end; ++p)
+    {
+        if (*p == '(')
+        {
+            lastOpen = text.size();
+        }
+        else if (*p == ')' && lastOpen >= 0)
+        {
+            text.truncate(lastOpen);
+            lastOpen = -1;
+            continue;
+        }
+        else if (*p == ')')
+        {
+            lastOpen = -1;
+        }
+        text.append(*p);
+    }
+
+    // Search backwards for whitespace, digits, optional whitespace and a dot
+    const char* begin = text.constData();
+    for (const char* dot = begin + text.size() - 1; dot > begin; --dot)
+    {
+        if (*dot != '.')
+        {
+            continue;
+        }
+        const char* s = dot - 1;
+        while (s > begin && isSpace(*s))
+        {
+            --s;
+        }
+        const char* lastDigit = s;
+        while (s > begin && isDigit(*s))
+        {
+            --s;
+        }
+        if (s < lastDigit && isSpace(*s))
+        {
+            return QByteArray(s + 1, int(lastDigit - s)).toInt();
+        }
+    }
+    return -1;
+}
+
+void PgnScanner::scan(qint64 begin, qint64 end, Chunk& chunk, volatile bool* breakFlag)
+{
+    qint64 pos = begin;
+    GameHeader header;
+    while (!(breakFlag && *breakFlag) && nextGame(pos, end, header))
+    {
+        bool hasPlyCount = false;
+        for (const Tag& tag: std::as_const(header.tags))
+        {
+            if (tag.first == QLatin1String("PlyCount"))
+            {
+                hasPlyCount = true;
+                break;
+            }
+        }
+        header.lastMoveNumber = hasPlyCount ? -1 : lastMoveNumber(header);
+        chunk.games.append(header);
+    }
+    chunk.end = pos;
+}
+
+qint64 PgnScanner::resyncPoint(qint64 pos) const
+{
+    if (pos <= 0)
+    {
+        return 0;
+    }
+    // Start with the line containing pos - 1, so a line starting at pos is found
+    const char* p = m_data + pos - 1;
+    while (p > m_data && p[-1] != '\n')
+    {
+        --p;
+    }
+    bool blank = false;
+    while (p < m_end)
+    {
+        const char* e = lineEnd(p);
+        if (blank && p - m_data >= pos && e - p >= 6 && memcmp(p, "[Event", 6) == 0)
+        {
+            return p - m_data;
+        }
+        blank = isBlank(p, e);
+        p = (e < m_end) ? e + 1 : m_end;
+    }
+    return size();
+}
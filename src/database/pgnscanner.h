@@ -0,0 +1,91 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef PGNSCANNER_H
+#define PGNSCANNER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+/** @ingroup Database
+ * The PgnScanner class finds the games and their tags in a PGN file which is
+ * held in memory as a whole, usually a memory mapped file. Lines are located
+ * with memchr() and only the tag names and values are decoded, the move text
+ * is skipped on the raw bytes.
+ *
+ * The game boundaries are the same as found by the line based parser of
+ * PgnDatabase: a game starts at a line beginning with '[' or a digit, its
+ * move text ends with the first blank line following it.
+ */
+class PgnScanner
+{
+public:
+    typedef QPair<QString, QString> Tag;
+
+    /** Tags and location of a single game */
+    struct GameHeader
+    {
+        /** Offset of the first line of the game */
+        qint64 offset;
+        /** Tags in the order found in the file, values are not unescaped */
+        QVector<Tag> tags;
+        /** Byte range of the move text */
+        qint64 moveTextBegin;
+        qint64 moveTextEnd;
+        /** Set by scan() to the lastMoveNumber() if there is no PlyCount tag, else -1 */
+        int lastMoveNumber;
+    };
+
+    /** Games found in a byte range by scan() */
+    struct Chunk
+    {
+        QVector<GameHeader> games;
+        /** Offset where scanning the next range has to start */
+        qint64 end;
+    };
+
+    /** Scan @p size bytes at @p data, tag values are decoded as UTF-8 if @p utf8 is set, else Latin1 */
+    PgnScanner(const char* data, qint64 size, bool utf8);
+
+    /** @return the number of bytes scanned */
+    qint64 size() const { return m_end - m_data; }
+
+    /** Find the next game starting at or after @p pos and before @p limit.
+        On success @p header is filled and @p pos is moved behind the game. */
+    bool nextGame(qint64& pos, qint64 limit, GameHeader& header);
+
+    /** @return the number of the last move of the main line, as written in the
+        move text of @p header, or -1 if there is no move number */
+    int lastMoveNumber(const GameHeader& header) const;
+
+    /** Find all games starting at or after @p begin and before @p end.
+        Scanning stops early if @p breakFlag gets set. */
+    void scan(qint64 begin, qint64 end, Chunk& chunk, volatile bool* breakFlag);
+    /** @return the offset of the first line at or after @p pos which starts
+        with an Event tag and follows a blank line, or size() if there is none.
+        Such a line starts a game unless the previous game has no move text,
+        so scanning may be split there if the previous range is checked to
+        end at this offset. */
+    qint64 resyncPoint(qint64 pos) const;
+
+private:
+    const char* lineEnd(const char* p) const;
+    const char* nextLine(const char* p) const;
+    bool isBlank(const char* p, const char* end) const;
+    /** Parse all complete tags in [ @p p, @p end ) */
+    void parseTagLine(const char* p, const char* end, GameHeader& header);
+    QString tagName(const char* p, const char* end);
+    QString tagValue(const char* p, const char* end) const;
+
+    const char* m_data;
+    const char* m_end;
+    bool m_utf8;
+    /** Tag names seen so far, to avoid decoding them for every game */
+    QHash<QByteArray, QString> m_tagNames;
+};
+
+#endif // PGNSCANNER_H
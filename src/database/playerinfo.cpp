@@ -12,6 +12,7 @@
 
 #include "ecopositions.h"
 #include "database.h"
+#include "gamestatistics.h"
 #include "playerinfo.h"
 #include "tags.h"
 
@@ -63,105 +64,79 @@ void PlayerInfo::setName(const QString& player)
     update();
 }
 
-int PlayerInfo::toResult(const QString& res) const
+void PlayerInfo::update()
 {
-    if(res.startsWith("1/2"))
-    {
-        return Draw;
-    }
-    else if(res.startsWith('1'))
-    {
-        return WhiteWin;
-    }
-    else if(res.startsWith('0'))
-    {
-        return BlackWin;
-    }
-    else
+    // Clean previous statistics
+    reset();
+    if(!m_database)
     {
-        return ResultUnknown;
+        return;
     }
-}
-
-void PlayerInfo::update()
-{
-    QHash<QString, EcoFrequencyInfo> openings[2];
-    QList<QString> openingsX[2];
-    QHash<QString, int> openingsXX[2];
     const IndexX* index = m_database->index();
 
-    // Determine matching tag values
-    ValueIndex player = index->getValueIndex(m_name);
-
-    // Clean previous statistics
-    reset();
+    GameStatistics statistics(m_database);
+    GameStatistics::Query query;
+    query.filterValue = index->getValueIndex(m_name);
+    query.eco = true;
 
-    for(int i = 0; i < (int)m_database->count(); ++i)
+    for(int c = White; c <= Black; ++c)
     {
-        Color c;
-        if(index->valueIndexFromTag(TagNameWhite, i) == player)
-        {
-            c = White;
-        }
-        else if(index->valueIndexFromTag(TagNameBlack, i) == player)
-        {
-            c = Black;
-        }
-        else
-        {
-            continue;
-        }
-        int res = toResult(index->tagValue(TagNameResult, i));
-        m_result[c][res]++;
-        m_count[c]++;
-        int elo = index->tagValue(c == White ? TagNameWhiteElo : TagNameBlackElo, i).toInt();
-        if(elo)
-        {
-            m_rating[0] = qMin(elo, m_rating[0]);
-            m_rating[1] = qMax(elo, m_rating[1]);
-        }
-        PartialDate date(index->tagValue(TagNameDate, i));
-        if(date.year() > 1000)
-        {
-            m_date[0] = qMin(date, m_date[0]);
-            m_date[1] = qMax(date, m_date[1]);
-        }
-        QString eco = index->tagValue(TagNameECO, i).left(3);
-        if(eco.length() == 3)
+        query.filterTag = (c == White) ? TagNameWhite : TagNameBlack;
+        // A game against oneself counts for White only
+        query.excludeTag = (c == White) ? QString() : TagNameWhite;
+        query.ratingTag = (c == White) ? TagNameWhiteElo : TagNameBlackElo;
+        const GameStatistics::Aggregate stats = statistics.aggregate(query).value(ValueNoIndex);
+
+        for(int r = 0; r < 4; ++r)
         {
-            openings[c][eco].count++;
-            openings[c][eco].result[res]++;
+            m_result[c][r] = stats.result[r];
         }
-        QString ecoX = index->tagValue(TagNameECO, i).left(4);
-        if(ecoX.length() >= 3)
+        m_count[c] = stats.count;
+        m_rating[0] = qMin(stats.minRating, m_rating[0]);
+        m_rating[1] = qMax(stats.maxRating, m_rating[1]);
+        m_date[0] = qMin(stats.minDate, m_date[0]);
+        m_date[1] = qMax(stats.maxDate, m_date[1]);
+
+        // ECO codes and opening names are looked up once per distinct tag value
+        QHash<QString, EcoFrequencyInfo> openings;
+        QHash<QString, int> openingCounts;
+        for(auto it = stats.eco.cbegin(); it != stats.eco.cend(); ++it)
         {
-            QString opening = EcoPositions::findEcoName(ecoX);
-            if (!opening.isEmpty())
+            QString ecoValue = index->tagValueFromIndex(it.key());
+            QString eco = ecoValue.left(3);
+            if(eco.length() == 3)
             {
-                openingsX[c].append(ecoX);
-                openingsXX[c][opening]++;
+                EcoFrequencyInfo& info = openings[eco];
+                info.count += it.value().count;
+                for(int r = 0; r < 4; ++r)
+                {
+                    info.result[r] += it.value().result[r];
+                }
+            }
+            QString ecoX = ecoValue.left(4);
+            if(ecoX.length() >= 3)
+            {
+                QString opening = EcoPositions::findEcoName(ecoX);
+                if (!opening.isEmpty())
+                {
+                    openingCounts[opening] += it.value().count;
+                    QStringList& codes = m_MapOpeningToECOCodes[c][opening];
+                    if (!codes.contains(ecoX))
+                    {
+                        codes.append(ecoX);
+                    }
+                }
             }
         }
-    }
 
-    for(int i = 0; i < 2; ++i)
-    {
-        for(auto it = openings[i].cbegin(); it != openings[i].cend(); ++it)
+        for(auto it = openings.cbegin(); it != openings.cend(); ++it)
         {
-            m_eco[i].append(EcoFrequencyItem(it.key(), it.value()));
+            m_eco[c].append(EcoFrequencyItem(it.key(), it.value()));
         }
-        std::sort(m_eco[i].begin(), m_eco[i].end(), sortEcoFrequencyLt);
-    }
+        std::sort(m_eco[c].begin(), m_eco[c].end(), sortEcoFrequencyLt);
 
-    for(int i = 0; i < 2; ++i)
-    {
-        for (auto it = openingsX[i].cbegin(); it != openingsX[i].cend(); ++it)
-        {
-            QString opening = EcoPositions::findEcoName(*it);
-            m_MapOpeningToECOCodes[i][opening].append(*it);
-        }
-        auto& counts = m_opening[i];
-        for (auto it = openingsXX[i].cbegin(); it != openingsXX[i].cend(); ++it)
+        auto& counts = m_opening[c];
+        for (auto it = openingCounts.cbegin(); it != openingCounts.cend(); ++it)
         {
             counts.append(OpeningCountItem(it.key(), it.value()));
         }
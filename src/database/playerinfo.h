@@ -74,7 +74,6 @@ private:
     /** Format score statistics for single color. */
     QString formattedScore(const int result[4], int count) const;
     QString formattedScore(const int results[4], int count, QString ref, bool mode) const;
-    int toResult(const QString& res) const;
 
     QString m_name;
     Database* m_database;
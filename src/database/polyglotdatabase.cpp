@@ -2,7 +2,10 @@
 *   Copyright (C) 2014 by Jens Nissen jens-chessx@gmx.net                   *
 ****************************************************************************/
 
+#include <algorithm>
+
 #include <QtCore>
+#include <QtEndian>
 #include <QFuture>
 #include <QtConcurrent/QtConcurrent>
 
@@ -37,7 +40,9 @@ struct key_compare
 PolyglotDatabase::PolyglotDatabase() :
     Database(),
     m_file(nullptr),
-    m_count(0)
+    m_count(0),
+    m_data(nullptr),
+    m_pos(-1)
 {
 }
 
@@ -61,30 +66,20 @@ bool PolyglotDatabase::open(const QString &filename, bool)
     if(openFile(filename, true))
     {
         m_utf8 = false;
-        QFileInfo fi(m_filename);
-        m_count = fi.size() / 16; // Polyglot entry size is 16
-        m_midKey = (quint64)-1;
-        m_midPos = 16*((m_count+1)/2);
+        m_count = m_file->size() / 16; // Polyglot entry size is 16
         if (m_count)
         {
-            if (m_file->seek(m_midPos))
+            // Probes are served from the mapped file, reading it is the fallback
+            m_data = m_file->map(0, m_count * 16);
+            if (!m_data)
             {
-                entry_t entry;
-                entry_t nextEntry;
-                if(!entry_from_file(&entry))
-                {
-                    while (!entry_from_file(&nextEntry))
-                    {
-                        if (entry.key != nextEntry.key)
-                        {
-                            m_midKey = nextEntry.key;
-                            m_midPos = m_file->pos() - sizeof(entry_t);
-                        }
-                    }
-                }
+                m_buffer = m_file->read(m_count * 16);
+                m_count = m_buffer.size() / 16;
+                m_data = reinterpret_cast<const uchar*>(m_buffer.constData());
             }
-            reset();
         }
+        build_fence();
+        reset();
         return true;
     }
     return false;
@@ -148,6 +143,10 @@ void PolyglotDatabase::close()
     }
     delete m_file;
     m_file = nullptr;
+    m_data = nullptr;
+    m_buffer.clear();
+    m_fence.clear();
+    m_count = 0;
 }
 
 // ---------------------------------------------------------
@@ -368,43 +367,66 @@ static const quint64 RandomTurn = U64(0xF8D626AAAF278509);
 // Book reading
 // ---------------------------------------------------------
 
-int PolyglotDatabase::int_from_file(int l, quint64& r)
+quint64 PolyglotDatabase::key_at(quint64 index) const
+{
+    return qFromBigEndian<quint64>(m_data + 16 * index);
+}
+
+void PolyglotDatabase::entry_at(quint64 index, entry_t *entry) const
+{
+    const uchar* p = m_data + 16 * index;
+    entry->key = qFromBigEndian<quint64>(p);
+    entry->move = qFromBigEndian<quint16>(p + 8);
+    entry->weight = qFromBigEndian<quint16>(p + 10);
+    entry->learn = qFromBigEndian<quint32>(p + 12);
+}
+
+void PolyglotDatabase::build_fence()
+{
+    m_fence.clear();
+    m_fence.reserve(int((m_count + POLYGLOT_FENCE_STRIDE - 1) / POLYGLOT_FENCE_STRIDE));
+    for (quint64 i = 0; i < m_count; i += POLYGLOT_FENCE_STRIDE)
+    {
+        m_fence.append(key_at(i));
+    }
+}
+
+quint64 PolyglotDatabase::find_first(quint64 key) const
 {
-    int i;
-    unsigned char c;
-    for(i=0;i<l;i++)
+    // The fence narrows the search to one block, which is searched in the mapped entries
+    quint64 block = std::lower_bound(m_fence.cbegin(), m_fence.cend(), key) - m_fence.cbegin();
+    quint64 lo = block ? (block - 1) * POLYGLOT_FENCE_STRIDE : 0;
+    quint64 hi = std::min<quint64>(block * POLYGLOT_FENCE_STRIDE, m_count);
+    while (lo < hi)
     {
-        if(m_file->read((char*)&c,1)<=0)
+        quint64 mid = lo + (hi - lo) / 2;
+        if (key_at(mid) < key)
         {
-            return 1;
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
         }
-        r=(r<<8)+c;
     }
-    return 0;
+    return lo;
 }
 
-int PolyglotDatabase::entry_from_file(entry_t *entry)
-{
-    int ret;
-    quint64 r=0;
-    ret=int_from_file(8,r);
-    if(ret) return 1;
-    entry->key=r;
-    ret=int_from_file(2,r);
-    if(ret) return 1;
-    entry->move=r;
-    ret=int_from_file(2,r);
-    if(ret) return 1;
-    entry->weight=r;
-    ret=int_from_file(4,r);
-    if(ret) return 1;
-    entry->learn=r;
-    return 0;
+int PolyglotDatabase::find_entries(quint64 key, QVector<entry_t>& entries) const
+{
+    entries.clear();
+    for (quint64 i = find_first(key); i < m_count && key_at(i) == key; ++i)
+    {
+        entry_t entry;
+        entry_at(i, &entry);
+        entries.append(entry);
+    }
+    return entries.count();
 }
 
 void PolyglotDatabase::reset()
 {
-    m_file->seek(0);
+    m_pos = -1;
 }
 
 // ---------------------------------------------------------
@@ -485,41 +507,21 @@ QString PolyglotDatabase::move_to_string(quint16 move) const
     return move_s;
 }
 
-int PolyglotDatabase::find_key(quint64 key, entry_t *entry)
-{
-    if(!entry_from_file(entry))
-    {
-        if (key==entry->key)
-        {
-            return 0;
-        }
-        else if (key>entry->key)
-        {
-            return 1;
-        }
-    }
-
-    return -1;
-}
-
 // ---------------------------------------------------------
 // Book parser - public interface
 // ---------------------------------------------------------
 
 bool PolyglotDatabase::findMove(quint64 key, MoveData& m, bool& done)
 {
-    entry_t entry;
     done = false;
-    if (m_file->pos()==0)
+    if (m_pos < 0)
     {
-        if (key >= m_midKey)
-        {
-            m_file->seek(m_midPos);
-        }
+        m_pos = find_first(key);
     }
-    int result = find_key(key, &entry);
-    if (result == 0)
+    if (quint64(m_pos) < m_count && key_at(m_pos) == key)
     {
+        entry_t entry;
+        entry_at(m_pos++, &entry);
         QString s = move_to_string(entry.move);
         m.san = s;
         m.localsan.clear(); // Don't care
@@ -529,11 +531,8 @@ bool PolyglotDatabase::findMove(quint64 key, MoveData& m, bool& done)
         m.results.update(ResultUnknown, count);
         return true;
     }
-    else if (result < 0)
-    {
-        done = true;
-    }
 
+    done = true;
     return false;
 }
 
@@ -576,28 +575,32 @@ unsigned int PolyglotDatabase::getMoveMapForBoard(const BoardX &board, QMap<Move
 // Book writing methods
 // ---------------------------------------------------------
 
-void PolyglotDatabase::write_integer(int size, quint64 n)
+void PolyglotDatabase::write_integer(QByteArray& data, int size, quint64 n)
 {
-    int i;
-    int b;
-
-    for (i = size-1; i >= 0; i--) {
-        b = (n >> (i*8)) & 0xFF;
-        unsigned char c = (unsigned char) b;
-        m_file->write((char*)&c,1);
+    for (int i = size-1; i >= 0; i--) {
+        data.append(char((n >> (i*8)) & 0xFF));
     }
 }
 
 void PolyglotDatabase::book_save()
 {
-    for (Book::const_iterator i=m_book.cbegin(); i!=m_book.cend();++i)
+    // Shards cover ascending key ranges, so writing them in turn keeps the file sorted
+    QByteArray data;
+    for (const Book& book: std::as_const(m_book))
     {
-        write_integer(8,(*i).key);
-        write_integer(2,(*i).move);
-        write_integer(2,entry_score((*i)));
-        write_integer(2,0);
-        write_integer(2,0);
+        data.clear();
+        data.reserve(16 * book.count());
+        for (Book::const_iterator i=book.cbegin(); i!=book.cend();++i)
+        {
+            write_integer(data,8,(*i).key);
+            write_integer(data,2,(*i).move);
+            write_integer(data,2,entry_score((*i)));
+            write_integer(data,2,0);
+            write_integer(data,2,0);
+        }
+        m_file->write(data);
     }
+    m_book.clear();
 }
 
 // ---------------------------------------------------------
@@ -626,17 +629,13 @@ void PolyglotDatabase::book_make(Database &db, volatile bool& breakFlag)
     QMutexLocker m(mutex());
     qDebug() << "Add Database";
     if (!breakFlag) add_database(db, breakFlag);
-    qDebug() << "Spool map";
-    if (!breakFlag) spool_map();
-    qDebug() << "Overflow correction";
-    if (!breakFlag) overflow_correction();
-    qDebug() << "Filter Book";
-    if (!breakFlag) book_filter();
-    qDebug() << "Sort Book";
-    if (!breakFlag) book_sort();
+    qDebug() << "Build shards";
+    if (!breakFlag) build_shards(breakFlag);
     qDebug() << "Save Book";
     if (!breakFlag) book_save();
     qDebug() << "Close";
+    m_threadShards.clear();
+    m_book.clear();
     close();
 }
 
@@ -664,85 +663,110 @@ bool PolyglotDatabase::keep_entry(const book_entry&  entry)
     return true;
 }
 
-void PolyglotDatabase::halve_stats(quint64 key)
+void PolyglotDatabase::halve_stats(Book::iterator first, Book::iterator last)
 {
-    for (Book::iterator i=m_book.begin(); i!=m_book.end();++i)
+    for (Book::iterator i=first; i!=last;++i)
     {
-        if ((*i).key == key)
-        {
-            (*i).n = ((*i).n + 1) / 2;
-            (*i).sum = ((*i).sum + 1) / 2;
-        }
+        (*i).n = ((*i).n + 1) / 2;
+        (*i).sum = ((*i).sum + 1) / 2;
     }
 }
 
-void PolyglotDatabase::spool_map()
+void PolyglotDatabase::spool_map(BookMap& map, Book& book)
 {
-    for (auto it = m_bookDictionary.cbegin(); it != m_bookDictionary.cend(); ++it)
+    book.reserve(map.count());
+    for (auto it = map.cbegin(); it != map.cend(); ++it)
     {
         book_entry b(it.key(), it.value());
-        m_book.append(b);
+        book.append(b);
     }
-    m_bookDictionary.clear();
+    map.clear();
 }
 
-void PolyglotDatabase::overflow_correction()
+void PolyglotDatabase::overflow_correction(Book& book)
 {
-    for (Book::iterator i=m_book.begin(); i!=m_book.end();++i)
+    // The book is sorted, so the entries of a key are adjacent
+    for (Book::iterator first=book.begin(); first!=book.end(); )
     {
-        while ((*i).n >= MAX_COUNT)
+        Book::iterator last = first;
+        quint32 n = 0;
+        while (last != book.end() && (*last).key == (*first).key)
         {
-            halve_stats((*i).key);
+            n = std::max(n, (*last).n);
+            ++last;
         }
-    }
-}
-
-book_entry* PolyglotDatabase::find_entry(const book_entry& entry)
-{
-    for (Book::iterator i=m_book.begin(); i!=m_book.end();++i)
-    {
-        if (((*i).key == entry.key) && ((*i).move == entry.move))
+        while (n >= MAX_COUNT)
         {
-            return &(*i);
+            halve_stats(first, last);
+            n = (n + 1) / 2;
         }
+        first = last;
     }
-
-    return nullptr;
 }
 
-void PolyglotDatabase::update_entry(book_entry& entry, int result)
+void PolyglotDatabase::update_entry(QVector<BookMap>& shards, const book_entry& entry, int result)
 {
-    QMutexLocker m(&mutex2);
     book_key key;
     key.key = entry.key;
     key.move = entry.move;
 
-    book_value b = m_bookDictionary.value(key);
+    book_value& b = shards[shard_of(entry.key)][key];
 
     ++b.n;
     b.sum += result + 1;
+}
 
-    m_bookDictionary[key] = b;
+void PolyglotDatabase::book_sort(Book& book)
+{
+    std::sort(book.begin(),book.end(),key_compare());
 }
 
-void PolyglotDatabase::book_sort()
+void PolyglotDatabase::book_filter(Book& book)
 {
-    std::sort(m_book.begin(),m_book.end(),key_compare());
+    book.erase(std::remove_if(book.begin(), book.end(),
+                              [this](const book_entry& entry) { return !keep_entry(entry); }),
+               book.end());
 }
 
-void PolyglotDatabase::book_filter()
+void PolyglotDatabase::build_shard(int shard)
 {
-    for (Book::iterator i=m_book.begin(); i!=m_book.end(); )
+    BookMap& map = m_threadShards[0][shard];
+    for (int t = 1; t < m_threadShards.count(); ++t)
     {
-        if (keep_entry(*i))
+        BookMap& other = m_threadShards[t][shard];
+        for (auto it = other.cbegin(); it != other.cend(); ++it)
         {
-            ++i;
-        }
-        else
-        {
-            i = m_book.erase(i);
+            book_value& b = map[it.key()];
+            b.n += it.value().n;
+            b.sum += it.value().sum;
         }
+        other.clear();
     }
+
+    Book& book = m_book[shard];
+    spool_map(map, book);
+    book_sort(book);
+    overflow_correction(book);
+    book_filter(book);
+}
+
+void PolyglotDatabase::build_shards(volatile bool& breakFlag)
+{
+    m_book.clear();
+    m_book.resize(BOOK_SHARDS);
+    if (m_threadShards.isEmpty())
+    {
+        return;
+    }
+
+    // Shards hold disjoint key ranges and are built independently
+    QFutureSynchronizer<void> synchronizer;
+    for (int shard = 0; shard < BOOK_SHARDS && !breakFlag; ++shard)
+    {
+        synchronizer.addFuture(QtConcurrent::run([this, shard]() { build_shard(shard); }));
+    }
+    synchronizer.waitForFinished();
+    m_threadShards.clear();
 }
 
 static const int MoveNone = 0; // HACK: a1a1 cannot be a legal move
@@ -819,7 +843,7 @@ bool PolyglotDatabase::get_move_entry(Move m, book_entry& entry) const
     return true;
 }
 
-void PolyglotDatabase::add_game(GameX& g, int result)
+void PolyglotDatabase::add_game(QVector<BookMap>& shards, GameX& g, int result)
 {
     int ply = 0;
     if (BoardX::standardStartBoard == g.startingBoard())
@@ -843,7 +867,7 @@ void PolyglotDatabase::add_game(GameX& g, int result)
             }
 
             // add to Book
-            update_entry(entry, result);
+            update_entry(shards, entry, result);
 
             // invert result for opposing color
             result = -result;
@@ -852,7 +876,7 @@ void PolyglotDatabase::add_game(GameX& g, int result)
     }
 }
 
-void PolyglotDatabase::add_database_chunk(Database* db, int start, int end, volatile bool* breakFlag)
+void PolyglotDatabase::add_database_chunk(Database* db, int start, int end, QVector<BookMap>* shards, volatile bool* breakFlag)
 {
     int progressCount = 1 + end / 100;
     for(int i = start; i < end; ++i)
@@ -869,7 +893,7 @@ void PolyglotDatabase::add_database_chunk(Database* db, int start, int end, vola
             int result = game.resultAsInt();
             if ((m_filterResult==0) || (m_filterResult != result))
             {
-                add_game(game, (m_overwriteResult == 0) ? result : m_overwriteResult);
+                add_game(*shards, game, (m_overwriteResult == 0) ? result : m_overwriteResult);
             }
         }
     }
@@ -883,17 +907,23 @@ void PolyglotDatabase::add_database(Database& db, volatile bool& breakFlag)
 
     RefKeeper m(db.refCounter());
     qDebug()<<"Collect from database with" << maxThreads << "threads";
+
+    // Each thread collects into its own maps, they are merged per shard afterwards
+    m_threadShards.clear();
+    m_threadShards.resize(maxThreads);
     QFutureSynchronizer<void> synchronizer;
     int start = 0;
     for (int i=0; i<maxThreads; ++i)
     {
-        int end = std::min(start + chunk, n);
+        int end = (i == maxThreads - 1) ? n : std::min(start + chunk, n);
+        m_threadShards[i].resize(BOOK_SHARDS);
+        QVector<BookMap>* shards = &m_threadShards[i];
 
         // This is ridiculous - why change a interface like this?
 #if QT_VERSION < 0x060000
-        QFuture<void> future = QtConcurrent::run(this, &PolyglotDatabase::add_database_chunk, &db, start, end, &breakFlag);
+        QFuture<void> future = QtConcurrent::run(this, &PolyglotDatabase::add_database_chunk, &db, start, end, shards, &breakFlag);
 #else
-        QFuture<void> future = QtConcurrent::run(&PolyglotDatabase::add_database_chunk, this, &db, start, end, &breakFlag);
+        QFuture<void> future = QtConcurrent::run(&PolyglotDatabase::add_database_chunk, this, &db, start, end, shards, &breakFlag);
 #endif
 
         synchronizer.addFuture(future);
@@ -5,7 +5,10 @@
 #ifndef POLYGLOTDATABASE_H
 #define POLYGLOTDATABASE_H
 
-#include <QMutex>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QVector>
 
 #include "database.h"
 #include "movedata.h"
@@ -42,10 +45,23 @@ typedef struct _book_key
         }
         return false;
     }
+    inline bool operator==(const _book_key& k2) const
+    {
+        return key == k2.key && move == k2.move;
+    }
     quint64 key;
     quint16 move;
 } book_key;
 
+#if QT_VERSION < 0x060000
+inline uint qHash(const book_key& k, uint seed = 0)
+#else
+inline size_t qHash(const book_key& k, size_t seed = 0)
+#endif
+{
+    return qHash(k.key ^ (quint64(k.move) << 48), seed);
+}
+
 typedef struct _book_value
 {
     _book_value() : n(0),sum(0) {}
@@ -95,8 +111,15 @@ typedef struct _book_entry
    }
 } book_entry;
 
-typedef QList<book_entry> Book;
-typedef QMap<book_key,book_value> BookMap;
+typedef QVector<book_entry> Book;
+typedef QHash<book_key,book_value> BookMap;
+
+/** A book is built in 2^BOOK_SHARD_BITS shards, each holding a range of keys */
+#define BOOK_SHARD_BITS 6
+#define BOOK_SHARDS (1 << BOOK_SHARD_BITS)
+
+/** Number of book entries per key of the fence index */
+#define POLYGLOT_FENCE_STRIDE 64
 
 class PolyglotDatabase : public Database
 {
@@ -131,6 +154,9 @@ public:
     void close();
     /** Find Information to a given key */
     bool findMove(quint64 key, MoveData &move, bool &done);
+    /** Get all entries of a given key, safe to call from several threads
+        @return the number of entries */
+    int find_entries(quint64 key, QVector<entry_t>& entries) const;
     /** Start a search for a new key */
     void reset();
     void book_make(Database& db, volatile bool& breakFlag);
@@ -144,43 +170,57 @@ signals:
 public slots:
 
 protected:
-    int find_key(quint64 key, entry_t *entry);
-    int entry_from_file(entry_t *entry);
-    int int_from_file(int l, quint64 &r);
+    quint64 key_at(quint64 index) const;
+    void entry_at(quint64 index, entry_t *entry) const;
+    /** Collect the first key of each block of POLYGLOT_FENCE_STRIDE entries */
+    void build_fence();
+    /** @return the index of the first entry with a key not less than @p key */
+    quint64 find_first(quint64 key) const;
 
     QString move_to_string(quint16 move) const;
     void book_save();
-    void write_integer(int size, quint64 n);
+    void write_integer(QByteArray& data, int size, quint64 n);
     int entry_score(const book_entry& entry);
     bool keep_entry(const book_entry &entry);
-    void halve_stats(quint64 key);
-    void book_sort();
-    void spool_map();
-    void overflow_correction();
-    void update_entry(book_entry &entry, int result);
-    book_entry *find_entry(const book_entry &entry);
-    void book_filter();
+    /** Halve the statistics of the entries in [ @p first, @p last ), which share a key */
+    void halve_stats(Book::iterator first, Book::iterator last);
+    void book_sort(Book& book);
+    void spool_map(BookMap& map, Book& book);
+    void overflow_correction(Book& book);
+    /** @return the shard holding the entries of @p key */
+    static int shard_of(quint64 key) { return int(key >> (64 - BOOK_SHARD_BITS)); }
+    void update_entry(QVector<BookMap>& shards, const book_entry &entry, int result);
+    void book_filter(Book& book);
+    /** Merge the maps of all threads for shard @p shard into its sorted and filtered entries */
+    void build_shard(int shard);
+    void build_shards(volatile bool &breakFlag);
     void add_database(Database &db, volatile bool &breakFlag);
-    void add_database_chunk(Database* db, int start, int end, volatile bool *breakFlag);
-    void add_game(GameX &g, int result);
+    void add_database_chunk(Database* db, int start, int end, QVector<BookMap>* shards, volatile bool *breakFlag);
+    void add_game(QVector<BookMap>& shards, GameX &g, int result);
     bool get_move_entry(Move m, book_entry &entry) const;
     int get_promotion(Move m) const;
     int make_castling_move(Move m) const;
     int make_move(int from, int to) const;
 private:
     QString m_filename;
-    QIODevice* m_file;
+    QFile* m_file;
     quint64 m_count;
-    quint64 m_midKey;
-    quint64 m_midPos;
-    Book m_book;
-    BookMap m_bookDictionary;
+    /** Entries of an opened book, mapped or read into m_buffer */
+    const uchar* m_data;
+    QByteArray m_buffer;
+    /** Key of every POLYGLOT_FENCE_STRIDE-th entry */
+    QVector<quint64> m_fence;
+    /** Entry findMove() continues with, -1 after reset() */
+    qint64 m_pos;
+    /** Entries collected by each thread, split into shards */
+    QVector<QVector<BookMap> > m_threadShards;
+    /** Final entries of each shard, in key order */
+    QVector<Book> m_book;
     bool m_uniform;
     int m_overwriteResult;
     int m_filterResult;
     quint32 m_minGame;
     int m_maxPly;
-    QMutex mutex2;
 };
 
 #endif // POLYGLOTDATABASE_H
@@ -0,0 +1,171 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <algorithm>
+
+#include "gamex.h"
+#include "positionindex.h"
+
+using namespace chessx;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+Move PositionIndex::Hit::move(const BoardX& position) const
+{
+    if (atGameEnd())
+    {
+        return Move();
+    }
+    Square from = Square(nextMove & 63);
+    Square to = Square((nextMove >> 6) & 63);
+    Move m = position.prepareMove(from, to);
+    PieceType promoted = PieceType((nextMove >> 12) & 7);
+    if (m.isPromotion() && promoted != None)
+    {
+        m.setPromoted(promoted);
+    }
+    return m;
+}
+
+PositionIndex::PositionIndex()
+{
+}
+
+void PositionIndex::clear()
+{
+    m_pending.clear();
+    m_keys.clear();
+    m_games.clear();
+    m_moveIds.clear();
+    m_nextMoves.clear();
+}
+
+quint16 PositionIndex::encodeMove(const Move& move)
+{
+    quint16 promoted = move.isPromotion() ? pieceType(move.promotedPiece()) : None;
+    return quint16(move.from() | (move.to() << 6) | (promoted << 12));
+}
+
+void PositionIndex::addGame(GameId gameId, const GameX& game)
+{
+    const GameCursor& cursor = game.cursor();
+    BoardX board(cursor.initialBoard());
+    QSet<quint64> seen;
+
+    MoveId current = ROOT_NODE;
+    while (current != NO_MOVE)
+    {
+        MoveId next = cursor.nextMove(current);
+        quint64 key = board.getHashValue();
+        if (!seen.contains(key))
+        {
+            seen.insert(key);
+            Entry e;
+            e.key = key;
+            e.gameId = gameId;
+            e.moveId = current;
+            e.nextMove = (next == NO_MOVE) ? NoNextMove : encodeMove(cursor.move(next));
+            m_pending.append(e);
+        }
+        if (next != NO_MOVE)
+        {
+            board.doMove(cursor.move(next));
+        }
+        current = next;
+    }
+}
+
+void PositionIndex::finalize()
+{
+    if (m_pending.isEmpty())
+    {
+        return;
+    }
+
+    // Merge postings already in place with the pending ones
+    m_pending.reserve(m_pending.count() + m_keys.count());
+    for (int i = 0; i < m_keys.count(); ++i)
+    {
+        Entry e;
+        e.key = m_keys.at(i);
+        e.gameId = m_games.at(i);
+        e.moveId = m_moveIds.at(i);
+        e.nextMove = m_nextMoves.at(i);
+        m_pending.append(e);
+    }
+    std::sort(m_pending.begin(), m_pending.end());
+
+    int n = m_pending.count();
+    m_keys.resize(n);
+    m_games.resize(n);
+    m_moveIds.resize(n);
+    m_nextMoves.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        const Entry& e = m_pending.at(i);
+        m_keys[i] = e.key;
+        m_games[i] = e.gameId;
+        m_moveIds[i] = e.moveId;
+        m_nextMoves[i] = e.nextMove;
+    }
+    m_pending.clear();
+    m_pending.squeeze();
+}
+
+PositionIndex::Range PositionIndex::range(quint64 key) const
+{
+    auto r = std::equal_range(m_keys.constBegin(), m_keys.constEnd(), key);
+    return Range(int(r.first - m_keys.constBegin()), int(r.second - m_keys.constBegin()));
+}
+
+bool PositionIndex::lookup(const Range& range, GameId gameId, Hit& hit) const
+{
+    auto first = m_games.constBegin() + range.first;
+    auto last = m_games.constBegin() + range.second;
+    auto it = std::lower_bound(first, last, gameId);
+    if (it == last || *it != gameId)
+    {
+        return false;
+    }
+    int i = int(it - m_games.constBegin());
+    hit.moveId = m_moveIds.at(i);
+    hit.nextMove = m_nextMoves.at(i);
+    return true;
+}
+
+bool PositionIndex::lookup(const BoardX& position, GameId gameId, Hit& hit) const
+{
+    return lookup(range(position.getHashValue()), gameId, hit);
+}
+
+void PositionIndex::write(QDataStream& out) const
+{
+    out << m_keys;
+    out << m_games;
+    out << m_moveIds;
+    out << m_nextMoves;
+}
+
+bool PositionIndex::read(QDataStream& in, volatile bool* breakFlag)
+{
+    clear();
+    in >> m_keys;
+    if (breakFlag && *breakFlag) return false;
+    in >> m_games;
+    in >> m_moveIds;
+    in >> m_nextMoves;
+    if ((breakFlag && *breakFlag) ||
+        (in.status() != QDataStream::Ok) ||
+        (m_games.count() != m_keys.count()) ||
+        (m_moveIds.count() != m_keys.count()) ||
+        (m_nextMoves.count() != m_keys.count()))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
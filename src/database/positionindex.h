@@ -0,0 +1,107 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include <QDataStream>
+#include <QPair>
+#include <QVector>
+
+#include "board.h"
+#include "gamecursor.h"
+#include "gameid.h"
+
+class GameX;
+
+#define VERSION_POSITION_INDEX_1_0 0x0001
+#define VERSION_POSITION_INDEX_1_1 0x0002 // Followed by a MaterialIndex
+#define VERSION_POSITION_INDEX_CURRENT VERSION_POSITION_INDEX_1_1
+
+#define POSITION_INDEX_FILE_MAGIC 0xce56
+
+/** @ingroup Database
+ * The PositionIndex class maps the hash key of a position (BoardX::getHashValue())
+ * to the games reaching this position in their main line. For each game only
+ * the first occurrence of a position is recorded, together with the move id
+ * of the node and the move played from there on. This allows answering
+ * position searches and opening tree queries without parsing any moves.
+ *
+ * The postings are kept in flat arrays sorted by (key, game), a lookup is a
+ * binary search for the key followed by a binary search for the game.
+ */
+class PositionIndex
+{
+public:
+    /** A match of a position in a single game */
+    struct Hit
+    {
+        MoveId moveId;
+        quint16 nextMove;
+
+        /** @return true if the position was reached at the end of the game */
+        bool atGameEnd() const { return nextMove == NoNextMove; }
+        /** @return the move played from @p position in the game, an illegal move at game end */
+        Move move(const BoardX& position) const;
+    };
+
+    /** A range of postings sharing the same key */
+    typedef QPair<int, int> Range;
+
+    static const quint16 NoNextMove = 0xFFFF;
+
+    PositionIndex();
+
+    /** Remove all postings */
+    void clear();
+    /** @return true if the index holds no postings */
+    bool isEmpty() const { return m_keys.isEmpty(); }
+    /** @return number of postings */
+    int count() const { return m_keys.count(); }
+
+    /** Add all main line positions of @p game with id @p gameId */
+    void addGame(GameId gameId, const GameX& game);
+    /** Sort the postings, must be called once all games are added */
+    void finalize();
+
+    /** @return the range of postings for the position with hash @p key */
+    Range range(quint64 key) const;
+    /** @return the game of posting @p i, the postings of a range are sorted by game */
+    GameId gameAt(int i) const { return m_games.at(i); }
+    /** Lookup @p gameId in a @p range obtained from range(), fill @p hit if found */
+    bool lookup(const Range& range, GameId gameId, Hit& hit) const;
+    /** Convenience function for a single lookup of @p position in game @p gameId */
+    bool lookup(const BoardX& position, GameId gameId, Hit& hit) const;
+
+    /** Write the postings to a stream */
+    void write(QDataStream& out) const;
+    /** Read the postings from a stream, returns false if interrupted by @p breakFlag */
+    bool read(QDataStream& in, volatile bool* breakFlag);
+
+    /** Encode a move into the 16 bit representation used by the postings */
+    static quint16 encodeMove(const Move& move);
+
+private:
+    struct Entry
+    {
+        quint64 key;
+        GameId gameId;
+        MoveId moveId;
+        quint16 nextMove;
+        bool operator<(const Entry& rhs) const
+        {
+            return key < rhs.key || (key == rhs.key && gameId < rhs.gameId);
+        }
+    };
+
+    /** Postings collected by addGame() and not yet sorted */
+    QVector<Entry> m_pending;
+
+    QVector<quint64> m_keys;
+    QVector<GameId> m_games;
+    QVector<MoveId> m_moveIds;
+    QVector<quint16> m_nextMoves;
+};
+
+#endif // POSITIONINDEX_H
@@ -14,11 +14,11 @@
 
 /* PositionSearch Class
  * ******************************/
-PositionSearch::PositionSearch()
+PositionSearch::PositionSearch() : m_positionIndex(nullptr)
 {
 }
 
-PositionSearch::PositionSearch(Database* db, const BoardX& position):Search(db)
+PositionSearch::PositionSearch(Database* db, const BoardX& position):Search(db), m_positionIndex(nullptr)
 {
     setPosition(position);
 }
@@ -26,10 +26,30 @@ PositionSearch::PositionSearch(Database* db, const BoardX& position):Search(db)
 void PositionSearch::setPosition(const BoardX& position)
 {
     m_position = position;
+    m_positionIndex = nullptr;
+}
+
+void PositionSearch::Prepare(volatile bool&)
+{
+    m_positionIndex = m_database ? m_database->positionIndex() : nullptr;
+    if (m_positionIndex)
+    {
+        m_range = m_positionIndex->range(m_position.getHashValue());
+    }
+}
+
+bool PositionSearch::isThreadSafe() const
+{
+    return m_positionIndex || (m_database && m_database->supportsConcurrentLoads());
 }
 
 int PositionSearch::matches(GameId index) const
 {
+    if (m_positionIndex)
+    {
+        PositionIndex::Hit hit;
+        return m_positionIndex->lookup(m_range, index, hit) ? hit.moveId + 1 : 0;
+    }
     return (1+m_database->findPosition(index, m_position)); // so NO_MOVE results in 0
 }
 
@@ -7,10 +7,12 @@
 
 #include "search.h"
 #include "board.h"
+#include "positionindex.h"
 
 /** @ingroup Search
 The PositionSearch class is a search that checks for given position.
-@todo Performance is seriously bad
+If the database provides a PositionIndex, the search is answered from the index,
+otherwise every game is loaded and replayed.
 */
 class PositionSearch : public Search
 {
@@ -23,12 +25,20 @@ public:
     PositionSearch(Database* db, const BoardX& position);
     /** Sets sought position. */
     void setPosition(const BoardX & position);
+    /** Lookup the position in the position index of the database, if there is one */
+    virtual void Prepare(volatile bool&);
     /** Return moveId the move of  after which the game matches the search + 1. E.g. for standard game and chess start position
         1 is returned.
     */
     virtual int matches(GameId index) const;
+    /** The index is read only, without it the database must support concurrent loads */
+    virtual bool isThreadSafe() const;
 private:
     BoardX m_position;
+    /** Postings of m_position in the position index */
+    PositionIndex::Range m_range;
+    /** Index used for the current search, nullptr if none */
+    const PositionIndex* m_positionIndex;
 };
 
 #endif // POSITIONSEARCH_H
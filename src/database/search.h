@@ -34,7 +34,7 @@ class Search : public QObject
     Q_OBJECT
 
 public:
-    enum Type { NullSearch, PositionSearch, EloSearch, DateSearch, TagSearch, FilterSearch, NumberSearch, DuplicateSearch, ListSearch};
+    enum Type { NullSearch, PositionSearch, EloSearch, DateSearch, TagSearch, FilterSearch, NumberSearch, DuplicateSearch, ListSearch, MaterialSearch, PatternSearch};
 
     /** Standard constructor. */
     explicit Search(Database* db = nullptr);
@@ -42,6 +42,8 @@ public:
     virtual ~Search();
     virtual void Prepare(volatile bool&) {};
     virtual int matches(GameId index) const = 0;
+    /** @return true if matches() may be called from several threads at once after Prepare() */
+    virtual bool isThreadSafe() const { return false; }
 
     void AddSearch(Search* search, FilterOperator op);
 
@@ -222,9 +222,12 @@ QMap<QString, QVariant> Settings::initDefaultValues() const
     map.insert("/General/automaticECO", true);
     map.insert("/General/preserveECO", true);
     map.insert("/General/useIndexFile", true);
+    map.insert("/General/usePositionIndex", false);
+    map.insert("/General/useMoveCache", false);
     map.insert("/General/ListFontSize", DEFAULT_LISTFONTSIZE);
     map.insert("/General/onlineTablebases", true);
     map.insert("/General/tablebaseSource", 0);
+    map.insert("/General/syzygyPath", "");
     map.insert("/General/onlineVersionCheck", true);
     map.insert("/General/autoCommitDB", false);
     map.insert("/General/language", "Default");
@@ -0,0 +1,1317 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+*                                                                           *
+*   Adapted from src/syzygy/tbprobe.cpp of Stockfish:                       *
+*   Stockfish, a UCI chess playing engine derived from Glaurung 2.1         *
+*   Copyright (C) 2004-2026 The Stockfish developers (see AUTHORS file)     *
+*   Based on the Syzygy probing code, Copyright (c) 2013 Ronald de Man      *
+*                                                                           *
+*   This file is free software: you can redistribute it and/or modify       *
+*   it under the terms of the GNU General Public License as published by    *
+*   the Free Software Foundation, either version 3 of the License, or       *
+*   (at your option) any later version.                                     *
+*                                                                           *
+*   This file is distributed in the hope that it will be useful,            *
+*   but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+*   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+*   GNU General Public License for more details.                            *
+*                                                                           *
+*   You should have received a copy of the GNU General Public License       *
+*   along with this program.  If not, see <https://www.gnu.org/licenses/>.  *
+*                                                                           *
+*   Unlike the rest of ChessX this file is licensed under version 3 of the  *
+*   GPL. ChessX may be distributed under any later version of the GPL, so   *
+*   a ChessX binary built with this file is distributed under version 3.    *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+#include "bitfind.h"
+#include "board.h"
+#include "qt6compat.h"
+#include "syzygy.h"
+
+using namespace chessx;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+// The file format and the encoding of the positions follow the probing code
+// of Ronald de Man. The tables and the decoding are those of Stockfish,
+// rewritten for BoardX and Qt.
+
+namespace {
+
+const int TBPieces = 7;
+
+enum TableType { WdlTable, DtzTable };
+
+enum TableFlag { FlagStm = 1, FlagMapped = 2, FlagWinPlies = 4, FlagLossPlies = 8, FlagWide = 16, FlagSingleValue = 128 };
+
+enum ProbeState
+{
+    ProbeFail = 0,
+    ProbeOk = 1,
+    /** The DTZ table stores the other side to move */
+    ProbeChangeStm = -1,
+    /** The best move zeroes the 50 move counter */
+    ProbeZeroingBestMove = 2
+};
+
+inline quint16 readLE16(const uchar* p)
+{
+    return quint16(p[0] | (p[1] << 8));
+}
+
+inline quint32 readLE32(const uchar* p)
+{
+    return quint32(p[0]) | (quint32(p[1]) << 8) | (quint32(p[2]) << 16) | (quint32(p[3]) << 24);
+}
+
+inline quint32 readBE32(const uchar* p)
+{
+    return (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | quint32(p[3]);
+}
+
+inline quint64 readBE64(const uchar* p)
+{
+    return (quint64(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+/** Huffman code and pairs of one side and one file of a table */
+struct PairsData
+{
+    quint8 flags;
+    quint8 maxSymLen;
+    quint8 minSymLen;
+    quint32 blocksNum;
+    quint64 sizeofBlock;
+    quint64 span;
+    /** Lowest symbol of each length, 16 bit little endian */
+    const uchar* lowestSym;
+    /** Left and right symbol of each symbol, 12 bits each */
+    const uchar* btree;
+    /** Number of values in each block minus one, 16 bit little endian */
+    const uchar* blockLength;
+    quint32 blockLengthSize;
+    /** Block and offset of every span-th value, 32 and 16 bit little endian */
+    const uchar* sparseIndex;
+    quint32 sparseIndexSize;
+    const uchar* data;
+    QVector<quint64> base64;
+    /** Number of values a symbol expands to minus one */
+    QVector<quint8> symlen;
+    /** Pieces in the order of the encoding */
+    int pieces[TBPieces];
+    /** Start index of each group of pieces */
+    quint64 groupIdx[TBPieces + 1];
+    /** Number of pieces of each group, zero terminated */
+    int groupLen[TBPieces + 1];
+    /** Offsets of the DTZ value maps for each result */
+    quint16 mapIdx[4];
+};
+
+/** A WDL or DTZ file of a table */
+struct TableFile
+{
+    TableFile() : base(nullptr), map(nullptr) {}
+
+    QFile file;
+    const uchar* base;
+    /** Value maps of a DTZ table */
+    const uchar* map;
+    PairsData items[2][4];
+    /** Set once the file was mapped or failed to map */
+    QAtomicInt ready;
+};
+
+/** A table for a material combination, as given by the file name */
+struct Table
+{
+    QString name;
+    /** Material with the first side as White */
+    quint64 key;
+    /** Material with the first side as Black */
+    quint64 key2;
+    int pieceCount;
+    bool hasPawns;
+    bool hasUniquePieces;
+    /** Pawns of the leading color and of the other color */
+    int pawnCount[2];
+    TableFile files[2];
+
+    int sides(TableType type) const
+    {
+        return (type == WdlTable && key != key2) ? 2 : 1;
+    }
+    PairsData* get(TableType type, int stm, int f)
+    {
+        return &files[type].items[stm % sides(type)][hasPawns ? f : 0];
+    }
+};
+
+/** Value read from a table, cached by position */
+struct CacheEntry
+{
+    quint64 key;
+    qint32 value;
+    qint32 state;
+};
+
+const int CacheSize = 1 << 16;
+
+// Tables for the encoding of the positions
+int MapPawns[64];
+int MapB1H1H7[64];
+int MapA1D1D4[64];
+int MapKK[10][64];
+int Binomial[TBPieces][64];
+int LeadPawnIdx[6][64];
+int LeadPawnsSize[6][4];
+bool s_indexReady = false;
+
+QReadWriteLock s_lock;
+QMutex s_mapMutex;
+QMutex s_cacheMutex;
+QString s_path;
+QStringList s_directories;
+QVector<Table*> s_tables;
+QHash<quint64, Table*> s_tableByKey;
+int s_maxPieces = 0;
+QVector<CacheEntry> s_cache;
+
+inline int fileOf(int s)
+{
+    return s & 7;
+}
+
+inline int rankOf(int s)
+{
+    return s >> 3;
+}
+
+inline int offA1H8(int s)
+{
+    return rankOf(s) - fileOf(s);
+}
+
+inline int edgeDistance(int f)
+{
+    return std::min(f, 7 - f);
+}
+
+inline bool pawnsComp(int i, int j)
+{
+    return MapPawns[i] < MapPawns[j];
+}
+
+/** @return the code of a piece in the tables, type P to K as 1 to 6, black adds 8 */
+inline int tablePiece(Piece p)
+{
+    return (7 - pieceType(p)) | (isBlack(p) ? 8 : 0);
+}
+
+void initIndexTables()
+{
+    int code = 0;
+    for (int s = 0; s < 64; ++s)
+    {
+        if (offA1H8(s) < 0)
+        {
+            MapB1H1H7[s] = code++;
+        }
+    }
+
+    // Squares of the a1-d1-d4 triangle, the diagonal is encoded last
+    QVector<int> diagonal;
+    code = 0;
+    for (int s = 0; s <= d4; ++s)
+    {
+        if (offA1H8(s) < 0 && fileOf(s) <= 3)
+        {
+            MapA1D1D4[s] = code++;
+        }
+        else if (!offA1H8(s) && fileOf(s) <= 3)
+        {
+            diagonal.append(s);
+        }
+    }
+    for (int s: std::as_const(diagonal))
+    {
+        MapA1D1D4[s] = code++;
+    }
+
+    // The 462 legal positions of two kings with the first in the a1-d1-d4
+    // triangle. Both kings on the diagonal are encoded last.
+    QVector<QPair<int, int> > bothOnDiagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; ++idx)
+    {
+        for (int s1 = 0; s1 <= d4; ++s1)
+        {
+            if (MapA1D1D4[s1] != idx || (!idx && s1 != b1))
+            {
+                continue;
+            }
+            for (int s2 = 0; s2 < 64; ++s2)
+            {
+                if (qAbs(fileOf(s1) - fileOf(s2)) <= 1 && qAbs(rankOf(s1) - rankOf(s2)) <= 1)
+                {
+                    continue;
+                }
+                else if (!offA1H8(s1) && offA1H8(s2) > 0)
+                {
+                    continue;
+                }
+                else if (!offA1H8(s1) && !offA1H8(s2))
+                {
+                    bothOnDiagonal.append(qMakePair(idx, s2));
+                }
+                else
+                {
+                    MapKK[idx][s2] = code++;
+                }
+            }
+        }
+    }
+    for (const QPair<int, int>& p: std::as_const(bothOnDiagonal))
+    {
+        MapKK[p.first][p.second] = code++;
+    }
+
+    Binomial[0][0] = 1;
+    for (int n = 1; n < 64; ++n)
+    {
+        for (int k = 0; k < TBPieces && k <= n; ++k)
+        {
+            Binomial[k][n] = (k > 0 ? Binomial[k - 1][n - 1] : 0) + (k < n ? Binomial[k][n - 1] : 0);
+        }
+    }
+
+    // MapPawns encodes a2-h7 so that the leading pawn, the one nearest to
+    // the edge and on the lowest rank, has the highest value
+    int availableSquares = 47;
+    for (int leadPawnsCnt = 1; leadPawnsCnt <= 5; ++leadPawnsCnt)
+    {
+        for (int f = 0; f <= 3; ++f)
+        {
+            int idx = 0;
+            for (int r = 1; r <= 6; ++r)
+            {
+                int s = 8 * r + f;
+                if (leadPawnsCnt == 1)
+                {
+                    MapPawns[s] = availableSquares--;
+                    MapPawns[s ^ 7] = availableSquares--;
+                }
+                LeadPawnIdx[leadPawnsCnt][s] = idx;
+                idx += Binomial[leadPawnsCnt - 1][MapPawns[s]];
+            }
+            LeadPawnsSize[leadPawnsCnt][f] = idx;
+        }
+    }
+}
+
+/** @return the material signature of @p code, like KRPvKR, with the first side as @p first */
+quint64 materialKey(const QString& code, Color first)
+{
+    quint64 key = 0;
+    Color color = first;
+    for (int i = 1; i < code.length(); ++i)
+    {
+        PieceType type = None;
+        switch (code[i].toLatin1())
+        {
+        case 'v': color = (color == White) ? Black : White; break;
+        case 'Q': type = Queen; break;
+        case 'R': type = Rook; break;
+        case 'B': type = Bishop; break;
+        case 'N': type = Knight; break;
+        case 'P': type = Pawn; break;
+        default: break;
+        }
+        if (type != None)
+        {
+            key += quint64(1) << BoardX::materialShift(color, type);
+        }
+    }
+    return key;
+}
+
+Table* createTable(const QString& name)
+{
+    Table* table = new Table;
+    table->name = name;
+    table->key = materialKey(name, White);
+    table->key2 = materialKey(name, Black);
+    table->pieceCount = name.length() - 1;
+    table->hasPawns = name.contains('P');
+
+    table->hasUniquePieces = false;
+    for (Color color: { White, Black })
+    {
+        for (PieceType type: { Queen, Rook, Bishop, Knight, Pawn })
+        {
+            if (BoardX::materialCount(table->key, color, type) == 1)
+            {
+                table->hasUniquePieces = true;
+            }
+        }
+    }
+
+    // The leading color is the one with fewer pawns, if both sides have pawns
+    int whitePawns = BoardX::materialCount(table->key, White, Pawn);
+    int blackPawns = BoardX::materialCount(table->key, Black, Pawn);
+    bool c = !blackPawns || (whitePawns && blackPawns >= whitePawns);
+    table->pawnCount[0] = c ? whitePawns : blackPawns;
+    table->pawnCount[1] = c ? blackPawns : whitePawns;
+    return table;
+}
+
+void setGroups(Table* table, PairsData* d, const int order[2], int f)
+{
+    int n = 0;
+    int firstLen = table->hasPawns ? 0 : table->hasUniquePieces ? 3 : 2;
+    d->groupLen[n] = 1;
+
+    // Pieces of a group are consecutive and equal, the first group holds
+    // the leading pawns, the kings or three unique pieces
+    for (int i = 1; i < table->pieceCount; ++i)
+    {
+        if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1])
+        {
+            d->groupLen[n]++;
+        }
+        else
+        {
+            d->groupLen[++n] = 1;
+        }
+    }
+    d->groupLen[++n] = 0;
+
+    // The groups are encoded in the order given by the file, the leading
+    // group at order[0] and the remaining pawns at order[1]
+    bool pp = table->hasPawns && table->pawnCount[1];
+    int next = pp ? 2 : 1;
+    int freeSquares = 64 - d->groupLen[0] - (pp ? d->groupLen[1] : 0);
+    quint64 idx = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; ++k)
+    {
+        if (k == order[0])
+        {
+            d->groupIdx[0] = idx;
+            idx *= table->hasPawns ? LeadPawnsSize[d->groupLen[0]][f]
+                   : table->hasUniquePieces ? 31332 : 462;
+        }
+        else if (k == order[1])
+        {
+            d->groupIdx[1] = idx;
+            idx *= Binomial[d->groupLen[1]][48 - d->groupLen[0]];
+        }
+        else
+        {
+            d->groupIdx[next] = idx;
+            idx *= Binomial[d->groupLen[next]][freeSquares];
+            freeSquares -= d->groupLen[next++];
+        }
+    }
+    d->groupIdx[n] = idx;
+}
+
+quint8 setSymLen(PairsData* d, int s, QVector<bool>& visited)
+{
+    visited[s] = true;
+    const uchar* lr = d->btree + 3 * s;
+    int sr = (lr[2] << 4) | (lr[1] >> 4);
+    if (sr == 0xFFF)
+    {
+        return 0;
+    }
+    int sl = ((lr[1] & 0xF) << 8) | lr[0];
+    if (!visited[sl])
+    {
+        d->symlen[sl] = setSymLen(d, sl, visited);
+    }
+    if (!visited[sr])
+    {
+        d->symlen[sr] = setSymLen(d, sr, visited);
+    }
+    return quint8(d->symlen[sl] + d->symlen[sr] + 1);
+}
+
+const uchar* setSizes(PairsData* d, const uchar* data)
+{
+    d->flags = *data++;
+    if (d->flags & FlagSingleValue)
+    {
+        d->blocksNum = d->blockLengthSize = 0;
+        d->span = d->sparseIndexSize = 0;
+        d->minSymLen = *data++; // The single value
+        return data;
+    }
+
+    int groups = int(std::find(d->groupLen, d->groupLen + TBPieces, 0) - d->groupLen);
+    quint64 tbSize = d->groupIdx[groups];
+
+    d->sizeofBlock = quint64(1) << *data++;
+    d->span = quint64(1) << *data++;
+    d->sparseIndexSize = quint32((tbSize + d->span - 1) / d->span);
+    int padding = *data++;
+    d->blocksNum = readLE32(data);
+    data += 4;
+    d->blockLengthSize = d->blocksNum + padding;
+    d->maxSymLen = *data++;
+    d->minSymLen = *data++;
+    d->lowestSym = data;
+    d->base64.fill(0, d->maxSymLen - d->minSymLen + 1);
+
+    // Canonical Huffman code: longer codes have lower values, base64 holds
+    // the lowest code of each length left aligned in 64 bits
+    for (int i = d->base64.size() - 2; i >= 0; --i)
+    {
+        d->base64[i] = (d->base64[i + 1] + readLE16(d->lowestSym + 2 * i)
+                        - readLE16(d->lowestSym + 2 * (i + 1))) / 2;
+    }
+    for (int i = 0; i < d->base64.size(); ++i)
+    {
+        d->base64[i] <<= 64 - i - d->minSymLen;
+    }
+
+    data += d->base64.size() * 2;
+    int symbols = readLE16(data);
+    data += 2;
+    d->btree = data;
+    d->symlen.fill(0, symbols);
+
+    // Each symbol expands recursively into a pair of symbols
+    QVector<bool> visited(symbols, false);
+    for (int s = 0; s < symbols; ++s)
+    {
+        if (!visited[s])
+        {
+            d->symlen[s] = setSymLen(d, s, visited);
+        }
+    }
+    return data + 3 * symbols + (symbols & 1);
+}
+
+const uchar* setDtzMap(Table* table, const uchar* base, const uchar* data, int maxFile)
+{
+    TableFile& tf = table->files[DtzTable];
+    tf.map = data;
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        PairsData* d = table->get(DtzTable, 0, f);
+        if (d->flags & FlagMapped)
+        {
+            if (d->flags & FlagWide)
+            {
+                data += (data - base) & 1;
+                for (int i = 0; i < 4; ++i)
+                {
+                    d->mapIdx[i] = quint16((data - tf.map) / 2 + 1);
+                    data += 2 * readLE16(data) + 2;
+                }
+            }
+            else
+            {
+                for (int i = 0; i < 4; ++i)
+                {
+                    d->mapIdx[i] = quint16(data - tf.map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+    }
+    return data + ((data - base) & 1);
+}
+
+/** Read the layout of a table from the mapped file @p base, starting after the magic number */
+void setupTable(Table* table, TableType type, const uchar* base)
+{
+    const uchar* data = base + 4;
+    TableFile& tf = table->files[type];
+    data++; // Flags
+
+    int sides = table->sides(type);
+    int maxFile = table->hasPawns ? 3 : 0;
+    bool pp = table->hasPawns && table->pawnCount[1];
+
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        for (int i = 0; i < sides; ++i)
+        {
+            tf.items[i][f] = PairsData();
+        }
+        int order[2][2] = { { *data & 0xF, pp ? *(data + 1) & 0xF : 0xF },
+                            { *data >> 4, pp ? *(data + 1) >> 4 : 0xF } };
+        data += 1 + pp;
+
+        for (int k = 0; k < table->pieceCount; ++k, ++data)
+        {
+            for (int i = 0; i < sides; ++i)
+            {
+                tf.items[i][f].pieces[k] = i ? *data >> 4 : *data & 0xF;
+            }
+        }
+        for (int i = 0; i < sides; ++i)
+        {
+            setGroups(table, &tf.items[i][f], order[i], f);
+        }
+    }
+
+    data += (data - base) & 1;
+
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        for (int i = 0; i < sides; ++i)
+        {
+            data = setSizes(&tf.items[i][f], data);
+        }
+    }
+
+    if (type == DtzTable)
+    {
+        data = setDtzMap(table, base, data, maxFile);
+    }
+
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        for (int i = 0; i < sides; ++i)
+        {
+            PairsData* d = &tf.items[i][f];
+            d->sparseIndex = data;
+            data += d->sparseIndexSize * 6;
+        }
+    }
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        for (int i = 0; i < sides; ++i)
+        {
+            PairsData* d = &tf.items[i][f];
+            d->blockLength = data;
+            data += d->blockLengthSize * 2;
+        }
+    }
+    for (int f = 0; f <= maxFile; ++f)
+    {
+        for (int i = 0; i < sides; ++i)
+        {
+            PairsData* d = &tf.items[i][f];
+            data = base + (((data - base) + 0x3F) & ~0x3F);
+            d->data = data;
+            data += d->blocksNum * d->sizeofBlock;
+        }
+    }
+}
+
+/** Map the file of @p type of @p table on first use, returns false if it is not available */
+bool mapTable(Table* table, TableType type)
+{
+    TableFile& tf = table->files[type];
+    if (tf.ready.loadAcquire())
+    {
+        return tf.base;
+    }
+
+    QMutexLocker locker(&s_mapMutex);
+    if (tf.ready.loadAcquire())
+    {
+        return tf.base;
+    }
+
+    static const uchar Magic[2][4] = { { 0x71, 0xE8, 0x23, 0x5D }, { 0xD7, 0x66, 0x0C, 0xA5 } };
+    QString name = table->name + ((type == WdlTable) ? ".rtbw" : ".rtbz");
+    for (const QString& directory: std::as_const(s_directories))
+    {
+        tf.file.setFileName(QDir(directory).filePath(name));
+        if (tf.file.open(QIODevice::ReadOnly))
+        {
+            break;
+        }
+    }
+    if (tf.file.isOpen())
+    {
+        qint64 size = tf.file.size();
+        const uchar* base = (size % 64 == 16) ? tf.file.map(0, size) : nullptr;
+        if (base && !memcmp(base, Magic[type], 4))
+        {
+            setupTable(table, type, base);
+            tf.base = base;
+        }
+        else
+        {
+            tf.file.close();
+        }
+    }
+    tf.ready.storeRelease(1);
+    return tf.base;
+}
+
+/** Decode the value at @p idx */
+int decompressPairs(PairsData* d, quint64 idx)
+{
+    if (d->flags & FlagSingleValue)
+    {
+        return d->minSymLen;
+    }
+
+    // The sparse index gives the block and the offset of every span-th value,
+    // from there the blocks are walked to the one holding idx
+    quint32 k = quint32(idx / d->span);
+    quint32 block = readLE32(d->sparseIndex + 6 * k);
+    int offset = readLE16(d->sparseIndex + 6 * k + 4);
+    offset += int(idx % d->span) - int(d->span / 2);
+
+    while (offset < 0)
+    {
+        offset += readLE16(d->blockLength + 2 * --block) + 1;
+    }
+    while (offset > readLE16(d->blockLength + 2 * block))
+    {
+        offset -= readLE16(d->blockLength + 2 * block++) + 1;
+    }
+
+    const uchar* ptr = d->data + block * d->sizeofBlock;
+    quint64 buf64 = readBE64(ptr);
+    ptr += 8;
+    int buf64Size = 64;
+    int sym;
+
+    while (true)
+    {
+        int len = 0;
+        while (buf64 < d->base64[len])
+        {
+            ++len;
+        }
+        sym = int((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+        sym += readLE16(d->lowestSym + 2 * len);
+
+        if (offset < d->symlen[sym] + 1)
+        {
+            break;
+        }
+        offset -= d->symlen[sym] + 1;
+        len += d->minSymLen;
+        buf64 <<= len;
+        buf64Size -= len;
+        if (buf64Size <= 32)
+        {
+            buf64Size += 32;
+            buf64 |= quint64(readBE32(ptr)) << (64 - buf64Size);
+            ptr += 4;
+        }
+    }
+
+    // Expand the symbol down to the value at offset
+    while (d->symlen[sym])
+    {
+        const uchar* lr = d->btree + 3 * sym;
+        int left = ((lr[1] & 0xF) << 8) | lr[0];
+        if (offset < d->symlen[left] + 1)
+        {
+            sym = left;
+        }
+        else
+        {
+            offset -= d->symlen[left] + 1;
+            sym = (lr[2] << 4) | (lr[1] >> 4);
+        }
+    }
+    const uchar* lr = d->btree + 3 * sym;
+    return ((lr[1] & 0xF) << 8) | lr[0];
+}
+
+int mapScore(Table* table, TableType type, int f, int value, int wdl)
+{
+    if (type == WdlTable)
+    {
+        return value - 2;
+    }
+
+    static const int WdlMap[] = { 1, 3, 0, 2, 0 };
+    PairsData* d = table->get(DtzTable, 0, f);
+    const uchar* map = table->files[DtzTable].map;
+    if (d->flags & FlagMapped)
+    {
+        int idx = d->mapIdx[WdlMap[wdl + 2]] + value;
+        value = (d->flags & FlagWide) ? readLE16(map + 2 * idx) : map[idx];
+    }
+
+    // DTZ is stored in moves or in plies, it is returned in plies
+    if ((wdl == Syzygy::Win && !(d->flags & FlagWinPlies)) ||
+        (wdl == Syzygy::Loss && !(d->flags & FlagLossPlies)) ||
+        wdl == Syzygy::CursedWin || wdl == Syzygy::BlessedLoss)
+    {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+/** Read the value of @p board from the file of @p type of @p table */
+int readTable(const BoardX& board, Table* table, TableType type, int wdl, ProbeState& state)
+{
+    int squares[TBPieces];
+    int pieces[TBPieces];
+    int size = 0;
+    int leadPawnsCnt = 0;
+    quint64 leadPawns = 0;
+    int tbFile = 0;
+
+    // Tables are stored with the stronger side as White, and symmetric
+    // tables with White to move only
+    bool symmetricBlackToMove = (table->key == table->key2 && board.toMove() == Black);
+    bool blackStronger = (board.materialSignature() != table->key);
+    int flip = (symmetricBlackToMove || blackStronger) ? 1 : 0;
+    int flipColor = flip * 8;
+    int flipSquares = flip * 56;
+    int stm = flip ^ (board.toMove() == Black ? 1 : 0);
+
+    if (table->hasPawns)
+    {
+        int pc = table->files[type].items[0][0].pieces[0] ^ flipColor;
+        leadPawns = board.pieces((pc & 8) ? Black : White, Pawn);
+        quint64 b = leadPawns;
+        while (b)
+        {
+            squares[size++] = getFirstBitAndClear64<int>(b) ^ flipSquares;
+        }
+        leadPawnsCnt = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawnsCnt, pawnsComp));
+        tbFile = edgeDistance(fileOf(squares[0]));
+    }
+
+    // DTZ tables store one side to move only
+    if (type == DtzTable)
+    {
+        int flags = table->get(DtzTable, stm, tbFile)->flags;
+        if ((flags & FlagStm) != stm && !(table->key == table->key2 && !table->hasPawns))
+        {
+            state = ProbeChangeStm;
+            return 0;
+        }
+    }
+
+    for (int s = 0; s < 64; ++s)
+    {
+        Piece p = board.pieceAt(Square(s));
+        if (p == Empty || (leadPawns & (quint64(1) << s)))
+        {
+            continue;
+        }
+        if (size == TBPieces)
+        {
+            state = ProbeFail;
+            return 0;
+        }
+        squares[size] = s ^ flipSquares;
+        pieces[size++] = tablePiece(p) ^ flipColor;
+    }
+
+    PairsData* d = table->get(type, stm, tbFile);
+
+    // Order the pieces as the table does
+    for (int i = leadPawnsCnt; i < size - 1; ++i)
+    {
+        for (int j = i + 1; j < size; ++j)
+        {
+            if (d->pieces[i] == pieces[j])
+            {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // The leading piece is mapped to the a-d files
+    if (fileOf(squares[0]) > 3)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            squares[i] ^= 7;
+        }
+    }
+
+    quint64 idx;
+    if (table->hasPawns)
+    {
+        idx = LeadPawnIdx[leadPawnsCnt][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawnsCnt, pawnsComp);
+        for (int i = 1; i < leadPawnsCnt; ++i)
+        {
+            idx += Binomial[i][MapPawns[squares[i]]];
+        }
+    }
+    else
+    {
+        // Without pawns the leading piece is mapped to the a1-d1-d4 triangle
+        if (rankOf(squares[0]) > 3)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                squares[i] ^= 56;
+            }
+        }
+        for (int i = 0; i < d->groupLen[0]; ++i)
+        {
+            if (!offA1H8(squares[i]))
+            {
+                continue;
+            }
+            if (offA1H8(squares[i]) > 0)
+            {
+                for (int j = i; j < size; ++j)
+                {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (table->hasUniquePieces)
+        {
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0]))
+            {
+                idx = (MapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            }
+            else if (offA1H8(squares[1]))
+            {
+                idx = (6 * 63 + rankOf(squares[0]) * 28 + MapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            }
+            else if (offA1H8(squares[2]))
+            {
+                idx = 6 * 63 * 62 + 4 * 28 * 62
+                      + rankOf(squares[0]) * 7 * 28
+                      + (rankOf(squares[1]) - adjust1) * 28
+                      + MapB1H1H7[squares[2]];
+            }
+            else
+            {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28
+                      + rankOf(squares[0]) * 7 * 6
+                      + (rankOf(squares[1]) - adjust1) * 6
+                      + (rankOf(squares[2]) - adjust2);
+            }
+        }
+        else
+        {
+            idx = MapKK[MapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // The remaining groups are encoded as combinations of the free squares
+    idx *= d->groupIdx[0];
+    int* groupSq = squares + d->groupLen[0];
+    bool remainingPawns = table->hasPawns && table->pawnCount[1];
+    int next = 0;
+    while (d->groupLen[++next])
+    {
+        std::stable_sort(groupSq, groupSq + d->groupLen[next]);
+        quint64 n = 0;
+        for (int i = 0; i < d->groupLen[next]; ++i)
+        {
+            int adjust = int(std::count_if(squares, groupSq, [&](int s) { return groupSq[i] > s; }));
+            n += Binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        idx += n * d->groupIdx[next];
+        groupSq += d->groupLen[next];
+    }
+
+    state = ProbeOk;
+    return mapScore(table, type, tbFile, decompressPairs(d, idx), wdl);
+}
+
+bool isKingsOnly(const BoardX& board)
+{
+    return board.materialSignature() == 0;
+}
+
+int probeTable(const BoardX& board, TableType type, int wdl, ProbeState& state)
+{
+    if (isKingsOnly(board))
+    {
+        state = ProbeOk;
+        return Syzygy::Draw;
+    }
+
+    quint64 key = board.getHashValue() ^ ((type == DtzTable) ? Q_UINT64_C(0x9E3779B97F4A7C15) : 0);
+    int slot = int(key & (CacheSize - 1));
+    {
+        QMutexLocker locker(&s_cacheMutex);
+        const CacheEntry& entry = s_cache.at(slot);
+        if (entry.key == key && entry.state != ProbeFail)
+        {
+            state = ProbeState(entry.state);
+            return entry.value;
+        }
+    }
+
+    Table* table = s_tableByKey.value(board.materialSignature());
+    if (!table || !mapTable(table, type))
+    {
+        state = ProbeFail;
+        return 0;
+    }
+    int value = readTable(board, table, type, wdl, state);
+    if (state != ProbeFail)
+    {
+        QMutexLocker locker(&s_cacheMutex);
+        s_cache[slot] = CacheEntry{ key, value, state };
+    }
+    return value;
+}
+
+Move::List legalMoves(const BoardX& board)
+{
+    Move::List moves = board.generateMoves();
+    Move::List legal;
+    for (const Move& m: std::as_const(moves))
+    {
+        BoardX next(board);
+        next.doMove(m);
+        if (!next.isAttackedBy(next.toMove(), next.kingSquare(board.toMove())))
+        {
+            legal.append(m);
+        }
+    }
+    return legal;
+}
+
+bool isZeroing(const Move& m)
+{
+    return m.isCapture() || pieceType(m.pieceMoved()) == Pawn;
+}
+
+/** Search the captures, and pawn moves if @p zeroingMoves is set, as the
+    tables do not store positions whose best move is one of them */
+int search(const BoardX& board, bool zeroingMoves, ProbeState& state)
+{
+    int bestValue = Syzygy::Loss;
+    int value;
+    Move::List moves = legalMoves(board);
+    int moveCount = 0;
+
+    for (const Move& m: std::as_const(moves))
+    {
+        if (!m.isCapture() && (!zeroingMoves || pieceType(m.pieceMoved()) != Pawn))
+        {
+            continue;
+        }
+        ++moveCount;
+
+        BoardX next(board);
+        next.doMove(m);
+        value = -search(next, false, state);
+        if (state == ProbeFail)
+        {
+            return Syzygy::Draw;
+        }
+        if (value > bestValue)
+        {
+            bestValue = value;
+            if (value >= Syzygy::Win)
+            {
+                state = ProbeZeroingBestMove;
+                return value;
+            }
+        }
+    }
+
+    // If all moves were searched the table is not needed, it may even be
+    // wrong, as it does not know about en passant captures
+    bool noMoreMoves = (moveCount && moveCount == moves.count());
+    if (noMoreMoves)
+    {
+        value = bestValue;
+    }
+    else
+    {
+        value = probeTable(board, WdlTable, Syzygy::Draw, state);
+        if (state == ProbeFail)
+        {
+            return Syzygy::Draw;
+        }
+    }
+
+    if (bestValue >= value)
+    {
+        state = (bestValue > Syzygy::Draw || noMoreMoves) ? ProbeZeroingBestMove : ProbeOk;
+        return bestValue;
+    }
+    state = ProbeOk;
+    return value;
+}
+
+int dtzBeforeZeroing(int wdl)
+{
+    return wdl == Syzygy::Win ? 1 :
+           wdl == Syzygy::CursedWin ? 101 :
+           wdl == Syzygy::BlessedLoss ? -101 :
+           wdl == Syzygy::Loss ? -1 : 0;
+}
+
+inline int signOf(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+int probeDtz(const BoardX& board, ProbeState& state)
+{
+    state = ProbeOk;
+    int wdl = search(board, true, state);
+    if (state == ProbeFail || wdl == Syzygy::Draw)
+    {
+        return 0;
+    }
+    if (state == ProbeZeroingBestMove)
+    {
+        return dtzBeforeZeroing(wdl);
+    }
+
+    int dtz = probeTable(board, DtzTable, wdl, state);
+    if (state == ProbeFail)
+    {
+        return 0;
+    }
+    if (state != ProbeChangeStm)
+    {
+        return (dtz + 100 * (wdl == Syzygy::BlessedLoss || wdl == Syzygy::CursedWin)) * signOf(wdl);
+    }
+
+    // The table stores the other side to move, find the best move by a 1 ply search
+    int minDtz = 0xFFFF;
+    Move::List moves = legalMoves(board);
+    for (const Move& m: std::as_const(moves))
+    {
+        bool zeroing = isZeroing(m);
+        BoardX next(board);
+        next.doMove(m);
+
+        // For zeroing moves the DTZ before the move is wanted, the search
+        // tells whether the move wins at all
+        dtz = zeroing ? -dtzBeforeZeroing(search(next, false, state))
+              : -probeDtz(next, state);
+        if (state == ProbeFail)
+        {
+            return 0;
+        }
+        if (dtz == 1 && next.kingInCheck() != InvalidSquare && legalMoves(next).isEmpty())
+        {
+            minDtz = 1;
+        }
+        if (!zeroing)
+        {
+            dtz += signOf(dtz);
+        }
+        if (dtz < minDtz && signOf(dtz) == signOf(wdl))
+        {
+            minDtz = dtz;
+        }
+    }
+    return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+/** @return true if @p board can be found in the tables at all */
+bool isProbeable(const BoardX& board)
+{
+    if (board.chess960() || board.castlingRights())
+    {
+        return false;
+    }
+    int pieces = 2;
+    quint64 signature = board.materialSignature();
+    for (Color color: { White, Black })
+    {
+        for (PieceType type: { Queen, Rook, Bishop, Knight, Pawn })
+        {
+            pieces += BoardX::materialCount(signature, color, type);
+        }
+    }
+    return pieces == 2 || (pieces <= s_maxPieces && s_tableByKey.contains(signature));
+}
+
+/** Rank of a root move with distance @p dtz, taking the 50 move rule into account */
+int rootRank(int dtz, int halfMoves)
+{
+    if (dtz > 0)
+    {
+        return ((dtz + halfMoves <= 100) ? (1 << 17) : (1 << 16)) - dtz;
+    }
+    if (dtz < 0)
+    {
+        return ((-dtz + halfMoves <= 100) ? -(1 << 17) : -(1 << 16)) - dtz;
+    }
+    return 0;
+}
+
+} // namespace
+
+void Syzygy::setPath(const QString& path)
+{
+    QWriteLocker locker(&s_lock);
+    if (!s_indexReady)
+    {
+        initIndexTables();
+        s_indexReady = true;
+    }
+
+    qDeleteAll(s_tables);
+    s_tables.clear();
+    s_tableByKey.clear();
+    s_maxPieces = 0;
+    s_path = path;
+    s_directories.clear();
+    s_cache.fill(CacheEntry{ 0, 0, ProbeFail }, CacheSize);
+
+    static const QRegularExpression tableName("^K[QRBNP]*vK[QRBNP]*$");
+    const QStringList directories = path.split(QDir::listSeparator(), SkipEmptyParts);
+    for (const QString& directory: directories)
+    {
+        QDir dir(directory);
+        if (!dir.exists())
+        {
+            continue;
+        }
+        s_directories.append(dir.absolutePath());
+        const QStringList files = dir.entryList(QStringList() << "*.rtbw", QDir::Files);
+        for (const QString& file: files)
+        {
+            QString name = QFileInfo(file).completeBaseName();
+            if (!tableName.match(name).hasMatch() || name.length() - 1 > TBPieces)
+            {
+                continue;
+            }
+            Table* table = createTable(name);
+            if (s_tableByKey.contains(table->key))
+            {
+                delete table;
+                continue;
+            }
+            s_tables.append(table);
+            s_tableByKey.insert(table->key, table);
+            s_tableByKey.insert(table->key2, table);
+            s_maxPieces = std::max(s_maxPieces, table->pieceCount);
+        }
+    }
+}
+
+QString Syzygy::path()
+{
+    QReadLocker locker(&s_lock);
+    return s_path;
+}
+
+int Syzygy::maxPieces()
+{
+    QReadLocker locker(&s_lock);
+    return s_maxPieces;
+}
+
+bool Syzygy::canProbe(const BoardX& board)
+{
+    QReadLocker locker(&s_lock);
+    return s_indexReady && isProbeable(board);
+}
+
+bool Syzygy::probeWdl(const BoardX& board, Wdl& wdl)
+{
+    QReadLocker locker(&s_lock);
+    if (!s_indexReady || !isProbeable(board))
+    {
+        return false;
+    }
+    ProbeState state = ProbeOk;
+    wdl = Wdl(search(board, false, state));
+    return state != ProbeFail;
+}
+
+bool Syzygy::probeDtz(const BoardX& board, int& dtz)
+{
+    QReadLocker locker(&s_lock);
+    if (!s_indexReady || !isProbeable(board))
+    {
+        return false;
+    }
+    ProbeState state = ProbeOk;
+    dtz = ::probeDtz(board, state);
+    return state != ProbeFail;
+}
+
+bool Syzygy::probeRoot(const BoardX& board, QList<Move>& bestMoves, int& dtz)
+{
+    QReadLocker locker(&s_lock);
+    bestMoves.clear();
+    dtz = 0;
+    if (!s_indexReady || !isProbeable(board))
+    {
+        return false;
+    }
+
+    int halfMoves = int(board.halfMoveClock());
+    int bestRank = 0;
+    const Move::List moves = legalMoves(board);
+    for (const Move& m: moves)
+    {
+        BoardX next(board);
+        next.doMove(m);
+
+        ProbeState state = ProbeOk;
+        int moveDtz;
+        if (isZeroing(m))
+        {
+            moveDtz = dtzBeforeZeroing(-search(next, false, state));
+        }
+        else
+        {
+            moveDtz = -::probeDtz(next, state);
+            moveDtz += signOf(moveDtz);
+        }
+        if (state == ProbeFail)
+        {
+            bestMoves.clear();
+            return false;
+        }
+        if (moveDtz == 2 && next.kingInCheck() != InvalidSquare && legalMoves(next).isEmpty())
+        {
+            moveDtz = 1;
+        }
+
+        int rank = rootRank(moveDtz, halfMoves);
+        if (bestMoves.isEmpty() || rank > bestRank)
+        {
+            bestMoves.clear();
+            bestRank = rank;
+            // Wins and losses spoiled by the 50 move rule are draws
+            dtz = (qAbs(rank) > (1 << 16)) ? moveDtz : 0;
+        }
+        if (rank == bestRank)
+        {
+            bestMoves.append(m);
+        }
+    }
+    return !bestMoves.isEmpty();
+}
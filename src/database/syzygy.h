@@ -0,0 +1,55 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef SYZYGY_H
+#define SYZYGY_H
+
+#include <QList>
+#include <QString>
+
+#include "move.h"
+
+class BoardX;
+
+/** @ingroup Feature
+ * The Syzygy class probes Syzygy WDL and DTZ tablebase files on disk.
+ *
+ * The files are memory mapped when a position first needs them and are
+ * shared by all threads. The values read from the tables are kept in a
+ * small cache shared by all callers, as the searches over captures and
+ * the root moves probe the same positions again and again.
+ *
+ * Positions with castling rights and Chess960 positions are not probed.
+ *
+ * The implementation is adapted from Stockfish and licensed under version 3
+ * of the GPL, see syzygy.cpp.
+ */
+class Syzygy
+{
+public:
+    /** Result for the side to move, a cursed win or blessed loss is a draw by the 50 move rule */
+    enum Wdl { Loss = -2, BlessedLoss = -1, Draw = 0, CursedWin = 1, Win = 2 };
+
+    /** Use the tables in the directories of @p path, separated by QDir::listSeparator().
+        Tables already mapped are released. */
+    static void setPath(const QString& path);
+    /** @return the path set by setPath() */
+    static QString path();
+    /** @return the largest number of pieces of the tables found, 0 if there are none */
+    static int maxPieces();
+
+    /** @return true if there is a table for the material of @p board */
+    static bool canProbe(const BoardX& board);
+    /** Probe the result of @p board into @p wdl, returns false if the tables do not tell */
+    static bool probeWdl(const BoardX& board, Wdl& wdl);
+    /** Probe the distance to the next capture or pawn move in plies into @p dtz,
+        positive if the side to move wins, 0 for draws. Returns false if the tables do not tell */
+    static bool probeDtz(const BoardX& board, int& dtz);
+    /** Find the best moves of @p board, taking the 50 move rule into account.
+        @p dtz is set to the distance of the best moves, 0 if they draw.
+        @return false if the tables do not tell */
+    static bool probeRoot(const BoardX& board, QList<Move>& bestMoves, int& dtz);
+};
+
+#endif // SYZYGY_H
@@ -8,9 +8,11 @@
  *   (at your option) any later version.                                   *
  ***************************************************************************/
 
+#include "board.h"
 #include "networkhelper.h"
 #include "qt6compat.h"
 #include "settings.h"
+#include "syzygy.h"
 #include "tablebase.h"
 #include "version.h"
 
@@ -23,6 +25,7 @@
 #include <QRegularExpression>
 #include <QStringList>
 #include <QTimer>
+#include <QtConcurrent/QtConcurrent>
 #include <QUrl>
 #include <QJsonDocument>
 
@@ -258,3 +261,75 @@ void OnlineTablebase::httpDone(QNetworkReply *reply)
     reply->deleteLater();
 }
 
+
+SyzygyTablebase::SyzygyTablebase()
+{
+    connect(&m_watcher, SIGNAL(finished()), SLOT(probeDone()));
+}
+
+SyzygyTablebase::~SyzygyTablebase()
+{
+    m_watcher.waitForFinished();
+}
+
+SyzygyTablebase::Result SyzygyTablebase::probe(const QString& path, const QString& fen)
+{
+    // Only one lookup runs at a time, so the tables are not changed during a probe
+    if (path != Syzygy::path())
+    {
+        Syzygy::setPath(path);
+    }
+    Result result;
+    result.fen = fen;
+    BoardX board;
+    if (board.fromFen(fen) && Syzygy::maxPieces() && Syzygy::canProbe(board))
+    {
+        result.found = Syzygy::probeRoot(board, result.bestMoves, result.dtz);
+    }
+    return result;
+}
+
+void SyzygyTablebase::startProbe()
+{
+    QString path = AppSettings->getValue("/General/syzygyPath").toString();
+    QString fen = m_fen;
+    m_watcher.setFuture(QtConcurrent::run([path, fen]() { return probe(path, fen); }));
+}
+
+void SyzygyTablebase::probeDone()
+{
+    Result result = m_watcher.result();
+    if (m_fen.isEmpty())
+    {
+        return;
+    }
+    if (result.fen != m_fen)
+    {
+        // The position was changed meanwhile
+        startProbe();
+        return;
+    }
+    m_fen.clear();
+    if (!result.found)
+    {
+        emit notFound(result.fen);
+    }
+    else if (s_allowEngineOutput)
+    {
+        emit bestMove(result.bestMoves, result.dtz);
+    }
+}
+
+void SyzygyTablebase::abortLookup()
+{
+    m_fen.clear();
+}
+
+void SyzygyTablebase::getBestMove(QString fen)
+{
+    m_fen = fen;
+    if (!m_watcher.isRunning())
+    {
+        startProbe();
+    }
+}
@@ -11,18 +11,19 @@
 #ifndef TABLEBASE_H_INCLUDED
 #define TABLEBASE_H_INCLUDED
 
+#include <QFutureWatcher>
 #include <QNetworkAccessManager>
 #include <QString>
 
 #include "move.h"
 
+class BoardX;
 class QNetworkReply;
 
 /** @ingroup Feature
  * Abstract base class for different types of tablebase access
  *
  * @todo
- * - Subclass to support local tablebases
  * - Add caching and/or prefetching of online queries to reduce lag
  */
 class Tablebase : public QObject
@@ -68,4 +69,44 @@ private:
     QString m_fen;
 };
 
+/** @ingroup Feature
+ * Implement Tablebase access to local Syzygy tablebases.
+ *
+ * The tables are read from the directories set in the preferences. The
+ * lookup is done on a worker thread, as reading the tables may take a while,
+ * only the last requested position is answered.
+ */
+class SyzygyTablebase : public Tablebase
+{
+    Q_OBJECT
+public:
+    SyzygyTablebase();
+    ~SyzygyTablebase();
+signals:
+    void bestMove(QList<Move> bestMoves, int score);
+    /** Emitted if the local tables cannot answer the lookup of @p fen, e.g. if a table is missing */
+    void notFound(QString fen);
+public slots:
+    void getBestMove(QString fen);
+    void abortLookup();
+private slots:
+    void probeDone();
+private:
+    /** Outcome of the lookup of a position */
+    struct Result
+    {
+        QString fen;
+        bool found {false};
+        QList<Move> bestMoves;
+        int dtz {0};
+    };
+    /** Look up @p fen in the tables of @p path, runs on the worker thread */
+    static Result probe(const QString& path, const QString& fen);
+    void startProbe();
+
+    QFutureWatcher<Result> m_watcher;
+    /** Position waiting for an answer, empty if none */
+    QString m_fen;
+};
+
 #endif // TABLEBASE_H_INCLUDED
@@ -0,0 +1,594 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tagcolumns.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define DEBUG_NEW new( _NORMAL_BLOCK, __FILE__, __LINE__ )
+#define new DEBUG_NEW
+#endif // _MSC_VER
+
+/** A sparse column is converted to a dense one once it holds more than
+    this many values and more than 1/8th of the games */
+#define MIN_DENSE_VALUES 256
+
+TagColumns::TagColumns() : m_count(0), m_mapped(false)
+{
+}
+
+void TagColumns::resize(int count)
+{
+    detach();
+    if (count < m_count)
+    {
+        for (int t = 0; t < m_dense.count(); ++t)
+        {
+            if (isDense(t) && m_dense[t].values.count() > count)
+            {
+                m_dense[t].values.resize(count);
+                m_dense[t].present.resize(count);
+            }
+        }
+        for (auto& sparse: m_sparse)
+        {
+            for (auto it = sparse.begin(); it != sparse.end(); )
+            {
+                if ((int)it.key() >= count)
+                {
+                    it = sparse.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+    }
+    m_count = count;
+}
+
+void TagColumns::reserve(int count)
+{
+    detach();
+    for (int t = 0; t < m_dense.count(); ++t)
+    {
+        if (isDense(t))
+        {
+            m_dense[t].values.reserve(count);
+        }
+    }
+}
+
+void TagColumns::squeeze()
+{
+    if (m_mapped)
+    {
+        return;
+    }
+    for (int t = 0; t < m_dense.count(); ++t)
+    {
+        if (isDense(t))
+        {
+            DenseColumn& column = m_dense[t];
+            if (column.values.count() < m_count)
+            {
+                column.present.resize(m_count);
+                column.values.resize(m_count);
+            }
+            column.values.squeeze();
+        }
+        else
+        {
+            m_sparse[t].squeeze();
+        }
+    }
+}
+
+void TagColumns::clear()
+{
+    m_count = 0;
+    m_dense.clear();
+    m_sparse.clear();
+    m_isDense.clear();
+    m_mappedColumns.clear();
+    m_mapped = false;
+}
+
+inline bool TagColumns::isDense(TagIndex tagIndex) const
+{
+    return (int)tagIndex < m_isDense.size() && m_isDense.testBit(tagIndex);
+}
+
+void TagColumns::growColumn(DenseColumn& column, GameId gameId)
+{
+    int size = qMax((int)gameId + 1, m_count);
+    if (column.values.capacity() < size)
+    {
+        column.values.reserve(qMax(size, 2 * column.values.capacity()));
+    }
+    column.values.resize(size);
+    column.present.resize(size);
+}
+
+void TagColumns::makeDense(TagIndex tagIndex)
+{
+    DenseColumn& column = m_dense[tagIndex];
+    column.values.fill(0, m_count);
+    column.present.resize(m_count);
+    column.present.fill(false);
+    SparseColumn& sparse = m_sparse[tagIndex];
+    for (auto it = sparse.cbegin(); it != sparse.cend(); ++it)
+    {
+        column.values[it.key()] = it.value();
+        column.present.setBit(it.key());
+    }
+    sparse = SparseColumn();
+    m_isDense.setBit(tagIndex);
+}
+
+void TagColumns::set(GameId gameId, TagIndex tagIndex, ValueIndex valueIndex)
+{
+    detach();
+    if ((int)gameId >= m_count)
+    {
+        m_count = gameId + 1;
+    }
+    if ((int)tagIndex >= m_dense.count())
+    {
+        m_dense.resize(tagIndex + 1);
+        m_sparse.resize(tagIndex + 1);
+        m_isDense.resize(tagIndex + 1);
+    }
+
+    if (!isDense(tagIndex))
+    {
+        SparseColumn& sparse = m_sparse[tagIndex];
+        sparse[gameId] = valueIndex;
+        if (sparse.count() <= MIN_DENSE_VALUES || sparse.count() <= m_count / 8)
+        {
+            return;
+        }
+        makeDense(tagIndex);
+    }
+
+    DenseColumn& column = m_dense[tagIndex];
+    if ((int)gameId >= column.values.count())
+    {
+        growColumn(column, gameId);
+    }
+    column.values[gameId] = valueIndex;
+    column.present.setBit(gameId);
+}
+
+void TagColumns::remove(GameId gameId, TagIndex tagIndex)
+{
+    detach();
+    if (isDense(tagIndex))
+    {
+        DenseColumn& column = m_dense[tagIndex];
+        if ((int)gameId < column.values.count())
+        {
+            column.values[gameId] = 0;
+            column.present.clearBit(gameId);
+        }
+    }
+    else if ((int)tagIndex < m_sparse.count())
+    {
+        m_sparse[tagIndex].remove(gameId);
+    }
+}
+
+ValueIndex TagColumns::value(GameId gameId, TagIndex tagIndex) const
+{
+    if (m_mapped)
+    {
+        if ((int)tagIndex >= m_mappedColumns.count() || (int)gameId >= m_count)
+        {
+            return 0;
+        }
+        const MappedColumn& column = m_mappedColumns[tagIndex];
+        if (column.values)
+        {
+            return column.values[gameId];
+        }
+        int i = findMapped(column, gameId);
+        return (i >= 0) ? column.sparse[2 * i + 1] : 0;
+    }
+    if (isDense(tagIndex))
+    {
+        const QVector<ValueIndex>& values = m_dense[tagIndex].values;
+        return ((int)gameId < values.count()) ? values[gameId] : 0;
+    }
+    if ((int)tagIndex < m_sparse.count())
+    {
+        return m_sparse[tagIndex].value(gameId, 0);
+    }
+    return 0;
+}
+
+bool TagColumns::has(GameId gameId, TagIndex tagIndex) const
+{
+    if (m_mapped)
+    {
+        if ((int)tagIndex >= m_mappedColumns.count() || (int)gameId >= m_count)
+        {
+            return false;
+        }
+        const MappedColumn& column = m_mappedColumns[tagIndex];
+        if (column.values)
+        {
+            return column.present[gameId / 32] & (1u << (gameId % 32));
+        }
+        return findMapped(column, gameId) >= 0;
+    }
+    if (isDense(tagIndex))
+    {
+        const QBitArray& present = m_dense[tagIndex].present;
+        return ((int)gameId < present.size()) && present.testBit(gameId);
+    }
+    if ((int)tagIndex < m_sparse.count())
+    {
+        return m_sparse[tagIndex].contains(gameId);
+    }
+    return false;
+}
+
+QList<TagIndex> TagColumns::tagIndices(GameId gameId) const
+{
+    QList<TagIndex> tags;
+    int columns = m_mapped ? m_mappedColumns.count() : m_dense.count();
+    for (int t = 0; t < columns; ++t)
+    {
+        if (has(gameId, t))
+        {
+            tags.append(t);
+        }
+    }
+    return tags;
+}
+
+bool TagColumns::isEqual(GameId i, GameId j) const
+{
+    int columns = m_mapped ? m_mappedColumns.count() : m_dense.count();
+    for (int t = 0; t < columns; ++t)
+    {
+        bool hasI = has(i, t);
+        if (hasI != has(j, t))
+        {
+            return false;
+        }
+        if (hasI && value(i, t) != value(j, t))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QVector<ValueIndex> TagColumns::column(TagIndex tagIndex) const
+{
+    if (m_mapped)
+    {
+        QVector<ValueIndex> column(m_count, 0);
+        if ((int)tagIndex < m_mappedColumns.count())
+        {
+            const MappedColumn& mapped = m_mappedColumns[tagIndex];
+            if (mapped.values)
+            {
+                memcpy(column.data(), mapped.values, m_count * sizeof(ValueIndex));
+            }
+            else
+            {
+                for (int i = 0; i < mapped.sparseCount; ++i)
+                {
+                    column[mapped.sparse[2 * i]] = mapped.sparse[2 * i + 1];
+                }
+            }
+        }
+        return column;
+    }
+    if (isDense(tagIndex))
+    {
+        const QVector<ValueIndex>& values = m_dense[tagIndex].values;
+        if (values.count() == m_count)
+        {
+            return values;
+        }
+        QVector<ValueIndex> column(values);
+        column.resize(m_count);
+        return column;
+    }
+
+    QVector<ValueIndex> column(m_count, 0);
+    if ((int)tagIndex < m_sparse.count())
+    {
+        const SparseColumn& sparse = m_sparse[tagIndex];
+        for (auto it = sparse.cbegin(); it != sparse.cend(); ++it)
+        {
+            column[it.key()] = it.value();
+        }
+    }
+    return column;
+}
+
+void TagColumns::replaceValue(const QList<TagIndex>& tags, ValueIndex valueIndex, ValueIndex newValueIndex, QVector<GameId>* gameIds)
+{
+    detach();
+    for (TagIndex t: tags)
+    {
+        if (isDense(t))
+        {
+            DenseColumn& column = m_dense[t];
+            for (int i = 0; i < column.values.count(); ++i)
+            {
+                if (column.values[i] == valueIndex && column.present.testBit(i))
+                {
+                    column.values[i] = newValueIndex;
+                    if (gameIds)
+                    {
+                        gameIds->append(GameId(i));
+                    }
+                }
+            }
+        }
+        else if ((int)t < m_sparse.count())
+        {
+            for (auto it = m_sparse[t].begin(); it != m_sparse[t].end(); ++it)
+            {
+                if (it.value() == valueIndex)
+                {
+                    it.value() = newValueIndex;
+                    if (gameIds)
+                    {
+                        gameIds->append(it.key());
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TagColumns::append(const IndexItem& item)
+{
+    GameId gameId = m_count;
+    resize(m_count + 1);
+    foreach(TagIndex tagIndex, item.getTagIndices())
+    {
+        set(gameId, tagIndex, item.valueIndex(tagIndex));
+    }
+}
+
+void TagColumns::write(QDataStream& out) const
+{
+    if (m_mapped)
+    {
+        TagColumns columns(*this);
+        columns.detach();
+        columns.write(out);
+        return;
+    }
+    out << (qint32) m_count;
+    out << (qint32) m_dense.count();
+    for (int t = 0; t < m_dense.count(); ++t)
+    {
+        bool dense = isDense(t);
+        out << dense;
+        if (dense)
+        {
+            out << m_dense[t].values;
+            out << m_dense[t].present;
+        }
+        else
+        {
+            out << m_sparse[t];
+        }
+    }
+}
+
+void TagColumns::read(QDataStream& in)
+{
+    clear();
+    qint32 count;
+    qint32 columns;
+    in >> count;
+    in >> columns;
+    m_count = count;
+    m_dense.resize(columns);
+    m_sparse.resize(columns);
+    m_isDense.resize(columns);
+    for (int t = 0; t < columns; ++t)
+    {
+        bool dense;
+        in >> dense;
+        if (dense)
+        {
+            in >> m_dense[t].values;
+            in >> m_dense[t].present;
+            m_isDense.setBit(t);
+        }
+        else
+        {
+            in >> m_sparse[t];
+        }
+    }
+}
+
+static inline void appendWord(QByteArray& data, quint32 word)
+{
+    data.append(reinterpret_cast<const char*>(&word), sizeof(word));
+}
+
+void TagColumns::writeMapped(QByteArray& data) const
+{
+    if (m_mapped)
+    {
+        TagColumns columns(*this);
+        columns.detach();
+        columns.writeMapped(data);
+        return;
+    }
+
+    // All fields are 32 bit words in host byte order
+    appendWord(data, m_count);
+    appendWord(data, m_dense.count());
+    for (int t = 0; t < m_dense.count(); ++t)
+    {
+        if (isDense(t))
+        {
+            appendWord(data, 1);
+            const QVector<ValueIndex> values = column(t);
+            data.append(reinterpret_cast<const char*>(values.constData()), m_count * sizeof(ValueIndex));
+            const QBitArray& present = m_dense[t].present;
+            for (int w = 0; w < (m_count + 31) / 32; ++w)
+            {
+                quint32 word = 0;
+                for (int b = 0; b < 32 && 32 * w + b < present.size(); ++b)
+                {
+                    if (present.testBit(32 * w + b))
+                    {
+                        word |= 1u << b;
+                    }
+                }
+                appendWord(data, word);
+            }
+        }
+        else
+        {
+            const SparseColumn& sparse = m_sparse[t];
+            QList<GameId> games = sparse.keys();
+            std::sort(games.begin(), games.end());
+            appendWord(data, 0);
+            appendWord(data, games.count());
+            for (GameId gameId: std::as_const(games))
+            {
+                appendWord(data, gameId);
+                appendWord(data, sparse.value(gameId));
+            }
+        }
+    }
+}
+
+qint64 TagColumns::map(const char* data, qint64 size)
+{
+    clear();
+    const quint32* words = reinterpret_cast<const quint32*>(data);
+    qint64 available = size / 4;
+    qint64 pos = 2;
+    if (available < pos)
+    {
+        return 0;
+    }
+    int count = words[0];
+    int columns = words[1];
+    QVector<MappedColumn> mappedColumns(columns);
+    for (int t = 0; t < columns; ++t)
+    {
+        MappedColumn& column = mappedColumns[t];
+        if (pos + 2 > available)
+        {
+            return 0;
+        }
+        if (words[pos++])
+        {
+            qint64 length = count + (count + 31) / 32;
+            if (pos + length > available)
+            {
+                return 0;
+            }
+            column.values = words + pos;
+            column.present = words + pos + count;
+            column.sparse = nullptr;
+            column.sparseCount = 0;
+            pos += length;
+        }
+        else
+        {
+            column.sparseCount = words[pos++];
+            if (pos + 2 * (qint64)column.sparseCount > available)
+            {
+                return 0;
+            }
+            column.values = nullptr;
+            column.present = nullptr;
+            column.sparse = words + pos;
+            pos += 2 * column.sparseCount;
+        }
+    }
+    m_count = count;
+    m_mappedColumns = mappedColumns;
+    m_mapped = true;
+    return pos * 4;
+}
+
+int TagColumns::findMapped(const MappedColumn& column, GameId gameId) const
+{
+    int low = 0;
+    int high = column.sparseCount - 1;
+    while (low <= high)
+    {
+        int mid = (low + high) / 2;
+        GameId midId = column.sparse[2 * mid];
+        if (midId == gameId)
+        {
+            return mid;
+        }
+        if (midId < gameId)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+void TagColumns::detach()
+{
+    if (!m_mapped)
+    {
+        return;
+    }
+    QVector<MappedColumn> mappedColumns;
+    mappedColumns.swap(m_mappedColumns);
+    m_mapped = false;
+
+    int columns = mappedColumns.count();
+    m_dense.resize(columns);
+    m_sparse.resize(columns);
+    m_isDense.resize(columns);
+    for (int t = 0; t < columns; ++t)
+    {
+        const MappedColumn& mapped = mappedColumns[t];
+        if (mapped.values)
+        {
+            DenseColumn& column = m_dense[t];
+            column.values.resize(m_count);
+            memcpy(column.values.data(), mapped.values, m_count * sizeof(ValueIndex));
+            column.present.resize(m_count);
+            for (int i = 0; i < m_count; ++i)
+            {
+                if (mapped.present[i / 32] & (1u << (i % 32)))
+                {
+                    column.present.setBit(i);
+                }
+            }
+            m_isDense.setBit(t);
+        }
+        else
+        {
+            SparseColumn& sparse = m_sparse[t];
+            sparse.reserve(mapped.sparseCount);
+            for (int i = 0; i < mapped.sparseCount; ++i)
+            {
+                sparse.insert(mapped.sparse[2 * i], mapped.sparse[2 * i + 1]);
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+*   Copyright (C) 2026 by ChessX developers                                 *
+****************************************************************************/
+
+#ifndef TAGCOLUMNS_H
+#define TAGCOLUMNS_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QDataStream>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+#include "gameid.h"
+#include "indexitem.h"
+
+/** @ingroup Database
+ * The TagColumns class stores the tag values of all games of a database
+ * column by column. Frequent tags get a dense array with one ValueIndex per
+ * game, rare tags are kept in a sparse map until they become frequent enough
+ * to be worth a dense column.
+ *
+ * Absent values read as 0, as they did with the per game IndexItem.
+ */
+class TagColumns
+{
+public:
+    TagColumns();
+
+    /** @return number of games */
+    int count() const { return m_count; }
+    /** Set the number of games, new games have no tags */
+    void resize(int count);
+    /** Reserve space for @p count games in all dense columns */
+    void reserve(int count);
+    /** Release unused memory */
+    void squeeze();
+    /** Remove all games and columns */
+    void clear();
+
+    /** Set the value of tag @p tagIndex for game @p gameId */
+    void set(GameId gameId, TagIndex tagIndex, ValueIndex valueIndex);
+    /** Remove tag @p tagIndex from game @p gameId */
+    void remove(GameId gameId, TagIndex tagIndex);
+    /** @return the value of tag @p tagIndex for game @p gameId or 0 if absent */
+    ValueIndex value(GameId gameId, TagIndex tagIndex) const;
+    /** @return true if game @p gameId has tag @p tagIndex */
+    bool has(GameId gameId, TagIndex tagIndex) const;
+    /** @return all tags set for game @p gameId */
+    QList<TagIndex> tagIndices(GameId gameId) const;
+    /** @return true if games @p i and @p j have the same tags and values */
+    bool isEqual(GameId i, GameId j) const;
+
+    /** @return the values of @p tagIndex for all games, absent values are 0.
+        For dense columns this is a shallow copy of the column. */
+    QVector<ValueIndex> column(TagIndex tagIndex) const;
+
+    /** Replace @p valueIndex by @p newValueIndex in all columns of @p tags,
+        the changed games are added to @p gameIds */
+    void replaceValue(const QList<TagIndex>& tags, ValueIndex valueIndex, ValueIndex newValueIndex, QVector<GameId>* gameIds = nullptr);
+
+    /** Append a game given in the legacy per game format */
+    void append(const IndexItem& item);
+
+    /** Write the columns to a stream */
+    void write(QDataStream& out) const;
+    /** Read the columns from a stream, existing data is cleared first */
+    void read(QDataStream& in);
+
+    /** Append the columns in the fixed layout used by map() to @p data */
+    void writeMapped(QByteArray& data) const;
+    /** Use columns written by writeMapped() in place, existing data is cleared first.
+        @p data must stay valid until the columns are cleared, they are copied
+        before the first change.
+        @return the number of bytes used or 0 if @p data is invalid */
+    qint64 map(const char* data, qint64 size);
+    /** @return true if the columns are used in place */
+    bool isMapped() const { return m_mapped; }
+
+private:
+    struct DenseColumn
+    {
+        QVector<ValueIndex> values;
+        QBitArray present;
+    };
+    typedef QHash<GameId, ValueIndex> SparseColumn;
+    /** A column in the layout of writeMapped(), values is nullptr for sparse columns */
+    struct MappedColumn
+    {
+        const ValueIndex* values;
+        const quint32* present;
+        /** Pairs of GameId and ValueIndex sorted by GameId */
+        const quint32* sparse;
+        int sparseCount;
+    };
+
+    bool isDense(TagIndex tagIndex) const;
+    /** Convert a sparse column into a dense one */
+    void makeDense(TagIndex tagIndex);
+    /** Grow a dense column to hold game @p gameId */
+    void growColumn(DenseColumn& column, GameId gameId);
+    /** Copy mapped columns into memory before changing them */
+    void detach();
+    /** @return the position of game @p gameId in a sparse mapped column or -1 */
+    int findMapped(const MappedColumn& column, GameId gameId) const;
+
+    int m_count;
+    /** Dense columns indexed by TagIndex, empty if a tag is stored sparse */
+    QVector<DenseColumn> m_dense;
+    /** Sparse columns indexed by TagIndex */
+    QVector<SparseColumn> m_sparse;
+    /** Flags indicating which columns are dense */
+    QBitArray m_isDense;
+    /** Columns used in place if m_mapped is set */
+    QVector<MappedColumn> m_mappedColumns;
+    bool m_mapped;
+};
+
+#endif // TAGCOLUMNS_H
@@ -28,6 +28,10 @@ BoardSearchDialog::BoardSearchDialog(QWidget *parent) :
     ui->boardView->showMoveIndicator(false);
     ui->boardView->setEnabled(false);
 
+    ui->searchCombo->addItem(tr("Exact position"), ExactPosition);
+    ui->searchCombo->addItem(tr("Same material"), SameMaterial);
+    ui->searchCombo->addItem(tr("Pieces on these squares"), PiecesOnSquares);
+
     ui->modeCombo->addItem(tr("Find in current filter"), FilterOperator::And);
     ui->modeCombo->addItem(tr("Search whole database"), FilterOperator::NullOperator);
     ui->modeCombo->addItem(tr("Add to current filter"), FilterOperator::Or);
@@ -77,6 +81,15 @@ int BoardSearchDialog::mode() const
     return ui->modeCombo->itemData(ui->modeCombo->currentIndex()).toInt();
 }
 
+BoardSearchDialog::SearchType BoardSearchDialog::searchType() const
+{
+    if(ui->searchCombo->currentIndex() == -1)
+    {
+        return ExactPosition;
+    }
+    return SearchType(ui->searchCombo->itemData(ui->searchCombo->currentIndex()).toInt());
+}
+
 void BoardSearchDialog::accept()
 {
     AppSettings->setLayout(this);
@@ -17,10 +17,19 @@ class BoardSearchDialog : public QDialog
     Q_OBJECT
 
 public:
+    /** What has to be found in the games */
+    enum SearchType
+    {
+        ExactPosition,  ///< The position of the board
+        SameMaterial,   ///< Any position with the same material
+        PiecesOnSquares ///< Any position with the pieces of the board on their squares
+    };
+
     explicit BoardSearchDialog(QWidget *parent = nullptr);
     ~BoardSearchDialog();
 
     int mode() const;
+    SearchType searchType() const;
     void setBoardList(const QList<BoardX> &);
     int boardIndex() const;
 protected slots:
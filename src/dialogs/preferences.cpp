@@ -73,6 +73,7 @@ PreferencesDialog::PreferencesDialog(QWidget* parent, Qt::WindowFlags f) : QDial
     connect(ui.directoryButton, SIGNAL(clicked(bool)), SLOT(slotSelectEngineDirectory()));
     connect(ui.commandButton, SIGNAL(clicked(bool)), SLOT(slotSelectEngineCommand()));
     connect(ui.browsePathButton, SIGNAL(clicked(bool)), SLOT(slotSelectDataBasePath()));
+    connect(ui.browseSyzygyButton, SIGNAL(clicked(bool)), SLOT(slotSelectSyzygyPath()));
     connect(ui.engineOptionMore, SIGNAL(clicked(bool)), SLOT(slotShowOptionDialog()));
 
     connect(ui.tbUK, SIGNAL(clicked()), SLOT(slotChangePieceString()));
@@ -197,6 +198,17 @@ void PreferencesDialog::slotSelectDataBasePath()
     }
 }
 
+void PreferencesDialog::slotSelectSyzygyPath()
+{
+    QString dir = QFileDialog::getExistingDirectory(this,
+                  tr("Select Syzygy tablebase folder"), ui.syzygyPath->text(),
+                  QFileDialog::ShowDirsOnly);
+    if(!dir.isEmpty() && QDir(dir).exists())
+    {
+        ui.syzygyPath->setText(dir);
+    }
+}
+
 void PreferencesDialog::slotAddEngine()
 {
     QString command = selectEngineFile();
@@ -464,10 +476,13 @@ void PreferencesDialog::restoreSettings()
     AppSettings->beginGroup("/General/");
     ui.tablebaseCheck->setChecked(AppSettings->getValue("onlineTablebases").toBool());
     ui.tablebaseSelect->setCurrentIndex(AppSettings->getValue("tablebaseSource").toInt());
+    ui.syzygyPath->setText(AppSettings->getValue("syzygyPath").toString());
     ui.versionCheck->setChecked(AppSettings->getValue("onlineVersionCheck").toBool());
     ui.automaticECO->setChecked(AppSettings->getValue("automaticECO").toBool());
     ui.preserveECO->setChecked(AppSettings->getValue("preserveECO").toBool());
     ui.useIndexFile->setChecked(AppSettings->getValue("useIndexFile").toBool());
+    ui.usePositionIndex->setChecked(AppSettings->getValue("usePositionIndex").toBool());
+    ui.useMoveCache->setChecked(AppSettings->getValue("useMoveCache").toBool());
     ui.cbAutoCommitDB->setChecked(AppSettings->getValue("autoCommitDB").toBool());
     ui.mergeAddSource->setChecked(AppSettings->getValue("mergeAddSource").toBool());
     ui.mergeAddTag->setText(AppSettings->getValue("mergeAddTag").toString());
@@ -687,10 +702,13 @@ void PreferencesDialog::saveSettings()
     AppSettings->beginGroup("/General/");
     AppSettings->setValue("onlineTablebases", QVariant(ui.tablebaseCheck->isChecked()));
     AppSettings->setValue("tablebaseSource", QVariant(ui.tablebaseSelect->currentIndex()));
+    AppSettings->setValue("syzygyPath", QVariant(ui.syzygyPath->text()));
     AppSettings->setValue("onlineVersionCheck", QVariant(ui.versionCheck->isChecked()));
     AppSettings->setValue("automaticECO", QVariant(ui.automaticECO->isChecked()));
     AppSettings->setValue("preserveECO", QVariant(ui.preserveECO->isChecked()));
     AppSettings->setValue("useIndexFile", QVariant(ui.useIndexFile->isChecked()));
+    AppSettings->setValue("usePositionIndex", QVariant(ui.usePositionIndex->isChecked()));
+    AppSettings->setValue("useMoveCache", QVariant(ui.useMoveCache->isChecked()));
     AppSettings->setValue("autoCommitDB", QVariant(ui.cbAutoCommitDB->isChecked()));
     AppSettings->setValue("language", QVariant(ui.cbLanguage->currentText()));
     AppSettings->setValue("mergeAddSource", QVariant(ui.mergeAddSource->isChecked()));
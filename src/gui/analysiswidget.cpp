@@ -54,6 +54,9 @@ AnalysisWidget::AnalysisWidget(QWidget *parent)
 
     m_tablebase = new OnlineTablebase;
     connect(m_tablebase, SIGNAL(bestMove(QList<Move>,int)), this, SLOT(showTablebaseMove(QList<Move>,int)), Qt::QueuedConnection);
+    m_localTablebase = new SyzygyTablebase;
+    connect(m_localTablebase, SIGNAL(bestMove(QList<Move>,int)), this, SLOT(showTablebaseMove(QList<Move>,int)), Qt::QueuedConnection);
+    connect(m_localTablebase, SIGNAL(notFound(QString)), this, SLOT(localTablebaseNotFound(QString)));
 
     ui.variationText->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui.variationText,SIGNAL(customContextMenuRequested(const QPoint&)),this,SLOT(showContextMenu(const QPoint&)));
@@ -63,6 +66,7 @@ AnalysisWidget::~AnalysisWidget()
 {
     stopEngine();
     delete m_tablebase;
+    delete m_localTablebase;
 }
 
 
@@ -411,6 +415,7 @@ void AnalysisWidget::setPosition(const BoardX& board, QString line)
         m_line = line;
         m_analyses.clear();
         m_tablebase->abortLookup();
+        m_localTablebase->abortLookup();
         m_tablebaseEvaluation.clear();
         m_tablebaseMove.clear();
         m_tb.setNullMove();
@@ -418,15 +423,12 @@ void AnalysisWidget::setPosition(const BoardX& board, QString line)
 
         updateBookMoves();
 
-        if(AppSettings->getValue("/General/onlineTablebases").toBool())
+        if (!(m_board.isStalemate() || m_board.isCheckmate() || m_board.chess960()))
         {
-            if (!(m_board.isStalemate() || m_board.isCheckmate() || m_board.chess960()))
+            if(objectName() == "Analysis")
             {
-                if(objectName() == "Analysis")
-                {
-                    m_tbBoard = m_board;
-                    m_tablebase->getBestMove(m_board.toFen());
-                }
+                m_tbBoard = m_board;
+                m_localTablebase->getBestMove(m_board.toFen());
             }
         }
 
@@ -571,6 +573,16 @@ bool AnalysisWidget::isAnalysisEnabled() const
     return true;
 }
 
+void AnalysisWidget::localTablebaseNotFound(QString fen)
+{
+    // Ask the online tablebase if the local tables cannot answer
+    if (m_tbBoard == m_board && fen == m_board.toFen() &&
+        AppSettings->getValue("/General/onlineTablebases").toBool())
+    {
+        m_tablebase->getBestMove(fen);
+    }
+}
+
 void AnalysisWidget::showTablebaseMove(QList<Move> bestMoves, int score)
 {
     if (m_tbBoard == m_board)
@@ -22,6 +22,7 @@
 	The Analysis widget which shows engine output
 */
 
+class SyzygyTablebase;
 class Tablebase;
 class Database;
 
@@ -99,6 +100,8 @@ private slots:
     void slotMpvChanged(int mpv);
     /** Show tablebase move information. */
     void showTablebaseMove(QList<Move> move, int score);
+    /** The local tables cannot answer, ask the online tablebase. */
+    void localTablebaseNotFound(QString fen);
     /** The pin button was pressed or released */
     void slotPinChanged(bool);
     bool hideLines() const;
@@ -140,6 +143,7 @@ private:
     Move m_tb;
     int m_score_tb;
     Tablebase* m_tablebase;
+    SyzygyTablebase* m_localTablebase;
     BoardX m_tbBoard;
     EngineParameter m_moveTime;
     bool m_bUciNewGame;
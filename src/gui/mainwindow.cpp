@@ -2136,6 +2136,8 @@ void MainWindow::setupActions()
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Remove Variations"), SLOT(slotDatabaseRemoveVariations())));
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Prune null moves"), SLOT(slotDatabaseRemoveNullLines())));
     refactorMenu2->addAction(createAction(refactorMenu2, tr("Edit tag"), SLOT(slotDatabaseEditTag())));
+    refactorMenu2->addAction(createAction(refactorMenu2, tr("Classify ECO"), SLOT(slotDatabaseClassifyEco())));
+    refactorMenu2->addAction(createAction(refactorMenu2, tr("Classify ECO of filter"), SLOT(slotDatabaseClassifyEcoFilter())));
     menuDatabase->addSeparator();
     menuDatabase->addAction(createAction(tr("Clear clipboard"), SLOT(slotDatabaseClearClipboard())));
 
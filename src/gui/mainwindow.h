@@ -45,6 +45,7 @@ class EcoThread;
 class EditAction;
 class EventListWidget;
 class ExclusiveActionGroup;
+class FilterX;
 class FicsClient;
 class FicsConsole;
 class GameList;
@@ -277,6 +278,10 @@ protected:
     void slotGameRemoveVariations();
     /** Remove all variations from all games. */
     void slotDatabaseRemoveVariations();
+    /** Set the ECO tag of all games from their moves. */
+    void slotDatabaseClassifyEco();
+    /** Set the ECO tag of the games in the filter from their moves. */
+    void slotDatabaseClassifyEcoFilter();
     /** Remove all lines consisting only of a null move */
     void slotGameRemoveNullLines();
     /** Set a annotation into the current game (w/o Undo) */
@@ -678,6 +683,8 @@ private:
     void triggerBoardMove();
     /** Filter Duplicates in the current database */
     void filterDuplicates(int mode);
+    /** Classify the games of @p filter by ECO, all games if nullptr */
+    void classifyEco(const FilterX* filter);
     /** Return true, if a game is drawn by rule */
     bool gameIsDraw() const;
     /** Get a list of moves from start to current position */
@@ -27,6 +27,7 @@
 #include "dlgsavebook.h"
 #include "downloadmanager.h"
 #include "duplicatesearch.h"
+#include "ecoclassifier.h"
 #include "ecolistwidget.h"
 #include "editaction.h"
 #include "eventlistwidget.h"
@@ -45,10 +46,12 @@
 #include "lichesstransfer.h"
 #include "mainwindow.h"
 #include "matchparameterdlg.h"
+#include "materialsearch.h"
 #include "messagedialog.h"
 #include "memorydatabase.h"
 #include "openingtreewidget.h"
 #include "output.h"
+#include "patternsearch.h"
 #include "playerlistwidget.h"
 #include "polyglotwriter.h"
 #include "positionsearch.h"
@@ -172,7 +175,15 @@ void MainWindow::saveDatabase(DatabaseInfo* dbInfo)
         startOperation(tr("Saving %1...").arg(db->name()));
         Output output(Output::Pgn, &BoardView::renderImageForBoard);
         connect(&output, SIGNAL(progress(int)), SLOT(slotOperationProgress(int)));
-        output.output(db->filename(), *db);
+        MemoryDatabase* memoryDatabase = qobject_cast<MemoryDatabase*>(db);
+        if(!memoryDatabase || !memoryDatabase->saveChanges(output))
+        {
+            output.output(db->filename(), *db);
+            if(memoryDatabase)
+            {
+                memoryDatabase->fileWritten();
+            }
+        }
         finishOperation(tr("%1 saved").arg(db->name()));
     }
 }
@@ -2185,6 +2196,39 @@ void MainWindow::slotDatabaseRemoveVariations()
     }
 }
 
+void MainWindow::slotDatabaseClassifyEco()
+{
+    classifyEco(nullptr);
+}
+
+void MainWindow::slotDatabaseClassifyEcoFilter()
+{
+    classifyEco(databaseInfo()->filter());
+}
+
+void MainWindow::classifyEco(const FilterX* filter)
+{
+    if (database()->isReadOnly())
+    {
+        return;
+    }
+    startOperation(tr("Classifying ECO..."));
+    EcoClassifier classifier(database());
+    int n = classifier.classify(filter, AppSettings->getValue("/General/preserveECO").toBool());
+    if (n)
+    {
+        QString eco = database()->tagValue(databaseInfo()->currentIndex(), TagNameECO);
+        if (!eco.isEmpty())
+        {
+            game().setTag(TagNameECO, eco);
+        }
+        emit signalGameModified(false);
+        UpdateBoardInformation();
+        slotDatabaseChanged();
+    }
+    finishOperation(tr("%1 games classified").arg(n));
+}
+
 void MainWindow::slotDatabaseEditTag()
 {
     QStringList list = database()->index()->tagNames();
@@ -3058,10 +3102,10 @@ void MainWindow::copyGame(DatabaseInfo* pTargetDB, DatabaseInfo* pSourceDB, Game
 
 void MainWindow::gameChangeTag(GameId id, QString tag)
 {
+    database()->setTagsModified(QVector<GameId>() << id);
     if (databaseInfo()->currentIndex()==id)
     {
         game().setTag(tag, database()->index()->tagValue(tag, id));
-        database()->setModified(true);
         m_eventList->setDatabase(databaseInfo());
         m_playerList->setDatabase(databaseInfo());
         emit signalGameModified(false);
@@ -3656,7 +3700,29 @@ void MainWindow::slotSearchBoard()
 
     if (dlg->exec() == QDialog::Accepted)
     {
-        Search* ps = new PositionSearch (databaseInfo()->filter()->database(), boardList.at(dlg->boardIndex()));
+        Database* database = databaseInfo()->filter()->database();
+        const BoardX& board = boardList.at(dlg->boardIndex());
+        Search* ps = nullptr;
+        switch (dlg->searchType())
+        {
+        case BoardSearchDialog::SameMaterial:
+        {
+            MaterialSearch* ms = new MaterialSearch(database);
+            ms->setMaterial(board);
+            ps = ms;
+            break;
+        }
+        case BoardSearchDialog::PiecesOnSquares:
+        {
+            PatternSearch* pts = new PatternSearch(database);
+            pts->requirePieces(board);
+            ps = pts;
+            break;
+        }
+        default:
+            ps = new PositionSearch(database, board);
+            break;
+        }
         m_openingTreeWidget->cancel();
         slotBoardSearchStarted();
         m_gameList->executeSearch(ps, FilterOperator(dlg->mode()));
@@ -3828,7 +3894,8 @@ void MainWindow::slotRenameRequest(QString tag, QString newValue, QString oldVal
         l << TagNameBlack;
     }
 
-    if(database()->index()->replaceTagValue(l, newValue, oldValue))
+    QVector<GameId> games;
+    if(database()->index()->replaceTagValue(l, newValue, oldValue, &games))
     {
         if(game().tag(tag) == oldValue)
         {
@@ -3841,7 +3908,7 @@ void MainWindow::slotRenameRequest(QString tag, QString newValue, QString oldVal
                 game().setTag(TagNameBlack, newValue);
             }
         }
-        database()->setModified(true);
+        database()->setTagsModified(games);
         m_eventList->setDatabase(databaseInfo());
         m_playerList->setDatabase(databaseInfo());
         emit signalGameModified(false);
@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+"""Generate the KQvK Syzygy tables used by test_syzygy.cpp.
+
+The positions are solved by retrograde analysis and written in the Syzygy
+file format, as read by src/database/syzygy.cpp. The values are stored
+without pairs, each value is a Huffman coded symbol of its own.
+
+Usage: generate.py [directory]
+"""
+
+import hashlib
+import os
+import struct
+import sys
+
+WIN, CURSED_WIN, DRAW, BLESSED_LOSS, LOSS = 2, 1, 0, -1, -2
+
+# Piece codes of the tables, black adds 8
+KING, QUEEN = 6, 5
+PIECES = (KING, QUEEN, KING | 8)
+
+
+def file_of(s):
+    return s & 7
+
+
+def rank_of(s):
+    return s >> 3
+
+
+def off_a1h8(s):
+    return rank_of(s) - file_of(s)
+
+
+def adjacent(a, b):
+    return max(abs(file_of(a) - file_of(b)), abs(rank_of(a) - rank_of(b))) <= 1
+
+
+# Index tables, see initIndexTables()
+MAP_B1H1H7 = [0] * 64
+MAP_A1D1D4 = [0] * 64
+
+
+def init_index_tables():
+    code = 0
+    for s in range(64):
+        if off_a1h8(s) < 0:
+            MAP_B1H1H7[s] = code
+            code += 1
+    diagonal = []
+    code = 0
+    for s in range(28):
+        if off_a1h8(s) < 0 and file_of(s) <= 3:
+            MAP_A1D1D4[s] = code
+            code += 1
+        elif off_a1h8(s) == 0 and file_of(s) <= 3:
+            diagonal.append(s)
+    for s in diagonal:
+        MAP_A1D1D4[s] = code
+        code += 1
+
+
+TB_SIZE = 31332
+
+
+def encode(squares, pieces, table_pieces):
+    """Index of the pieces on squares, with the pieces of the table as White"""
+    squares = list(squares)
+    pieces = list(pieces)
+    for i in range(len(pieces) - 1):
+        for j in range(i + 1, len(pieces)):
+            if table_pieces[i] == pieces[j]:
+                pieces[i], pieces[j] = pieces[j], pieces[i]
+                squares[i], squares[j] = squares[j], squares[i]
+                break
+    if file_of(squares[0]) > 3:
+        squares = [s ^ 7 for s in squares]
+    if rank_of(squares[0]) > 3:
+        squares = [s ^ 56 for s in squares]
+    for i in range(3):
+        if not off_a1h8(squares[i]):
+            continue
+        if off_a1h8(squares[i]) > 0:
+            for j in range(i, len(squares)):
+                squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63
+        break
+
+    adjust1 = int(squares[1] > squares[0])
+    adjust2 = int(squares[2] > squares[0]) + int(squares[2] > squares[1])
+    if off_a1h8(squares[0]):
+        return (MAP_A1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2
+    if off_a1h8(squares[1]):
+        return (6 * 63 + rank_of(squares[0]) * 28 + MAP_B1H1H7[squares[1]]) * 62 + squares[2] - adjust2
+    if off_a1h8(squares[2]):
+        return (6 * 63 * 62 + 4 * 28 * 62 + rank_of(squares[0]) * 7 * 28
+                + (rank_of(squares[1]) - adjust1) * 28 + MAP_B1H1H7[squares[2]])
+    return (6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rank_of(squares[0]) * 7 * 6
+            + (rank_of(squares[1]) - adjust1) * 6 + (rank_of(squares[2]) - adjust2))
+
+
+def index_of(wk, wq, bk):
+    """Index of a position, the pieces ordered by square as the prober finds them"""
+    found = sorted([(wk, KING), (wq, QUEEN), (bk, KING | 8)])
+    return encode([s for s, _ in found], [p for _, p in found], PIECES)
+
+
+def queen_attacks(q, s, blockers):
+    df = file_of(s) - file_of(q)
+    dr = rank_of(s) - rank_of(q)
+    if (df, dr) == (0, 0) or not (df == 0 or dr == 0 or abs(df) == abs(dr)):
+        return False
+    sf = (df > 0) - (df < 0)
+    sr = (dr > 0) - (dr < 0)
+    f, r = file_of(q) + sf, rank_of(q) + sr
+    while (f, r) != (file_of(s), rank_of(s)):
+        if 8 * r + f in blockers:
+            return False
+        f, r = f + sf, r + sr
+    return True
+
+
+def king_moves(s):
+    return [t for t in range(64) if t != s and adjacent(s, t)]
+
+
+def queen_moves(q, blockers):
+    moves = []
+    for sf in (-1, 0, 1):
+        for sr in (-1, 0, 1):
+            if (sf, sr) == (0, 0):
+                continue
+            f, r = file_of(q) + sf, rank_of(q) + sr
+            while 0 <= f < 8 and 0 <= r < 8 and 8 * r + f not in blockers:
+                moves.append(8 * r + f)
+                f, r = f + sf, r + sr
+    return moves
+
+
+def legal(wk, wq, bk, stm):
+    if len({wk, wq, bk}) < 3 or adjacent(wk, bk):
+        return False
+    # The side not to move must not be in check
+    return stm == 1 or not queen_attacks(wq, bk, {wk})
+
+
+def solve():
+    """@return WDL and distance to mate in plies of all legal positions"""
+    wdl = [{}, {}]
+    dtm = [{}, {}]
+    successors = {}
+    for wk in range(64):
+        for wq in range(64):
+            for bk in range(64):
+                if not legal(wk, wq, bk, 1):
+                    continue
+                moves = []
+                capture = False
+                for t in king_moves(bk):
+                    if adjacent(t, wk) or queen_attacks(wq, t, {wk}) and t != wq:
+                        continue
+                    if t == wq:
+                        capture = True
+                    else:
+                        moves.append((wk, wq, t))
+                if capture:
+                    wdl[1][(wk, wq, bk)] = DRAW
+                elif not moves:
+                    if queen_attacks(wq, bk, {wk}):
+                        wdl[1][(wk, wq, bk)] = LOSS
+                        dtm[1][(wk, wq, bk)] = 0
+                    else:
+                        wdl[1][(wk, wq, bk)] = DRAW
+                else:
+                    successors[(wk, wq, bk)] = moves
+
+    white = {}
+    for wk in range(64):
+        for wq in range(64):
+            for bk in range(64):
+                if not legal(wk, wq, bk, 0):
+                    continue
+                moves = [(t, wq, bk) for t in king_moves(wk) if t != wq and not adjacent(t, bk)]
+                moves += [(wk, t, bk) for t in queen_moves(wq, {wk, bk})]
+                white[(wk, wq, bk)] = moves
+
+    ply = 0
+    changed = True
+    while changed:
+        changed = False
+        ply += 1
+        if ply % 2:
+            for pos, moves in white.items():
+                if pos not in wdl[0] and any(dtm[1].get(m) == ply - 1 for m in moves):
+                    wdl[0][pos] = WIN
+                    dtm[0][pos] = ply
+                    changed = True
+        else:
+            for pos, moves in successors.items():
+                if pos in wdl[1]:
+                    continue
+                if all(m in dtm[0] for m in moves):
+                    wdl[1][pos] = LOSS
+                    dtm[1][pos] = 1 + max(dtm[0][m] for m in moves)
+                    changed = True
+    for pos in white:
+        wdl[0].setdefault(pos, DRAW)
+    for pos in successors:
+        wdl[1].setdefault(pos, DRAW)
+    return wdl, dtm
+
+
+def canonical_huffman(counts):
+    """@return code length of each symbol, by the number of times it is used"""
+    nodes = [(n, [s]) for s, n in enumerate(counts)]
+    lengths = [0] * len(counts)
+    if len(nodes) == 1:
+        return [1]
+    while len(nodes) > 1:
+        nodes.sort(key=lambda n: n[0])
+        (n1, s1), (n2, s2) = nodes[0], nodes[1]
+        for s in s1 + s2:
+            lengths[s] += 1
+        nodes = nodes[2:] + [(n1 + n2, s1 + s2)]
+    return lengths
+
+
+def pairs_data(values, flags):
+    """Encode the values of one side, @return (sizes, sparse index, block lengths, blocks)"""
+    distinct = sorted(set(values))
+    if len(distinct) == 1:
+        return bytes([flags | 128, distinct[0]]), b"", b"", b""
+
+    counts = [values.count(v) for v in distinct]
+    lengths = canonical_huffman(counts)
+    min_len, max_len = min(lengths), max(lengths)
+
+    # Symbols are numbered from the longest codes, which have the lowest values
+    symbols = sorted(range(len(distinct)), key=lambda s: (-lengths[s], distinct[s]))
+    number = {s: i for i, s in enumerate(symbols)}
+    lowest = [0] * (max_len - min_len + 1)
+    base = [0] * (max_len - min_len + 1)
+    for i in range(max_len - min_len - 1, -1, -1):
+        count = sum(1 for s in symbols if lengths[s] == min_len + i + 1)
+        lowest[i] = lowest[i + 1] + count
+        base[i] = (base[i + 1] + count) // 2
+    code = {}
+    for s in symbols:
+        i = lengths[s] - min_len
+        code[distinct[s]] = (base[i] + number[s] - lowest[i], lengths[s])
+
+    block_size = 64
+    span = 64
+    blocks = []
+    block_lengths = []
+    starts = []
+    bits, nbits, first = 0, 0, 0
+    for idx, v in enumerate(values + [None]):
+        c = code[v] if v is not None else None
+        if v is None or nbits + c[1] > 8 * block_size:
+            blocks.append((bits << (8 * block_size - nbits)).to_bytes(block_size, "big"))
+            block_lengths.append(idx - first - 1)
+            starts.append(first)
+            bits, nbits, first = 0, 0, idx
+            if v is None:
+                break
+        bits = (bits << c[1]) | c[0]
+        nbits += c[1]
+
+    sparse = b""
+    for k in range((len(values) + span - 1) // span):
+        i = k * span + span // 2
+        block = max(b for b in range(len(starts)) if starts[b] <= i)
+        sparse += struct.pack("<IH", block, i - starts[block])
+
+    sizes = bytes([flags, block_size.bit_length() - 1, span.bit_length() - 1, 0])
+    sizes += struct.pack("<I", len(blocks)) + bytes([max_len, min_len])
+    sizes += b"".join(struct.pack("<H", n) for n in lowest)
+    sizes += struct.pack("<H", len(symbols))
+    for s in symbols:
+        v = distinct[s]
+        sizes += bytes([v & 0xFF, ((v >> 8) & 0xF) | 0xF0, 0xFF])
+    if len(symbols) & 1:
+        sizes += b"\0"
+    return (sizes, sparse, b"".join(struct.pack("<H", n) for n in block_lengths), b"".join(blocks))
+
+
+def fill(table):
+    """Store the most frequent value at the indexes of illegal positions"""
+    known = [v for v in table if v is not None]
+    common = max(set(known), key=known.count)
+    return [common if v is None else v for v in table]
+
+
+def store(table, idx, value):
+    assert table[idx] is None or table[idx] == value, "inconsistent value at %d" % idx
+    table[idx] = value
+
+
+def write_table(filename, magic, sides):
+    data = bytearray(magic)
+    data += bytes([1])                                      # Split: KQvK differs from KvKQ
+    data += bytes([0])                                      # Order of the groups
+    for k in range(3):
+        data += bytes([PIECES[k] | (PIECES[k] << 4)])
+    if len(data) & 1:
+        data += b"\0"
+    for side in sides:
+        data += side[0]
+    for side in sides:
+        data += side[1]
+    for side in sides:
+        data += side[2]
+    for side in sides:
+        data += b"\0" * (-len(data) % 64)
+        data += side[3]
+    data += b"\0" * (-len(data) % 64)
+    data += hashlib.md5(data).digest()
+    with open(filename, "wb") as f:
+        f.write(data)
+
+
+def main():
+    directory = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    init_index_tables()
+    wdl, dtm = solve()
+
+    wdl_tables = [[None] * TB_SIZE, [None] * TB_SIZE]
+    dtz_table = [None] * TB_SIZE
+    for stm in (0, 1):
+        for (wk, wq, bk), value in wdl[stm].items():
+            idx = index_of(wk, wq, bk)
+            store(wdl_tables[stm], idx, value + 2)
+            if stm == 0 and value == WIN:
+                store(dtz_table, idx, dtm[0][(wk, wq, bk)] - 1)
+
+    # WDL tables store both sides to move, DTZ tables White to move in plies
+    write_table(os.path.join(directory, "KQvK.rtbw"), b"\x71\xE8\x23\x5D",
+                [pairs_data(fill(wdl_tables[0]), 0), pairs_data(fill(wdl_tables[1]), 0)])
+    write_table(os.path.join(directory, "KQvK.rtbz"), b"\xD7\x66\x0C\xA5",
+                [pairs_data(fill(dtz_table), 4)])
+
+
+if __name__ == "__main__":
+    main()
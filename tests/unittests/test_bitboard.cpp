@@ -0,0 +1,100 @@
+#include "doctest.h"
+
+#include "board.h"
+
+namespace {
+
+/** Squares attacked by a slider on @p square, found by walking each ray until a piece blocks it */
+quint64 rayAttacks(int square, quint64 occupied, bool bishop)
+{
+    static const int rookSteps[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    static const int bishopSteps[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+    const int (*steps)[2] = bishop ? bishopSteps : rookSteps;
+
+    quint64 attacks = 0;
+    for (int d = 0; d < 4; ++d)
+    {
+        int file = square % 8 + steps[d][0];
+        int rank = square / 8 + steps[d][1];
+        for (; file >= 0 && file < 8 && rank >= 0 && rank < 8; file += steps[d][0], rank += steps[d][1])
+        {
+            quint64 bit = Q_UINT64_C(1) << (rank * 8 + file);
+            attacks |= bit;
+            if (occupied & bit)
+            {
+                break;
+            }
+        }
+    }
+    return attacks;
+}
+
+/** Number of leaf positions @p depth plies from @p board */
+quint64 perft(const BoardX& board, int depth)
+{
+    quint64 nodes = 0;
+    Move::List moves = board.generateMoves();
+    for (const Move& m: std::as_const(moves))
+    {
+        BoardX next(board);
+        next.doMove(m);
+        if (next.isAttackedBy(next.toMove(), next.kingSquare(board.toMove())))
+        {
+            continue;
+        }
+        nodes += (depth > 1) ? perft(next, depth - 1) : 1;
+    }
+    return nodes;
+}
+
+}
+
+TEST_CASE("testing BitBoard slider attacks agree with scanning the rays")
+{
+    // The attack tables are set up along with the first board
+    BitBoard board;
+
+    quint64 random = Q_UINT64_C(0x9E3779B97F4A7C15);
+    for (int square = 0; square < 64; ++square)
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            // xorshift, sparse occupancies are made by combining several values
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            quint64 occupied = random;
+            if (i % 3)
+            {
+                occupied &= random * Q_UINT64_C(0x2545F4914F6CDD1D);
+            }
+            if (i % 3 == 2)
+            {
+                occupied &= occupied >> 5;
+            }
+
+            const SliderAttacks& rook = bb_RookAttacks[square];
+            const SliderAttacks& bishop = bb_BishopAttacks[square];
+            CHECK_EQ(rook.attacks[rook.index(occupied)], rayAttacks(square, occupied, false));
+            CHECK_EQ(bishop.attacks[bishop.index(occupied)], rayAttacks(square, occupied, true));
+        }
+        const SliderAttacks& rook = bb_RookAttacks[square];
+        const SliderAttacks& bishop = bb_BishopAttacks[square];
+        CHECK_EQ(rook.attacks[rook.index(0)], rayAttacks(square, 0, false));
+        CHECK_EQ(bishop.attacks[bishop.index(0)], rayAttacks(square, 0, true));
+    }
+}
+
+TEST_CASE("testing BitBoard move generation by counting the positions")
+{
+    BoardX start;
+    start.setStandardPosition();
+    CHECK_EQ(perft(start, 1), 20u);
+    CHECK_EQ(perft(start, 2), 400u);
+    CHECK_EQ(perft(start, 3), 8902u);
+
+    // Castling, pins and sliders on crowded lines
+    BoardX kiwipete("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    CHECK_EQ(perft(kiwipete, 1), 48u);
+    CHECK_EQ(perft(kiwipete, 2), 2039u);
+}
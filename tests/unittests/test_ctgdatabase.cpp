@@ -0,0 +1,125 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "ctgdatabase.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing CtgDatabase writes books it can read")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QString filename = dir.filePath("book.ctg");
+    {
+        CtgDatabase book;
+        REQUIRE(book.openForWriting(filename, 20, 1, false));
+        volatile bool breakFlag = false;
+        book.book_make(db, breakFlag);
+    }
+
+    // Every first move of the games has to be found
+    QMap<Move, int> firstMoves;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGame(gameId, game);
+        QString result = game.tag(TagNameResult);
+        if (game.startingBoard().toFen() != BoardX::standardStartBoard.toFen() || result == "*" || game.atLineEnd())
+        {
+            continue;
+        }
+        game.moveToStart();
+        game.forward();
+        firstMoves[game.move()] += 1;
+    }
+
+    CtgDatabase book;
+    REQUIRE(book.open(filename, false));
+    CHECK_GT(book.positionCount(), 0u);
+
+    BoardX board;
+    board.setStandardPosition();
+    QMap<Move, MoveData> moves;
+    book.getMoveMapForBoard(board, moves);
+    CHECK_EQ(moves.count(), firstMoves.count());
+    for (auto it = firstMoves.constBegin(); it != firstMoves.constEnd(); ++it)
+    {
+        REQUIRE(moves.contains(it.key()));
+        CHECK_EQ(int(moves[it.key()].results.count()), it.value());
+    }
+}
+
+TEST_CASE("testing CtgDatabase spills runs, merges them and splits pages")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QString plainName = dir.filePath("plain.ctg");
+    QString splitName = dir.filePath("split.ctg");
+    volatile bool breakFlag = false;
+    {
+        CtgDatabase book;
+        REQUIRE(book.openForWriting(plainName, 1000, 1, false));
+        book.book_make(db, breakFlag);
+    }
+    {
+        // A run per game, three runs merged at once and two buckets overflowing their pages
+        CtgDatabase book;
+        book.setBuildLimits(2, 3, 1);
+        REQUIRE(book.openForWriting(splitName, 1000, 1, false));
+        book.book_make(db, breakFlag);
+    }
+    CHECK_GT(QFileInfo(splitName).size() / 4096 - 1, 2);
+
+    CtgDatabase plain;
+    REQUIRE(plain.open(plainName, false));
+    CtgDatabase split;
+    REQUIRE(split.open(splitName, false));
+    CHECK_EQ(split.positionCount(), plain.positionCount());
+
+    // Positions of all games are spread over the pages and runs
+    int probed = 0;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGame(gameId, game);
+        game.moveToStart();
+        do
+        {
+            QMap<Move, MoveData> plainMoves;
+            QMap<Move, MoveData> splitMoves;
+            unsigned int plainCount = plain.getMoveMapForBoard(game.board(), plainMoves);
+            unsigned int splitCount = split.getMoveMapForBoard(game.board(), splitMoves);
+            CHECK_EQ(splitCount, plainCount);
+            REQUIRE(splitMoves.keys() == plainMoves.keys());
+            for (auto it = plainMoves.constBegin(); it != plainMoves.constEnd(); ++it)
+            {
+                CHECK(splitMoves[it.key()].results == it.value().results);
+            }
+            probed += plainMoves.isEmpty() ? 0 : 1;
+        }
+        while (game.forward());
+    }
+    CHECK_GT(probed, 100);
+
+    AppSettings = nullptr;
+}
@@ -0,0 +1,85 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QDataStream>
+#include <QTemporaryFile>
+
+#include "ecoclassifier.h"
+#include "ecopositions.h"
+#include "pgndatabase.h"
+#include "tags.h"
+
+#include "settings.h"
+
+TEST_CASE("testing EcoClassifier agrees with a replay of the games")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    // Classify a few early positions of each game
+    QMap<quint64, QString> positions;
+    for (GameId i = 0; i < db.count(); ++i)
+    {
+        GameX game;
+        db.loadGameMoves(i, game);
+        BoardX board(game.cursor().initialBoard());
+        MoveId current = game.cursor().nextMove(ROOT_NODE);
+        for (int ply = 1; ply <= 6 && current != NO_MOVE; ++ply)
+        {
+            board.doMove(game.cursor().move(current));
+            if (ply % 3 == i % 3)
+            {
+                positions.insert(board.getHashValue(), QString("B%1%2 Test").arg(i % 10).arg(ply));
+            }
+            current = game.cursor().nextMove(current);
+        }
+    }
+
+    QTemporaryFile file;
+    REQUIRE(file.open());
+    {
+        QDataStream out(&file);
+        out << (quint32)COMPILED_ECO_FILE_ID << positions;
+    }
+    file.close();
+    REQUIRE(EcoPositions::loadEcoFile(file.fileName()));
+    EcoPositions::m_ecoReady = true;
+
+    EcoClassifier classifier(&db);
+    int n = classifier.classify(nullptr, false);
+
+    int classified = 0;
+    for (GameId i = 0; i < db.count(); ++i)
+    {
+        GameX game;
+        db.loadGameMoves(i, game);
+
+        // The last ECO position of the main line wins
+        QString expected;
+        BoardX board(game.cursor().initialBoard());
+        MoveId current = game.cursor().nextMove(ROOT_NODE);
+        while (current != NO_MOVE)
+        {
+            board.doMove(game.cursor().move(current));
+            expected = positions.value(board.getHashValue(), expected);
+            current = game.cursor().nextMove(current);
+        }
+
+        CHECK_EQ(game.ecoClassify(), expected);
+        if (!expected.isEmpty())
+        {
+            CHECK_EQ(db.index()->tagValue(TagNameECO, i), expected.left(3));
+            ++classified;
+        }
+    }
+    CHECK(classified > 0);
+    CHECK_EQ(n, classified);
+
+    EcoPositions::terminateEco();
+    EcoPositions::m_ecoReady = false;
+}
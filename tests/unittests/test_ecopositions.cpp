@@ -0,0 +1,43 @@
+#include "doctest.h"
+
+#include <QDataStream>
+#include <QTemporaryFile>
+
+#include "ecopositions.h"
+
+TEST_CASE("testing EcoPositions name lookup")
+{
+    QMap<quint64, QString> positions;
+    positions.insert(5, "B20 Sicilian");
+    positions.insert(3, "B22a Sicilian: Alapin");
+    positions.insert(7, "B22 Sicilian: Alapin Variation");
+    positions.insert(9, "C00 French");
+
+    QTemporaryFile file;
+    REQUIRE(file.open());
+    {
+        QDataStream out(&file);
+        out << (quint32)COMPILED_ECO_FILE_ID << positions;
+    }
+    file.close();
+    REQUIRE(EcoPositions::loadEcoFile(file.fileName()));
+
+    // Same results as a scan of the positions in key order
+    for (QString eco: { "", "B", "B2", "B20", "B22", "B22a", "B22b", "C00", "D00", "B22a Sic", "B20 X" })
+    {
+        QString expected;
+        for (const QString& actualEco: std::as_const(positions))
+        {
+            if (actualEco.startsWith(eco))
+            {
+                expected = actualEco.section(" ",1);
+                break;
+            }
+        }
+        CHECK_EQ(EcoPositions::findEcoNameDetailed(eco), expected);
+    }
+    CHECK_EQ(EcoPositions::findEcoName("B22"), QString("Sicilian"));
+    CHECK_EQ(EcoPositions::findEcoName("C"), QString("French"));
+
+    EcoPositions::terminateEco();
+}
@@ -0,0 +1,140 @@
+#include "doctest.h"
+
+#include <QStringList>
+#include <QVector>
+
+#include "gamecursor.h"
+
+namespace {
+
+MoveId addMoves(GameCursor& cursor, const QString& san, bool variation = false)
+{
+    MoveId first = NO_MOVE;
+    const QStringList moves = san.split(' ');
+    for (const QString& m: moves)
+    {
+        Move move = cursor.currentBoard()->parseMove(m);
+        REQUIRE(move.isLegal());
+        MoveId id = (first == NO_MOVE && variation) ? cursor.addVariation(move) : cursor.addMove(move);
+        if (first == NO_MOVE)
+        {
+            first = id;
+        }
+    }
+    return first;
+}
+
+BoardX replayed(const GameCursor& cursor, MoveId moveId)
+{
+    QVector<Move> moves;
+    for (MoveId node = moveId; node != ROOT_NODE; node = cursor.prevMove(node))
+    {
+        moves.prepend(cursor.move(node));
+    }
+    BoardX board(cursor.initialBoard());
+    for (const Move& m: std::as_const(moves))
+    {
+        board.doMove(m);
+    }
+    return board;
+}
+
+} // namespace
+
+TEST_CASE("testing GameCursor moves between lines")
+{
+    GameCursor cursor;
+    addMoves(cursor, "e4 e5 Nf3 Nc6 Bb5 a6 Ba4 Nf6 O-O Be7 Re1 b5 Bb3 d6 c3 O-O h3 Nb8 d4 Nbd7");
+
+    // Variations at several depths, one of them nested
+    REQUIRE(cursor.moveToId(3));
+    MoveId philidor = addMoves(cursor, "d6 d4 exd4 Nxd4 Nf6", true);
+    REQUIRE(cursor.moveToId(philidor + 1));
+    addMoves(cursor, "Nd7 Bc4 c6", true);
+    REQUIRE(cursor.moveToId(12));
+    addMoves(cursor, "Bxb5 axb5 d4", true);
+    REQUIRE(cursor.moveToId(9));
+    addMoves(cursor, "Nxe4 d4 b5 Bb3 d5 dxe5 Be6", true);
+
+    QVector<MoveId> nodes;
+    QVector<BoardX> boards;
+    for (MoveId id = 0; id < cursor.capacity(); ++id)
+    {
+        nodes.append(id);
+        boards.append(replayed(cursor, id));
+    }
+
+    // Jumps near and far, in and out of variations
+    for (int step: { 1, 5, 7, 11, 13 })
+    {
+        for (int i = 0; i < nodes.count(); ++i)
+        {
+            int n = (i * step) % nodes.count();
+            REQUIRE(cursor.moveToId(nodes[n]));
+            CHECK_EQ(cursor.currMove(), nodes[n]);
+            CHECK_EQ(cursor.currentBoard()->toFen(), boards[n].toFen());
+            CHECK_EQ(cursor.currentBoard()->getHashValue(), boards[n].getHashValue());
+        }
+    }
+
+    // The current node is removed with its variation
+    REQUIRE(cursor.moveToId(philidor + 3));
+    MoveId parent = cursor.parentMove();
+    REQUIRE(cursor.removeVariation(philidor));
+    CHECK_EQ(cursor.currMove(), parent);
+    CHECK_EQ(cursor.currentBoard()->toFen(), boards[parent].toFen());
+    REQUIRE(cursor.moveToId(cursor.capacity() - 1));
+    CHECK_EQ(cursor.currentBoard()->toFen(), boards[cursor.capacity() - 1].toFen());
+
+    QString moveList;
+    REQUIRE(cursor.moveToId(4, &moveList));
+    CHECK_EQ(moveList, QString("e2e4 e7e5 g1f3 b8c6 "));
+}
+
+TEST_CASE("testing GameCursor variation links")
+{
+    GameCursor cursor;
+    addMoves(cursor, "e4 e5 Nf3");
+    for (QString san: { "c5", "e6", "c6" })
+    {
+        REQUIRE(cursor.moveToId(1));
+        addMoves(cursor, san, true);
+    }
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 4, 5, 6 }));
+    CHECK_EQ(cursor.variationCount(1), 3);
+    CHECK_EQ(cursor.nextMove(1), 2);
+
+    REQUIRE(cursor.moveToId(5));
+    REQUIRE(cursor.moveVariationUp(5));
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 5, 4, 6 }));
+    REQUIRE(cursor.moveToId(4));
+    CHECK_FALSE(cursor.canMoveVariationDown(6));
+    REQUIRE(cursor.moveVariationDown(4));
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 5, 6, 4 }));
+
+    cursor.promoteVariation(6);
+    CHECK_EQ(cursor.nextMove(1), 6);
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 5, 2, 4 }));
+    CHECK(cursor.isMainline(6));
+    CHECK_FALSE(cursor.isMainline(3));
+
+    REQUIRE(cursor.removeVariation(2));
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 5, 4 }));
+
+    // Copies share the nodes until one of them changes
+    GameCursor copy(cursor);
+    CHECK(copy.isEqual(cursor));
+    QMap<MoveId, MoveId> renames = copy.compact();
+    CHECK_EQ(copy.capacity(), cursor.capacity() - 2);
+    CHECK_EQ(cursor.variations(1), QList<MoveId>({ 5, 4 }));
+    CHECK_EQ(copy.variations(1), QList<MoveId>({ renames[5], renames[4] }));
+    CHECK_EQ(copy.nextMove(1), renames[6]);
+    for (MoveId id: { 1, 4, 5, 6 })
+    {
+        CHECK(copy.move(renames[id]) == cursor.move(id));
+    }
+
+    cursor.removeVariations();
+    CHECK_EQ(cursor.variationCount(1), 0);
+    CHECK_EQ(copy.variationCount(1), 2);
+}
@@ -0,0 +1,79 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "gamestatistics.h"
+#include "pgndatabase.h"
+#include "result.h"
+#include "tags.h"
+
+#include "settings.h"
+
+TEST_CASE("testing GameStatistics agrees with a scan of the tags")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+    const IndexX* index = db.index();
+
+    GameStatistics statistics(&db);
+    GameStatistics::Query query;
+    query.groupTag = TagNameWhite;
+    query.ratingTag = TagNameWhiteElo;
+    query.eco = true;
+    const GameStatistics::Groups groups = statistics.aggregate(query);
+
+    QHash<QString, GameStatistics::Aggregate> expected;
+    for (GameId i = 0; i < db.count(); ++i)
+    {
+        GameStatistics::Aggregate& a = expected[index->tagValue(TagNameWhite, i)];
+        QString result = index->tagValue(TagNameResult, i);
+        a.count++;
+        a.result[ResultFromString(result)]++;
+        a.points += GameStatistics::points(result);
+        int elo = index->tagValue(TagNameWhiteElo, i).toInt();
+        if (elo)
+        {
+            a.minRating = qMin(elo, a.minRating);
+            a.maxRating = qMax(elo, a.maxRating);
+        }
+        PartialDate date(index->tagValue(TagNameDate, i));
+        if (date.year() > 1000)
+        {
+            a.minDate = qMin(date, a.minDate);
+            a.maxDate = qMax(date, a.maxDate);
+        }
+        a.eco[index->valueIndexFromTag(TagNameECO, i)].count++;
+    }
+
+    REQUIRE_EQ(groups.count(), expected.count());
+    for (auto it = groups.cbegin(); it != groups.cend(); ++it)
+    {
+        QString player = index->tagValueFromIndex(it.key());
+        REQUIRE(expected.contains(player));
+        const GameStatistics::Aggregate& a = expected[player];
+        CHECK_EQ(it.value().count, a.count);
+        for (int r = 0; r < 4; ++r)
+        {
+            CHECK_EQ(it.value().result[r], a.result[r]);
+        }
+        CHECK_EQ(it.value().points, a.points);
+        CHECK_EQ(it.value().minRating, a.minRating);
+        CHECK_EQ(it.value().maxRating, a.maxRating);
+        CHECK(it.value().minDate == a.minDate);
+        CHECK(it.value().maxDate == a.maxDate);
+        CHECK_EQ(it.value().eco.count(), a.eco.count());
+    }
+
+    // Filtering on a single value
+    QString player = index->tagValue(TagNameWhite, 0);
+    query.filterTag = TagNameWhite;
+    query.filterValue = index->getValueIndex(player);
+    query.groupTag.clear();
+    const GameStatistics::Groups filtered = statistics.aggregate(query);
+    REQUIRE_EQ(filtered.count(), 1);
+    CHECK_EQ(filtered.value(ValueNoIndex).count, expected[player].count);
+}
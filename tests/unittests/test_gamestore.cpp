@@ -0,0 +1,124 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "gamestore.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing GameStore restores the parsed games")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    GameStore store;
+    QVector<GameX> games;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        store.append(game);
+        games.append(game);
+    }
+    REQUIRE(store.count() == (int)db.count());
+    CHECK(store.size() > 0);
+
+    // Comments and NAGs of a replaced game
+    GameX annotated = games[0];
+    annotated.dbSetAnnotation(QString::fromUtf8("Kommentar \xc3\xa4\xc3\xb6\xc3\xbc"), 1);
+    annotated.dbSetAnnotation("Start", 1, GameX::BeforeMove);
+    annotated.dbAddNag(GoodMove, 1);
+    annotated.dbAddNag(WhiteHasADecisiveAdvantage, 1);
+    store.replace(0, annotated);
+    games[0] = annotated;
+
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        REQUIRE(store.load(gameId, game));
+        CHECK(game.isEqual(games[gameId]));
+        CHECK(game.startingBoard() == games[gameId].startingBoard());
+        CHECK(game.currentMove() == ROOT_NODE);
+    }
+    GameX game;
+    CHECK_FALSE(store.load(db.count(), game));
+}
+
+TEST_CASE("testing GameStore restores variations and set up positions")
+{
+    GameX endgame;
+    endgame.dbSetStartingBoard("4k3/8/8/8/8/8/4P3/4K3 w - - 0 40");
+    REQUIRE(endgame.addMove("e4") != NO_MOVE);
+    REQUIRE(endgame.addMove("Kd7") != NO_MOVE);
+    endgame.backward();
+    REQUIRE(endgame.addVariation("Kf7", "Opposition") != NO_MOVE);
+    endgame.moveToEnd();
+    REQUIRE(endgame.addMove(endgame.board().nullMove()) != NO_MOVE);
+    REQUIRE(endgame.addMove("Kc6") != NO_MOVE);
+    endgame.dbAddNag(WhiteIsInZugzwang);
+
+    GameX chess960;
+    chess960.dbSetStartingBoard("bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", true);
+    REQUIRE(chess960.addMove("a4") != NO_MOVE);
+
+    GameStore store;
+    store.append(endgame);
+    store.append(chess960);
+    REQUIRE(store.count() == 2);
+
+    GameX game;
+    REQUIRE(store.load(0, game));
+    CHECK(game.isEqual(endgame));
+    CHECK(game.startingBoard() == endgame.startingBoard());
+    CHECK_FALSE(game.startingBoard().chess960());
+
+    REQUIRE(store.load(1, game));
+    CHECK(game.isEqual(chess960));
+    CHECK(game.startingBoard() == chess960.startingBoard());
+    CHECK(game.startingBoard().chess960());
+}
+
+TEST_CASE("testing GameStore restores reordered variations")
+{
+    GameX game;
+    REQUIRE(game.addMove("e4") != NO_MOVE);
+    REQUIRE(game.addMove("e5") != NO_MOVE);
+    game.moveToStart();
+    MoveId d4 = game.addVariation("d4");
+    REQUIRE(d4 != NO_MOVE);
+    game.moveToStart();
+    MoveId c4 = game.addVariation("c4");
+    REQUIRE(c4 != NO_MOVE);
+
+    // The later variation comes first, its nodes are no longer in id order
+    GameX reordered = game;
+    reordered.moveToId(c4);
+    reordered.moveVariationUp(c4);
+    REQUIRE(reordered.cursor().variations(ROOT_NODE).first() == c4);
+
+    GameX promoted = game;
+    promoted.promoteVariation(d4);
+    REQUIRE(promoted.isMainline(d4));
+
+    GameStore store;
+    store.append(reordered);
+    store.append(promoted);
+
+    GameX restored;
+    REQUIRE(store.load(0, restored));
+    CHECK(restored.isEqual(reordered));
+    CHECK(restored.cursor().variations(ROOT_NODE).first() == c4);
+    REQUIRE(store.load(1, restored));
+    CHECK(restored.isEqual(promoted));
+    CHECK(restored.isMainline(d4));
+
+    // Replacing keeps the order as well
+    store.replace(0, promoted);
+    REQUIRE(store.load(0, restored));
+    CHECK(restored.isEqual(promoted));
+}
@@ -64,6 +64,122 @@ TEST_CASE("testing Index class")
 
 }
 
+TEST_CASE("testing Index with dense and sparse tag columns")
+{
+    IndexX index;
+
+    const int games = 2000;
+    for (int i = 0; i < games; ++i)
+    {
+        index.setTag(TagNameWhite, QString("Player %1").arg(i % 50), i);
+        index.setTag(TagNameResult, (i % 2) ? "1-0" : "0-1", i);
+        if (i % 500 == 0)
+        {
+            index.setTag("Annotator", "Rare", i);
+        }
+    }
+
+    CHECK_EQ(index.count(), games);
+    CHECK_EQ(index.tagValue(TagNameWhite, 1234), QString("Player 34"));
+    CHECK_EQ(index.tagValue(TagNameResult, 1234), QString("0-1"));
+    CHECK(index.hasTag("Annotator", 1000));
+    CHECK_FALSE(index.hasTag("Annotator", 1001));
+    CHECK_EQ(index.tagValue("Annotator", 1500), QString("Rare"));
+    CHECK_EQ(index.tagValue("Annotator", 1501), QString());
+    CHECK(index.isIndexItemEqual(0, 100));
+    CHECK_FALSE(index.isIndexItemEqual(0, 1));
+    CHECK_EQ(index.tagValues(TagNameWhite).count(), 50);
+
+    index.removeTag(TagNameResult, 7);
+    CHECK_FALSE(index.hasTag(TagNameResult, 7));
+    CHECK(index.hasTag(TagNameResult, 8));
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        index.write(out);
+    }
+    IndexX copy;
+    QDataStream in(data);
+    volatile bool breakFlag = false;
+    CHECK(copy.read(in, &breakFlag, VERSION_INDEX_CURRENT));
+    CHECK_EQ(copy.count(), games);
+    CHECK_EQ(copy.tagValue(TagNameWhite, 1999), QString("Player 49"));
+    CHECK_EQ(copy.tagValue("Annotator", 500), QString("Rare"));
+    CHECK_FALSE(copy.hasTag(TagNameResult, 7));
+}
+
+TEST_CASE("testing Index used in place from the mapped layout")
+{
+    IndexX index;
+
+    const int games = 2000;
+    for (int i = 0; i < games; ++i)
+    {
+        index.setTag(TagNameWhite, QString("Player %1").arg(i % 50), i);
+        index.setTag(TagNameResult, (i % 2) ? "1-0" : "0-1", i);
+        if (i % 500 == 0)
+        {
+            index.setTag("Annotator", "Rare", i);
+        }
+    }
+    index.setValidFlag(3, false);
+
+    QByteArray data;
+    index.writeMapped(data);
+
+    IndexX copy;
+    REQUIRE(copy.map(data.constData(), data.size()));
+    CHECK_EQ(copy.count(), games);
+    CHECK_EQ(copy.tagValue(TagNameWhite, 1234), QString("Player 34"));
+    CHECK_EQ(copy.tagValue(TagNameResult, 1234), QString("0-1"));
+    CHECK(copy.hasTag("Annotator", 1000));
+    CHECK_FALSE(copy.hasTag("Annotator", 1001));
+    CHECK_EQ(copy.tagValue("Annotator", 1500), QString("Rare"));
+    CHECK_FALSE(copy.isValidFlag(3));
+    CHECK(copy.isValidFlag(4));
+    CHECK(copy.isIndexItemEqual(0, 100));
+    CHECK_FALSE(copy.isIndexItemEqual(0, 1));
+    CHECK_EQ(copy.tagValues(TagNameWhite).count(), 50);
+    CHECK_EQ(copy.listPartialValue(TagNameWhite, "Player 7").count(true), 40);
+
+    // Changes copy the mapped data first
+    copy.setTag(TagNameWhite, "Someone else", 7);
+    CHECK_EQ(copy.tagValue(TagNameWhite, 7), QString("Someone else"));
+    CHECK_EQ(copy.tagValue(TagNameWhite, 8), QString("Player 8"));
+    CHECK_EQ(copy.tagValue("Annotator", 500), QString("Rare"));
+
+    IndexX truncated;
+    CHECK_FALSE(truncated.map(data.constData(), data.size() / 2));
+}
+
+TEST_CASE("testing Index tag searches")
+{
+    IndexX index;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        index.setTag(TagNameWhite, (i % 3) ? "Carlsen, Magnus" : "Anand, Viswanathan", i);
+        index.setTag(TagNameWhiteElo, QString::number(2700 + i), i);
+    }
+
+    QBitArray names = index.listPartialValue(TagNameWhite, "carlsen");
+    CHECK_EQ(names.count(true), 66);
+    CHECK_FALSE(names.testBit(0));
+    CHECK(names.testBit(1));
+
+    QBitArray set = index.listInSet(TagNameWhite, QSet<QString>() << "Anand" << "Kasparov");
+    CHECK_EQ(set.count(true), 34);
+
+    QBitArray elo = index.listInRange(TagNameWhiteElo, 2750, 2759);
+    CHECK_EQ(elo.count(true), 10);
+    CHECK(elo.testBit(50));
+    CHECK_FALSE(elo.testBit(60));
+
+    QBitArray range = index.listInRange(TagNameWhite, "A", "B");
+    CHECK_EQ(range.count(true), 34);
+}
+
 TEST_CASE("testing Index read from PGN database")
 {
     // required by PgnDatabase::open() to check if indexing is enabled
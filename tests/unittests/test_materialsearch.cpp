@@ -0,0 +1,104 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "materialindex.h"
+#include "materialsearch.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing MaterialSearch signatures")
+{
+    BoardX board;
+    board.setStandardPosition();
+    quint64 signature = board.materialSignature();
+    CHECK_EQ(BitBoard::materialCount(signature, White, Queen), 1);
+    CHECK_EQ(BitBoard::materialCount(signature, Black, Knight), 2);
+    CHECK_EQ(BitBoard::materialCount(signature, Black, Pawn), 8);
+
+    MaterialSearch search;
+    CHECK(search.matchesSignature(signature));
+    search.setRange(White, Pawn, 0, 7);
+    CHECK_FALSE(search.matchesSignature(signature));
+
+    REQUIRE(board.fromFen("8/8/4k3/8/8/2K5/1P6/1R5r w - - 0 1"));
+    signature = board.materialSignature();
+    CHECK(search.setMaterial(White, "RP"));
+    CHECK(search.setMaterial(Black, "R"));
+    CHECK(search.matchesSignature(signature));
+    CHECK_FALSE(search.setMaterial(Black, "R+"));
+
+    MaterialSearch reversed;
+    reversed.setMaterial(White, "R");
+    reversed.setMaterial(Black, "RP");
+    CHECK_FALSE(reversed.matchesSignature(signature));
+    reversed.setIgnoreColors(true);
+    CHECK(reversed.matchesSignature(signature));
+
+    // The material of a board as set up in the board search dialog
+    MaterialSearch fromBoard;
+    fromBoard.setMaterial(board);
+    CHECK(fromBoard.matchesSignature(signature));
+    REQUIRE(board.fromFen("8/8/4k3/8/8/2K5/1P6/1R5q w - - 0 1"));
+    CHECK_FALSE(fromBoard.matchesSignature(board.materialSignature()));
+}
+
+TEST_CASE("testing MaterialIndex agrees with replaying the games")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    MaterialIndex index;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        index.addGame(gameId, game);
+    }
+    REQUIRE_EQ(index.count(), int(db.count()));
+
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        QVector<quint64> signatures;
+        QVector<MoveId> moveIds;
+        MaterialIndex::collect(game, signatures, moveIds);
+
+        MaterialIndex::Range range = index.range(gameId);
+        REQUIRE_EQ(range.second - range.first, signatures.count());
+        for (int i = 0; i < signatures.count(); ++i)
+        {
+            CHECK_EQ(index.signatureAt(range.first + i), signatures[i]);
+            CHECK_EQ(index.moveIdAt(range.first + i), moveIds[i]);
+
+            game.moveToId(moveIds[i]);
+            CHECK_EQ(game.board().materialSignature(), signatures[i]);
+        }
+    }
+
+    // Without an index the search replays the game
+    MaterialSearch search(&db);
+    search.setRange(White, Queen, 0, 0);
+    search.setRange(Black, Queen, 0, 0);
+    volatile bool breakFlag = false;
+    search.Prepare(breakFlag);
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        int result = search.matches(gameId);
+        bool expected = false;
+        MaterialIndex::Range range = index.range(gameId);
+        for (int i = range.first; i < range.second && !expected; ++i)
+        {
+            expected = search.matchesSignature(index.signatureAt(i));
+        }
+        CHECK_EQ(result != 0, expected);
+    }
+
+    AppSettings = nullptr;
+}
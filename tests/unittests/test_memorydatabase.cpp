@@ -0,0 +1,162 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QTemporaryDir>
+
+#include "memorydatabase.h"
+#include "output.h"
+#include "tags.h"
+
+#include "settings.h"
+
+static bool openDatabase(MemoryDatabase& db, const QString& filename)
+{
+    Database& base = db;
+    return db.open(filename, false) && base.parseFile();
+}
+
+/** Cut the main line of @p game after a few moves, so it fits in its old text */
+static void shortenGame(GameX& game)
+{
+    game.moveToStart();
+    game.forward(6);
+    game.truncateVariation();
+}
+
+TEST_CASE("testing MemoryDatabase saves changes in place")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QString filename = dir.filePath("games.pgn");
+    REQUIRE(QFile::copy(RESOURCE_PATH "game10.pgn", filename));
+    qint64 size = QFileInfo(filename).size();
+
+    int count;
+    {
+        MemoryDatabase db;
+        REQUIRE(openDatabase(db, filename));
+        count = int(db.count());
+        REQUIRE(count >= 3);
+
+        GameX game;
+        REQUIRE(db.loadGame(0, game));
+        shortenGame(game);
+        game.setTag("Annotator", "Replaced");
+        REQUIRE(db.replace(0, game));
+        REQUIRE(db.remove(1));
+        REQUIRE(db.loadGame(2, game));
+        game.setTag("Annotator", "Appended");
+        REQUIRE(db.appendGame(game));
+
+        Output output(Output::Pgn);
+        REQUIRE(db.saveChanges(output));
+        CHECK_FALSE(db.isModified());
+
+        // A second save continues with the updated file
+        REQUIRE(db.loadGame(3, game));
+        shortenGame(game);
+        game.setTag("Annotator", "Again");
+        REQUIRE(db.replace(3, game));
+        REQUIRE(db.saveChanges(output));
+    }
+    CHECK_LT(QFileInfo(filename).size(), 2 * size);
+
+    MemoryDatabase db;
+    REQUIRE(openDatabase(db, filename));
+    REQUIRE_EQ(int(db.count()), count);
+    QStringList annotators;
+    for (GameId i = 0; i < db.count(); ++i)
+    {
+        GameX game;
+        REQUIRE(db.loadGame(i, game));
+        annotators.append(game.tag("Annotator"));
+    }
+    CHECK_EQ(annotators.count("Replaced"), 1);
+    CHECK_EQ(annotators.count("Appended"), 1);
+    CHECK_EQ(annotators.count("Again"), 1);
+}
+
+TEST_CASE("testing MemoryDatabase moves the following games if a changed game grows")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QString filename = dir.filePath("games.pgn");
+    REQUIRE(QFile::copy(RESOURCE_PATH "game10.pgn", filename));
+
+    QStringList events;
+    {
+        MemoryDatabase db;
+        REQUIRE(openDatabase(db, filename));
+        REQUIRE(db.count() >= 3);
+        for (GameId i = 0; i < db.count(); ++i)
+        {
+            events.append(db.tagValue(i, TagNameEvent) + db.tagValue(i, TagNameWhite));
+        }
+
+        GameX game;
+        REQUIRE(db.loadGame(1, game));
+        game.moveToEnd();
+        REQUIRE(game.setAnnotation(QString(1000, 'x')));
+        REQUIRE(db.replace(1, game));
+
+        Output output(Output::Pgn);
+        REQUIRE(db.saveChanges(output));
+        qint64 size = QFileInfo(filename).size();
+
+        // The game grows into the blank text left behind it
+        REQUIRE(db.loadGame(1, game));
+        game.moveToEnd();
+        REQUIRE(game.setAnnotation(QString(1100, 'x')));
+        REQUIRE(db.replace(1, game));
+        REQUIRE(db.saveChanges(output));
+        CHECK_EQ(QFileInfo(filename).size(), size);
+
+        // Tags changed in the index are saved game by game
+        QVector<GameId> games;
+        QString white = db.tagValue(2, TagNameWhite);
+        REQUIRE(db.index()->replaceTagValue(QStringList() << TagNameWhite << TagNameBlack, "Renamed", white, &games));
+        CHECK(games.contains(2));
+        db.setTagsModified(games);
+        CHECK(db.isModified());
+        REQUIRE(db.saveChanges(output));
+        for (GameId i = 0; i < db.count(); ++i)
+        {
+            events[i] = db.tagValue(i, TagNameEvent) + db.tagValue(i, TagNameWhite);
+        }
+
+        // Changes made behind its back still write the whole file
+        db.setModified(true);
+        CHECK_FALSE(db.saveChanges(output));
+        REQUIRE(output.output(filename, db));
+        db.fileWritten();
+
+        // The rewritten file is followed by the next save
+        REQUIRE(db.loadGame(2, game));
+        shortenGame(game);
+        REQUIRE(db.replace(2, game));
+        REQUIRE(db.saveChanges(output));
+    }
+
+    MemoryDatabase db;
+    REQUIRE(openDatabase(db, filename));
+    REQUIRE_EQ(int(db.count()), events.count());
+    for (GameId i = 0; i < db.count(); ++i)
+    {
+        CHECK_EQ(db.tagValue(i, TagNameEvent) + db.tagValue(i, TagNameWhite), events[i]);
+    }
+    GameX game;
+    REQUIRE(db.loadGame(1, game));
+    game.moveToEnd();
+    CHECK_EQ(game.annotation(), QString(1100, 'x'));
+    REQUIRE(db.loadGame(2, game));
+    CHECK_EQ(game.cursor().plyCount(), 6);
+    CHECK_EQ(game.tag(TagNameWhite), QString("Renamed"));
+}
@@ -0,0 +1,50 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "movecache.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing MoveCache restores the parsed move trees")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    MoveCache cache;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        CHECK(cache.append(game));
+    }
+    REQUIRE(cache.count() == (int)db.count());
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        cache.write(out);
+    }
+    MoveCache restored;
+    QDataStream in(data);
+    REQUIRE(restored.read(in, nullptr));
+    REQUIRE(restored.count() == cache.count());
+
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX parsed;
+        db.loadGameMoves(gameId, parsed);
+
+        GameX game;
+        game.dbSetStartingBoard(parsed.startingBoard().toFen(), parsed.startingBoard().chess960());
+        REQUIRE(restored.contains(gameId));
+        REQUIRE(restored.load(gameId, game));
+        CHECK(game.cursor().isEqual(parsed.cursor()));
+        CHECK(game.currentMove() == parsed.currentMove());
+    }
+}
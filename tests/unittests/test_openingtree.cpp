@@ -0,0 +1,107 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QDir>
+#include <QTemporaryDir>
+
+#include "filter.h"
+#include "openingtreethread.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+namespace {
+
+unsigned int treeGames(OpeningTreeThread& thread, FilterX& filter, const BoardX& board)
+{
+    unsigned int games = 0;
+    thread.updateFilter(filter, board, games, false, false, false);
+    thread.wait();
+    return games;
+}
+
+/** Step down the main line of the first game of @p db and compare the tree with a fresh search */
+void checkLine(PgnDatabase& db)
+{
+    FilterX filter(&db);
+
+    GameX game;
+    db.loadGameMoves(0, game);
+    game.moveToStart();
+    BoardX board(game.board());
+
+    OpeningTreeThread stepping;
+    CHECK_EQ(treeGames(stepping, filter, board), db.count());
+
+    QList<Move> line;
+    for (int ply = 0; ply < 14 && !game.atGameEnd(); ++ply)
+    {
+        game.forward();
+        board.doMove(game.move());
+        line.append(game.move());
+
+        // games following the main line of the first game
+        unsigned int expected = 0;
+        for (GameId gameId = 0; gameId < db.count(); ++gameId)
+        {
+            GameX other;
+            db.loadGameMoves(gameId, other);
+            const auto& cursor = other.cursor();
+            MoveId node = ROOT_NODE;
+            for (const Move& move: std::as_const(line))
+            {
+                node = cursor.nextMove(node);
+                if (node == NO_MOVE || !(cursor.move(node) == move))
+                {
+                    node = NO_MOVE;
+                    break;
+                }
+            }
+            expected += (node != NO_MOVE);
+        }
+
+        // a new thread searches all games, including transpositions
+        OpeningTreeThread scanning;
+        unsigned int found = treeGames(scanning, filter, board);
+        CHECK_GE(found, expected);
+
+        // the result must not depend on the positions searched before
+        CHECK_EQ(treeGames(stepping, filter, board), found);
+    }
+}
+
+}
+
+TEST_CASE("testing OpeningTreeThread follows a line without position index")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+    REQUIRE(db.positionIndex() == nullptr);
+    checkLine(db);
+
+    AppSettings = nullptr;
+}
+
+TEST_CASE("testing OpeningTreeThread follows a line with position index")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    REQUIRE(QDir(dir.path()).mkpath("index"));
+    AppSettings = new Settings(dir.filePath("chessx.ini"));
+    AppSettings->setValue("/General/DefaultDataPath", dir.path());
+    AppSettings->setValue("/General/useIndexFile", true);
+    AppSettings->setValue("/General/usePositionIndex", true);
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+    REQUIRE(db.positionIndex() != nullptr);
+    checkLine(db);
+
+    AppSettings = nullptr;
+}
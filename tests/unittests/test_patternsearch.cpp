@@ -0,0 +1,88 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "patternsearch.h"
+#include "pgndatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing PatternSearch on pawn structures")
+{
+    BoardX board;
+    // Queen's Gambit Declined, exchange variation
+    REQUIRE(board.fromFen("r1bqkb1r/pp1n1ppp/2p2n2/3p4/3P4/2NBPN2/PP3PPP/R2QK2R w KQkq - 0 8"));
+
+    PatternSearch carlsbad;
+    carlsbad.addPawnStructure(PatternSearch::Carlsbad);
+    CHECK(carlsbad.matchesBoard(board));
+    CHECK(carlsbad.matchesMaterial(board.materialSignature()));
+
+    PatternSearch iqp;
+    iqp.addPawnStructure(PatternSearch::IsolatedQueenPawnWhite);
+    CHECK_FALSE(iqp.matchesBoard(board));
+
+    REQUIRE(board.fromFen("r1bq1rk1/pp2bppp/2n2n2/3p4/3P4/2NB1N2/PP3PPP/R1BQ1RK1 w - - 0 10"));
+    CHECK(iqp.matchesBoard(board));
+    CHECK_FALSE(carlsbad.matchesBoard(board));
+
+    PatternSearch pieces;
+    pieces.require(White, Bishop, chessx::d3);
+    pieces.forbid(Black, Knight, chessx::f6);
+    CHECK_FALSE(pieces.matchesBoard(board));
+    PatternSearch empty;
+    CHECK(empty.matchesBoard(board));
+
+    // The pieces of a partial position as set up in the board search dialog
+    BoardX partial;
+    REQUIRE(partial.fromFen("6k1/8/8/3p4/3P4/3B4/8/6K1 w - - 0 1"));
+    PatternSearch partialSearch;
+    partialSearch.requirePieces(partial);
+    CHECK(partialSearch.matchesBoard(partial));
+    CHECK(partialSearch.matchesBoard(board));
+    CHECK(partialSearch.matchesMaterial(board.materialSignature()));
+    REQUIRE(board.fromFen("r1bqkb1r/pp1n1ppp/2p2n2/3p4/3P4/2NBPN2/PP3PPP/R2QK2R w KQkq - 0 8"));
+    CHECK_FALSE(partialSearch.matchesBoard(board));
+}
+
+TEST_CASE("testing PatternSearch agrees with testing every position")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    PatternSearch search(&db);
+    search.require(White, Pawn, chessx::e4);
+    search.require(White, Knight, chessx::f3);
+    search.forbidSquares(Black, Pawn, Q_UINT64_C(0x0101010101010101) << 4);
+    volatile bool breakFlag = false;
+    search.Prepare(breakFlag);
+
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        game.moveToStart();
+        int expected = 0;
+        while (true)
+        {
+            if (search.matchesBoard(game.board()))
+            {
+                CHECK(search.matchesMaterial(game.board().materialSignature()));
+                expected = game.currentMove() + 1;
+                break;
+            }
+            if (game.atGameEnd())
+            {
+                break;
+            }
+            game.forward();
+        }
+        CHECK_EQ(search.matches(gameId), expected);
+    }
+
+    AppSettings = nullptr;
+}
@@ -0,0 +1,108 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QFile>
+
+#include "pgndatabase.h"
+#include "pgnscanner.h"
+#include "settings.h"
+
+TEST_CASE("testing PgnScanner finds games and tags")
+{
+    const QByteArray pgn =
+        "junk before the first game\n"
+        "[Event \"First\"][Site \"Somewhere\"]\n"
+        "[White \"Doe,   John\"]\r\n"
+        "\n"
+        "1. e4 e5 (1... c5 2. Nf3) 2. Nf3 Nc6 3. Bb5 1-0\n"
+        "\n"
+        "\n"
+        "[Event \"Second\"]\n"
+        "\n"
+        "1. d4 d5 2. c4 *";
+
+    PgnScanner scanner(pgn.constData(), pgn.size(), false);
+    PgnScanner::GameHeader header;
+    qint64 pos = 0;
+
+    REQUIRE(scanner.nextGame(pos, pgn.size(), header));
+    CHECK(header.offset == pgn.indexOf("[Event"));
+    REQUIRE(header.tags.count() == 3);
+    CHECK(header.tags[0] == PgnScanner::Tag("Event", "First"));
+    CHECK(header.tags[1] == PgnScanner::Tag("Site", "Somewhere"));
+    CHECK(header.tags[2] == PgnScanner::Tag("White", "Doe, John"));
+    CHECK(scanner.lastMoveNumber(header) == 3);
+
+    REQUIRE(scanner.nextGame(pos, pgn.size(), header));
+    CHECK(header.offset == pgn.indexOf("[Event \"Second"));
+    REQUIRE(header.tags.count() == 1);
+    CHECK(header.tags[0] == PgnScanner::Tag("Event", "Second"));
+    CHECK(scanner.lastMoveNumber(header) == 2);
+
+    CHECK_FALSE(scanner.nextGame(pos, pgn.size(), header));
+}
+
+TEST_CASE("testing PgnScanner split into ranges")
+{
+    QByteArray pgn;
+    for (int i = 0; i < 20; ++i)
+    {
+        pgn += "[Event \"E" + QByteArray::number(i) + "\"]\n[Result \"*\"]\n\n";
+        pgn += "1. e4 e5\n[Event \"not a tag line\"]\n2. Nf3 *\n\n";
+    }
+
+    PgnScanner scanner(pgn.constData(), pgn.size(), false);
+    PgnScanner::Chunk whole;
+    scanner.scan(0, pgn.size(), whole, nullptr);
+    REQUIRE(whole.games.count() == 20);
+
+    // The Event line inside the move text does not follow a blank line
+    qint64 boundary = scanner.resyncPoint(pgn.size() / 2);
+    REQUIRE(boundary < pgn.size());
+    CHECK(pgn.mid(boundary, 6) == "[Event");
+    CHECK(pgn.at(boundary - 2) == '\n');
+
+    PgnScanner::Chunk first;
+    PgnScanner::Chunk second;
+    scanner.scan(0, boundary, first, nullptr);
+    scanner.scan(boundary, pgn.size(), second, nullptr);
+    CHECK(first.end == boundary);
+    REQUIRE(first.games.count() + second.games.count() == 20);
+    for (int i = 0; i < first.games.count(); ++i)
+    {
+        CHECK(first.games[i].offset == whole.games[i].offset);
+    }
+    for (int i = 0; i < second.games.count(); ++i)
+    {
+        CHECK(second.games[i].offset == whole.games[first.games.count() + i].offset);
+        CHECK(second.games[i].lastMoveNumber == 2);
+    }
+
+    CHECK(scanner.resyncPoint(pgn.size() - 1) == pgn.size());
+}
+
+TEST_CASE("testing mapped indexing agrees with the line based parser")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase mapped;
+    REQUIRE(mapped.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(mapped.parseFile());
+
+    QFile file(RESOURCE_PATH "game10.pgn");
+    REQUIRE(file.open(QIODevice::ReadOnly));
+    PgnDatabase buffered;
+    REQUIRE(buffered.openString(QString::fromLatin1(file.readAll())));
+
+    REQUIRE(mapped.count() == buffered.count());
+    for (GameId gameId = 0; gameId < mapped.count(); ++gameId)
+    {
+        const QStringList tags = mapped.index()->tagNames();
+        for (const QString& tag: tags)
+        {
+            CHECK(mapped.tagValue(gameId, tag) == buffered.tagValue(gameId, tag));
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QTemporaryDir>
+#include <QtEndian>
+
+#include "pgndatabase.h"
+#include "polyglotdatabase.h"
+
+#include "settings.h"
+
+TEST_CASE("testing PolyglotDatabase probes agree with a scan of the book")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QString filename = dir.filePath("book.bin");
+    {
+        PolyglotDatabase book;
+        REQUIRE(book.openForWriting(filename, 40, 1, false, 0, 0));
+        volatile bool breakFlag = false;
+        book.book_make(db, breakFlag);
+    }
+
+    QFile file(filename);
+    REQUIRE(file.open(QIODevice::ReadOnly));
+    QByteArray data = file.readAll();
+    REQUIRE(data.size() % 16 == 0);
+
+    PolyglotDatabase book;
+    REQUIRE(book.open(filename, false));
+    REQUIRE_EQ(book.positionCount(), quint64(data.size() / 16));
+
+    // Every key of the book and its neighbours
+    QMap<quint64, int> counts;
+    for (int i = 0; i < data.size(); i += 16)
+    {
+        counts[qFromBigEndian<quint64>(data.constData() + i)] += 1;
+    }
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it)
+    {
+        QVector<entry_t> entries;
+        CHECK_EQ(book.find_entries(it.key(), entries), it.value());
+        for (const entry_t& entry: std::as_const(entries))
+        {
+            CHECK_EQ(entry.key, it.key());
+        }
+        if (!counts.contains(it.key() + 1))
+        {
+            CHECK_EQ(book.find_entries(it.key() + 1, entries), 0);
+        }
+    }
+    QVector<entry_t> entries;
+    CHECK_EQ(book.find_entries(0, entries), counts.contains(0) ? counts[0] : 0);
+
+    BoardX board;
+    board.setStandardPosition();
+    QMap<Move, MoveData> moves;
+    unsigned int games = book.getMoveMapForBoard(board, moves);
+    CHECK_GT(games, 0u);
+    CHECK_EQ(moves.count(), book.find_entries(book.getHashFromBoard(board), entries));
+}
@@ -0,0 +1,56 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include "pgndatabase.h"
+#include "positionindex.h"
+
+#include "settings.h"
+
+TEST_CASE("testing PositionIndex agrees with replaying the games")
+{
+    // required by PgnDatabase::open() to check if indexing is enabled
+    // TODO: remove
+    AppSettings = new Settings;
+
+    PgnDatabase db;
+    REQUIRE(db.open(RESOURCE_PATH "game10.pgn", false));
+    REQUIRE(db.parseFile());
+
+    PositionIndex index;
+    for (GameId gameId = 0; gameId < db.count(); ++gameId)
+    {
+        GameX game;
+        db.loadGameMoves(gameId, game);
+        index.addGame(gameId, game);
+    }
+    index.finalize();
+    CHECK_FALSE(index.isEmpty());
+
+    GameX game;
+    db.loadGameMoves(0, game);
+    game.moveToStart();
+    BoardX board(game.board());
+    for (int ply = 0; ply < 10 && !game.atGameEnd(); ++ply)
+    {
+        PositionIndex::Range range = index.range(board.getHashValue());
+        for (GameId gameId = 0; gameId < db.count(); ++gameId)
+        {
+            GameX other;
+            db.loadGameMoves(gameId, other);
+            MoveId expected = other.cursor().findPosition(board);
+
+            PositionIndex::Hit hit;
+            bool found = index.lookup(range, gameId, hit);
+            CHECK_EQ(found, expected != NO_MOVE);
+            if (found)
+            {
+                CHECK_EQ(hit.moveId, expected);
+                CHECK_EQ(hit.atGameEnd(), other.cursor().atGameEnd(expected));
+            }
+        }
+        game.forward();
+        board.doMove(game.move());
+    }
+
+    AppSettings = nullptr;
+}
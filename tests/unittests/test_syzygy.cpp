@@ -0,0 +1,268 @@
+#include "doctest.h"
+#include "resourcepath.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include "bitfind.h"
+#include "board.h"
+#include "syzygy.h"
+
+namespace {
+
+/** Index of a KQvK position with the white king on @p wk, the queen on @p q and the black king on @p bk */
+inline int kqkIndex(int wk, int q, int bk, Color toMove)
+{
+    return ((wk * 64 + q) * 64 + bk) * 2 + (toMove == Black ? 1 : 0);
+}
+
+BoardX kqkBoard(int index)
+{
+    BoardX board;
+    board.clear();
+    board.setAt(chessx::Square(index >> 13), WhiteKing);
+    board.setAt(chessx::Square((index >> 7) & 63), WhiteQueen);
+    board.setAt(chessx::Square((index >> 1) & 63), BlackKing);
+    board.setToMove((index & 1) ? Black : White);
+    return board;
+}
+
+/** Plies to mate of all KQvK positions with the white queen, found by retrograde
+    analysis with the move generator. -1 for draws, -2 for illegal positions. */
+QVector<int> kqkDistances()
+{
+    const int count = 64 * 64 * 64 * 2;
+    const int draw = -1;
+    QVector<int> distances(count, -2);
+    // Successors of each position, draw if the queen is captured
+    QVector<int> begins(count + 1, 0);
+    QVector<int> successors;
+    for (int index = 0; index < count; ++index)
+    {
+        begins[index] = successors.count();
+        int wk = index >> 13;
+        int q = (index >> 7) & 63;
+        int bk = (index >> 1) & 63;
+        if (wk == q || wk == bk || q == bk)
+        {
+            continue;
+        }
+        BoardX board = kqkBoard(index);
+        Color toMove = board.toMove();
+        if (board.isAttackedBy(toMove, board.kingSquare(oppositeColor(toMove))))
+        {
+            continue;
+        }
+        distances[index] = draw;
+        Move::List moves = board.generateMoves();
+        for (const Move& m: std::as_const(moves))
+        {
+            BoardX next(board);
+            next.doMove(m);
+            if (next.isAttackedBy(next.toMove(), next.kingSquare(toMove)))
+            {
+                continue;
+            }
+            quint64 queens = next.pieces(White, Queen);
+            if (!queens)
+            {
+                successors.append(draw);
+                continue;
+            }
+            successors.append(kqkIndex(next.kingSquare(White), getFirstBitAndClear64<int>(queens),
+                                       next.kingSquare(Black), next.toMove()));
+        }
+        if (begins[index] == successors.count() && board.isCheck())
+        {
+            distances[index] = 0;
+        }
+    }
+    begins[count] = successors.count();
+
+    for (int plies = 1; ; ++plies)
+    {
+        QVector<int> found;
+        for (int index = 0; index < count; ++index)
+        {
+            if (distances[index] != draw || begins[index] == begins[index + 1])
+            {
+                continue;
+            }
+            bool white = !(index & 1);
+            // White needs one successor with Black mated, Black has to be mated after every move
+            bool mates = !white;
+            for (int i = begins[index]; i < begins[index + 1]; ++i)
+            {
+                int next = successors[i];
+                bool mated = (next >= 0 && distances[next] >= 0);
+                if (white ? mated : !mated)
+                {
+                    mates = white;
+                    break;
+                }
+            }
+            if (mates)
+            {
+                found.append(index);
+            }
+        }
+        if (found.isEmpty())
+        {
+            break;
+        }
+        for (int index: std::as_const(found))
+        {
+            distances[index] = plies;
+        }
+    }
+    return distances;
+}
+
+}
+
+TEST_CASE("testing Syzygy without usable tables")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    Syzygy::setPath(dir.path());
+    CHECK_EQ(Syzygy::maxPieces(), 0);
+
+    // Bare kings are a draw without any table
+    BoardX kings("8/8/4k3/8/8/3K4/8/8 w - - 0 1");
+    Syzygy::Wdl wdl = Syzygy::Loss;
+    REQUIRE(Syzygy::probeWdl(kings, wdl));
+    CHECK_EQ(wdl, Syzygy::Draw);
+
+    BoardX queen("8/8/4k3/8/8/3K4/8/7Q w - - 0 1");
+    CHECK_FALSE(Syzygy::canProbe(queen));
+    CHECK_FALSE(Syzygy::probeWdl(queen, wdl));
+
+    // A table which is not a Syzygy file is found, but fails to probe
+    QFile file(dir.filePath("KQvK.rtbw"));
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(80, '\0'));
+    file.close();
+    Syzygy::setPath(dir.path());
+    CHECK_EQ(Syzygy::maxPieces(), 3);
+    CHECK(Syzygy::canProbe(queen));
+    CHECK_FALSE(Syzygy::probeWdl(queen, wdl));
+    BoardX blackQueen("8/8/4k3/8/8/3K4/8/7q b - - 0 1");
+    CHECK(Syzygy::canProbe(blackQueen));
+
+    QList<Move> bestMoves;
+    int dtz;
+    CHECK_FALSE(Syzygy::probeRoot(queen, bestMoves, dtz));
+    CHECK(bestMoves.isEmpty());
+
+    Syzygy::setPath(QString());
+}
+
+TEST_CASE("testing Syzygy with the KQvK tables")
+{
+    // Generated by data/syzygy/generate.py
+    Syzygy::setPath(RESOURCE_PATH "syzygy");
+    REQUIRE_EQ(Syzygy::maxPieces(), 3);
+
+    Syzygy::Wdl wdl = Syzygy::Draw;
+    int dtz = 0;
+    QList<Move> bestMoves;
+
+    // White to move mates with Qh8
+    BoardX mate("k7/8/1K6/8/8/8/7Q/8 w - - 0 1");
+    REQUIRE(Syzygy::probeWdl(mate, wdl));
+    CHECK_EQ(wdl, Syzygy::Win);
+    REQUIRE(Syzygy::probeDtz(mate, dtz));
+    CHECK_EQ(dtz, 1);
+    REQUIRE(Syzygy::probeRoot(mate, bestMoves, dtz));
+    REQUIRE_EQ(bestMoves.count(), 1);
+    CHECK_EQ(bestMoves[0].from(), chessx::h2);
+    CHECK_EQ(bestMoves[0].to(), chessx::h8);
+    CHECK_EQ(dtz, 1);
+
+    // With Black to move it is stalemate
+    BoardX stalemate("k7/8/1K6/8/8/8/7Q/8 b - - 0 1");
+    REQUIRE(Syzygy::probeWdl(stalemate, wdl));
+    CHECK_EQ(wdl, Syzygy::Draw);
+    REQUIRE(Syzygy::probeDtz(stalemate, dtz));
+    CHECK_EQ(dtz, 0);
+
+    BoardX mated("k6Q/8/1K6/8/8/8/8/8 b - - 0 1");
+    REQUIRE(Syzygy::probeWdl(mated, wdl));
+    CHECK_EQ(wdl, Syzygy::Loss);
+    REQUIRE(Syzygy::probeDtz(mated, dtz));
+    CHECK_EQ(dtz, -1);
+
+    // The DTZ table only stores White to move, Black is mated after 18 plies
+    BoardX loss("8/8/8/4k3/8/8/8/K6Q b - - 0 1");
+    REQUIRE(Syzygy::probeWdl(loss, wdl));
+    CHECK_EQ(wdl, Syzygy::Loss);
+    REQUIRE(Syzygy::probeDtz(loss, dtz));
+    CHECK_EQ(dtz, -18);
+
+    // The same positions with Black as the stronger side
+    BoardX blackMates("8/7q/8/8/8/1k6/8/K7 b - - 0 1");
+    REQUIRE(Syzygy::probeWdl(blackMates, wdl));
+    CHECK_EQ(wdl, Syzygy::Win);
+    REQUIRE(Syzygy::probeDtz(blackMates, dtz));
+    CHECK_EQ(dtz, 1);
+    REQUIRE(Syzygy::probeRoot(blackMates, bestMoves, dtz));
+    REQUIRE_EQ(bestMoves.count(), 1);
+    CHECK_EQ(bestMoves[0].from(), chessx::h7);
+    CHECK_EQ(bestMoves[0].to(), chessx::h1);
+    CHECK_EQ(dtz, 1);
+
+    BoardX whiteLoses("k6q/8/8/8/4K3/8/8/8 w - - 0 1");
+    REQUIRE(Syzygy::probeWdl(whiteLoses, wdl));
+    CHECK_EQ(wdl, Syzygy::Loss);
+    REQUIRE(Syzygy::probeDtz(whiteLoses, dtz));
+    CHECK_EQ(dtz, -18);
+
+    Syzygy::setPath(QString());
+}
+
+TEST_CASE("testing Syzygy KQvK tables against a retrograde analysis")
+{
+    Syzygy::setPath(RESOURCE_PATH "syzygy");
+    REQUIRE_EQ(Syzygy::maxPieces(), 3);
+
+    QVector<int> distances = kqkDistances();
+    int longestWin = 0;
+    int longestLoss = 0;
+    int mismatches = 0;
+    for (int index = 0; index < distances.count(); ++index)
+    {
+        int plies = distances[index];
+        if (plies < -1)
+        {
+            continue;
+        }
+        BoardX board = kqkBoard(index);
+        bool white = (board.toMove() == White);
+        Syzygy::Wdl expected = (plies < 0) ? Syzygy::Draw : (white ? Syzygy::Win : Syzygy::Loss);
+        // A mated side has a DTZ of -1 like a side mated after its move
+        int expectedDtz = (plies < 0) ? 0 : (white ? plies : -std::max(plies, 1));
+        Syzygy::Wdl wdl = Syzygy::Draw;
+        int dtz = 0;
+        if (!Syzygy::probeWdl(board, wdl) || wdl != expected ||
+            !Syzygy::probeDtz(board, dtz) || dtz != expectedDtz)
+        {
+            ++mismatches;
+        }
+        if (white)
+        {
+            longestWin = std::max(longestWin, plies);
+        }
+        else
+        {
+            longestLoss = std::max(longestLoss, plies);
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+
+    // The queen mates in at most ten moves, known since the first endgame databases
+    CHECK_EQ(longestWin, 19);
+    CHECK_EQ(longestLoss, 20);
+
+    Syzygy::setPath(QString());
+}